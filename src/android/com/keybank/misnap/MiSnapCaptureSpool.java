@@ -0,0 +1,124 @@
+package com.keybank.misnap;
+
+import android.content.Context;
+import android.util.Log;
+
+import org.json.JSONArray;
+import org.json.JSONException;
+import org.json.JSONObject;
+
+import java.io.Closeable;
+import java.io.File;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.charset.Charset;
+
+/**
+ * The capture spool of src/common (MiSnapSpoolCore.h), with its calls serialized. Captures are
+ * stored with the same record layout as on iOS: the length of the results JSON, the JSON, then the JPEG.
+ */
+final class MiSnapCaptureSpool {
+
+    private static final String TAG = "MiSnap";
+    private static final Charset UTF8 = Charset.forName("UTF-8");
+
+    private static MiSnapCaptureSpool shared;
+
+    private long spool;
+
+    /**
+     * A stored capture. jpeg reads straight from the spool's memory mapping and must not be used
+     * after close.
+     */
+    static final class Capture implements Closeable {
+        final ByteBuffer jpeg;
+        final JSONObject results;
+        private long map;
+
+        private Capture(ByteBuffer jpeg, JSONObject results, long map) {
+            this.jpeg = jpeg;
+            this.results = results;
+            this.map = map;
+        }
+
+        @Override
+        public synchronized void close() {
+            if (map != 0) {
+                MiSnapNative.spoolReleaseMap(map);
+                map = 0;
+            }
+        }
+    }
+
+    //The spool in the no-backup files directory, or null if it cannot be opened
+    static synchronized MiSnapCaptureSpool sharedSpool(Context context) {
+        if (shared == null) {
+            File directory = new File(context.getNoBackupFilesDir(), "MiSnap");
+            directory.mkdirs();
+            try {
+                shared = new MiSnapCaptureSpool(new File(directory, "captures.spool").getPath());
+            } catch (IOException e) {
+                Log.e(TAG, "Cannot open capture spool: " + e.getMessage());
+            }
+        }
+        return shared;
+    }
+
+    MiSnapCaptureSpool(String path) throws IOException {
+        spool = MiSnapNative.spoolOpen(path);
+    }
+
+    //Stores a capture and returns its handle, or 0 on failure. jpeg must be a direct buffer; its
+    //bytes from position to limit are stored.
+    synchronized long appendJPEG(ByteBuffer jpeg, JSONObject results) {
+        byte[] json = results.toString().getBytes(UTF8);
+        ByteBuffer jsonBuffer = MiSnapNative.acquireBuffer(Math.max(json.length, 1));
+        try {
+            jsonBuffer.put(json);
+            return MiSnapNative.spoolAppend(spool, jsonBuffer, json.length, jpeg.slice(), jpeg.remaining());
+        } finally {
+            MiSnapNative.releaseBuffer(jsonBuffer);
+        }
+    }
+
+    //Returns null if there is no such capture
+    synchronized Capture readCapture(long handle) {
+        long[] map = new long[1];
+        ByteBuffer record = MiSnapNative.spoolRead(spool, handle, map);
+        if (record == null) {
+            return null;
+        }
+        record.order(ByteOrder.nativeOrder());
+        long jsonLength = record.capacity() >= 4 ? record.getInt(0) & 0xFFFFFFFFL : -1;
+        if (jsonLength < 0 || jsonLength > record.capacity() - 4) {
+            MiSnapNative.spoolReleaseMap(map[0]);
+            return null;
+        }
+        JSONObject results;
+        try {
+            byte[] json = new byte[(int)jsonLength];
+            record.position(4);
+            record.get(json);
+            results = new JSONObject(new String(json, UTF8));
+        } catch (JSONException e) {
+            results = new JSONObject();
+        }
+        record.position(4 + (int)jsonLength);
+        return new Capture(record.slice(), results, map[0]);
+    }
+
+    synchronized boolean deleteCapture(long handle) {
+        return MiSnapNative.spoolDelete(spool, handle);
+    }
+
+    //One { handle, bytes } object per stored capture, oldest first
+    synchronized JSONArray captures() throws JSONException {
+        long[] entries = MiSnapNative.spoolEntries(spool);
+        JSONArray captures = new JSONArray();
+        for (int i = 0; i + 1 < entries.length; i += 2) {
+            captures.put(new JSONObject().put("handle", entries[i]).put("bytes", entries[i + 1]));
+        }
+        return captures;
+    }
+}
@@ -0,0 +1,70 @@
+package com.keybank.misnap;
+
+import android.graphics.Bitmap;
+
+import java.nio.ByteBuffer;
+
+/**
+ * JNI bindings to the capture core in src/common, which the iOS plugin builds as well. Frames,
+ * scores and stored captures cross as direct ByteBuffers, so they are never copied into the Java heap.
+ */
+final class MiSnapNative {
+
+    static {
+        System.loadLibrary("misnapcore");
+    }
+
+    //Layout of a score buffer (MiSnapScoreRecord), in native byte order
+    static final int SCORE_BRIGHTNESS = 0;
+    static final int SCORE_SHARPNESS = 4;
+    static final int SCORE_ANGLE = 8;
+    static final int SCORE_QUAD_FOUND = 12;
+    static final int SCORE_QUAD_ANGLE = 16;
+    static final int SCORE_QUAD_PADDING = 20;
+    //Top left, top right, bottom right, bottom left as x, y float pairs
+    static final int SCORE_QUAD_CORNERS = 24;
+    static final int SCORE_BYTES = 56;
+
+    private MiSnapNative() {
+    }
+
+    //Scores an 8-bit luma plane, such as the Y plane of a YUV_420_888 camera image
+    static native void scoreLumaFrame(ByteBuffer luma, int width, int height, int rowStride, ByteBuffer score);
+
+    //Scores an ARGB_8888 bitmap without copying its pixels; false for other configurations
+    static native boolean scoreBitmap(Bitmap bitmap, ByteBuffer score);
+
+    //Thresholds as kMiSnapBrightness, kMiSnapMaxBrightness, kMiSnapSharpness and kMiSnapAngle; 0 ignores a check
+    static native boolean scorePasses(ByteBuffer score, int minBrightness, int maxBrightness, int sharpness, int angle);
+
+    //Indices into profileThresholds
+    static final int THRESHOLD_BRIGHTNESS = 0;
+    static final int THRESHOLD_MAX_BRIGHTNESS = 1;
+    static final int THRESHOLD_SHARPNESS = 2;
+    static final int THRESHOLD_ANGLE = 3;
+
+    //The documented thresholds of a document type such as "CheckFront", the same profiles as on
+    //iOS (MiSnapProfileCore.h); null for an unknown document type
+    static native int[] profileThresholds(String documentType);
+
+    //A direct buffer from the shared buffer pool, to be handed back to releaseBuffer
+    static native ByteBuffer acquireBuffer(int size);
+    static native void releaseBuffer(ByteBuffer buffer);
+    static native void setBufferPoolHighWater(long bytes);
+    static native void trimBufferPool();
+    //{ hits, misses, trimmed, inUseBytes, idleBytes, peakBytes, highWaterBytes }
+    static native long[] bufferPoolStatistics(boolean reset);
+
+    //Spool handles are not thread safe; see MiSnapCaptureSpool
+    static native long spoolOpen(String path) throws java.io.IOException;
+    static native void spoolClose(long spool);
+    static native long spoolAppend(long spool, ByteBuffer json, int jsonLength, ByteBuffer jpeg, int jpegLength);
+    //A direct buffer over the record in the spool's mapping, valid until map[0] is released
+    static native ByteBuffer spoolRead(long spool, long id, long[] map);
+    static native void spoolReleaseMap(long map);
+    static native boolean spoolDelete(long spool, long id);
+    //{ id, length } pairs in id order
+    static native long[] spoolEntries(long spool);
+    //{ offset, length } of the chunk of total bytes a readCaptureChunk request reads
+    static native long[] spoolChunkRange(long total, long offset, long length);
+}
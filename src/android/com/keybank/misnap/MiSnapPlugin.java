@@ -0,0 +1,395 @@
+package com.keybank.misnap;
+
+import android.app.Activity;
+import android.content.ComponentCallbacks2;
+import android.content.Intent;
+import android.content.res.Configuration;
+import android.graphics.Bitmap;
+import android.graphics.BitmapFactory;
+import android.util.Log;
+
+import com.miteksystems.misnap.misnapworkflow_UX2.MiSnapWorkflowActivity_UX2;
+import com.miteksystems.misnap.params.MiSnapApi;
+
+import org.apache.cordova.CallbackContext;
+import org.apache.cordova.CordovaPlugin;
+import org.apache.cordova.PluginResult;
+import org.json.JSONArray;
+import org.json.JSONException;
+import org.json.JSONObject;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.ArrayList;
+import java.util.Iterator;
+import java.util.List;
+
+/**
+ * Android side of the MiSnap plugin. Capture is done by the MiSnap Android SDK; scoring, the buffer
+ * pool and the capture spool are the native core shared with iOS (src/common), called through
+ * MiSnapNative.
+ */
+public class MiSnapPlugin extends CordovaPlugin {
+
+    private static final String TAG = "MiSnap";
+
+    private static final String RESULT_TYPE_TEXT = "text";
+    private static final String RESULT_TYPE_ARRAY_BUFFER = "arraybuffer";
+    private static final String RESULT_TYPE_HANDLE = "handle";
+
+    private static final int REQUEST_CAPTURE = 0x4D53;
+
+    private CallbackContext captureContext;
+    private JSONObject captureOptions;
+
+    private final ComponentCallbacks2 memoryCallbacks = new ComponentCallbacks2() {
+        @Override
+        public void onTrimMemory(int level) {
+            if (level >= TRIM_MEMORY_RUNNING_LOW) {
+                MiSnapNative.trimBufferPool();
+            }
+        }
+
+        @Override
+        public void onLowMemory() {
+            MiSnapNative.trimBufferPool();
+        }
+
+        @Override
+        public void onConfigurationChanged(Configuration configuration) {
+        }
+    };
+
+    @Override
+    protected void pluginInitialize() {
+        //<preference name="MiSnapBufferPoolBytes" value="..." /> sets the idle bytes the buffer pool keeps
+        String poolBytes = preferences.getString("MiSnapBufferPoolBytes", null);
+        if (poolBytes != null) {
+            try {
+                long bytes = Long.parseLong(poolBytes);
+                if (bytes >= 0) {
+                    MiSnapNative.setBufferPoolHighWater(bytes);
+                }
+            } catch (NumberFormatException e) {
+                Log.w(TAG, "Ignoring MiSnapBufferPoolBytes " + poolBytes);
+            }
+        }
+        cordova.getActivity().getApplicationContext().registerComponentCallbacks(memoryCallbacks);
+    }
+
+    @Override
+    public void onDestroy() {
+        cordova.getActivity().getApplicationContext().unregisterComponentCallbacks(memoryCallbacks);
+        super.onDestroy();
+    }
+
+    @Override
+    public boolean execute(String action, JSONArray args, CallbackContext callbackContext) throws JSONException {
+        if ("cordovaCallMiSnap".equals(action)) {
+            captureMiSnap(args.optJSONObject(0), callbackContext);
+        } else if ("getMetrics".equals(action)) {
+            getMetrics(args.optJSONObject(0), callbackContext);
+        } else if ("readCapture".equals(action)) {
+            readCapture(args.optLong(0), callbackContext);
+        } else if ("readCaptureChunk".equals(action)) {
+            readCaptureChunk(args.optLong(0), args.optLong(1, 0), args.optLong(2, 0), callbackContext);
+        } else if ("deleteCapture".equals(action)) {
+            deleteCapture(args.optLong(0), callbackContext);
+        } else if ("listCaptures".equals(action)) {
+            listCaptures(callbackContext);
+        } else if ("captureBatch".equals(action) || "prewarm".equals(action) || "replayFrames".equals(action)
+                   || "watchQuality".equals(action) || "clearQualityWatch".equals(action) || "benchmark".equals(action)) {
+            callbackContext.error(action + " is not available on Android");
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    //Options passed from the web layer, e.g. { resultType: "arraybuffer", parameters: { sharpness: 700 } }
+
+    private void captureMiSnap(JSONObject options, CallbackContext callbackContext) throws JSONException {
+        if (captureContext != null) {
+            callbackContext.error("A capture is already in progress");
+            return;
+        }
+        options = options != null ? options : new JSONObject();
+
+        //MiSnap Invocation with default parameters for check front unless another document type is requested
+        String documentType = options.optString("documentType", "CheckFront");
+        if (MiSnapNative.profileThresholds(documentType) == null) {
+            callbackContext.error("Unknown document type " + documentType);
+            return;
+        }
+        JSONObject jobSettings = new JSONObject();
+        jobSettings.put(MiSnapApi.MiSnapDocumentType, documentType);
+        JSONObject parameters = options.optJSONObject("parameters");
+        if (parameters != null) {
+            for (Iterator<String> keys = parameters.keys(); keys.hasNext(); ) {
+                String key = keys.next();
+                jobSettings.put(key, parameters.get(key));
+            }
+        }
+
+        captureContext = callbackContext;
+        captureOptions = options;
+        Intent intent = new Intent(cordova.getActivity(), MiSnapWorkflowActivity_UX2.class);
+        intent.putExtra(MiSnapApi.JOB_SETTINGS, jobSettings.toString());
+        cordova.startActivityForResult(this, intent, REQUEST_CAPTURE);
+    }
+
+    @Override
+    public void onActivityResult(int requestCode, int resultCode, Intent data) {
+        if (requestCode != REQUEST_CAPTURE || captureContext == null) {
+            return;
+        }
+        final CallbackContext callbackContext = captureContext;
+        final JSONObject options = captureOptions;
+        captureContext = null;
+        captureOptions = null;
+
+        final String resultType = options.optString("resultType", RESULT_TYPE_TEXT);
+        final JSONObject results = new JSONObject();
+        try {
+            if (data != null) {
+                results.put(MiSnapApi.RESULT_CODE, data.getStringExtra(MiSnapApi.RESULT_CODE));
+                results.putOpt(MiSnapApi.RESULT_MIBI_DATA, data.getStringExtra(MiSnapApi.RESULT_MIBI_DATA));
+            }
+        } catch (JSONException e) {
+            Log.w(TAG, "Cannot report MiSnap results: " + e.getMessage());
+        }
+        final byte[] image = data != null ? data.getByteArrayExtra(MiSnapApi.RESULT_PICTURE_DATA) : null;
+
+        if (resultCode != Activity.RESULT_OK || image == null) {
+            if (RESULT_TYPE_TEXT.equals(resultType)) {
+                callbackContext.sendPluginResult(new PluginResult(PluginResult.Status.NO_RESULT, "Cancelled"));
+            } else {
+                //Report cancellations with their results so the MIBI data can be forwarded to the server
+                callbackContext.error(results);
+            }
+            return;
+        }
+
+        cordova.getThreadPool().execute(new Runnable() {
+            @Override
+            public void run() {
+                deliverCapture(image, results, options, resultType, callbackContext);
+            }
+        });
+    }
+
+    //Runs on the thread pool: adds our own scoring of the image ("frameScore") to the results and
+    //sends the image as an ArrayBuffer, or stores it in the spool with resultType "handle"
+
+    private void deliverCapture(byte[] image, JSONObject results, JSONObject options, String resultType, CallbackContext callbackContext) {
+        try {
+            JSONObject frameScore = scoreImage(image, options.optString("documentType", "CheckFront"), options.optJSONObject("parameters"));
+            if (frameScore != null) {
+                results.put("frameScore", frameScore);
+            }
+            if (RESULT_TYPE_HANDLE.equals(resultType)) {
+                MiSnapCaptureSpool spool = MiSnapCaptureSpool.sharedSpool(cordova.getActivity());
+                ByteBuffer jpeg = MiSnapNative.acquireBuffer(Math.max(image.length, 1));
+                long handle;
+                try {
+                    jpeg.put(image);
+                    jpeg.flip();
+                    handle = spool != null ? spool.appendJPEG(jpeg, results) : 0;
+                } finally {
+                    MiSnapNative.releaseBuffer(jpeg);
+                }
+                if (handle != 0) {
+                    callbackContext.success(new JSONObject().put("handle", handle).put("bytes", image.length).put("results", results));
+                } else {
+                    callbackContext.error("Cannot store capture");
+                }
+            } else if (RESULT_TYPE_ARRAY_BUFFER.equals(resultType)) {
+                List<PluginResult> parts = new ArrayList<PluginResult>(2);
+                parts.add(new PluginResult(PluginResult.Status.OK, image));
+                parts.add(new PluginResult(PluginResult.Status.OK, results));
+                callbackContext.sendPluginResult(new PluginResult(PluginResult.Status.OK, parts));
+            } else {
+                callbackContext.success("Captured Image");
+            }
+        } catch (JSONException e) {
+            callbackContext.error(e.getMessage());
+        }
+    }
+
+    //{ brightness, sharpness, angle, quad, passes } for the captured JPEG, or null if it cannot be
+    //decoded. passes uses the document type's thresholds, as on iOS, with the overrides in parameters.
+
+    private JSONObject scoreImage(byte[] image, String documentType, JSONObject parameters) throws JSONException {
+        BitmapFactory.Options decode = new BitmapFactory.Options();
+        decode.inPreferredConfig = Bitmap.Config.ARGB_8888;
+        Bitmap bitmap = BitmapFactory.decodeByteArray(image, 0, image.length, decode);
+        if (bitmap == null) {
+            return null;
+        }
+        ByteBuffer score = MiSnapNative.acquireBuffer(MiSnapNative.SCORE_BYTES);
+        try {
+            if (!MiSnapNative.scoreBitmap(bitmap, score)) {
+                return null;
+            }
+            parameters = parameters != null ? parameters : new JSONObject();
+            int[] thresholds = MiSnapNative.profileThresholds(documentType);
+            boolean passes = MiSnapNative.scorePasses(score,
+                                                      parameters.optInt("brightness", thresholds[MiSnapNative.THRESHOLD_BRIGHTNESS]),
+                                                      parameters.optInt("maxBrightness", thresholds[MiSnapNative.THRESHOLD_MAX_BRIGHTNESS]),
+                                                      parameters.optInt("sharpness", thresholds[MiSnapNative.THRESHOLD_SHARPNESS]),
+                                                      parameters.optInt("angle", thresholds[MiSnapNative.THRESHOLD_ANGLE]));
+            return dictionaryFromScore(score).put("passes", passes);
+        } finally {
+            MiSnapNative.releaseBuffer(score);
+            bitmap.recycle();
+        }
+    }
+
+    //Scores as an object with brightness, sharpness, angle and quad keys, as on iOS
+
+    static JSONObject dictionaryFromScore(ByteBuffer score) throws JSONException {
+        score.order(ByteOrder.nativeOrder());
+        JSONObject quad = new JSONObject();
+        if (score.getInt(MiSnapNative.SCORE_QUAD_FOUND) != 0) {
+            JSONArray corners = new JSONArray();
+            for (int corner = 0; corner < 4; corner++) {
+                int offset = MiSnapNative.SCORE_QUAD_CORNERS + 8 * corner;
+                corners.put(new JSONArray().put(Math.round(score.getFloat(offset))).put(Math.round(score.getFloat(offset + 4))));
+            }
+            quad.put("found", true)
+                .put("corners", corners)
+                .put("angle", score.getInt(MiSnapNative.SCORE_QUAD_ANGLE))
+                .put("padding", score.getInt(MiSnapNative.SCORE_QUAD_PADDING));
+        } else {
+            quad.put("found", false);
+        }
+        return new JSONObject()
+            .put("brightness", score.getInt(MiSnapNative.SCORE_BRIGHTNESS))
+            .put("sharpness", score.getInt(MiSnapNative.SCORE_SHARPNESS))
+            .put("angle", score.getInt(MiSnapNative.SCORE_ANGLE))
+            .put("quad", quad);
+    }
+
+    //Buffer pool statistics since launch, or since the last call with reset: true. The latency
+    //metrics of the iOS plugin are not collected on Android.
+
+    private void getMetrics(JSONObject options, CallbackContext callbackContext) throws JSONException {
+        boolean reset = options != null && options.optBoolean("reset");
+        long[] statistics = MiSnapNative.bufferPoolStatistics(reset);
+        long acquisitions = statistics[0] + statistics[1];
+        JSONObject bufferPool = new JSONObject()
+            .put("hits", statistics[0])
+            .put("misses", statistics[1])
+            .put("trimmed", statistics[2])
+            .put("hitRate", acquisitions > 0 ? (double)statistics[0] / acquisitions : 0)
+            .put("inUseBytes", statistics[3])
+            .put("idleBytes", statistics[4])
+            .put("peakBytes", statistics[5])
+            .put("highWaterBytes", statistics[6]);
+        callbackContext.success(new JSONObject().put("bufferPool", bufferPool));
+    }
+
+    //Capture spool
+
+    private MiSnapCaptureSpool spoolOrError(CallbackContext callbackContext) {
+        MiSnapCaptureSpool spool = MiSnapCaptureSpool.sharedSpool(cordova.getActivity());
+        if (spool == null) {
+            callbackContext.error("Capture spool unavailable");
+        }
+        return spool;
+    }
+
+    //Returns a spooled capture as (ArrayBuffer, results) like resultType "arraybuffer". The bridge
+    //needs a byte array, so this is the one place the JPEG is copied out of the spool's mapping.
+
+    private void readCapture(final long handle, final CallbackContext callbackContext) {
+        cordova.getThreadPool().execute(new Runnable() {
+            @Override
+            public void run() {
+                MiSnapCaptureSpool spool = spoolOrError(callbackContext);
+                MiSnapCaptureSpool.Capture capture = spool != null ? spool.readCapture(handle) : null;
+                if (capture == null) {
+                    if (spool != null) {
+                        callbackContext.error("No such capture");
+                    }
+                    return;
+                }
+                byte[] jpeg = new byte[capture.jpeg.remaining()];
+                capture.jpeg.get(jpeg);
+                capture.close();
+                List<PluginResult> parts = new ArrayList<PluginResult>(2);
+                parts.add(new PluginResult(PluginResult.Status.OK, jpeg));
+                parts.add(new PluginResult(PluginResult.Status.OK, capture.results));
+                callbackContext.sendPluginResult(new PluginResult(PluginResult.Status.OK, parts));
+            }
+        });
+    }
+
+    //Returns length bytes of a spooled JPEG from offset as (ArrayBuffer, { offset, length, total }), so
+    //large images can cross the bridge in pieces. Past the end the ArrayBuffer is empty.
+
+    private void readCaptureChunk(final long handle, final long offset, final long length, final CallbackContext callbackContext) {
+        cordova.getThreadPool().execute(new Runnable() {
+            @Override
+            public void run() {
+                MiSnapCaptureSpool spool = spoolOrError(callbackContext);
+                MiSnapCaptureSpool.Capture capture = spool != null ? spool.readCapture(handle) : null;
+                if (capture == null) {
+                    if (spool != null) {
+                        callbackContext.error("No such capture");
+                    }
+                    return;
+                }
+                int total = capture.jpeg.remaining();
+                long[] range = MiSnapNative.spoolChunkRange(total, offset, length);
+                int start = (int)range[0];
+                byte[] chunk = new byte[(int)range[1]];
+                capture.jpeg.position(start);
+                capture.jpeg.get(chunk);
+                capture.close();
+                try {
+                    List<PluginResult> parts = new ArrayList<PluginResult>(2);
+                    parts.add(new PluginResult(PluginResult.Status.OK, chunk));
+                    parts.add(new PluginResult(PluginResult.Status.OK, new JSONObject().put("offset", start).put("length", chunk.length).put("total", total)));
+                    callbackContext.sendPluginResult(new PluginResult(PluginResult.Status.OK, parts));
+                } catch (JSONException e) {
+                    callbackContext.error(e.getMessage());
+                }
+            }
+        });
+    }
+
+    private void deleteCapture(final long handle, final CallbackContext callbackContext) {
+        cordova.getThreadPool().execute(new Runnable() {
+            @Override
+            public void run() {
+                MiSnapCaptureSpool spool = spoolOrError(callbackContext);
+                if (spool == null) {
+                    return;
+                }
+                if (spool.deleteCapture(handle)) {
+                    callbackContext.success();
+                } else {
+                    callbackContext.error("No such capture");
+                }
+            }
+        });
+    }
+
+    private void listCaptures(final CallbackContext callbackContext) {
+        cordova.getThreadPool().execute(new Runnable() {
+            @Override
+            public void run() {
+                MiSnapCaptureSpool spool = spoolOrError(callbackContext);
+                if (spool == null) {
+                    return;
+                }
+                try {
+                    callbackContext.success(spool.captures());
+                } catch (JSONException e) {
+                    callbackContext.error(e.getMessage());
+                }
+            }
+        });
+    }
+}
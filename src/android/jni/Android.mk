@@ -0,0 +1,17 @@
+LOCAL_PATH := $(call my-dir)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := misnapcore
+#The capture core is shared with iOS; plugin.xml copies src/common next to this file
+LOCAL_SRC_FILES := MiSnapNative.c \
+                   common/MiSnapBufferPoolCore.c \
+                   common/MiSnapQuadCore.c \
+                   common/MiSnapFrameScoreCore.c \
+                   common/MiSnapSpoolCore.c \
+                   common/MiSnapProfileCore.c
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/common
+LOCAL_CFLAGS := -std=gnu11 -O2 -Wall
+LOCAL_LDLIBS := -ljnigraphics
+
+include $(BUILD_SHARED_LIBRARY)
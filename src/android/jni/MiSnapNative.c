@@ -0,0 +1,306 @@
+
+#include <jni.h>
+#include <errno.h>
+#include <string.h>
+#include "MiSnapFrameScoreCore.h"
+#include "MiSnapProfileCore.h"
+#include "MiSnapBufferPoolCore.h"
+#include "MiSnapSpoolCore.h"
+
+#if defined(__ANDROID__)
+#include <android/bitmap.h>
+#endif
+
+//JNI side of com.keybank.misnap.MiSnapNative. Frames, scores and stored captures cross as direct
+//ByteBuffers, so pixels are read where the camera or the bitmap left them and spooled JPEGs are
+//read straight from the spool's memory mapping. Only the Android bitmap entry point needs the NDK;
+//everything else builds against any JDK's jni.h.
+
+//A score buffer, in native byte order; the offsets are mirrored by MiSnapNative.SCORE_*
+typedef struct {
+    int32_t brightness;
+    int32_t sharpness;
+    int32_t angle;
+    int32_t quadFound;
+    int32_t quadAngle;
+    int32_t quadPadding;
+    float corners[8];
+} MiSnapScoreRecord;
+
+_Static_assert(sizeof(MiSnapScoreRecord) == 56, "MiSnapNative.SCORE_BYTES");
+
+static void MiSnapThrow(JNIEnv *env, const char *className, const char *message)
+{
+    jclass exception = (*env)->FindClass(env, className);
+    if (exception != NULL) {
+        (*env)->ThrowNew(env, exception, message);
+    }
+}
+
+//Returns the address of a direct buffer holding at least length bytes, or NULL with an
+//IllegalArgumentException pending
+static uint8_t *MiSnapDirectBytes(JNIEnv *env, jobject buffer, jlong length)
+{
+    uint8_t *bytes = buffer ? (*env)->GetDirectBufferAddress(env, buffer) : NULL;
+    if (bytes == NULL) {
+        MiSnapThrow(env, "java/lang/IllegalArgumentException", "Not a direct buffer");
+        return NULL;
+    }
+    if ((*env)->GetDirectBufferCapacity(env, buffer) < length) {
+        MiSnapThrow(env, "java/lang/IllegalArgumentException", "Buffer too small");
+        return NULL;
+    }
+    return bytes;
+}
+
+static void MiSnapStoreScore(const MiSnapFrameScore *score, uint8_t *bytes)
+{
+    MiSnapScoreRecord record = {
+        score->brightness, score->sharpness, score->angle,
+        score->quad.found, score->quad.angle, score->quad.padding,
+        { 0 }
+    };
+    for (int corner = 0; corner < 4; corner++) {
+        record.corners[2 * corner] = score->quad.corners[corner].x;
+        record.corners[2 * corner + 1] = score->quad.corners[corner].y;
+    }
+    memcpy(bytes, &record, sizeof(record));
+}
+
+#pragma mark -
+#pragma mark Scoring
+
+JNIEXPORT void JNICALL Java_com_keybank_misnap_MiSnapNative_scoreLumaFrame(JNIEnv *env, jclass class, jobject luma, jint width, jint height, jint rowStride, jobject score)
+{
+    if (width < 0 || height < 0 || rowStride < width) {
+        MiSnapThrow(env, "java/lang/IllegalArgumentException", "Bad frame geometry");
+        return;
+    }
+    jlong lumaLength = height > 0 ? (jlong)rowStride * (height - 1) + width : 0;
+    const uint8_t *pixels = MiSnapDirectBytes(env, luma, lumaLength);
+    uint8_t *scoreBytes = pixels ? MiSnapDirectBytes(env, score, sizeof(MiSnapScoreRecord)) : NULL;
+    if (scoreBytes == NULL) {
+        return;
+    }
+    MiSnapFrameScore frameScore;
+    MiSnapScoreLumaFrame(pixels, (size_t)width, (size_t)height, (size_t)rowStride, &frameScore);
+    MiSnapStoreScore(&frameScore, scoreBytes);
+}
+
+#if defined(__ANDROID__)
+
+//Scores an ARGB_8888 bitmap in place; the luma plane comes from the buffer pool
+
+JNIEXPORT jboolean JNICALL Java_com_keybank_misnap_MiSnapNative_scoreBitmap(JNIEnv *env, jclass class, jobject bitmap, jobject score)
+{
+    uint8_t *scoreBytes = MiSnapDirectBytes(env, score, sizeof(MiSnapScoreRecord));
+    AndroidBitmapInfo info;
+    void *pixels;
+    if (scoreBytes == NULL || AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS || info.format != ANDROID_BITMAP_FORMAT_RGBA_8888) {
+        return JNI_FALSE;
+    }
+    size_t lumaRowBytes = (info.width + 63) & ~(size_t)63;
+    uint8_t *luma = MiSnapBufferAcquire(MiSnapSharedBufferPool(), lumaRowBytes * info.height);
+    if (luma == NULL || AndroidBitmap_lockPixels(env, bitmap, &pixels) != ANDROID_BITMAP_RESULT_SUCCESS) {
+        MiSnapBufferRelease(MiSnapSharedBufferPool(), luma);
+        return JNI_FALSE;
+    }
+    MiSnapExtractLumaRGBA(pixels, info.width, info.height, info.stride, luma, lumaRowBytes);
+    AndroidBitmap_unlockPixels(env, bitmap);
+
+    MiSnapFrameScore frameScore;
+    MiSnapScoreLumaFrame(luma, info.width, info.height, lumaRowBytes, &frameScore);
+    MiSnapBufferRelease(MiSnapSharedBufferPool(), luma);
+    MiSnapStoreScore(&frameScore, scoreBytes);
+    return JNI_TRUE;
+}
+
+#endif
+
+JNIEXPORT jboolean JNICALL Java_com_keybank_misnap_MiSnapNative_scorePasses(JNIEnv *env, jclass class, jobject score, jint minBrightness, jint maxBrightness, jint sharpness, jint angle)
+{
+    const uint8_t *scoreBytes = MiSnapDirectBytes(env, score, sizeof(MiSnapScoreRecord));
+    if (scoreBytes == NULL) {
+        return JNI_FALSE;
+    }
+    MiSnapScoreRecord record;
+    memcpy(&record, scoreBytes, sizeof(record));
+    MiSnapFrameScore frameScore = { record.brightness, record.sharpness, record.angle, { 0 } };
+    MiSnapFrameThresholds thresholds = { minBrightness, maxBrightness, sharpness, angle };
+    return MiSnapFrameScorePasses(&frameScore, &thresholds) ? JNI_TRUE : JNI_FALSE;
+}
+
+//The documented { minBrightness, maxBrightness, sharpness, angle } of a document type such as
+//"CheckFront", from the profiles iOS uses; null for an unknown document type
+
+JNIEXPORT jintArray JNICALL Java_com_keybank_misnap_MiSnapNative_profileThresholds(JNIEnv *env, jclass class, jstring documentType)
+{
+    const char *utf = documentType ? (*env)->GetStringUTFChars(env, documentType, NULL) : NULL;
+    if (utf == NULL) {
+        return NULL;
+    }
+    const MiSnapProfile *profile = MiSnapProfileNamed(utf);
+    (*env)->ReleaseStringUTFChars(env, documentType, utf);
+    if (profile == NULL) {
+        return NULL;
+    }
+    MiSnapFrameThresholds thresholds = MiSnapProfileThresholds(profile);
+    jint values[4] = { thresholds.minBrightness, thresholds.maxBrightness, thresholds.sharpness, thresholds.angle };
+    jintArray array = (*env)->NewIntArray(env, 4);
+    if (array != NULL) {
+        (*env)->SetIntArrayRegion(env, array, 0, 4, values);
+    }
+    return array;
+}
+
+#pragma mark -
+#pragma mark Buffer pool
+
+//A direct buffer over pooled memory; it must be handed back to releaseBuffer
+
+JNIEXPORT jobject JNICALL Java_com_keybank_misnap_MiSnapNative_acquireBuffer(JNIEnv *env, jclass class, jint size)
+{
+    void *bytes = size > 0 ? MiSnapBufferAcquire(MiSnapSharedBufferPool(), (size_t)size) : NULL;
+    if (bytes == NULL) {
+        MiSnapThrow(env, "java/lang/OutOfMemoryError", "MiSnap buffer pool");
+        return NULL;
+    }
+    jobject buffer = (*env)->NewDirectByteBuffer(env, bytes, size);
+    if (buffer == NULL) {
+        MiSnapBufferRelease(MiSnapSharedBufferPool(), bytes);
+    }
+    return buffer;
+}
+
+JNIEXPORT void JNICALL Java_com_keybank_misnap_MiSnapNative_releaseBuffer(JNIEnv *env, jclass class, jobject buffer)
+{
+    MiSnapBufferRelease(MiSnapSharedBufferPool(), buffer ? (*env)->GetDirectBufferAddress(env, buffer) : NULL);
+}
+
+JNIEXPORT void JNICALL Java_com_keybank_misnap_MiSnapNative_setBufferPoolHighWater(JNIEnv *env, jclass class, jlong bytes)
+{
+    MiSnapBufferPoolSetHighWater(MiSnapSharedBufferPool(), bytes > 0 ? (size_t)bytes : 0);
+}
+
+JNIEXPORT void JNICALL Java_com_keybank_misnap_MiSnapNative_trimBufferPool(JNIEnv *env, jclass class)
+{
+    MiSnapBufferPoolTrim(MiSnapSharedBufferPool());
+}
+
+//{ hits, misses, trimmed, inUseBytes, idleBytes, peakBytes, highWaterBytes }
+
+JNIEXPORT jlongArray JNICALL Java_com_keybank_misnap_MiSnapNative_bufferPoolStatistics(JNIEnv *env, jclass class, jboolean reset)
+{
+    MiSnapBufferPoolStatistics statistics;
+    MiSnapBufferPoolGetStatistics(MiSnapSharedBufferPool(), &statistics, reset);
+    jlong values[7] = {
+        (jlong)statistics.hits, (jlong)statistics.misses, (jlong)statistics.trimmed,
+        (jlong)statistics.inUseBytes, (jlong)statistics.idleBytes, (jlong)statistics.peakBytes,
+        (jlong)statistics.highWaterBytes
+    };
+    jlongArray array = (*env)->NewLongArray(env, 7);
+    if (array != NULL) {
+        (*env)->SetLongArrayRegion(env, array, 0, 7, values);
+    }
+    return array;
+}
+
+#pragma mark -
+#pragma mark Capture spool
+
+//The spool functions are not thread safe; MiSnapCaptureSpool serializes them
+
+JNIEXPORT jlong JNICALL Java_com_keybank_misnap_MiSnapNative_spoolOpen(JNIEnv *env, jclass class, jstring path)
+{
+    const char *utf = (*env)->GetStringUTFChars(env, path, NULL);
+    if (utf == NULL) {
+        return 0;
+    }
+    MiSnapSpool *spool = MiSnapSpoolOpen(utf);
+    int error = errno;
+    (*env)->ReleaseStringUTFChars(env, path, utf);
+    if (spool == NULL) {
+        MiSnapThrow(env, "java/io/IOException", strerror(error));
+    }
+    return (jlong)(intptr_t)spool;
+}
+
+JNIEXPORT void JNICALL Java_com_keybank_misnap_MiSnapNative_spoolClose(JNIEnv *env, jclass class, jlong spool)
+{
+    MiSnapSpoolClose((MiSnapSpool *)(intptr_t)spool);
+}
+
+//A capture record is the length of the results JSON (uint32), the JSON, then the JPEG, as on iOS
+
+JNIEXPORT jlong JNICALL Java_com_keybank_misnap_MiSnapNative_spoolAppend(JNIEnv *env, jclass class, jlong spool, jobject json, jint jsonLength, jobject jpeg, jint jpegLength)
+{
+    if (jsonLength < 0 || jpegLength < 0) {
+        MiSnapThrow(env, "java/lang/IllegalArgumentException", "Negative length");
+        return 0;
+    }
+    const uint8_t *jsonBytes = MiSnapDirectBytes(env, json, jsonLength);
+    const uint8_t *jpegBytes = jsonBytes ? MiSnapDirectBytes(env, jpeg, jpegLength) : NULL;
+    if (jpegBytes == NULL) {
+        return 0;
+    }
+    uint32_t length = (uint32_t)jsonLength;
+    const void *parts[3] = { &length, jsonBytes, jpegBytes };
+    size_t lengths[3] = { sizeof(length), (size_t)jsonLength, (size_t)jpegLength };
+    return (jlong)MiSnapSpoolAppend((MiSnapSpool *)(intptr_t)spool, parts, lengths, 3);
+}
+
+//Returns a read-only direct buffer over the record in the spool's mapping, or null, and stores the
+//map to release in map[0]. The buffer must not be used after spoolReleaseMap.
+
+JNIEXPORT jobject JNICALL Java_com_keybank_misnap_MiSnapNative_spoolRead(JNIEnv *env, jclass class, jlong spool, jlong id, jlongArray map)
+{
+    size_t length;
+    MiSnapSpoolMap *recordMap;
+    const uint8_t *bytes = MiSnapSpoolRead((MiSnapSpool *)(intptr_t)spool, (uint64_t)id, &length, &recordMap);
+    if (bytes == NULL) {
+        return NULL;
+    }
+    jobject buffer = (*env)->NewDirectByteBuffer(env, (void *)bytes, (jlong)length);
+    if (buffer == NULL) {
+        MiSnapSpoolMapRelease(recordMap);
+        return NULL;
+    }
+    jlong mapHandle = (jlong)(intptr_t)recordMap;
+    (*env)->SetLongArrayRegion(env, map, 0, 1, &mapHandle);
+    return buffer;
+}
+
+JNIEXPORT void JNICALL Java_com_keybank_misnap_MiSnapNative_spoolReleaseMap(JNIEnv *env, jclass class, jlong map)
+{
+    MiSnapSpoolMapRelease((MiSnapSpoolMap *)(intptr_t)map);
+}
+
+JNIEXPORT jboolean JNICALL Java_com_keybank_misnap_MiSnapNative_spoolDelete(JNIEnv *env, jclass class, jlong spool, jlong id)
+{
+    return MiSnapSpoolDelete((MiSnapSpool *)(intptr_t)spool, (uint64_t)id) ? JNI_TRUE : JNI_FALSE;
+}
+
+//Live records as { id, length } pairs in id order
+
+JNIEXPORT jlongArray JNICALL Java_com_keybank_misnap_MiSnapNative_spoolEntries(JNIEnv *env, jclass class, jlong spool)
+{
+    size_t count;
+    const MiSnapSpoolEntry *entries = MiSnapSpoolEntries((MiSnapSpool *)(intptr_t)spool, &count);
+    jlongArray array = (*env)->NewLongArray(env, (jsize)(2 * count));
+    for (size_t i = 0; array != NULL && i < count; i++) {
+        jlong pair[2] = { (jlong)entries[i].id, (jlong)entries[i].length };
+        (*env)->SetLongArrayRegion(env, array, (jsize)(2 * i), 2, pair);
+    }
+    return array;
+}
+
+JNIEXPORT jlongArray JNICALL Java_com_keybank_misnap_MiSnapNative_spoolChunkRange(JNIEnv *env, jclass class, jlong total, jlong offset, jlong length)
+{
+    MiSnapSpoolChunk chunk = MiSnapSpoolChunkRange((size_t)MAX(total, 0), offset, length);
+    jlongArray array = (*env)->NewLongArray(env, 2);
+    if (array != NULL) {
+        jlong range[2] = { (jlong)chunk.offset, (jlong)chunk.length };
+        (*env)->SetLongArrayRegion(env, array, 0, 2, range);
+    }
+    return array;
+}
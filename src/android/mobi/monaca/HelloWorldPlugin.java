@@ -1,17 +0,0 @@
-package mobi.monaca;
-
-import org.apache.cordova.CallbackContext;
-import org.apache.cordova.CordovaPlugin;
-import org.json.JSONArray;
-import org.json.JSONException;
-
-/**
- * This class echoes a string called from JavaScript.
- */
-public class HelloWorldPlugin extends CordovaPlugin {
-    @Override
-    public boolean execute(String action, JSONArray args, CallbackContext callbackContext) throws JSONException {
-        callbackContext.success("Hello World!");
-        return true;
-    }    
-}
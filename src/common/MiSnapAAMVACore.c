@@ -0,0 +1,185 @@
+
+#include "MiSnapAAMVACore.h"
+#include <stdio.h>
+#include <string.h>
+
+#define kMiSnapAAMVADataSeparator '\n'
+#define kMiSnapAAMVARecordSeparator 0x1E
+#define kMiSnapAAMVASegmentTerminator '\r'
+#define kMiSnapAAMVADesignatorLength 10
+
+typedef struct {
+    char code[4];
+    MiSnapAAMVAField field;
+} MiSnapAAMVAElement;
+
+//Current element ids first: a field keeps the first id that sets it
+static const MiSnapAAMVAElement kMiSnapAAMVAElements[] = {
+    { "DCS", MiSnapAAMVAFieldFamilyName },
+    { "DAC", MiSnapAAMVAFieldFirstName },
+    { "DAD", MiSnapAAMVAFieldMiddleName },
+    { "DBB", MiSnapAAMVAFieldDateOfBirth },
+    { "DAQ", MiSnapAAMVAFieldLicenseNumber },
+    { "DAG", MiSnapAAMVAFieldStreet },
+    { "DAH", MiSnapAAMVAFieldStreet2 },
+    { "DAI", MiSnapAAMVAFieldCity },
+    { "DAJ", MiSnapAAMVAFieldState },
+    { "DAK", MiSnapAAMVAFieldPostalCode },
+    { "DBA", MiSnapAAMVAFieldExpiry },
+    { "DBD", MiSnapAAMVAFieldIssueDate },
+    { "DBC", MiSnapAAMVAFieldSex },
+    { "DCG", MiSnapAAMVAFieldCountry },
+    { "DAB", MiSnapAAMVAFieldFamilyName },
+    { "DCT", MiSnapAAMVAFieldFirstName },
+    { "DAA", MiSnapAAMVAFieldFullName },
+};
+
+static bool MiSnapParseDigits(const char *bytes, size_t count, int *value)
+{
+    int result = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (bytes[i] < '0' || bytes[i] > '9') {
+            return false;
+        }
+        result = result * 10 + (bytes[i] - '0');
+    }
+    *value = result;
+    return true;
+}
+
+static const char *MiSnapFind(const char *bytes, size_t length, const char *needle, size_t needleLength)
+{
+    for (size_t i = 0; i + needleLength <= length; i++) {
+        if (memcmp(bytes + i, needle, needleLength) == 0) {
+            return bytes + i;
+        }
+    }
+    return NULL;
+}
+
+static inline bool MiSnapIsSeparator(char c)
+{
+    return c == kMiSnapAAMVADataSeparator || c == kMiSnapAAMVARecordSeparator || c == kMiSnapAAMVASegmentTerminator;
+}
+
+//Elements of a subfile: a three letter id and its value, up to the next separator
+static void MiSnapAAMVAParseSubfile(const char *bytes, size_t length, MiSnapAAMVARecord *record)
+{
+    size_t position = 0;
+    while (position < length) {
+        size_t end = position;
+        while (end < length && !MiSnapIsSeparator(bytes[end])) {
+            end++;
+        }
+        if (end - position >= 3) {
+            for (size_t i = 0; i < sizeof(kMiSnapAAMVAElements) / sizeof(kMiSnapAAMVAElements[0]); i++) {
+                const MiSnapAAMVAElement *element = &kMiSnapAAMVAElements[i];
+                if (memcmp(bytes + position, element->code, 3) == 0) {
+                    MiSnapSlice *slice = &record->fields[element->field];
+                    if (slice->length == 0) {
+                        size_t valueEnd = end;
+                        while (valueEnd > position + 3 && bytes[valueEnd - 1] == ' ') {
+                            valueEnd--;
+                        }
+                        slice->bytes = bytes + position + 3;
+                        slice->length = valueEnd - position - 3;
+                    }
+                    break;
+                }
+            }
+        }
+        if (end < length && bytes[end] == kMiSnapAAMVASegmentTerminator) {
+            break;
+        }
+        position = end + 1;
+    }
+}
+
+bool MiSnapAAMVAParse(const char *payload, size_t length, MiSnapAAMVARecord *record)
+{
+    memset(record, 0, sizeof(*record));
+
+    //Header: "@" LF RS CR, then "ANSI " (or "AAMVA"), issuer, versions, entry count and the
+    //subfile designators. Some readers drop or mangle the separators, so the file type is searched for.
+    const char *fileType = MiSnapFind(payload, MIN(length, (size_t)32), "ANSI ", 5);
+    if (fileType == NULL) {
+        fileType = MiSnapFind(payload, MIN(length, (size_t)32), "AAMVA", 5);
+    }
+    const char *cursor = payload;
+    size_t entries = 0;
+    if (fileType != NULL) {
+        const char *header = fileType + 5;
+        size_t available = (size_t)(payload + length - header);
+        int version = 0, count = 0;
+        if (available >= 10 && MiSnapParseDigits(header + 6, 2, &version)) {
+            record->issuer = (MiSnapSlice){ header, 6 };
+            record->version = version;
+            //Version 1 has no jurisdiction version
+            size_t countOffset = version >= 2 ? 10 : 8;
+            if (available >= countOffset + 2 && MiSnapParseDigits(header + countOffset, 2, &count)) {
+                entries = (size_t)count;
+                cursor = header + countOffset + 2;
+            }
+        }
+    }
+
+    //Prefer a DL or ID subfile located by its designator
+    for (size_t i = 0; i < entries; i++) {
+        const char *designator = cursor + i * kMiSnapAAMVADesignatorLength;
+        if ((size_t)(payload + length - designator) < kMiSnapAAMVADesignatorLength) {
+            break;
+        }
+        int offset, subfileLength;
+        if ((memcmp(designator, "DL", 2) != 0 && memcmp(designator, "ID", 2) != 0)
+            || !MiSnapParseDigits(designator + 2, 4, &offset) || !MiSnapParseDigits(designator + 6, 4, &subfileLength)) {
+            continue;
+        }
+        //A subfile holds at least its two letter type; anything shorter, or cut off by the end of
+        //the payload, is a corrupt designator
+        size_t end = MIN((size_t)offset + (size_t)subfileLength, length);
+        if (subfileLength >= 2 && end >= (size_t)offset + 2 && memcmp(payload + offset, designator, 2) == 0) {
+            record->subfileType = (MiSnapSlice){ payload + offset, 2 };
+            MiSnapAAMVAParseSubfile(payload + offset + 2, end - offset - 2, record);
+            return true;
+        }
+    }
+
+    //Offsets and entry counts are often wrong in practice: fall back to the first subfile, which
+    //starts with its type followed directly by an element id (a designator is followed by digits)
+    size_t remaining = (size_t)(payload + length - cursor);
+    for (size_t i = 0; i + 5 <= remaining; i++) {
+        const char *subfile = cursor + i;
+        if ((memcmp(subfile, "DL", 2) == 0 || memcmp(subfile, "ID", 2) == 0) && subfile[2] == 'D' && subfile[3] >= 'A' && subfile[3] <= 'Z') {
+            record->subfileType = (MiSnapSlice){ subfile, 2 };
+            MiSnapAAMVAParseSubfile(subfile + 2, remaining - i - 2, record);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MiSnapAAMVAFormatDate(const MiSnapAAMVARecord *record, MiSnapAAMVAField field, char iso[11])
+{
+    const MiSnapSlice *date = &record->fields[field];
+    int first, second, third;
+    if (date->length != 8 || !MiSnapParseDigits(date->bytes, 4, &first) || !MiSnapParseDigits(date->bytes + 4, 2, &second) || !MiSnapParseDigits(date->bytes + 6, 2, &third)) {
+        return false;
+    }
+    const MiSnapSlice *country = &record->fields[MiSnapAAMVAFieldCountry];
+    bool canadian = country->length == 3 && memcmp(country->bytes, "CAN", 3) == 0;
+    int year, month, day;
+    if (canadian || first > 1231) {
+        year = first;
+        month = second;
+        day = third;
+    } else {
+        month = first / 100;
+        day = first % 100;
+        year = second * 100 + third;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31) {
+        return false;
+    }
+    snprintf(iso, 11, "%04d-%02d-%02d", year, month, day);
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef MiSnapAAMVACore_h
+#define MiSnapAAMVACore_h
+
+#include "MiSnapCore.h"
+
+//Parser for the AAMVA driver's license / ID card data carried in the PDF417 barcode
+//(kMiSnapPDF417Data). Fields are returned as slices of the payload: nothing is copied or
+//allocated until a dictionary is built for the web layer.
+
+typedef struct {
+    const char *bytes;
+    size_t length;
+} MiSnapSlice;
+
+typedef enum {
+    MiSnapAAMVAFieldFamilyName,         //DCS (DAB before version 2)
+    MiSnapAAMVAFieldFirstName,          //DAC (DCT before version 4)
+    MiSnapAAMVAFieldMiddleName,         //DAD
+    MiSnapAAMVAFieldFullName,           //DAA, version 1 only: "FAMILY,FIRST,MIDDLE"
+    MiSnapAAMVAFieldDateOfBirth,        //DBB
+    MiSnapAAMVAFieldLicenseNumber,      //DAQ
+    MiSnapAAMVAFieldStreet,             //DAG
+    MiSnapAAMVAFieldStreet2,            //DAH
+    MiSnapAAMVAFieldCity,               //DAI
+    MiSnapAAMVAFieldState,              //DAJ
+    MiSnapAAMVAFieldPostalCode,         //DAK
+    MiSnapAAMVAFieldExpiry,             //DBA
+    MiSnapAAMVAFieldIssueDate,          //DBD
+    MiSnapAAMVAFieldSex,                //DBC
+    MiSnapAAMVAFieldCountry,            //DCG
+    MiSnapAAMVAFieldCount
+} MiSnapAAMVAField;
+
+typedef struct {
+    int version;                        //AAMVA version, 0 when the header is missing
+    MiSnapSlice issuer;                 //six digit issuer identification number
+    MiSnapSlice subfileType;            //"DL" or "ID"
+    MiSnapSlice fields[MiSnapAAMVAFieldCount];
+} MiSnapAAMVARecord;
+
+//Returns false when no DL or ID subfile is found. Absent fields have length 0. Never reads
+//outside payload[0, length).
+bool MiSnapAAMVAParse(const char *payload, size_t length, MiSnapAAMVARecord *record);
+
+//Writes a date field as YYYY-MM-DD (US cards use MMDDCCYY, Canadian ones CCYYMMDD). Returns false
+//if the field is not a date.
+bool MiSnapAAMVAFormatDate(const MiSnapAAMVARecord *record, MiSnapAAMVAField field, char iso[11]);
+
+#endif
@@ -0,0 +1,191 @@
+
+#include "MiSnapBase64Core.h"
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+static const char kEncodeTable[64] = {
+    'A','B','C','D','E','F','G','H','I','J','K','L','M','N','O','P',
+    'Q','R','S','T','U','V','W','X','Y','Z','a','b','c','d','e','f',
+    'g','h','i','j','k','l','m','n','o','p','q','r','s','t','u','v',
+    'w','x','y','z','0','1','2','3','4','5','6','7','8','9','+','/'
+};
+
+//0xFF marks characters outside the alphabet, including the '=' padding
+static uint8_t kDecodeTable[256];
+
+static void MiSnapBase64FillDecodeTable(void)
+{
+    memset(kDecodeTable, 0xFF, sizeof(kDecodeTable));
+    for (uint8_t i = 0; i < 64; i++) {
+        kDecodeTable[(uint8_t)kEncodeTable[i]] = i;
+    }
+}
+
+static void MiSnapBase64BuildDecodeTable(void)
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, MiSnapBase64FillDecodeTable);
+}
+
+#if defined(__aarch64__)
+
+//48 input bytes -> 64 characters per iteration
+static size_t MiSnapBase64EncodeNEON(const uint8_t *src, size_t len, char *dst)
+{
+    uint8x16x4_t table;
+    table.val[0] = vld1q_u8((const uint8_t *)kEncodeTable);
+    table.val[1] = vld1q_u8((const uint8_t *)kEncodeTable + 16);
+    table.val[2] = vld1q_u8((const uint8_t *)kEncodeTable + 32);
+    table.val[3] = vld1q_u8((const uint8_t *)kEncodeTable + 48);
+
+    const uint8x16_t mask6 = vdupq_n_u8(0x3F);
+    size_t consumed = 0;
+    while (len - consumed >= 48) {
+        uint8x16x3_t in = vld3q_u8(src + consumed);
+        uint8x16x4_t out;
+        out.val[0] = vshrq_n_u8(in.val[0], 2);
+        out.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[0], 4), vshrq_n_u8(in.val[1], 4)), mask6);
+        out.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[1], 2), vshrq_n_u8(in.val[2], 6)), mask6);
+        out.val[3] = vandq_u8(in.val[2], mask6);
+        out.val[0] = vqtbl4q_u8(table, out.val[0]);
+        out.val[1] = vqtbl4q_u8(table, out.val[1]);
+        out.val[2] = vqtbl4q_u8(table, out.val[2]);
+        out.val[3] = vqtbl4q_u8(table, out.val[3]);
+        vst4q_u8((uint8_t *)dst + consumed / 3 * 4, out);
+        consumed += 48;
+    }
+    return consumed;
+}
+
+//64 characters -> 48 output bytes per iteration. Stops at the first block holding a character
+//outside the alphabet and leaves the rest to the scalar path.
+static size_t MiSnapBase64DecodeNEON(const char *src, size_t len, uint8_t *dst)
+{
+    uint8x16x4_t low, high;
+    for (int i = 0; i < 4; i++) {
+        low.val[i] = vld1q_u8(kDecodeTable + 16 * i);
+        high.val[i] = vld1q_u8(kDecodeTable + 64 + 16 * i);
+    }
+
+    const uint8x16_t offset = vdupq_n_u8(64);
+    const uint8x16_t highBit = vdupq_n_u8(0x80);
+    size_t consumed = 0;
+    while (len - consumed >= 64) {
+        uint8x16x4_t in = vld4q_u8((const uint8_t *)src + consumed);
+        uint8x16_t invalid = vdupq_n_u8(0);
+        for (int i = 0; i < 4; i++) {
+            uint8x16_t c = in.val[i];
+            //Indices past the end of a table lookup to 0, so OR the two halves together
+            //and force anything with the high bit set to invalid
+            uint8x16_t v = vorrq_u8(vqtbl4q_u8(low, c), vqtbl4q_u8(high, vsubq_u8(c, offset)));
+            v = vorrq_u8(v, vtstq_u8(c, highBit));
+            invalid = vorrq_u8(invalid, v);
+            in.val[i] = v;
+        }
+        if (vmaxvq_u8(invalid) > 63) {
+            break;
+        }
+        uint8x16x3_t out;
+        out.val[0] = vorrq_u8(vshlq_n_u8(in.val[0], 2), vshrq_n_u8(in.val[1], 4));
+        out.val[1] = vorrq_u8(vshlq_n_u8(in.val[1], 4), vshrq_n_u8(in.val[2], 2));
+        out.val[2] = vorrq_u8(vshlq_n_u8(in.val[2], 6), in.val[3]);
+        vst3q_u8(dst + consumed / 4 * 3, out);
+        consumed += 64;
+    }
+    return consumed;
+}
+
+#endif
+
+size_t MiSnapBase64EncodeBytesScalar(const uint8_t *src, size_t len, char *dst)
+{
+    size_t i = 0;
+    char *out = dst;
+    for (; i + 3 <= len; i += 3) {
+        uint32_t triple = ((uint32_t)src[i] << 16) | ((uint32_t)src[i + 1] << 8) | src[i + 2];
+        out[0] = kEncodeTable[(triple >> 18) & 0x3F];
+        out[1] = kEncodeTable[(triple >> 12) & 0x3F];
+        out[2] = kEncodeTable[(triple >> 6) & 0x3F];
+        out[3] = kEncodeTable[triple & 0x3F];
+        out += 4;
+    }
+    if (i < len) {
+        uint32_t triple = (uint32_t)src[i] << 16;
+        if (i + 1 < len) {
+            triple |= (uint32_t)src[i + 1] << 8;
+        }
+        out[0] = kEncodeTable[(triple >> 18) & 0x3F];
+        out[1] = kEncodeTable[(triple >> 12) & 0x3F];
+        out[2] = (i + 1 < len) ? kEncodeTable[(triple >> 6) & 0x3F] : '=';
+        out[3] = '=';
+        out += 4;
+    }
+    return out - dst;
+}
+
+size_t MiSnapBase64DecodeBytesScalar(const char *src, size_t len, uint8_t *dst)
+{
+    MiSnapBase64BuildDecodeTable();
+
+    const uint8_t *in = (const uint8_t *)src;
+    uint8_t *out = dst;
+    size_t i = 0;
+
+    //Fast path: whole quads of valid characters
+    for (; i + 4 <= len; i += 4) {
+        uint8_t a = kDecodeTable[in[i]], b = kDecodeTable[in[i + 1]];
+        uint8_t c = kDecodeTable[in[i + 2]], d = kDecodeTable[in[i + 3]];
+        if ((a | b | c | d) & 0x80) {
+            break;
+        }
+        uint32_t triple = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | d;
+        out[0] = (uint8_t)(triple >> 16);
+        out[1] = (uint8_t)(triple >> 8);
+        out[2] = (uint8_t)triple;
+        out += 3;
+    }
+
+    //Slow path: line breaks, padding and anything else outside the alphabet
+    uint32_t accumulator = 0;
+    int bits = 0;
+    for (; i < len; i++) {
+        uint8_t value = kDecodeTable[in[i]];
+        if (value & 0x80) {
+            continue;
+        }
+        accumulator = (accumulator << 6) | value;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            *out++ = (uint8_t)(accumulator >> bits);
+        }
+    }
+    return out - dst;
+}
+
+//The vector paths stop on a whole block, so the scalar path carries on from a quad boundary as
+//if it had started there
+
+size_t MiSnapBase64EncodeBytes(const uint8_t *src, size_t len, char *dst)
+{
+    size_t consumed = 0;
+#if defined(__aarch64__)
+    consumed = MiSnapBase64EncodeNEON(src, len, dst);
+#endif
+    return consumed / 3 * 4 + MiSnapBase64EncodeBytesScalar(src + consumed, len - consumed, dst + consumed / 3 * 4);
+}
+
+size_t MiSnapBase64DecodeBytes(const char *src, size_t len, uint8_t *dst)
+{
+    MiSnapBase64BuildDecodeTable();
+
+    size_t consumed = 0;
+#if defined(__aarch64__)
+    consumed = MiSnapBase64DecodeNEON(src, len, dst);
+#endif
+    return consumed / 4 * 3 + MiSnapBase64DecodeBytesScalar(src + consumed, len - consumed, dst + consumed / 4 * 3);
+}
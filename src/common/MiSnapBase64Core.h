@@ -0,0 +1,25 @@
+
+#ifndef MiSnapBase64Core_h
+#define MiSnapBase64Core_h
+
+#include "MiSnapCore.h"
+
+//Base64 codec for the encoded images and MIBI data crossing the plugin.
+//Uses NEON on arm64 devices and a table driven scalar path everywhere else.
+
+//Decodes len characters of src into dst, skipping characters outside the base64 alphabet.
+//dst must hold at least MiSnapBase64DecodedLength(len) bytes. Returns the number of bytes written.
+size_t MiSnapBase64DecodeBytes(const char *src, size_t len, uint8_t *dst);
+
+//Encodes len bytes of src into dst with padding and no line breaks.
+//dst must hold at least MiSnapBase64EncodedLength(len) characters. Returns the number of characters written.
+size_t MiSnapBase64EncodeBytes(const uint8_t *src, size_t len, char *dst);
+
+//The same without NEON, which the vector path must match byte for byte
+size_t MiSnapBase64DecodeBytesScalar(const char *src, size_t len, uint8_t *dst);
+size_t MiSnapBase64EncodeBytesScalar(const uint8_t *src, size_t len, char *dst);
+
+static inline size_t MiSnapBase64DecodedLength(size_t len) { return (len / 4 + 1) * 3; }
+static inline size_t MiSnapBase64EncodedLength(size_t len) { return (len + 2) / 3 * 4; }
+
+#endif
@@ -0,0 +1,71 @@
+
+#include "MiSnapBenchmarkFrame.h"
+#include "MiSnapMICR.h"
+#include <string.h>
+
+//Design units of E-13B: 0.013", with characters on a 0.125" pitch
+#define kMiSnapBenchmarkMICRUnit 0.013
+#define kMiSnapBenchmarkMICRPitch 0.125
+
+//Whether (x, y), in design units from the top left of the MICR line, is inked
+static bool MiSnapBenchmarkMICRInk(double x, double y)
+{
+    if (x < 0 || y < 0 || y >= 9) {
+        return false;
+    }
+    double pitch = kMiSnapBenchmarkMICRPitch / kMiSnapBenchmarkMICRUnit;
+    size_t index = (size_t)(x / pitch);
+    if (index >= strlen(kMiSnapBenchmarkMICRLine)) {
+        return false;
+    }
+    const char *const *glyph = MiSnapMICRGlyph(kMiSnapBenchmarkMICRLine[index]);
+    int column = (int)(x - index * pitch);
+    return glyph != NULL && column < 7 && glyph[(int)y][column] == 'X';
+}
+
+MiSnapBenchmarkRect MiSnapBenchmarkDrawFrame(uint8_t *bgra, size_t width, size_t height, size_t rowBytes)
+{
+    //A 6" x 2.75" check three quarters of the frame wide, or as wide as the frame height allows
+    size_t checkWidth = MIN(width * 3 / 4, (size_t)(height * 0.9 * 6 / 2.75));
+    size_t checkHeight = (size_t)(checkWidth * 2.75 / 6);
+    MiSnapBenchmarkRect check = { (width - checkWidth) / 2, (height - checkHeight) / 2, checkWidth, checkHeight };
+
+    //The MICR line ends 0.25" from the right edge with its baseline 0.19" from the bottom
+    double unit = checkWidth / 6.0 * kMiSnapBenchmarkMICRUnit;
+    double micrWidth = strlen(kMiSnapBenchmarkMICRLine) * kMiSnapBenchmarkMICRPitch / kMiSnapBenchmarkMICRUnit * unit;
+    double micrLeft = check.left + checkWidth - checkWidth / 6.0 * 0.25 - micrWidth;
+    double micrTop = check.top + checkHeight - checkWidth / 6.0 * 0.19 - 9 * unit;
+    size_t textBottom = check.top + checkHeight * 6 / 10;
+
+    uint32_t seed = 0x2545F491;
+    for (size_t y = 0; y < height; y++) {
+        uint8_t *row = bgra + y * rowBytes;
+        bool inCheck = y >= check.top && y < check.top + checkHeight;
+        bool line = inCheck && y < textBottom && (y - check.top) % 24 >= 8 && (y - check.top) % 24 < 14;
+        bool micrRow = y + 1 >= micrTop && y <= micrTop + 9 * unit + 1;
+        for (size_t x = 0; x < width; x++) {
+            seed = seed * 1664525 + 1013904223;
+            int noise = (int)(seed >> 28) - 8;
+            int value = 60;
+            if (inCheck && x >= check.left && x < check.left + checkWidth) {
+                bool ink = line && x >= check.left + checkWidth / 16 && (x / 7) % 5 != 0 && ((x * 31 + y * 17) >> 6) % 3 != 0;
+                value = ink ? 40 : 225;
+                if (micrRow) {
+                    //2x2 samples, so character edges are antialiased as a lens would
+                    int inked = 0;
+                    for (int sample = 0; sample < 4; sample++) {
+                        double sx = x + 0.25 + 0.5 * (sample % 2), sy = y + 0.25 + 0.5 * (sample / 2);
+                        inked += MiSnapBenchmarkMICRInk((sx - micrLeft) / unit, (sy - micrTop) / unit);
+                    }
+                    value -= (225 - 40) * inked / 4;
+                }
+            }
+            value = MIN(MAX(value + noise, 0), 255);
+            row[x * 4 + 0] = (uint8_t)value;
+            row[x * 4 + 1] = (uint8_t)value;
+            row[x * 4 + 2] = (uint8_t)MIN(value + 6, 255);
+            row[x * 4 + 3] = 255;
+        }
+    }
+    return check;
+}
@@ -0,0 +1,24 @@
+#ifndef MiSnapBenchmarkFrame_h
+#define MiSnapBenchmarkFrame_h
+
+#include "MiSnapCore.h"
+
+//The synthetic frame the benchmarks time the capture kernels on: a light check on a dark desk,
+//with text-like strokes for the scorer and the JPEG encoder and an E-13B MICR line along its
+//bottom edge, so the MICR kernel times a successful read rather than the rejection of a frame
+//without one. Deterministic, so runs can be compared.
+
+//The MICR line printed on the check
+#define kMiSnapBenchmarkMICRLine "T021000021T 1234567890U 0042"
+
+typedef struct {
+    size_t left;
+    size_t top;
+    size_t width;
+    size_t height;
+} MiSnapBenchmarkRect;
+
+//Draws the frame into BGRA pixels and returns where the check is, as the capture would crop it
+MiSnapBenchmarkRect MiSnapBenchmarkDrawFrame(uint8_t *bgra, size_t width, size_t height, size_t rowBytes);
+
+#endif
@@ -0,0 +1,201 @@
+#include "MiSnapBufferPoolCore.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#define kMiSnapPoolMagic 0x4D53504Cu
+#define kMiSnapPoolAlignment 64
+#define kMiSnapPoolMinShift 12
+#define kMiSnapPoolMaxShift 27
+//Two classes per power of two
+#define kMiSnapPoolClasses (2 * (kMiSnapPoolMaxShift - kMiSnapPoolMinShift) + 1)
+//Idle buffers kept per class, whatever the high-water mark
+#define kMiSnapPoolIdlePerClass 8
+
+static const size_t kDefaultHighWaterBytes = 32 << 20;
+
+//Precedes every buffer; its alignment pads it to a whole number of alignment units on any ABI,
+//which keeps the buffer after it aligned
+typedef struct {
+    _Alignas(kMiSnapPoolAlignment) uint32_t magic;
+    int32_t sizeClass;                  //-1 for buffers bypassing the pool
+    size_t capacity;
+} MiSnapPoolHeader;
+
+_Static_assert(sizeof(MiSnapPoolHeader) % kMiSnapPoolAlignment == 0, "buffers must follow their header aligned");
+
+struct MiSnapBufferPool {
+    pthread_mutex_t lock;
+    void *idle[kMiSnapPoolClasses][kMiSnapPoolIdlePerClass];
+    int idleCount[kMiSnapPoolClasses];
+    MiSnapBufferPoolStatistics statistics;
+};
+
+static size_t MiSnapPoolClassSize(int sizeClass)
+{
+    size_t base = (size_t)1 << (kMiSnapPoolMinShift + sizeClass / 2);
+    return sizeClass % 2 ? base + base / 2 : base;
+}
+
+//The smallest class holding size, or -1
+static int MiSnapPoolClassForSize(size_t size)
+{
+    for (int sizeClass = 0; sizeClass < kMiSnapPoolClasses; sizeClass++) {
+        if (MiSnapPoolClassSize(sizeClass) >= size) {
+            return sizeClass;
+        }
+    }
+    return -1;
+}
+
+static inline MiSnapPoolHeader *MiSnapPoolHeaderOf(void *buffer)
+{
+    return (MiSnapPoolHeader *)buffer - 1;
+}
+
+static void MiSnapPoolFree(void *buffer)
+{
+    MiSnapPoolHeader *header = MiSnapPoolHeaderOf(buffer);
+    header->magic = 0;
+    free(header);
+}
+
+MiSnapBufferPool *MiSnapBufferPoolCreate(size_t highWaterBytes)
+{
+    MiSnapBufferPool *pool = calloc(1, sizeof(MiSnapBufferPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->statistics.highWaterBytes = highWaterBytes;
+    return pool;
+}
+
+void MiSnapBufferPoolDestroy(MiSnapBufferPool *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    MiSnapBufferPoolTrim(pool);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+static MiSnapBufferPool *sharedPool;
+
+static void MiSnapCreateSharedBufferPool(void)
+{
+    sharedPool = MiSnapBufferPoolCreate(kDefaultHighWaterBytes);
+}
+
+MiSnapBufferPool *MiSnapSharedBufferPool(void)
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, MiSnapCreateSharedBufferPool);
+    return sharedPool;
+}
+
+void *MiSnapBufferAcquire(MiSnapBufferPool *pool, size_t size)
+{
+    int sizeClass = MiSnapPoolClassForSize(size);
+    size_t capacity = sizeClass >= 0 ? MiSnapPoolClassSize(sizeClass) : size;
+    void *buffer = NULL;
+    
+    pthread_mutex_lock(&pool->lock);
+    if (sizeClass >= 0 && pool->idleCount[sizeClass] > 0) {
+        buffer = pool->idle[sizeClass][--pool->idleCount[sizeClass]];
+        pool->statistics.idleBytes -= capacity;
+        pool->statistics.inUseBytes += capacity;
+        pool->statistics.hits++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    if (buffer != NULL) {
+        return buffer;
+    }
+    
+    MiSnapPoolHeader *header = NULL;
+    if (capacity > SIZE_MAX - sizeof(MiSnapPoolHeader) || posix_memalign((void **)&header, kMiSnapPoolAlignment, sizeof(MiSnapPoolHeader) + capacity) != 0) {
+        return NULL;
+    }
+    header->magic = kMiSnapPoolMagic;
+    header->sizeClass = sizeClass;
+    header->capacity = capacity;
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->statistics.misses++;
+    pool->statistics.inUseBytes += capacity;
+    pool->statistics.peakBytes = MAX(pool->statistics.peakBytes, pool->statistics.inUseBytes + pool->statistics.idleBytes);
+    pthread_mutex_unlock(&pool->lock);
+    return header + 1;
+}
+
+void MiSnapBufferRelease(MiSnapBufferPool *pool, void *buffer)
+{
+    if (buffer == NULL) {
+        return;
+    }
+    MiSnapPoolHeader *header = MiSnapPoolHeaderOf(buffer);
+    assert(header->magic == kMiSnapPoolMagic && "Buffer not acquired from a MiSnapBufferPool");
+    int sizeClass = header->sizeClass;
+    size_t capacity = header->capacity;
+    
+    bool keep = false;
+    pthread_mutex_lock(&pool->lock);
+    pool->statistics.inUseBytes -= capacity;
+    if (sizeClass >= 0 && pool->idleCount[sizeClass] < kMiSnapPoolIdlePerClass && pool->statistics.idleBytes + capacity <= pool->statistics.highWaterBytes) {
+        pool->idle[sizeClass][pool->idleCount[sizeClass]++] = buffer;
+        pool->statistics.idleBytes += capacity;
+        keep = true;
+    } else {
+        pool->statistics.trimmed++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    if (!keep) {
+        MiSnapPoolFree(buffer);
+    }
+}
+
+//Frees idle buffers, largest classes first, until at most limit idle bytes remain
+static void MiSnapPoolTrimTo(MiSnapBufferPool *pool, size_t limit)
+{
+    void *freed[kMiSnapPoolClasses * kMiSnapPoolIdlePerClass];
+    size_t count = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (int sizeClass = kMiSnapPoolClasses - 1; sizeClass >= 0 && pool->statistics.idleBytes > limit; sizeClass--) {
+        while (pool->idleCount[sizeClass] > 0 && pool->statistics.idleBytes > limit) {
+            freed[count++] = pool->idle[sizeClass][--pool->idleCount[sizeClass]];
+            pool->statistics.idleBytes -= MiSnapPoolClassSize(sizeClass);
+            pool->statistics.trimmed++;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    for (size_t i = 0; i < count; i++) {
+        MiSnapPoolFree(freed[i]);
+    }
+}
+
+void MiSnapBufferPoolSetHighWater(MiSnapBufferPool *pool, size_t highWaterBytes)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->statistics.highWaterBytes = highWaterBytes;
+    pthread_mutex_unlock(&pool->lock);
+    MiSnapPoolTrimTo(pool, highWaterBytes);
+}
+
+void MiSnapBufferPoolTrim(MiSnapBufferPool *pool)
+{
+    MiSnapPoolTrimTo(pool, 0);
+}
+
+void MiSnapBufferPoolGetStatistics(MiSnapBufferPool *pool, MiSnapBufferPoolStatistics *statistics, bool reset)
+{
+    pthread_mutex_lock(&pool->lock);
+    *statistics = pool->statistics;
+    if (reset) {
+        pool->statistics.hits = 0;
+        pool->statistics.misses = 0;
+        pool->statistics.trimmed = 0;
+        pool->statistics.peakBytes = pool->statistics.inUseBytes + pool->statistics.idleBytes;
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,48 @@
+
+#ifndef MiSnapBufferPoolCore_h
+#define MiSnapBufferPoolCore_h
+
+#include "MiSnapCore.h"
+
+//Size-classed pool for pixel and scratch buffers, shared by the frame analysis, scoring and
+//scaling code so that the large buffers of one frame or capture are reused by the next instead of
+//being returned to the system and faulted in again. Classes are spaced at 1x and 1.5x powers of
+//two from 4 KB to 128 MB; larger requests bypass the pool. Released buffers are kept idle up to a
+//high-water mark of idle bytes and freed beyond it. Buffers are 64-byte aligned. Thread safe.
+
+typedef struct MiSnapBufferPool MiSnapBufferPool;
+
+typedef struct {
+    uint64_t hits;                      //acquisitions served by an idle buffer
+    uint64_t misses;                    //acquisitions that allocated
+    uint64_t trimmed;                   //buffers freed instead of kept idle
+    size_t inUseBytes;
+    size_t idleBytes;
+    size_t peakBytes;                   //largest inUseBytes + idleBytes
+    size_t highWaterBytes;
+} MiSnapBufferPoolStatistics;
+
+MiSnapBufferPool *MiSnapBufferPoolCreate(size_t highWaterBytes);
+
+//Every buffer must have been released
+void MiSnapBufferPoolDestroy(MiSnapBufferPool *pool);
+
+//The pool used by the plugin (32 MB high-water mark unless configured)
+MiSnapBufferPool *MiSnapSharedBufferPool(void);
+
+//Returns a buffer of at least size bytes with undefined contents, or NULL
+void *MiSnapBufferAcquire(MiSnapBufferPool *pool, size_t size);
+
+//Returns a buffer to the pool it came from; NULL is ignored
+void MiSnapBufferRelease(MiSnapBufferPool *pool, void *buffer);
+
+//Sets the high-water mark and frees idle buffers above it
+void MiSnapBufferPoolSetHighWater(MiSnapBufferPool *pool, size_t highWaterBytes);
+
+//Frees every idle buffer, e.g. on a memory warning
+void MiSnapBufferPoolTrim(MiSnapBufferPool *pool);
+
+//reset restarts the counters and the peak
+void MiSnapBufferPoolGetStatistics(MiSnapBufferPool *pool, MiSnapBufferPoolStatistics *statistics, bool reset);
+
+#endif
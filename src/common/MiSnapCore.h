@@ -0,0 +1,20 @@
+
+#ifndef MiSnapCore_h
+#define MiSnapCore_h
+
+//The capture core shared by the iOS and Android plugins: frame scoring, document detection, the
+//buffer pool and the capture spool. It is plain C with no platform frameworks, so the same sources
+//build with Xcode and with the NDK.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef MIN
+#define MIN(a,b) (((a)<(b))?(a):(b))
+#endif
+#ifndef MAX
+#define MAX(a,b) (((a)>(b))?(a):(b))
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+
+#include "MiSnapFeedback.h"
+#include <string.h>
+
+static const double kMinRate = 0.1;
+static const double kMaxRate = 60;
+
+void MiSnapFeedbackInit(MiSnapFeedbackThrottle *throttle, double maxRate)
+{
+    memset(throttle, 0, sizeof(*throttle));
+    maxRate = maxRate > kMinRate ? maxRate : kMinRate;
+    throttle->intervalMs = 1000.0 / MIN(maxRate, kMaxRate);
+}
+
+static void MiSnapFeedbackTake(MiSnapFeedbackThrottle *throttle, MiSnapFeedbackEvent *event)
+{
+    *event = throttle->pending;
+    throttle->lastEventMs = event->last.timeMs;
+    throttle->emitted = true;
+    throttle->events++;
+    throttle->pending.frames = 0;
+}
+
+bool MiSnapFeedbackOffer(MiSnapFeedbackThrottle *throttle, const MiSnapFeedbackSample *sample, MiSnapFeedbackEvent *event)
+{
+    MiSnapFeedbackEvent *pending = &throttle->pending;
+    if (pending->frames == 0) {
+        pending->passingFrames = 0;
+        pending->torchSwitches = 0;
+        pending->bestSharpness = sample->sharpness;
+        pending->minBrightness = sample->brightness;
+        pending->maxBrightness = sample->brightness;
+    } else {
+        pending->bestSharpness = MAX(pending->bestSharpness, sample->sharpness);
+        pending->minBrightness = MIN(pending->minBrightness, sample->brightness);
+        pending->maxBrightness = MAX(pending->maxBrightness, sample->brightness);
+    }
+    pending->last = *sample;
+    pending->frames++;
+    pending->passingFrames += sample->passes;
+    pending->torchSwitches += throttle->offered > 0 && sample->torch != throttle->lastTorch;
+    throttle->lastTorch = sample->torch;
+    throttle->offered++;
+
+    //A timestamp going backwards (a new session on the same throttle) also makes an event due
+    double elapsed = sample->timeMs - throttle->lastEventMs;
+    if (throttle->emitted && elapsed >= 0 && elapsed < throttle->intervalMs) {
+        return false;
+    }
+    MiSnapFeedbackTake(throttle, event);
+    return true;
+}
+
+bool MiSnapFeedbackFlush(MiSnapFeedbackThrottle *throttle, MiSnapFeedbackEvent *event)
+{
+    if (throttle->pending.frames == 0) {
+        return false;
+    }
+    MiSnapFeedbackTake(throttle, event);
+    return true;
+}
@@ -0,0 +1,52 @@
+
+#ifndef MiSnapFeedback_h
+#define MiSnapFeedback_h
+
+#include "MiSnapCore.h"
+
+//Coalesces per-frame quality scores into events sent to the web layer at a bounded rate. An event
+//is due on the first frame and then on the first frame at least 1 / maxRate seconds after the
+//previous event; the frames in between are folded into it, so none goes unreported however low
+//the rate. Everything is driven by the frame timestamps, which keeps it independent of the clock
+//and of the thread calling it.
+
+typedef struct {
+    uint64_t frame;
+    double timeMs;
+    int brightness;
+    int sharpness;
+    int angle;
+    bool torch;
+    bool passes;
+} MiSnapFeedbackSample;
+
+typedef struct {
+    MiSnapFeedbackSample last;          //the frame that made the event due, or the last one flushed
+    uint32_t frames;                    //frames folded into the event, including last
+    uint32_t passingFrames;
+    int bestSharpness;
+    int minBrightness;
+    int maxBrightness;
+    uint32_t torchSwitches;             //torch changes between consecutive frames folded in
+} MiSnapFeedbackEvent;
+
+typedef struct {
+    double intervalMs;
+    double lastEventMs;
+    bool emitted;                       //an event has been sent, so lastEventMs is valid
+    bool lastTorch;                     //of the last frame offered
+    MiSnapFeedbackEvent pending;        //frames is 0 when nothing is pending
+    uint64_t offered;
+    uint64_t events;
+} MiSnapFeedbackThrottle;
+
+//maxRate is in events per second and is clamped to 0.1-60
+void MiSnapFeedbackInit(MiSnapFeedbackThrottle *throttle, double maxRate);
+
+//Folds one frame in. Returns true with *event filled when an event is due.
+bool MiSnapFeedbackOffer(MiSnapFeedbackThrottle *throttle, const MiSnapFeedbackSample *sample, MiSnapFeedbackEvent *event);
+
+//Returns true with the frames folded in since the last event, e.g. when the session ends
+bool MiSnapFeedbackFlush(MiSnapFeedbackThrottle *throttle, MiSnapFeedbackEvent *event);
+
+#endif
@@ -0,0 +1,200 @@
+
+#include "MiSnapFrameReplayCore.h"
+#include "MiSnapFrameWindowCore.h"
+#include "MiSnapMetricsCore.h"
+#include <stdlib.h>
+#include <string.h>
+
+const char *const kMiSnapReplayStageNames[MiSnapReplayStageCount] = { "convert", "score", "quad", "torch", "window" };
+
+static int MiSnapReplayCompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+//Sorts samples in place
+static void MiSnapReplaySummarize(double *samples, size_t count, MiSnapReplayLatency *latency)
+{
+    double total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += samples[i];
+    }
+    qsort(samples, count, sizeof(double), MiSnapReplayCompareDoubles);
+    latency->meanMs = total / count;
+    latency->p50Ms = samples[count / 2];
+    latency->p95Ms = samples[MIN(count - 1, count * 95 / 100)];
+    latency->maxMs = samples[count - 1];
+}
+
+void MiSnapReplayOptionsInit(MiSnapReplayOptions *options, size_t width, size_t height, size_t rowBytes, MiSnapFrameFormat format)
+{
+    memset(options, 0, sizeof(*options));
+    options->width = width;
+    options->height = height;
+    options->rowBytes = rowBytes;
+    options->format = format;
+    options->thresholds = (MiSnapFrameThresholds){ 400, 700, 400, 150 };
+    options->frameRate = 30;
+    options->torchMode = MiSnapTorchModeAuto;
+    options->candidates = 4;
+}
+
+static size_t MiSnapReplayRowBytes(const MiSnapReplayOptions *options)
+{
+    if (options->rowBytes != 0) {
+        return options->rowBytes;
+    }
+    return options->format == MiSnapFrameFormatBGRA ? options->width * 4 : options->width;
+}
+
+size_t MiSnapReplayFrameSize(const MiSnapReplayOptions *options)
+{
+    size_t rowBytes = MiSnapReplayRowBytes(options);
+    return options->format == MiSnapFrameFormatBGRA ? rowBytes * options->height : rowBytes * options->height * 3 / 2;
+}
+
+MiSnapReplayStatus MiSnapReplayRun(const MiSnapReplayOptions *options, const uint8_t *dump, size_t length, MiSnapReplayReport *report)
+{
+    size_t width = options->width, height = options->height, rowBytes = MiSnapReplayRowBytes(options);
+    bool bgra = options->format == MiSnapFrameFormatBGRA;
+    if (width < 2 || height < 2 || rowBytes < (bgra ? width * 4 : width)) {
+        return MiSnapReplayInvalidGeometry;
+    }
+    size_t frameSize = MiSnapReplayFrameSize(options);
+    size_t frameCount = length / frameSize;
+    if (frameCount == 0) {
+        return MiSnapReplayTooShort;
+    }
+
+    double frameRate = options->frameRate > 0 ? options->frameRate : 30;
+    MiSnapFrameWindow window;
+    bool windowReady = MiSnapFrameWindowInit(&window, options->candidates, width, height, options->bestOfWindowMs);
+    double *latencies = malloc(sizeof(double) * frameCount * MiSnapReplayStageCount);
+    double *samples = malloc(sizeof(double) * frameCount);
+    uint8_t *luma = bgra ? malloc(width * height) : NULL;
+    if (!windowReady || latencies == NULL || samples == NULL || (bgra && luma == NULL)) {
+        if (windowReady) {
+            MiSnapFrameWindowDestroy(&window);
+        }
+        free(latencies);
+        free(samples);
+        free(luma);
+        return MiSnapReplayOutOfMemory;
+    }
+
+    memset(report, 0, sizeof(*report));
+    report->frames = frameCount;
+    report->acceptedFrame = -1;
+    report->firstPassingFrame = -1;
+    report->decisionFrame = -1;
+    MiSnapTorchInit(&report->torch, options->torchMode, options->driversLicense, options->thresholds.minBrightness);
+    bool torchOn = report->torch.torch;
+    size_t decisionCapacity = 0;
+    uint64_t runStart = MiSnapMetricsNow();
+
+    for (size_t i = 0; i < frameCount; i++) {
+        const uint8_t *frame = dump + i * frameSize;
+        double *stage = latencies + i * MiSnapReplayStageCount;
+
+        uint64_t start = MiSnapMetricsNow();
+        const uint8_t *plane = frame;
+        size_t planeRowBytes = rowBytes;
+        if (bgra) {
+            MiSnapExtractLuma(frame, width, height, rowBytes, luma, width);
+            plane = luma;
+            planeRowBytes = width;
+        }
+        stage[MiSnapReplayStageConvert] = MiSnapMetricsMsSince(start);
+
+        start = MiSnapMetricsNow();
+        MiSnapFrameScore score;
+        MiSnapScoreLumaPixels(plane, width, height, planeRowBytes, &score);
+        stage[MiSnapReplayStageScore] = MiSnapMetricsMsSince(start);
+
+        start = MiSnapMetricsNow();
+        MiSnapScoreLumaQuad(plane, width, height, planeRowBytes, &score);
+        stage[MiSnapReplayStageQuad] = MiSnapMetricsMsSince(start);
+
+        start = MiSnapMetricsNow();
+        bool torchDecision = MiSnapTorchUpdate(&report->torch, plane, width, height, planeRowBytes);
+        stage[MiSnapReplayStageTorch] = MiSnapMetricsMsSince(start);
+
+        //The window decides once it closes: on the first frame past its end, passing or not, or
+        //on the last frame of the dump
+        start = MiSnapMetricsNow();
+        bool passes = MiSnapFrameScorePasses(&score, &options->thresholds);
+        if (passes && report->firstPassingFrame < 0) {
+            report->firstPassingFrame = (long)i;
+        }
+        const MiSnapWindowCandidate *best = NULL;
+        if (report->decisionFrame < 0 && report->firstPassingFrame >= 0) {
+            double timeMs = i * 1000.0 / frameRate;
+            bool closed = passes ? MiSnapFrameWindowOffer(&window, &score, plane, width, height, planeRowBytes, i, timeMs) : MiSnapFrameWindowPoll(&window, timeMs);
+            if (closed || i + 1 == frameCount) {
+                best = MiSnapFrameWindowFinish(&window);
+                report->decisionFrame = (long)i;
+            }
+        }
+        stage[MiSnapReplayStageWindow] = MiSnapMetricsMsSince(start);
+
+        if (best != NULL) {
+            report->acceptedFrame = (long)best->frame.sequence;
+            report->acceptedScore = best->score;
+            report->wallTimeToAcceptMs = MiSnapMetricsMsSince(runStart);
+        }
+        if (torchDecision != torchOn) {
+            torchOn = torchDecision;
+            if (report->decisionCount == decisionCapacity) {
+                size_t capacity = MAX(decisionCapacity * 2, (size_t)8);
+                MiSnapReplayTorchDecision *decisions = realloc(report->decisions, capacity * sizeof(*decisions));
+                if (decisions == NULL) {
+                    continue;
+                }
+                report->decisions = decisions;
+                decisionCapacity = capacity;
+            }
+            report->decisions[report->decisionCount++] = (MiSnapReplayTorchDecision){
+                i, torchOn, report->torch.brightness, report->torch.ambient, report->torch.torchGain
+            };
+        }
+    }
+    report->wallMs = MiSnapMetricsMsSince(runStart);
+    report->framesPerSecond = report->wallMs > 0 ? frameCount * 1000.0 / report->wallMs : 0;
+    if (report->acceptedFrame >= 0) {
+        report->timeToAcceptMs = report->decisionFrame * 1000.0 / frameRate;
+    }
+    report->windowMs = window.windowMs;
+    report->framesOffered = window.offered;
+    report->candidates = window.count;
+    MiSnapFrameWindowDestroy(&window);
+    free(luma);
+
+    for (int s = 0; s < MiSnapReplayStageCount; s++) {
+        for (size_t i = 0; i < frameCount; i++) {
+            samples[i] = latencies[i * MiSnapReplayStageCount + s];
+        }
+        MiSnapReplaySummarize(samples, frameCount, &report->stages[s]);
+    }
+    free(samples);
+    free(latencies);
+    return MiSnapReplayOK;
+}
+
+void MiSnapReplayReportFree(MiSnapReplayReport *report)
+{
+    free(report->decisions);
+    report->decisions = NULL;
+    report->decisionCount = 0;
+}
+
+const char *MiSnapReplayStatusMessage(MiSnapReplayStatus status)
+{
+    switch (status) {
+        case MiSnapReplayOK:                return "OK";
+        case MiSnapReplayInvalidGeometry:   return "Invalid frame geometry";
+        case MiSnapReplayTooShort:          return "Dump is smaller than one frame";
+        case MiSnapReplayOutOfMemory:       return "Out of memory";
+    }
+    return "Unknown error";
+}
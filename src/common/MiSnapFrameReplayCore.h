@@ -0,0 +1,101 @@
+
+#ifndef MiSnapFrameReplayCore_h
+#define MiSnapFrameReplayCore_h
+
+#include "MiSnapCore.h"
+#include "MiSnapFrameScoreCore.h"
+#include "MiSnapTorchCore.h"
+
+//Streams a raw frame dump through the frame analysis pipeline as fast as possible and reports
+//throughput, time-to-accept, per-stage latency and the auto-torch decisions: the replayFrames
+//action on iOS and misnap_core_replay on hosts, which report the same numbers for the same dump.
+
+typedef enum {
+    MiSnapFrameFormatNV12,
+    MiSnapFrameFormatBGRA
+} MiSnapFrameFormat;
+
+typedef enum {
+    MiSnapReplayStageConvert,           //BGRA to luma; nothing for NV12, whose Y plane is used as is
+    MiSnapReplayStageScore,             //brightness and sharpness
+    MiSnapReplayStageQuad,              //the document quad and the angle
+    MiSnapReplayStageTorch,             //the auto-torch estimate
+    MiSnapReplayStageWindow,            //the pass rule and the best-of-window selection
+    MiSnapReplayStageCount
+} MiSnapReplayStage;
+
+//The names of the stages in reports
+extern const char *const kMiSnapReplayStageNames[MiSnapReplayStageCount];
+
+typedef struct {
+    size_t width;
+    size_t height;
+    size_t rowBytes;                    //0 means tightly packed rows
+    MiSnapFrameFormat format;
+    MiSnapFrameThresholds thresholds;
+    double frameRate;                   //rate the frames were recorded at, for session time
+    MiSnapTorchMode torchMode;
+    bool driversLicense;
+    double bestOfWindowMs;              //0 accepts the first passing frame
+    size_t candidates;
+} MiSnapReplayOptions;
+
+typedef enum {
+    MiSnapReplayOK,
+    MiSnapReplayInvalidGeometry,
+    MiSnapReplayTooShort,               //the dump is smaller than one frame
+    MiSnapReplayOutOfMemory
+} MiSnapReplayStatus;
+
+typedef struct {
+    double meanMs;
+    double p50Ms;
+    double p95Ms;
+    double maxMs;
+} MiSnapReplayLatency;
+
+//A frame after which the torch would switch, with the estimate that switched it
+typedef struct {
+    size_t frame;
+    bool torch;
+    int brightness;
+    int ambient;
+    int torchGain;
+} MiSnapReplayTorchDecision;
+
+typedef struct {
+    size_t frames;
+    double wallMs;
+    double framesPerSecond;
+    long acceptedFrame;                 //-1 if no frame passed
+    long firstPassingFrame;
+    long decisionFrame;                 //the frame on which the window closed
+    double timeToAcceptMs;              //session time of the decision frame
+    double wallTimeToAcceptMs;
+    MiSnapFrameScore acceptedScore;
+    double windowMs;
+    uint64_t framesOffered;
+    size_t candidates;
+    MiSnapTorchEstimator torch;
+    MiSnapReplayTorchDecision *decisions;
+    size_t decisionCount;
+    MiSnapReplayLatency stages[MiSnapReplayStageCount];
+} MiSnapReplayReport;
+
+//The documented defaults: thresholds for any document type, 30 frames per second, an AUTO torch
+//for a document that is not a driver's license and 4 candidates
+void MiSnapReplayOptionsInit(MiSnapReplayOptions *options, size_t width, size_t height, size_t rowBytes, MiSnapFrameFormat format);
+
+//Bytes of one frame of the dump; NV12 is a full-resolution Y plane followed by a half-height
+//interleaved CbCr plane
+size_t MiSnapReplayFrameSize(const MiSnapReplayOptions *options);
+
+//Replays every whole frame of the dump. The report is filled only on MiSnapReplayOK and must be
+//freed with MiSnapReplayReportFree then.
+MiSnapReplayStatus MiSnapReplayRun(const MiSnapReplayOptions *options, const uint8_t *dump, size_t length, MiSnapReplayReport *report);
+void MiSnapReplayReportFree(MiSnapReplayReport *report);
+
+//A message for a status other than MiSnapReplayOK
+const char *MiSnapReplayStatusMessage(MiSnapReplayStatus status);
+
+#endif
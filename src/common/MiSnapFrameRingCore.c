@@ -0,0 +1,67 @@
+
+#include "MiSnapFrameRingCore.h"
+#include "MiSnapBufferPoolCore.h"
+#include <string.h>
+
+//Set on the latest slot index while it holds a frame the consumer has not taken yet
+#define kMiSnapRingFresh 0x80000000u
+#define kMiSnapRingSlotMask 0x3u
+
+bool MiSnapFrameRingInit(MiSnapFrameRing *ring, size_t maxWidth, size_t maxHeight)
+{
+    memset(ring, 0, sizeof(*ring));
+    for (int i = 0; i < 3; i++) {
+        ring->slots[i].luma = MiSnapBufferAcquire(MiSnapSharedBufferPool(), maxWidth * maxHeight);
+        ring->slots[i].rowBytes = maxWidth;
+        if (ring->slots[i].luma == NULL) {
+            MiSnapFrameRingDestroy(ring);
+            return false;
+        }
+    }
+    ring->producerSlot = 0;
+    atomic_init(&ring->latest, 1);
+    ring->consumerSlot = 2;
+    atomic_init(&ring->published, 0);
+    atomic_init(&ring->consumed, 0);
+    atomic_init(&ring->dropped, 0);
+    return true;
+}
+
+void MiSnapFrameRingDestroy(MiSnapFrameRing *ring)
+{
+    for (int i = 0; i < 3; i++) {
+        MiSnapBufferRelease(MiSnapSharedBufferPool(), ring->slots[i].luma);
+        ring->slots[i].luma = NULL;
+    }
+}
+
+MiSnapRingFrame *MiSnapFrameRingWriteSlot(MiSnapFrameRing *ring)
+{
+    return &ring->slots[ring->producerSlot];
+}
+
+void MiSnapFrameRingPublish(MiSnapFrameRing *ring)
+{
+    uint32_t previous = atomic_exchange_explicit(&ring->latest, ring->producerSlot | kMiSnapRingFresh, memory_order_acq_rel);
+    if (previous & kMiSnapRingFresh) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+    }
+    ring->producerSlot = previous & kMiSnapRingSlotMask;
+    atomic_fetch_add_explicit(&ring->published, 1, memory_order_relaxed);
+}
+
+MiSnapRingFrame *MiSnapFrameRingAcquire(MiSnapFrameRing *ring)
+{
+    if (!MiSnapFrameRingHasFrame(ring)) {
+        return NULL;
+    }
+    uint32_t previous = atomic_exchange_explicit(&ring->latest, ring->consumerSlot, memory_order_acq_rel);
+    ring->consumerSlot = previous & kMiSnapRingSlotMask;
+    atomic_fetch_add_explicit(&ring->consumed, 1, memory_order_relaxed);
+    return &ring->slots[ring->consumerSlot];
+}
+
+bool MiSnapFrameRingHasFrame(MiSnapFrameRing *ring)
+{
+    return (atomic_load_explicit(&ring->latest, memory_order_acquire) & kMiSnapRingFresh) != 0;
+}
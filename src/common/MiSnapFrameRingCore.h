@@ -0,0 +1,48 @@
+
+#ifndef MiSnapFrameRingCore_h
+#define MiSnapFrameRingCore_h
+
+#include "MiSnapCore.h"
+#include <stdatomic.h>
+
+//Bounded single-producer/single-consumer hand-off of frames from the camera callback to the
+//analysis worker. The ring has three preallocated slots: one being written by the producer, one
+//being read by the consumer, and the latest published frame. Publishing a frame replaces an
+//unread one, so the consumer always gets the newest frame and stale frames are dropped.
+//Neither side ever blocks or allocates. There is one producer thread and one consumer thread per
+//ring.
+
+typedef struct {
+    uint8_t *luma;
+    size_t width;
+    size_t height;
+    size_t rowBytes;
+    uint64_t sequence;
+    uint64_t timestamp;     //when the camera delivered the frame, on the producer's clock
+} MiSnapRingFrame;
+
+typedef struct {
+    MiSnapRingFrame slots[3];
+    _Atomic uint32_t latest;
+    uint32_t producerSlot;
+    uint32_t consumerSlot;
+    //Once both sides are idle, published == consumed + dropped, plus 1 while a frame is unread
+    _Atomic uint64_t published;
+    _Atomic uint64_t consumed;
+    _Atomic uint64_t dropped;       //published frames replaced before the consumer took them
+} MiSnapFrameRing;
+
+//Allocates slots large enough for maxWidth x maxHeight luma frames. Returns false when out of memory.
+bool MiSnapFrameRingInit(MiSnapFrameRing *ring, size_t maxWidth, size_t maxHeight);
+void MiSnapFrameRingDestroy(MiSnapFrameRing *ring);
+
+//Producer side: fill the slot returned by MiSnapFrameRingWriteSlot, then publish it
+MiSnapRingFrame *MiSnapFrameRingWriteSlot(MiSnapFrameRing *ring);
+void MiSnapFrameRingPublish(MiSnapFrameRing *ring);
+
+//Consumer side: returns the newest unread frame, or NULL. The frame stays valid until the next call.
+MiSnapRingFrame *MiSnapFrameRingAcquire(MiSnapFrameRing *ring);
+
+bool MiSnapFrameRingHasFrame(MiSnapFrameRing *ring);
+
+#endif
@@ -0,0 +1,236 @@
+
+#include "MiSnapFrameScoreCore.h"
+#include "MiSnapBufferPoolCore.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define kMiSnapScoreMax 1000
+
+//Mean absolute gradient (on the 0-255 scale) that maps to a sharpness of ~632
+static const float kSharpnessScale = 8.0f;
+//Sobel magnitude (on the 0-255 scale) below which a grid cell does not vote for the skew angle
+static const float kEdgeThreshold = 96.0f;
+//Grid cells along the longer side used for the skew estimate, independent of resolution
+static const size_t kAngleGrid = 160;
+
+static uint64_t MiSnapSumRow(const uint8_t *row, size_t width)
+{
+    uint64_t sum = 0;
+    size_t x = 0;
+#if defined(__aarch64__)
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; x + 16 <= width; x += 16) {
+        acc = vpadalq_u16(acc, vpaddlq_u8(vld1q_u8(row + x)));
+    }
+    sum = vaddvq_u32(acc);
+#endif
+    for (; x < width; x++) {
+        sum += row[x];
+    }
+    return sum;
+}
+
+//Sum of horizontal and vertical absolute differences for x in [0, width - 1)
+static uint64_t MiSnapGradientRow(const uint8_t *row, const uint8_t *next, size_t width)
+{
+    uint64_t sum = 0;
+    size_t x = 0;
+#if defined(__aarch64__)
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; x + 17 <= width; x += 16) {
+        uint8x16_t p = vld1q_u8(row + x);
+        uint16x8_t d = vpaddlq_u8(vabdq_u8(vld1q_u8(row + x + 1), p));
+        d = vpadalq_u8(d, vabdq_u8(vld1q_u8(next + x), p));
+        acc = vpadalq_u16(acc, d);
+    }
+    sum = vaddvq_u32(acc);
+#endif
+    for (; x + 1 < width; x++) {
+        sum += abs(row[x + 1] - row[x]) + abs(next[x] - row[x]);
+    }
+    return sum;
+}
+
+//Dominant edge orientation folded into [-45, 45) degrees, in one-degree bins centred on whole
+//degrees. The frame is box-averaged onto a grid of at most kAngleGrid cells per side, which keeps
+//sub-pixel edge positions, and strong Sobel gradients on the grid vote into the histogram.
+static int MiSnapSkewScore(const uint8_t *luma, size_t width, size_t height, size_t rowBytes)
+{
+    size_t step = (MAX(width, height) + kAngleGrid - 1) / kAngleGrid;
+    size_t gridWidth = width / step;
+    size_t gridHeight = height / step;
+    if (gridWidth < 3 || gridHeight < 3) {
+        return 0;
+    }
+    
+    MiSnapBufferPool *pool = MiSnapSharedBufferPool();
+    float *grid = MiSnapBufferAcquire(pool, gridWidth * gridHeight * sizeof(float));
+    uint32_t *sums = MiSnapBufferAcquire(pool, gridWidth * sizeof(uint32_t));
+    if (grid == NULL || sums == NULL) {
+        MiSnapBufferRelease(pool, grid);
+        MiSnapBufferRelease(pool, sums);
+        return 0;
+    }
+    const float area = (float)(step * step);
+    for (size_t gy = 0; gy < gridHeight; gy++) {
+        memset(sums, 0, gridWidth * sizeof(uint32_t));
+        for (size_t y = gy * step; y < (gy + 1) * step; y++) {
+            const uint8_t *row = luma + y * rowBytes;
+            for (size_t gx = 0; gx < gridWidth; gx++) {
+                const uint8_t *cell = row + gx * step;
+                uint32_t sum = 0;
+                for (size_t x = 0; x < step; x++) {
+                    sum += cell[x];
+                }
+                sums[gx] += sum;
+            }
+        }
+        for (size_t gx = 0; gx < gridWidth; gx++) {
+            grid[gy * gridWidth + gx] = sums[gx] / area;
+        }
+    }
+    MiSnapBufferRelease(pool, sums);
+    
+    float histogram[90] = { 0 };
+    float votes = 0;
+    for (size_t y = 1; y + 1 < gridHeight; y++) {
+        const float *r0 = grid + (y - 1) * gridWidth;
+        const float *r1 = r0 + gridWidth;
+        const float *r2 = r1 + gridWidth;
+        for (size_t x = 1; x + 1 < gridWidth; x++) {
+            float gx = (r0[x + 1] + 2 * r1[x + 1] + r2[x + 1]) - (r0[x - 1] + 2 * r1[x - 1] + r2[x - 1]);
+            float gy = (r2[x - 1] + 2 * r2[x] + r2[x + 1]) - (r0[x - 1] + 2 * r0[x] + r0[x + 1]);
+            float magnitude = fabsf(gx) + fabsf(gy);
+            if (magnitude < kEdgeThreshold) {
+                continue;
+            }
+            float degrees = atan2f(gy, gx) * (float)(180.0 / M_PI);
+            float folded = fmodf(degrees + 360.0f, 90.0f);
+            if (folded >= 45.0f) {
+                folded -= 90.0f;
+            }
+            int bin = ((int)lroundf(folded) + 90 + 45) % 90;
+            histogram[bin] += magnitude;
+            votes += magnitude;
+        }
+    }
+    MiSnapBufferRelease(pool, grid);
+    if (votes == 0) {
+        return 0;
+    }
+    
+    int peak = 0;
+    for (int bin = 1; bin < 90; bin++) {
+        if (histogram[bin] > histogram[peak]) {
+            peak = bin;
+        }
+    }
+    //Refine with the centroid of the peak and its (wrapped) neighbours
+    float weight = 0, moment = 0;
+    for (int offset = -1; offset <= 1; offset++) {
+        float h = histogram[(peak + offset + 90) % 90];
+        weight += h;
+        moment += h * offset;
+    }
+    float skew = (peak + moment / weight) - 45.0f;
+    int score = (int)lroundf(fabsf(tanf(skew * (float)(M_PI / 180.0))) * kMiSnapScoreMax);
+    return MIN(score, kMiSnapScoreMax);
+}
+
+void MiSnapScoreLumaPixels(const uint8_t *luma, size_t width, size_t height, size_t rowBytes, MiSnapFrameScore *score)
+{
+    memset(score, 0, sizeof(*score));
+    if (width < 2 || height < 2) {
+        return;
+    }
+    
+    uint64_t brightness = 0;
+    uint64_t gradient = 0;
+    for (size_t y = 0; y < height; y++) {
+        const uint8_t *row = luma + y * rowBytes;
+        brightness += MiSnapSumRow(row, width);
+        if (y + 1 < height) {
+            gradient += MiSnapGradientRow(row, row + rowBytes, width);
+        }
+    }
+    
+    score->brightness = (int)(brightness * kMiSnapScoreMax / (255 * (uint64_t)width * height));
+    float meanGradient = (float)gradient / (float)((width - 1) * (height - 1));
+    score->sharpness = (int)lroundf(kMiSnapScoreMax * (1.0f - expf(-meanGradient / kSharpnessScale)));
+}
+
+void MiSnapScoreLumaQuad(const uint8_t *luma, size_t width, size_t height, size_t rowBytes, MiSnapFrameScore *score)
+{
+    if (width < 2 || height < 2) {
+        return;
+    }
+    if (MiSnapDetectQuad(luma, width, height, rowBytes, &score->quad)) {
+        score->angle = score->quad.angle;
+    } else {
+        score->angle = MiSnapSkewScore(luma, width, height, rowBytes);
+    }
+}
+
+void MiSnapScoreLumaFrame(const uint8_t *luma, size_t width, size_t height, size_t rowBytes, MiSnapFrameScore *score)
+{
+    MiSnapScoreLumaPixels(luma, width, height, rowBytes, score);
+    MiSnapScoreLumaQuad(luma, width, height, rowBytes, score);
+}
+
+//blue and red are the byte offsets of those channels in a pixel; green is always byte 1
+static void MiSnapExtractLumaOrdered(const uint8_t *pixels, size_t width, size_t height, size_t rowBytes, int blue, int red, uint8_t *luma, size_t lumaRowBytes)
+{
+    for (size_t y = 0; y < height; y++) {
+        const uint8_t *src = pixels + y * rowBytes;
+        uint8_t *dst = luma + y * lumaRowBytes;
+        size_t x = 0;
+#if defined(__aarch64__)
+        for (; x + 16 <= width; x += 16) {
+            uint8x16x4_t px = vld4q_u8(src + 4 * x);
+            uint16x8_t lo = vmull_u8(vget_low_u8(px.val[blue]), vdup_n_u8(29));
+            lo = vmlal_u8(lo, vget_low_u8(px.val[1]), vdup_n_u8(150));
+            lo = vmlal_u8(lo, vget_low_u8(px.val[red]), vdup_n_u8(77));
+            uint16x8_t hi = vmull_u8(vget_high_u8(px.val[blue]), vdup_n_u8(29));
+            hi = vmlal_u8(hi, vget_high_u8(px.val[1]), vdup_n_u8(150));
+            hi = vmlal_u8(hi, vget_high_u8(px.val[red]), vdup_n_u8(77));
+            vst1q_u8(dst + x, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+        }
+#endif
+        for (; x < width; x++) {
+            const uint8_t *p = src + 4 * x;
+            dst[x] = (uint8_t)((29 * p[blue] + 150 * p[1] + 77 * p[red] + 128) >> 8);
+        }
+    }
+}
+
+void MiSnapExtractLuma(const uint8_t *bgra, size_t width, size_t height, size_t rowBytes, uint8_t *luma, size_t lumaRowBytes)
+{
+    MiSnapExtractLumaOrdered(bgra, width, height, rowBytes, 0, 2, luma, lumaRowBytes);
+}
+
+void MiSnapExtractLumaRGBA(const uint8_t *rgba, size_t width, size_t height, size_t rowBytes, uint8_t *luma, size_t lumaRowBytes)
+{
+    MiSnapExtractLumaOrdered(rgba, width, height, rowBytes, 2, 0, luma, lumaRowBytes);
+}
+
+bool MiSnapFrameScorePasses(const MiSnapFrameScore *score, const MiSnapFrameThresholds *thresholds)
+{
+    if (thresholds->minBrightness > 0 && score->brightness < thresholds->minBrightness) {
+        return false;
+    }
+    if (thresholds->maxBrightness > 0 && score->brightness > thresholds->maxBrightness) {
+        return false;
+    }
+    if (thresholds->sharpness > 0 && score->sharpness < thresholds->sharpness) {
+        return false;
+    }
+    if (thresholds->angle > 0 && score->angle > thresholds->angle) {
+        return false;
+    }
+    return true;
+}
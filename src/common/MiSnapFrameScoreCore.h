@@ -0,0 +1,44 @@
+
+#ifndef MiSnapFrameScoreCore_h
+#define MiSnapFrameScoreCore_h
+
+#include "MiSnapQuadCore.h"
+
+//Open implementation of the MiSnap frame quality checks. Scores use the SDK's 0-1000 scales:
+//brightness and sharpness where higher is better, angle in tenths of a percent of skew. The angle
+//is measured on the document's edges when they are found, and on the dominant edge orientation of
+//the whole frame otherwise.
+
+typedef struct {
+    int brightness;
+    int sharpness;
+    int angle;
+    MiSnapQuad quad;
+} MiSnapFrameScore;
+
+//Thresholds with the meaning of kMiSnapBrightness, kMiSnapMaxBrightness, kMiSnapSharpness and
+//kMiSnapAngle; 0 ignores the corresponding check
+typedef struct {
+    int minBrightness;
+    int maxBrightness;
+    int sharpness;
+    int angle;
+} MiSnapFrameThresholds;
+
+//Scores an 8-bit luma plane (the Y plane of an NV12 frame, or the output of MiSnapExtractLuma)
+void MiSnapScoreLumaFrame(const uint8_t *luma, size_t width, size_t height, size_t rowBytes, MiSnapFrameScore *score);
+
+//The same in two steps, for callers that time them apart: brightness and sharpness, which clear
+//the rest of the score, then the document quad and the angle
+void MiSnapScoreLumaPixels(const uint8_t *luma, size_t width, size_t height, size_t rowBytes, MiSnapFrameScore *score);
+void MiSnapScoreLumaQuad(const uint8_t *luma, size_t width, size_t height, size_t rowBytes, MiSnapFrameScore *score);
+
+//Converts a BGRA frame to 8-bit luma. luma must hold lumaRowBytes * height bytes.
+void MiSnapExtractLuma(const uint8_t *bgra, size_t width, size_t height, size_t rowBytes, uint8_t *luma, size_t lumaRowBytes);
+
+//The same for RGBA pixels, such as an Android ARGB_8888 bitmap
+void MiSnapExtractLumaRGBA(const uint8_t *rgba, size_t width, size_t height, size_t rowBytes, uint8_t *luma, size_t lumaRowBytes);
+
+bool MiSnapFrameScorePasses(const MiSnapFrameScore *score, const MiSnapFrameThresholds *thresholds);
+
+#endif
@@ -0,0 +1,112 @@
+
+#include "MiSnapFrameWindowCore.h"
+#include "MiSnapBufferPoolCore.h"
+#include <string.h>
+
+bool MiSnapFrameWindowInit(MiSnapFrameWindow *window, size_t capacity, size_t maxWidth, size_t maxHeight, double windowMs)
+{
+    memset(window, 0, sizeof(*window));
+    window->capacity = MAX((size_t)1, MIN(capacity, (size_t)kMiSnapFrameWindowMaxCandidates));
+    window->maxWidth = maxWidth;
+    window->maxHeight = maxHeight;
+    window->windowMs = MAX(0, windowMs);
+    for (size_t i = 0; i < window->capacity; i++) {
+        window->candidates[i].frame.luma = MiSnapBufferAcquire(MiSnapSharedBufferPool(), maxWidth * maxHeight);
+        window->candidates[i].frame.rowBytes = maxWidth;
+        if (window->candidates[i].frame.luma == NULL) {
+            MiSnapFrameWindowDestroy(window);
+            return false;
+        }
+    }
+    return true;
+}
+
+void MiSnapFrameWindowDestroy(MiSnapFrameWindow *window)
+{
+    for (size_t i = 0; i < kMiSnapFrameWindowMaxCandidates; i++) {
+        MiSnapBufferRelease(MiSnapSharedBufferPool(), window->candidates[i].frame.luma);
+        window->candidates[i].frame.luma = NULL;
+    }
+}
+
+void MiSnapFrameWindowReset(MiSnapFrameWindow *window)
+{
+    window->count = 0;
+    window->open = false;
+    window->closed = false;
+    window->openedMs = 0;
+    window->offered = 0;
+}
+
+bool MiSnapFrameScoreRanksAbove(const MiSnapFrameScore *a, const MiSnapFrameScore *b)
+{
+    if (a->sharpness != b->sharpness) {
+        return a->sharpness > b->sharpness;
+    }
+    return a->angle < b->angle;
+}
+
+bool MiSnapFrameWindowOffer(MiSnapFrameWindow *window, const MiSnapFrameScore *score, const uint8_t *luma, size_t width, size_t height, size_t rowBytes, uint64_t sequence, double timeMs)
+{
+    if (window->closed) {
+        return true;
+    }
+    if (window->open && timeMs - window->openedMs > window->windowMs) {
+        window->closed = true;
+        return true;
+    }
+    if (width > window->maxWidth || height > window->maxHeight) {
+        return false;
+    }
+    if (!window->open) {
+        window->open = true;
+        window->openedMs = timeMs;
+    }
+    window->offered++;
+
+    //Earlier frames win ties, so a frame has to rank strictly above one to displace it
+    size_t position = window->count;
+    while (position > 0 && MiSnapFrameScoreRanksAbove(score, &window->candidates[position - 1].score)) {
+        position--;
+    }
+    if (position < window->capacity) {
+        //Reuse the slot of the worst candidate, or a free one
+        size_t last = MIN(window->count, window->capacity - 1);
+        MiSnapWindowCandidate slot = window->candidates[last];
+        memmove(&window->candidates[position + 1], &window->candidates[position], (last - position) * sizeof(MiSnapWindowCandidate));
+        for (size_t y = 0; y < height; y++) {
+            memcpy(slot.frame.luma + y * slot.frame.rowBytes, luma + y * rowBytes, width);
+        }
+        slot.frame.width = width;
+        slot.frame.height = height;
+        slot.frame.sequence = sequence;
+        slot.score = *score;
+        slot.timeMs = timeMs;
+        window->candidates[position] = slot;
+        window->count = MIN(window->count + 1, window->capacity);
+    }
+
+    if (timeMs - window->openedMs >= window->windowMs) {
+        window->closed = true;
+    }
+    return window->closed;
+}
+
+const MiSnapWindowCandidate *MiSnapFrameWindowBest(const MiSnapFrameWindow *window)
+{
+    return window->count > 0 ? &window->candidates[0] : NULL;
+}
+
+bool MiSnapFrameWindowPoll(MiSnapFrameWindow *window, double timeMs)
+{
+    if (window->open && timeMs - window->openedMs >= window->windowMs) {
+        window->closed = true;
+    }
+    return window->closed;
+}
+
+const MiSnapWindowCandidate *MiSnapFrameWindowFinish(MiSnapFrameWindow *window)
+{
+    window->closed = true;
+    return MiSnapFrameWindowBest(window);
+}
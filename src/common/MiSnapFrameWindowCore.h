@@ -0,0 +1,62 @@
+
+#ifndef MiSnapFrameWindowCore_h
+#define MiSnapFrameWindowCore_h
+
+#include "MiSnapFrameRingCore.h"
+#include "MiSnapFrameScoreCore.h"
+
+//Best-of-window frame selection. Instead of accepting the first frame that passes the capture
+//thresholds, the window opens on that frame, stays open for a fixed time and keeps the top
+//candidates offered meanwhile in a pool of preallocated slots, ranked by sharpness and then by
+//angle. Offering a frame copies it into a slot only if it ranks among the candidates; nothing is
+//allocated after MiSnapFrameWindowInit. A window of 0 ms accepts the first frame. The window closes
+//on its deadline whether or not another passing frame comes: whoever reads it polls it first.
+
+#define kMiSnapFrameWindowMaxCandidates 8
+
+typedef struct {
+    MiSnapRingFrame frame;
+    MiSnapFrameScore score;
+    double timeMs;
+} MiSnapWindowCandidate;
+
+typedef struct {
+    MiSnapWindowCandidate candidates[kMiSnapFrameWindowMaxCandidates];     //best first
+    size_t capacity;
+    size_t count;
+    size_t maxWidth;
+    size_t maxHeight;
+    double windowMs;
+    bool open;
+    bool closed;
+    double openedMs;
+    uint64_t offered;
+} MiSnapFrameWindow;
+
+//Allocates capacity (at most kMiSnapFrameWindowMaxCandidates) slots for maxWidth x maxHeight
+//luma frames. Returns false when out of memory.
+bool MiSnapFrameWindowInit(MiSnapFrameWindow *window, size_t capacity, size_t maxWidth, size_t maxHeight, double windowMs);
+void MiSnapFrameWindowDestroy(MiSnapFrameWindow *window);
+
+//Empties the window for a new session, keeping the slots
+void MiSnapFrameWindowReset(MiSnapFrameWindow *window);
+
+//Offers a passing frame taken at timeMs. Returns true once the window has closed; frames offered
+//after that are ignored. Frames larger than the slots are ignored.
+bool MiSnapFrameWindowOffer(MiSnapFrameWindow *window, const MiSnapFrameScore *score, const uint8_t *luma, size_t width, size_t height, size_t rowBytes, uint64_t sequence, double timeMs);
+
+//Closes an open window whose deadline has passed at timeMs, on the clock of the offers. Returns
+//whether the window is closed. Call it for frames that do not pass and before reading the window.
+bool MiSnapFrameWindowPoll(MiSnapFrameWindow *window, double timeMs);
+
+//Closes the window when its frames run out before the deadline, at the end of a session or of a
+//dump, and returns the best candidate or NULL
+const MiSnapWindowCandidate *MiSnapFrameWindowFinish(MiSnapFrameWindow *window);
+
+//The best candidate so far, or NULL if no frame has been offered
+const MiSnapWindowCandidate *MiSnapFrameWindowBest(const MiSnapFrameWindow *window);
+
+//Whether a ranks above b
+bool MiSnapFrameScoreRanksAbove(const MiSnapFrameScore *a, const MiSnapFrameScore *b);
+
+#endif
@@ -0,0 +1,208 @@
+
+#include "MiSnapImageHash.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+static const uint32_t kMiSnapHashIndexMagic = 0x4948534D;      //"MSHI"
+static const uint32_t kMiSnapHashIndexVersion = 1;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t next;
+} MiSnapHashIndexHeader;
+
+static uint64_t MiSnapImageHashSumSpan(const uint8_t *row, size_t width)
+{
+    uint64_t sum = 0;
+    size_t x = 0;
+#if defined(__aarch64__)
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; x + 16 <= width; x += 16) {
+        acc = vpadalq_u16(acc, vpaddlq_u8(vld1q_u8(row + x)));
+    }
+    sum = vaddvq_u32(acc);
+#endif
+    for (; x < width; x++) {
+        sum += row[x];
+    }
+    return sum;
+}
+
+//kMiSnapImageHashCosines[u][x] = cos((2x + 1)uπ / 2N), the DCT-II basis for the rows and columns
+//of the grid
+static double kMiSnapImageHashCosines[kMiSnapImageHashSide][kMiSnapImageHashGrid];
+static pthread_once_t kMiSnapImageHashOnce = PTHREAD_ONCE_INIT;
+
+static void MiSnapImageHashBuildCosines(void)
+{
+    for (size_t u = 0; u < kMiSnapImageHashSide; u++) {
+        for (size_t x = 0; x < kMiSnapImageHashGrid; x++) {
+            kMiSnapImageHashCosines[u][x] = cos((2 * x + 1) * u * M_PI / (2 * kMiSnapImageHashGrid));
+        }
+    }
+}
+
+static int MiSnapCompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+bool MiSnapImageHashLuma(const uint8_t *luma, size_t width, size_t height, size_t rowBytes, MiSnapImageHash *hash)
+{
+    memset(hash, 0, sizeof(*hash));
+    if (width < kMiSnapImageHashGrid || height < kMiSnapImageHashGrid) {
+        return false;
+    }
+    pthread_once(&kMiSnapImageHashOnce, MiSnapImageHashBuildCosines);
+    
+    //Mean of every grid cell; cells differ in size by a pixel at most
+    size_t left[kMiSnapImageHashGrid + 1];
+    for (size_t c = 0; c <= kMiSnapImageHashGrid; c++) {
+        left[c] = c * width / kMiSnapImageHashGrid;
+    }
+    double grid[kMiSnapImageHashGrid][kMiSnapImageHashGrid];
+    for (size_t r = 0; r < kMiSnapImageHashGrid; r++) {
+        size_t top = r * height / kMiSnapImageHashGrid;
+        size_t bottom = (r + 1) * height / kMiSnapImageHashGrid;
+        uint64_t cells[kMiSnapImageHashGrid] = { 0 };
+        for (size_t y = top; y < bottom; y++) {
+            const uint8_t *row = luma + y * rowBytes;
+            for (size_t c = 0; c < kMiSnapImageHashGrid; c++) {
+                cells[c] += MiSnapImageHashSumSpan(row + left[c], left[c + 1] - left[c]);
+            }
+        }
+        for (size_t c = 0; c < kMiSnapImageHashGrid; c++) {
+            grid[r][c] = (double)cells[c] / ((bottom - top) * (left[c + 1] - left[c]));
+        }
+    }
+    
+    //Separable DCT, keeping only the lowest frequencies: rows first, then columns
+    double rows[kMiSnapImageHashGrid][kMiSnapImageHashSide];
+    for (size_t y = 0; y < kMiSnapImageHashGrid; y++) {
+        for (size_t u = 0; u < kMiSnapImageHashSide; u++) {
+            double sum = 0;
+            for (size_t x = 0; x < kMiSnapImageHashGrid; x++) {
+                sum += kMiSnapImageHashCosines[u][x] * grid[y][x];
+            }
+            rows[y][u] = sum;
+        }
+    }
+    double coefficients[kMiSnapImageHashBits];
+    for (size_t v = 0; v < kMiSnapImageHashSide; v++) {
+        for (size_t u = 0; u < kMiSnapImageHashSide; u++) {
+            double sum = 0;
+            for (size_t y = 0; y < kMiSnapImageHashGrid; y++) {
+                sum += kMiSnapImageHashCosines[v][y] * rows[y][u];
+            }
+            coefficients[v * kMiSnapImageHashSide + u] = sum;
+        }
+    }
+    
+    //The median leaves out the DC coefficient, which only carries the overall brightness
+    double sorted[kMiSnapImageHashBits - 1];
+    memcpy(sorted, coefficients + 1, sizeof(sorted));
+    qsort(sorted, kMiSnapImageHashBits - 1, sizeof(double), MiSnapCompareDoubles);
+    double median = sorted[(kMiSnapImageHashBits - 1) / 2];
+    for (size_t i = 0; i < kMiSnapImageHashBits; i++) {
+        hash->words[i / 64] |= (uint64_t)(coefficients[i] > median) << (i % 64);
+    }
+    return true;
+}
+
+int MiSnapImageHashDistance(const MiSnapImageHash *a, const MiSnapImageHash *b)
+{
+    int distance = 0;
+    for (size_t i = 0; i < kMiSnapImageHashWords; i++) {
+        distance += __builtin_popcountll(a->words[i] ^ b->words[i]);
+    }
+    return distance;
+}
+
+void MiSnapHashIndexInit(MiSnapHashIndex *index)
+{
+    memset(index, 0, sizeof(*index));
+}
+
+void MiSnapHashIndexAdd(MiSnapHashIndex *index, const MiSnapHashEntry *entry)
+{
+    index->entries[index->next] = *entry;
+    index->next = (index->next + 1) % kMiSnapHashIndexCapacity;
+    index->count = MIN(index->count + 1, kMiSnapHashIndexCapacity);
+}
+
+bool MiSnapHashIndexNearest(const MiSnapHashIndex *index, const MiSnapImageHash *hash, uint32_t tag, int maxDistance, int64_t sinceMs, MiSnapHashEntry *match, int *distance)
+{
+    const MiSnapHashEntry *best = NULL;
+    int bestDistance = maxDistance + 1;
+    //Newest first, so the strict comparison keeps the most recent of equally close entries
+    for (uint32_t i = 1; i <= index->count; i++) {
+        const MiSnapHashEntry *entry = &index->entries[(index->next + kMiSnapHashIndexCapacity - i) % kMiSnapHashIndexCapacity];
+        if (entry->tag != tag || entry->timeMs < sinceMs) {
+            continue;
+        }
+        int d = MiSnapImageHashDistance(hash, &entry->hash);
+        if (d < bestDistance) {
+            best = entry;
+            bestDistance = d;
+        }
+    }
+    if (best == NULL) {
+        return false;
+    }
+    *match = *best;
+    *distance = bestDistance;
+    return true;
+}
+
+bool MiSnapHashIndexLoad(MiSnapHashIndex *index, const char *path)
+{
+    MiSnapHashIndexInit(index);
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    MiSnapHashIndexHeader header;
+    bool loaded = fread(&header, sizeof(header), 1, file) == 1
+        && header.magic == kMiSnapHashIndexMagic && header.version == kMiSnapHashIndexVersion
+        && header.count <= kMiSnapHashIndexCapacity && header.next < kMiSnapHashIndexCapacity
+        && fread(index->entries, sizeof(index->entries), 1, file) == 1;
+    fclose(file);
+    if (!loaded) {
+        MiSnapHashIndexInit(index);
+        return false;
+    }
+    index->count = header.count;
+    index->next = header.next;
+    return true;
+}
+
+bool MiSnapHashIndexSave(const MiSnapHashIndex *index, const char *path)
+{
+    char temporary[1024];
+    if (snprintf(temporary, sizeof(temporary), "%s.tmp", path) >= (int)sizeof(temporary)) {
+        return false;
+    }
+    FILE *file = fopen(temporary, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    MiSnapHashIndexHeader header = { kMiSnapHashIndexMagic, kMiSnapHashIndexVersion, index->count, index->next };
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(index->entries, sizeof(index->entries), 1, file) == 1;
+    written = fclose(file) == 0 && written;
+    if (!written || rename(temporary, path) != 0) {
+        remove(temporary);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef MiSnapImageHash_h
+#define MiSnapImageHash_h
+
+#include "MiSnapCore.h"
+
+//Perceptual hashes of captured documents and an index of recent ones, to flag a document that is
+//captured twice before it is uploaded twice. The hash is a 256-bit DCT hash (pHash): the luma
+//plane is box-averaged onto a 32x32 grid, and each bit tells whether one of the 16x16 lowest
+//frequency DCT coefficients of the grid is above their median. Exposure changes, recompression,
+//scaling and the small shifts and skews between two crops of the same document move a recapture
+//by a few dozen bits; different documents, even on the same check stock, differ in about half.
+
+#define kMiSnapImageHashGrid 32
+#define kMiSnapImageHashSide 16
+#define kMiSnapImageHashBits (kMiSnapImageHashSide * kMiSnapImageHashSide)
+#define kMiSnapImageHashWords (kMiSnapImageHashBits / 64)
+//Distance at or below which two hashes are taken as the same document
+#define kMiSnapImageHashDuplicateDistance 48
+#define kMiSnapHashIndexCapacity 64
+
+typedef struct {
+    uint64_t words[kMiSnapImageHashWords];
+} MiSnapImageHash;
+
+typedef struct {
+    MiSnapImageHash hash;
+    int64_t timeMs;                     //wall clock, milliseconds since 1970
+    uint32_t tag;                       //the caller's, e.g. the document type; only equal tags match
+    uint32_t reserved;
+} MiSnapHashEntry;
+
+//The most recent kMiSnapHashIndexCapacity entries; older ones are overwritten. Not thread safe.
+typedef struct {
+    MiSnapHashEntry entries[kMiSnapHashIndexCapacity];
+    uint32_t count;
+    uint32_t next;                      //slot the next entry goes to
+} MiSnapHashIndex;
+
+//Returns false, with the hash zeroed, for a plane smaller than the 32x32 grid
+bool MiSnapImageHashLuma(const uint8_t *luma, size_t width, size_t height, size_t rowBytes, MiSnapImageHash *hash);
+int MiSnapImageHashDistance(const MiSnapImageHash *a, const MiSnapImageHash *b);
+
+void MiSnapHashIndexInit(MiSnapHashIndex *index);
+void MiSnapHashIndexAdd(MiSnapHashIndex *index, const MiSnapHashEntry *entry);
+
+//The closest entry with the given tag added at or after sinceMs, if it is within maxDistance.
+//Ties go to the most recent entry.
+bool MiSnapHashIndexNearest(const MiSnapHashIndex *index, const MiSnapImageHash *hash, uint32_t tag, int maxDistance, int64_t sinceMs, MiSnapHashEntry *match, int *distance);
+
+//The index is stored as a small fixed-size file, replaced atomically on save. Load leaves the
+//index empty and returns false if the file is missing or not a valid index.
+bool MiSnapHashIndexLoad(MiSnapHashIndex *index, const char *path);
+bool MiSnapHashIndexSave(const MiSnapHashIndex *index, const char *path);
+
+#endif
@@ -0,0 +1,231 @@
+
+#include "MiSnapImageScalerCore.h"
+#include "MiSnapBufferPoolCore.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+//Weights are 1.14 fixed point. Horizontally filtered rows keep 8 fractional bits in 16 bits.
+#define kMiSnapScaleWeightBits 14
+#define kMiSnapScaleRowBits 6
+#define kMiSnapScaleBandRows 16
+//Threads a resize runs on, the calling one included
+#define kMiSnapScaleMaxThreads 4
+
+//Source span and weights of every output pixel along one axis
+typedef struct {
+    size_t *first;
+    size_t *count;
+    uint16_t *weights;          //maxTaps per output pixel
+    size_t maxTaps;
+} MiSnapScaleAxis;
+
+typedef struct {
+    const uint8_t *src;
+    size_t srcWidth, srcRowBytes;
+    uint8_t *dst;
+    size_t dstWidth, dstHeight, dstRowBytes;
+    size_t channels;
+    MiSnapScaleAxis horizontal, vertical;
+    size_t bands;
+    _Atomic size_t nextBand;
+    _Atomic bool failed;
+} MiSnapScaleJob;
+
+static void MiSnapScaleAxisFree(MiSnapScaleAxis *axis)
+{
+    free(axis->first);
+    free(axis->count);
+    free(axis->weights);
+}
+
+static bool MiSnapScaleAxisInit(MiSnapScaleAxis *axis, size_t srcLength, size_t dstLength)
+{
+    double scale = (double)srcLength / dstLength;
+    axis->maxTaps = (size_t)ceil(scale) + 1;
+    axis->first = malloc(dstLength * sizeof(size_t));
+    axis->count = malloc(dstLength * sizeof(size_t));
+    axis->weights = calloc(dstLength * axis->maxTaps, sizeof(uint16_t));
+    if (!axis->first || !axis->count || !axis->weights) {
+        MiSnapScaleAxisFree(axis);
+        return false;
+    }
+    for (size_t i = 0; i < dstLength; i++) {
+        double start = i * scale, end = (i + 1) * scale;
+        size_t first = (size_t)start;
+        size_t last = MIN((size_t)ceil(end), srcLength) - 1;
+        uint16_t *weights = axis->weights + i * axis->maxTaps;
+        int total = 0, largest = 0;
+        for (size_t j = first; j <= last; j++) {
+            double coverage = MIN(end, (double)(j + 1)) - MAX(start, (double)j);
+            int weight = (int)lround(coverage / scale * (1 << kMiSnapScaleWeightBits));
+            weights[j - first] = (uint16_t)weight;
+            total += weight;
+            if (weight > weights[largest]) {
+                largest = (int)(j - first);
+            }
+        }
+        //Rounding error goes to the largest tap so that flat areas stay exactly flat
+        weights[largest] += (1 << kMiSnapScaleWeightBits) - total;
+        axis->first[i] = first;
+        axis->count[i] = last - first + 1;
+    }
+    return true;
+}
+
+static void MiSnapScaleRow(const MiSnapScaleJob *job, const uint8_t *src, uint16_t *out)
+{
+    const MiSnapScaleAxis *axis = &job->horizontal;
+    const uint32_t rounding = 1 << (kMiSnapScaleRowBits - 1);
+    if (job->channels == 4) {
+        for (size_t x = 0; x < job->dstWidth; x++) {
+            const uint8_t *pixel = src + 4 * axis->first[x];
+            const uint16_t *weights = axis->weights + x * axis->maxTaps;
+            size_t count = axis->count[x];
+#if defined(__aarch64__)
+            uint32x4_t sum = vdupq_n_u32(0);
+            for (size_t k = 0; k < count; k++) {
+                uint32_t bgra;
+                memcpy(&bgra, pixel + 4 * k, sizeof(bgra));
+                sum = vmlal_n_u16(sum, vget_low_u16(vmovl_u8(vcreate_u8(bgra))), weights[k]);
+            }
+            vst1_u16(out + 4 * x, vrshrn_n_u32(sum, kMiSnapScaleRowBits));
+#else
+            uint32_t sum[4] = { 0, 0, 0, 0 };
+            for (size_t k = 0; k < count; k++) {
+                for (int c = 0; c < 4; c++) {
+                    sum[c] += pixel[4 * k + c] * (uint32_t)weights[k];
+                }
+            }
+            for (int c = 0; c < 4; c++) {
+                out[4 * x + c] = (uint16_t)((sum[c] + rounding) >> kMiSnapScaleRowBits);
+            }
+#endif
+        }
+        return;
+    }
+    for (size_t x = 0; x < job->dstWidth; x++) {
+        const uint8_t *pixel = src + axis->first[x];
+        const uint16_t *weights = axis->weights + x * axis->maxTaps;
+        uint32_t sum = 0;
+        for (size_t k = 0; k < axis->count[x]; k++) {
+            sum += pixel[k] * (uint32_t)weights[k];
+        }
+        out[x] = (uint16_t)((sum + rounding) >> kMiSnapScaleRowBits);
+    }
+}
+
+static void MiSnapScaleColumn(const uint16_t *const *rows, const uint16_t *weights, size_t count, size_t length, uint8_t *out)
+{
+    const int shift = kMiSnapScaleWeightBits + 8;
+    size_t x = 0;
+#if defined(__aarch64__)
+    for (; x + 8 <= length; x += 8) {
+        uint32x4_t low = vdupq_n_u32(0), high = vdupq_n_u32(0);
+        for (size_t k = 0; k < count; k++) {
+            uint16x8_t value = vld1q_u16(rows[k] + x);
+            low = vmlal_n_u16(low, vget_low_u16(value), weights[k]);
+            high = vmlal_n_u16(high, vget_high_u16(value), weights[k]);
+        }
+        uint16x8_t narrowed = vcombine_u16(vmovn_u32(vrshrq_n_u32(low, kMiSnapScaleWeightBits + 8)),
+                                           vmovn_u32(vrshrq_n_u32(high, kMiSnapScaleWeightBits + 8)));
+        vst1_u8(out + x, vqmovn_u16(narrowed));
+    }
+#endif
+    for (; x < length; x++) {
+        uint32_t sum = 0;
+        for (size_t k = 0; k < count; k++) {
+            sum += rows[k][x] * (uint32_t)weights[k];
+        }
+        sum = (sum + (1u << (shift - 1))) >> shift;
+        out[x] = (uint8_t)MIN(sum, 255u);
+    }
+}
+
+//Scales output rows [band * kMiSnapScaleBandRows, ...) of the job
+static void MiSnapScaleBand(MiSnapScaleJob *job, size_t band)
+{
+    const MiSnapScaleAxis *vertical = &job->vertical;
+    size_t y0 = band * kMiSnapScaleBandRows;
+    size_t y1 = MIN(y0 + kMiSnapScaleBandRows, job->dstHeight);
+    size_t firstRow = vertical->first[y0];
+    size_t rowCount = vertical->first[y1 - 1] + vertical->count[y1 - 1] - firstRow;
+    size_t rowLength = job->dstWidth * job->channels;
+
+    MiSnapBufferPool *pool = MiSnapSharedBufferPool();
+    uint16_t *filtered = MiSnapBufferAcquire(pool, rowCount * rowLength * sizeof(uint16_t));
+    const uint16_t **rows = MiSnapBufferAcquire(pool, vertical->maxTaps * sizeof(uint16_t *));
+    if (!filtered || !rows) {
+        MiSnapBufferRelease(pool, filtered);
+        MiSnapBufferRelease(pool, rows);
+        atomic_store(&job->failed, true);
+        return;
+    }
+    for (size_t r = 0; r < rowCount; r++) {
+        MiSnapScaleRow(job, job->src + (firstRow + r) * job->srcRowBytes, filtered + r * rowLength);
+    }
+    for (size_t y = y0; y < y1; y++) {
+        for (size_t k = 0; k < vertical->count[y]; k++) {
+            rows[k] = filtered + (vertical->first[y] + k - firstRow) * rowLength;
+        }
+        MiSnapScaleColumn(rows, vertical->weights + y * vertical->maxTaps, vertical->count[y], rowLength, job->dst + y * job->dstRowBytes);
+    }
+    MiSnapBufferRelease(pool, rows);
+    MiSnapBufferRelease(pool, filtered);
+}
+
+//Takes the next band until there are none left, on the calling thread and on every worker
+static void *MiSnapScaleWorker(void *context)
+{
+    MiSnapScaleJob *job = context;
+    for (size_t band = atomic_fetch_add(&job->nextBand, 1); band < job->bands; band = atomic_fetch_add(&job->nextBand, 1)) {
+        MiSnapScaleBand(job, band);
+    }
+    return NULL;
+}
+
+bool MiSnapScaleImage(const uint8_t *src, size_t srcWidth, size_t srcHeight, size_t srcRowBytes,
+                      uint8_t *dst, size_t dstWidth, size_t dstHeight, size_t dstRowBytes, size_t channels)
+{
+    if ((channels != 1 && channels != 4) || !srcWidth || !srcHeight || !dstWidth || !dstHeight) {
+        return false;
+    }
+    MiSnapScaleJob job = {
+        .src = src, .srcWidth = srcWidth, .srcRowBytes = srcRowBytes,
+        .dst = dst, .dstWidth = dstWidth, .dstHeight = dstHeight, .dstRowBytes = dstRowBytes,
+        .channels = channels
+    };
+    atomic_init(&job.nextBand, 0);
+    atomic_init(&job.failed, false);
+    if (!MiSnapScaleAxisInit(&job.horizontal, srcWidth, dstWidth)) {
+        return false;
+    }
+    if (!MiSnapScaleAxisInit(&job.vertical, srcHeight, dstHeight)) {
+        MiSnapScaleAxisFree(&job.horizontal);
+        return false;
+    }
+    job.bands = (dstHeight + kMiSnapScaleBandRows - 1) / kMiSnapScaleBandRows;
+
+    //A worker that cannot be started leaves its bands to the others
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = MIN(MIN((size_t)MAX(cores, 1L), (size_t)kMiSnapScaleMaxThreads), job.bands);
+    pthread_t workers[kMiSnapScaleMaxThreads];
+    size_t started = 0;
+    while (started + 1 < threads && pthread_create(&workers[started], NULL, MiSnapScaleWorker, &job) == 0) {
+        started++;
+    }
+    MiSnapScaleWorker(&job);
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    MiSnapScaleAxisFree(&job.horizontal);
+    MiSnapScaleAxisFree(&job.vertical);
+    return !atomic_load(&job.failed);
+}
@@ -0,0 +1,15 @@
+
+#ifndef MiSnapImageScalerCore_h
+#define MiSnapImageScalerCore_h
+
+#include "MiSnapCore.h"
+
+//Area-average resize of 8-bit images with 1 (grayscale) or 4 (BGRA) interleaved channels. Every
+//output pixel is the exact average of the source area it covers, so downscaling does not alias.
+//Output rows are processed in bands, several at once on worker threads when there are enough of
+//them; each band keeps its horizontally filtered source rows in a small buffer that stays in
+//cache. Returns false for unsupported arguments or when buffers could not be allocated.
+bool MiSnapScaleImage(const uint8_t *src, size_t srcWidth, size_t srcHeight, size_t srcRowBytes,
+                      uint8_t *dst, size_t dstWidth, size_t dstHeight, size_t dstRowBytes, size_t channels);
+
+#endif
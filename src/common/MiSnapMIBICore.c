@@ -0,0 +1,563 @@
+
+#include "MiSnapMIBICore.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t kMiSnapMIBIMagic[2] = { 'M', 'B' };
+
+typedef enum {
+    MiSnapMIBITokenNull = 0,
+    MiSnapMIBITokenFalse,
+    MiSnapMIBITokenTrue,
+    MiSnapMIBITokenInteger,
+    MiSnapMIBITokenDouble,
+    MiSnapMIBITokenString,
+    MiSnapMIBITokenStringRef,
+    MiSnapMIBITokenArray,
+    MiSnapMIBITokenObject,
+    MiSnapMIBITokenIntegerDeltas,
+    MiSnapMIBITokenNumericString,
+    MiSnapMIBITokenRaw,
+    MiSnapMIBITokenUnsigned
+} MiSnapMIBIToken;
+
+//Nesting deeper than this is malformed rather than recursing without bound
+#define kMiSnapMIBIMaxDepth 64
+
+//Longest decimal string that always fits in an int64_t
+#define kMiSnapMIBIMaxDigits 18
+
+#pragma mark - Buffers
+
+void MiSnapMIBIBufferFree(MiSnapMIBIBuffer *buffer)
+{
+    free(buffer->bytes);
+    memset(buffer, 0, sizeof(*buffer));
+}
+
+static bool MiSnapMIBIBufferReserve(MiSnapMIBIBuffer *buffer, size_t length)
+{
+    if (buffer->failed) {
+        return false;
+    }
+    if (buffer->capacity - buffer->length >= length) {
+        return true;
+    }
+    size_t capacity = MAX(buffer->capacity * 2, MAX(buffer->length + length, 256));
+    uint8_t *bytes = realloc(buffer->bytes, capacity);
+    if (bytes == NULL) {
+        buffer->failed = true;
+        return false;
+    }
+    buffer->bytes = bytes;
+    buffer->capacity = capacity;
+    return true;
+}
+
+static void MiSnapMIBIBufferAppend(MiSnapMIBIBuffer *buffer, const void *bytes, size_t length)
+{
+    if (length > 0 && MiSnapMIBIBufferReserve(buffer, length)) {
+        memcpy(buffer->bytes + buffer->length, bytes, length);
+        buffer->length += length;
+    }
+}
+
+static void MiSnapMIBIBufferAppendString(MiSnapMIBIBuffer *buffer, const char *string)
+{
+    MiSnapMIBIBufferAppend(buffer, string, strlen(string));
+}
+
+//Zigzag and the deltas are computed on uint64_t, so INT64_MIN and INT64_MAX neighbours wrap
+//rather than overflow
+static inline uint64_t MiSnapMIBIZigZag(uint64_t value)
+{
+    return (value << 1) ^ (0 - (value >> 63));
+}
+
+static inline uint64_t MiSnapMIBIUnZigZag(uint64_t value)
+{
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+static inline int64_t MiSnapMIBISigned(uint64_t value)
+{
+    return value <= INT64_MAX ? (int64_t)value : -(int64_t)(~value) - 1;
+}
+
+static void MiSnapMIBIAppendVarint(MiSnapMIBIBuffer *buffer, uint64_t value)
+{
+    uint8_t bytes[10];
+    size_t count = 0;
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        bytes[count++] = byte | (value ? 0x80 : 0);
+    } while (value);
+    MiSnapMIBIBufferAppend(buffer, bytes, count);
+}
+
+#pragma mark - Writer
+
+typedef struct {
+    uint64_t hash;
+    size_t offset;                      //in the string arena
+    size_t length;
+    uint64_t index;                     //in the string table, plus one; 0 for an empty slot
+} MiSnapMIBISlot;
+
+struct MiSnapMIBIEncoder {
+    MiSnapMIBIBuffer pending;
+    bool started;                       //the header has been written
+    MiSnapMIBIBuffer arena;             //bytes of the interned strings
+    MiSnapMIBISlot *slots;              //open addressing, a power of two long
+    size_t slotCount;
+    size_t stringCount;
+};
+
+MiSnapMIBIEncoder *MiSnapMIBIEncoderCreate(void)
+{
+    MiSnapMIBIEncoder *encoder = calloc(1, sizeof(*encoder));
+    if (encoder == NULL) {
+        return NULL;
+    }
+    encoder->slotCount = 64;
+    encoder->slots = calloc(encoder->slotCount, sizeof(MiSnapMIBISlot));
+    if (encoder->slots == NULL) {
+        free(encoder);
+        return NULL;
+    }
+    return encoder;
+}
+
+void MiSnapMIBIEncoderFree(MiSnapMIBIEncoder *encoder)
+{
+    if (encoder == NULL) {
+        return;
+    }
+    MiSnapMIBIBufferFree(&encoder->pending);
+    MiSnapMIBIBufferFree(&encoder->arena);
+    free(encoder->slots);
+    free(encoder);
+}
+
+static void MiSnapMIBIWriteToken(MiSnapMIBIEncoder *encoder, MiSnapMIBIToken token)
+{
+    if (!encoder->started) {
+        uint8_t version = kMiSnapMIBIVersion;
+        MiSnapMIBIBufferAppend(&encoder->pending, kMiSnapMIBIMagic, sizeof(kMiSnapMIBIMagic));
+        MiSnapMIBIBufferAppend(&encoder->pending, &version, 1);
+        encoder->started = true;
+    }
+    uint8_t byte = token;
+    MiSnapMIBIBufferAppend(&encoder->pending, &byte, 1);
+}
+
+void MiSnapMIBIWriteNull(MiSnapMIBIEncoder *encoder)
+{
+    MiSnapMIBIWriteToken(encoder, MiSnapMIBITokenNull);
+}
+
+void MiSnapMIBIWriteBool(MiSnapMIBIEncoder *encoder, bool value)
+{
+    MiSnapMIBIWriteToken(encoder, value ? MiSnapMIBITokenTrue : MiSnapMIBITokenFalse);
+}
+
+void MiSnapMIBIWriteInteger(MiSnapMIBIEncoder *encoder, int64_t value)
+{
+    MiSnapMIBIWriteToken(encoder, MiSnapMIBITokenInteger);
+    MiSnapMIBIAppendVarint(&encoder->pending, MiSnapMIBIZigZag((uint64_t)value));
+}
+
+void MiSnapMIBIWriteUnsigned(MiSnapMIBIEncoder *encoder, uint64_t value)
+{
+    if (value <= INT64_MAX) {
+        MiSnapMIBIWriteInteger(encoder, (int64_t)value);
+        return;
+    }
+    MiSnapMIBIWriteToken(encoder, MiSnapMIBITokenUnsigned);
+    MiSnapMIBIAppendVarint(&encoder->pending, value);
+}
+
+void MiSnapMIBIWriteDouble(MiSnapMIBIEncoder *encoder, double value)
+{
+    MiSnapMIBIWriteToken(encoder, MiSnapMIBITokenDouble);
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (uint8_t)(bits >> (8 * i));
+    }
+    MiSnapMIBIBufferAppend(&encoder->pending, bytes, sizeof(bytes));
+}
+
+//Canonical decimal integers ("0", "-12", "345" but not "007", "-0" or "+1") fit a varint losslessly
+static bool MiSnapMIBIParseCanonicalInteger(const char *bytes, size_t length, int64_t *value)
+{
+    const char *digits = length > 0 && bytes[0] == '-' ? bytes + 1 : bytes;
+    size_t digitCount = length - (size_t)(digits - bytes);
+    if (digitCount == 0 || digitCount > kMiSnapMIBIMaxDigits || (digits[0] == '0' && (digitCount > 1 || digits != bytes))) {
+        return false;
+    }
+    int64_t result = 0;
+    for (size_t i = 0; i < digitCount; i++) {
+        if (digits[i] < '0' || digits[i] > '9') {
+            return false;
+        }
+        result = result * 10 + (digits[i] - '0');
+    }
+    *value = digits == bytes ? result : -result;
+    return true;
+}
+
+//FNV-1a
+static uint64_t MiSnapMIBIHash(const char *bytes, size_t length)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static MiSnapMIBISlot *MiSnapMIBIFindSlot(MiSnapMIBISlot *slots, size_t slotCount, const uint8_t *arena, uint64_t hash, const char *bytes, size_t length)
+{
+    for (size_t i = hash & (slotCount - 1); ; i = (i + 1) & (slotCount - 1)) {
+        MiSnapMIBISlot *slot = &slots[i];
+        if (slot->index == 0 || (slot->hash == hash && slot->length == length && (length == 0 || memcmp(arena + slot->offset, bytes, length) == 0))) {
+            return slot;
+        }
+    }
+}
+
+//Keeps the table under three quarters full
+static bool MiSnapMIBIGrowSlots(MiSnapMIBIEncoder *encoder)
+{
+    if ((encoder->stringCount + 1) * 4 < encoder->slotCount * 3) {
+        return true;
+    }
+    size_t slotCount = encoder->slotCount * 2;
+    MiSnapMIBISlot *slots = calloc(slotCount, sizeof(MiSnapMIBISlot));
+    if (slots == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < encoder->slotCount; i++) {
+        const MiSnapMIBISlot *slot = &encoder->slots[i];
+        if (slot->index == 0) {
+            continue;
+        }
+        size_t j = slot->hash & (slotCount - 1);
+        while (slots[j].index != 0) {
+            j = (j + 1) & (slotCount - 1);
+        }
+        slots[j] = *slot;
+    }
+    free(encoder->slots);
+    encoder->slots = slots;
+    encoder->slotCount = slotCount;
+    return true;
+}
+
+void MiSnapMIBIWriteString(MiSnapMIBIEncoder *encoder, const char *bytes, size_t length)
+{
+    int64_t integer;
+    uint64_t hash = MiSnapMIBIHash(bytes, length);
+    MiSnapMIBISlot *slot = MiSnapMIBIFindSlot(encoder->slots, encoder->slotCount, encoder->arena.bytes, hash, bytes, length);
+    if (slot->index != 0) {
+        MiSnapMIBIWriteToken(encoder, MiSnapMIBITokenStringRef);
+        MiSnapMIBIAppendVarint(&encoder->pending, slot->index - 1);
+        return;
+    }
+    if (MiSnapMIBIParseCanonicalInteger(bytes, length, &integer)) {
+        MiSnapMIBIWriteToken(encoder, MiSnapMIBITokenNumericString);
+        MiSnapMIBIAppendVarint(&encoder->pending, MiSnapMIBIZigZag((uint64_t)integer));
+        return;
+    }
+    MiSnapMIBIWriteToken(encoder, MiSnapMIBITokenString);
+    MiSnapMIBIAppendVarint(&encoder->pending, length);
+    MiSnapMIBIBufferAppend(&encoder->pending, bytes, length);
+
+    //The decoder adds every string token to its table, so a string that cannot be remembered here
+    //leaves the stream unusable
+    size_t offset = encoder->arena.length;
+    MiSnapMIBIBufferAppend(&encoder->arena, bytes, length);
+    if (encoder->arena.failed || !MiSnapMIBIGrowSlots(encoder)) {
+        encoder->pending.failed = true;
+        return;
+    }
+    slot = MiSnapMIBIFindSlot(encoder->slots, encoder->slotCount, encoder->arena.bytes, hash, bytes, length);
+    *slot = (MiSnapMIBISlot){ hash, offset, length, ++encoder->stringCount };
+}
+
+void MiSnapMIBIWriteArray(MiSnapMIBIEncoder *encoder, size_t count)
+{
+    MiSnapMIBIWriteToken(encoder, MiSnapMIBITokenArray);
+    MiSnapMIBIAppendVarint(&encoder->pending, count);
+}
+
+void MiSnapMIBIWriteObject(MiSnapMIBIEncoder *encoder, size_t count)
+{
+    MiSnapMIBIWriteToken(encoder, MiSnapMIBITokenObject);
+    MiSnapMIBIAppendVarint(&encoder->pending, count);
+}
+
+void MiSnapMIBIWriteIntegers(MiSnapMIBIEncoder *encoder, const int64_t *values, size_t count)
+{
+    MiSnapMIBIWriteToken(encoder, MiSnapMIBITokenIntegerDeltas);
+    MiSnapMIBIAppendVarint(&encoder->pending, count);
+    uint64_t previous = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t current = (uint64_t)values[i];
+        MiSnapMIBIAppendVarint(&encoder->pending, MiSnapMIBIZigZag(current - previous));
+        previous = current;
+    }
+}
+
+void MiSnapMIBIWriteRaw(MiSnapMIBIEncoder *encoder, const char *bytes, size_t length)
+{
+    MiSnapMIBIWriteToken(encoder, MiSnapMIBITokenRaw);
+    MiSnapMIBIAppendVarint(&encoder->pending, length);
+    MiSnapMIBIBufferAppend(&encoder->pending, bytes, length);
+}
+
+const uint8_t *MiSnapMIBIEncoderBytes(const MiSnapMIBIEncoder *encoder, size_t *length)
+{
+    *length = encoder->pending.failed ? 0 : encoder->pending.length;
+    return encoder->pending.bytes;
+}
+
+bool MiSnapMIBIEncoderFailed(const MiSnapMIBIEncoder *encoder)
+{
+    return encoder->pending.failed;
+}
+
+void MiSnapMIBIEncoderDrain(MiSnapMIBIEncoder *encoder)
+{
+    encoder->pending.length = 0;
+}
+
+#pragma mark - Reader
+
+bool MiSnapMIBIDecoderInit(MiSnapMIBIDecoder *decoder, const uint8_t *bytes, size_t length)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    if (length < sizeof(kMiSnapMIBIMagic) + 1 || memcmp(bytes, kMiSnapMIBIMagic, sizeof(kMiSnapMIBIMagic)) != 0) {
+        return false;
+    }
+    decoder->version = bytes[sizeof(kMiSnapMIBIMagic)];
+    if (decoder->version < 1 || decoder->version > kMiSnapMIBIVersion) {
+        return false;
+    }
+    decoder->bytes = bytes;
+    decoder->length = length;
+    decoder->offset = sizeof(kMiSnapMIBIMagic) + 1;
+    return true;
+}
+
+void MiSnapMIBIDecoderFree(MiSnapMIBIDecoder *decoder)
+{
+    free(decoder->strings);
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+static bool MiSnapMIBIReadVarint(MiSnapMIBIDecoder *decoder, uint64_t *value)
+{
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && decoder->offset < decoder->length; shift += 7) {
+        uint8_t byte = decoder->bytes[decoder->offset++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+//Reads a count or length and checks that the rest of the stream can hold it, each element taking
+//at least one byte, before anything is allocated for it
+static bool MiSnapMIBIReadCount(MiSnapMIBIDecoder *decoder, uint64_t *count)
+{
+    return MiSnapMIBIReadVarint(decoder, count) && *count <= decoder->length - decoder->offset;
+}
+
+static void MiSnapMIBIAppendJSONString(MiSnapMIBIBuffer *text, const uint8_t *bytes, size_t length)
+{
+    MiSnapMIBIBufferAppend(text, "\"", 1);
+    size_t run = 0;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = bytes[i];
+        if (byte >= 0x20 && byte != '"' && byte != '\\') {
+            continue;
+        }
+        MiSnapMIBIBufferAppend(text, bytes + run, i - run);
+        char escape[8];
+        if (byte == '"' || byte == '\\') {
+            snprintf(escape, sizeof(escape), "\\%c", byte);
+        } else {
+            snprintf(escape, sizeof(escape), "\\u%04x", byte);
+        }
+        MiSnapMIBIBufferAppendString(text, escape);
+        run = i + 1;
+    }
+    MiSnapMIBIBufferAppend(text, bytes + run, length - run);
+    MiSnapMIBIBufferAppend(text, "\"", 1);
+}
+
+static void MiSnapMIBIAppendInteger(MiSnapMIBIBuffer *text, int64_t value, bool quoted)
+{
+    char number[24];
+    snprintf(number, sizeof(number), quoted ? "\"%lld\"" : "%lld", (long long)value);
+    MiSnapMIBIBufferAppendString(text, number);
+}
+
+static bool MiSnapMIBIReadValue(MiSnapMIBIDecoder *decoder, MiSnapMIBIBuffer *text, int depth, bool key)
+{
+    if (decoder->offset >= decoder->length || depth > kMiSnapMIBIMaxDepth) {
+        return false;
+    }
+    uint8_t token = decoder->bytes[decoder->offset++];
+    if (key && token != MiSnapMIBITokenString && token != MiSnapMIBITokenStringRef && token != MiSnapMIBITokenNumericString) {
+        return false;
+    }
+    uint64_t value;
+    switch (token) {
+        case MiSnapMIBITokenNull:
+            MiSnapMIBIBufferAppendString(text, "null");
+            return true;
+        case MiSnapMIBITokenFalse:
+            MiSnapMIBIBufferAppendString(text, "false");
+            return true;
+        case MiSnapMIBITokenTrue:
+            MiSnapMIBIBufferAppendString(text, "true");
+            return true;
+        case MiSnapMIBITokenInteger:
+        case MiSnapMIBITokenNumericString:
+            if (!MiSnapMIBIReadVarint(decoder, &value)) {
+                return false;
+            }
+            MiSnapMIBIAppendInteger(text, MiSnapMIBISigned(MiSnapMIBIUnZigZag(value)), token == MiSnapMIBITokenNumericString);
+            return true;
+        case MiSnapMIBITokenUnsigned: {
+            if (decoder->version < 2 || !MiSnapMIBIReadVarint(decoder, &value)) {
+                return false;
+            }
+            char number[24];
+            snprintf(number, sizeof(number), "%llu", (unsigned long long)value);
+            MiSnapMIBIBufferAppendString(text, number);
+            return true;
+        }
+        case MiSnapMIBITokenDouble: {
+            if (decoder->length - decoder->offset < 8) {
+                return false;
+            }
+            uint64_t bits = 0;
+            for (int i = 0; i < 8; i++) {
+                bits |= (uint64_t)decoder->bytes[decoder->offset++] << (8 * i);
+            }
+            double number;
+            memcpy(&number, &bits, sizeof(number));
+            //JSON has no NaN or infinity; an encoder fed from JSON never produces them
+            char formatted[32];
+            snprintf(formatted, sizeof(formatted), "%.17g", number);
+            MiSnapMIBIBufferAppendString(text, isfinite(number) ? formatted : "null");
+            return true;
+        }
+        case MiSnapMIBITokenString: {
+            if (!MiSnapMIBIReadCount(decoder, &value)) {
+                return false;
+            }
+            if (decoder->stringCount == decoder->stringCapacity) {
+                size_t capacity = MAX(decoder->stringCapacity * 2, 64);
+                MiSnapMIBIString *strings = realloc(decoder->strings, capacity * sizeof(MiSnapMIBIString));
+                if (strings == NULL) {
+                    return false;
+                }
+                decoder->strings = strings;
+                decoder->stringCapacity = capacity;
+            }
+            decoder->strings[decoder->stringCount++] = (MiSnapMIBIString){ decoder->offset, (size_t)value };
+            MiSnapMIBIAppendJSONString(text, decoder->bytes + decoder->offset, (size_t)value);
+            decoder->offset += value;
+            return true;
+        }
+        case MiSnapMIBITokenStringRef: {
+            if (!MiSnapMIBIReadVarint(decoder, &value) || value >= decoder->stringCount) {
+                return false;
+            }
+            const MiSnapMIBIString *string = &decoder->strings[value];
+            MiSnapMIBIAppendJSONString(text, decoder->bytes + string->offset, string->length);
+            return true;
+        }
+        case MiSnapMIBITokenArray:
+        case MiSnapMIBITokenObject: {
+            bool object = token == MiSnapMIBITokenObject;
+            if (!MiSnapMIBIReadCount(decoder, &value)) {
+                return false;
+            }
+            MiSnapMIBIBufferAppend(text, object ? "{" : "[", 1);
+            for (uint64_t i = 0; i < value; i++) {
+                if (i > 0) {
+                    MiSnapMIBIBufferAppend(text, ",", 1);
+                }
+                if (object) {
+                    if (!MiSnapMIBIReadValue(decoder, text, depth + 1, true)) {
+                        return false;
+                    }
+                    MiSnapMIBIBufferAppend(text, ":", 1);
+                }
+                if (!MiSnapMIBIReadValue(decoder, text, depth + 1, false)) {
+                    return false;
+                }
+            }
+            MiSnapMIBIBufferAppend(text, object ? "}" : "]", 1);
+            return true;
+        }
+        case MiSnapMIBITokenIntegerDeltas: {
+            if (!MiSnapMIBIReadCount(decoder, &value)) {
+                return false;
+            }
+            MiSnapMIBIBufferAppend(text, "[", 1);
+            uint64_t current = 0;
+            for (uint64_t i = 0; i < value; i++) {
+                uint64_t delta;
+                if (!MiSnapMIBIReadVarint(decoder, &delta)) {
+                    return false;
+                }
+                current += MiSnapMIBIUnZigZag(delta);
+                if (i > 0) {
+                    MiSnapMIBIBufferAppend(text, ",", 1);
+                }
+                MiSnapMIBIAppendInteger(text, MiSnapMIBISigned(current), false);
+            }
+            MiSnapMIBIBufferAppend(text, "]", 1);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+MiSnapMIBIRecord MiSnapMIBIReadRecord(MiSnapMIBIDecoder *decoder, MiSnapMIBIBuffer *text)
+{
+    if (decoder->offset >= decoder->length) {
+        return MiSnapMIBIRecordEnd;
+    }
+    if (decoder->bytes[decoder->offset] == MiSnapMIBITokenRaw) {
+        decoder->offset++;
+        uint64_t length;
+        if (!MiSnapMIBIReadCount(decoder, &length)) {
+            decoder->offset = decoder->length;
+            return MiSnapMIBIRecordMalformed;
+        }
+        MiSnapMIBIBufferAppend(text, decoder->bytes + decoder->offset, (size_t)length);
+        decoder->offset += length;
+        return text->failed ? MiSnapMIBIRecordMalformed : MiSnapMIBIRecordRaw;
+    }
+    if (!MiSnapMIBIReadValue(decoder, text, 0, false) || text->failed) {
+        decoder->offset = decoder->length;
+        return MiSnapMIBIRecordMalformed;
+    }
+    return MiSnapMIBIRecordJSON;
+}
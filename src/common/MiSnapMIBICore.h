@@ -0,0 +1,109 @@
+#ifndef MiSnapMIBICore_h
+#define MiSnapMIBICore_h
+
+#include "MiSnapCore.h"
+
+//Compact binary encoding for MIBI/UXP telemetry (kMiSnapMIBIData): an encoder that turns values
+//into a token stream and a decoder that turns the stream back into JSON text.
+//
+//Format, version 2
+//
+//A stream starts with the bytes 'M' 'B' and the version, followed by records. A record is one
+//value; a value is a token byte and its operands:
+//
+//    0  null
+//    1  false
+//    2  true
+//    3  integer          varint of the zigzag of a signed 64-bit integer
+//    4  double           8 bytes, IEEE 754, little endian
+//    5  string           varint length + UTF-8; appended to the string table
+//    6  string ref       varint index into the string table
+//    7  array            varint count + count values
+//    8  object           varint count + count (key, value) pairs; keys are string, string ref
+//                        or numeric string values
+//    9  integer deltas   varint count + count varints: the zigzag of the first integer, then of
+//                        the difference to the previous one, computed modulo 2^64
+//    10 numeric string   varint of the zigzag of a canonical decimal string ("0", "-12" but
+//                        not "007", "+1" or more than 18 digits), which decodes to that string
+//    11 raw              varint length + UTF-8 of a payload that is not a JSON object or array
+//    12 unsigned         varint of an integer above 2^63 - 1
+//
+//Varints are little endian base 128, at most 10 bytes. The string table starts empty and is
+//shared by every record of the stream, so a record can reference strings of earlier ones: the
+//chunks an encoder hands out over a session decode only as one stream, in order. Version 1 streams
+//(no unsigned token) decode as well.
+
+#define kMiSnapMIBIVersion 2
+
+typedef struct {
+    uint8_t *bytes;
+    size_t length;
+    size_t capacity;
+    bool failed;                        //an allocation failed, the contents are incomplete
+} MiSnapMIBIBuffer;
+
+void MiSnapMIBIBufferFree(MiSnapMIBIBuffer *buffer);
+
+typedef struct MiSnapMIBIEncoder MiSnapMIBIEncoder;
+
+//Returns NULL if out of memory
+MiSnapMIBIEncoder *MiSnapMIBIEncoderCreate(void);
+void MiSnapMIBIEncoderFree(MiSnapMIBIEncoder *encoder);
+
+//One call per value. A container is written as its count followed by that many values; for
+//an object, each key (MiSnapMIBIWriteString) followed by its value.
+void MiSnapMIBIWriteNull(MiSnapMIBIEncoder *encoder);
+void MiSnapMIBIWriteBool(MiSnapMIBIEncoder *encoder, bool value);
+void MiSnapMIBIWriteInteger(MiSnapMIBIEncoder *encoder, int64_t value);
+//Written as an integer when it fits in one
+void MiSnapMIBIWriteUnsigned(MiSnapMIBIEncoder *encoder, uint64_t value);
+void MiSnapMIBIWriteDouble(MiSnapMIBIEncoder *encoder, double value);
+void MiSnapMIBIWriteString(MiSnapMIBIEncoder *encoder, const char *bytes, size_t length);
+void MiSnapMIBIWriteArray(MiSnapMIBIEncoder *encoder, size_t count);
+void MiSnapMIBIWriteObject(MiSnapMIBIEncoder *encoder, size_t count);
+//An array of integers, delta coded
+void MiSnapMIBIWriteIntegers(MiSnapMIBIEncoder *encoder, const int64_t *values, size_t count);
+//A record that is not JSON, kept as is
+void MiSnapMIBIWriteRaw(MiSnapMIBIEncoder *encoder, const char *bytes, size_t length);
+
+//The bytes written since the last drain, the first time starting with the header
+const uint8_t *MiSnapMIBIEncoderBytes(const MiSnapMIBIEncoder *encoder, size_t *length);
+//Whether an allocation failed since the encoder was created; the stream cannot be continued then
+//and the pending bytes are empty
+bool MiSnapMIBIEncoderFailed(const MiSnapMIBIEncoder *encoder);
+//Hands out the pending bytes; the string table is kept for the records that follow
+void MiSnapMIBIEncoderDrain(MiSnapMIBIEncoder *encoder);
+
+typedef struct {
+    size_t offset;
+    size_t length;
+} MiSnapMIBIString;
+
+typedef struct {
+    const uint8_t *bytes;
+    size_t length;
+    size_t offset;
+    int version;
+    MiSnapMIBIString *strings;
+    size_t stringCount;
+    size_t stringCapacity;
+} MiSnapMIBIDecoder;
+
+typedef enum {
+    MiSnapMIBIRecordJSON,               //a JSON object or array (or any value)
+    MiSnapMIBIRecordRaw,                //a payload that was not JSON, as it was appended
+    MiSnapMIBIRecordEnd,
+    MiSnapMIBIRecordMalformed
+} MiSnapMIBIRecord;
+
+//Reads a whole stream: every chunk of one encoder, concatenated in order. Returns false if the
+//header is not a supported MIBI header. The bytes must stay valid while the decoder is used.
+bool MiSnapMIBIDecoderInit(MiSnapMIBIDecoder *decoder, const uint8_t *bytes, size_t length);
+void MiSnapMIBIDecoderFree(MiSnapMIBIDecoder *decoder);
+
+//Appends the next record to text: JSON with object keys in stream order and numeric strings as
+//strings, or the raw payload. Never reads outside the stream; nesting deeper than 64 levels, a
+//truncated value or an unknown token is malformed, and reading stops there.
+MiSnapMIBIRecord MiSnapMIBIReadRecord(MiSnapMIBIDecoder *decoder, MiSnapMIBIBuffer *text);
+
+#endif
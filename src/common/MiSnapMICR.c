@@ -0,0 +1,521 @@
+
+#include "MiSnapMICR.h"
+#include "MiSnapBufferPoolCore.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kMiSnapMICRGlyphColumns 7
+#define kMiSnapMICRGlyphRows 9
+#define kMiSnapMICRGlyphCount 14
+#define kMiSnapMICRMaxComponents 4096
+
+//The glyphs on the 7x9 design grid of E-13B (units of 0.013"), left aligned, top row first
+static const char kMiSnapMICRGlyphCharacters[kMiSnapMICRGlyphCount] = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'T', '$', 'U', '-'
+};
+static const char *const kMiSnapMICRGlyphs[kMiSnapMICRGlyphCount][kMiSnapMICRGlyphRows] = {
+    { ".XXXXX.", ".X...X.", ".X...X.", ".X...X.", "XX...XX", "XX...XX", "XX...XX", "XX...XX", "XXXXXXX" },
+    { "XXX....", "..X....", "..X....", "..X....", "..XX...", "..XX...", "..XX...", "..XX...", "XXXXX.." },
+    { "XXXXX..", "....X..", "....X..", "....X..", "XXXXX..", "XX.....", "XX.....", "XX.....", "XXXXXX." },
+    { "XXXXX..", "....X..", "....X..", "....X..", ".XXXXXX", "....XXX", "....XXX", "....XXX", "XXXXXXX" },
+    { "X......", "X......", "X..X...", "X..X...", "XXXXXXX", "...XX..", "...XX..", "...XX..", "...XX.." },
+    { "XXXXX..", "X......", "X......", "X......", "XXXXXXX", ".....XX", ".....XX", ".....XX", "XXXXXXX" },
+    { "XXXX...", "X......", "X......", "X......", "XXXXXXX", "XX...XX", "XX...XX", "XX...XX", "XXXXXXX" },
+    { "XXXXXXX", "X....X.", ".....X.", "....X..", "....X..", "...XX..", "...XX..", "...XX..", "...XX.." },
+    { ".XXXX..", ".X..X..", ".X..X..", ".XXXX..", "XXXXXXX", "XX...XX", "XX...XX", "XX...XX", "XXXXXXX" },
+    { "XXXXXXX", "X....XX", "X....XX", "X....XX", "XXXXXXX", ".....XX", ".....XX", ".....XX", ".....XX" },
+    { "XX.....", "XX..XXX", "XX..XXX", "XX.....", "XX.....", "XX.....", "XX..XXX", "XX..XXX", "XX....." },
+    { "XX..XX.", "XX..XX.", "....XX.", "....XX.", "....XX.", "....XX.", "....XX.", "XX..XX.", "XX..XX." },
+    { "XX.XX..", "XX.XX..", "XX.XX..", "XX.XX..", "XX.XX..", "XX.XX..", ".......", "XXXXX..", "XXXXX.." },
+    { "XX.....", "XX.....", "XX.....", "...XX..", "...XX..", "...XX..", ".....XX", ".....XX", ".....XX" }
+};
+
+//Character pitch in design units: 0.125" over 0.013"
+static const double kMiSnapMICRPitchUnits = 0.125 / 0.013;
+//Sum of squared cell differences above which a character is rejected
+static const double kMiSnapMICRRejectDistance = 12.0;
+
+typedef struct {
+    int x0, y0, x1, y1;                 //inclusive, in strip coordinates
+    int area;
+} MiSnapMICRComponent;
+
+//A straight line y = a + b x through the tops or the bottoms of the characters
+typedef struct {
+    double a, b;
+} MiSnapMICRFit;
+
+static uint32_t MiSnapMICRFindRoot(uint32_t *parent, uint32_t label)
+{
+    while (parent[label] != label) {
+        parent[label] = parent[parent[label]];
+        label = parent[label];
+    }
+    return label;
+}
+
+static void MiSnapMICRUnion(uint32_t *parent, uint32_t a, uint32_t b)
+{
+    a = MiSnapMICRFindRoot(parent, a);
+    b = MiSnapMICRFindRoot(parent, b);
+    if (a < b) {
+        parent[b] = a;
+    } else if (b < a) {
+        parent[a] = b;
+    }
+}
+
+//Ink is darker than the mean of the (2 * radius + 1) square around it by more than 18%
+static void MiSnapMICRBinarize(const uint8_t *luma, size_t rowBytes, int width, int height, int radius, uint32_t *integral, uint8_t *ink)
+{
+    size_t stride = (size_t)width + 1;
+    memset(integral, 0, stride * sizeof(uint32_t));
+    for (int y = 0; y < height; y++) {
+        const uint8_t *row = luma + (size_t)y * rowBytes;
+        uint32_t *above = integral + (size_t)y * stride;
+        uint32_t *current = above + stride;
+        uint32_t sum = 0;
+        current[0] = 0;
+        for (int x = 0; x < width; x++) {
+            sum += row[x];
+            current[x + 1] = above[x + 1] + sum;
+        }
+    }
+    for (int y = 0; y < height; y++) {
+        const uint8_t *row = luma + (size_t)y * rowBytes;
+        uint8_t *out = ink + (size_t)y * width;
+        int top = MAX(y - radius, 0), bottom = MIN(y + radius + 1, height);
+        const uint32_t *upper = integral + (size_t)top * stride;
+        const uint32_t *lower = integral + (size_t)bottom * stride;
+        for (int x = 0; x < width; x++) {
+            int left = MAX(x - radius, 0), right = MIN(x + radius + 1, width);
+            uint32_t sum = lower[right] - lower[left] - upper[right] + upper[left];
+            uint32_t area = (uint32_t)((bottom - top) * (right - left));
+            out[x] = (uint64_t)row[x] * area * 100 < (uint64_t)sum * 82;
+        }
+    }
+}
+
+//Labels the 8-connected ink components and returns how many there are, at most maxComponents;
+//the smallest ones are dropped first if there are more. labels and parent come from the caller.
+static size_t MiSnapMICRComponents(const uint8_t *ink, int width, int height, uint32_t *labels, uint32_t *parent, MiSnapMICRComponent *components, size_t maxComponents)
+{
+    uint32_t next = 1;
+    parent[0] = 0;
+    for (int y = 0; y < height; y++) {
+        const uint8_t *row = ink + (size_t)y * width;
+        uint32_t *current = labels + (size_t)y * width;
+        const uint32_t *above = y > 0 ? current - width : NULL;
+        for (int x = 0; x < width; x++) {
+            if (!row[x]) {
+                current[x] = 0;
+                continue;
+            }
+            uint32_t label = x > 0 ? current[x - 1] : 0;
+            if (above) {
+                uint32_t neighbors[3] = { x > 0 ? above[x - 1] : 0, above[x], x + 1 < width ? above[x + 1] : 0 };
+                for (int i = 0; i < 3; i++) {
+                    if (neighbors[i] == 0) {
+                        continue;
+                    }
+                    if (label == 0) {
+                        label = neighbors[i];
+                    } else if (neighbors[i] != label) {
+                        MiSnapMICRUnion(parent, label, neighbors[i]);
+                    }
+                }
+            }
+            if (label == 0) {
+                label = next++;
+                parent[label] = label;
+            }
+            current[x] = label;
+        }
+    }
+
+    //Reuse parent to map every label to its component, then gather the bounding boxes. A label's
+    //parent is never larger than the label, so it has been mapped by the time the label is reached.
+    size_t count = 0;
+    for (uint32_t label = 1; label < next; label++) {
+        uint32_t up = parent[label];
+        parent[label] = up == label ? (uint32_t)count++ : parent[up];
+    }
+    MiSnapMICRComponent *boxes = malloc(MAX(count, 1) * sizeof(MiSnapMICRComponent));
+    if (boxes == NULL) {
+        return 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        boxes[i] = (MiSnapMICRComponent){ width, height, -1, -1, 0 };
+    }
+    for (int y = 0; y < height; y++) {
+        const uint32_t *row = labels + (size_t)y * width;
+        for (int x = 0; x < width; x++) {
+            if (row[x] == 0) {
+                continue;
+            }
+            MiSnapMICRComponent *box = &boxes[parent[row[x]]];
+            box->x0 = MIN(box->x0, x);
+            box->x1 = MAX(box->x1, x);
+            box->y0 = MIN(box->y0, y);
+            box->y1 = MAX(box->y1, y);
+            box->area++;
+        }
+    }
+
+    //Specks of background pattern and noise are of no use; keep the largest components
+    size_t kept = 0;
+    int minArea = 1;
+    while (1) {
+        kept = 0;
+        for (size_t i = 0; i < count; i++) {
+            kept += boxes[i].area >= minArea;
+        }
+        if (kept <= maxComponents) {
+            break;
+        }
+        minArea *= 2;
+    }
+    kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (boxes[i].area >= minArea) {
+            components[kept++] = boxes[i];
+        }
+    }
+    free(boxes);
+    return kept;
+}
+
+static MiSnapMICRFit MiSnapMICRFitLine(const double *xs, const double *ys, size_t count)
+{
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (size_t i = 0; i < count; i++) {
+        sx += xs[i];
+        sy += ys[i];
+        sxx += xs[i] * xs[i];
+        sxy += xs[i] * ys[i];
+    }
+    double n = (double)count;
+    double denominator = n * sxx - sx * sx;
+    MiSnapMICRFit fit;
+    fit.b = count > 1 && fabs(denominator) > 1e-9 ? (n * sxy - sx * sy) / denominator : 0;
+    fit.a = (sy - fit.b * sx) / n;
+    return fit;
+}
+
+static double MiSnapMICRFitAt(MiSnapMICRFit fit, double x)
+{
+    return fit.a + fit.b * x;
+}
+
+static int MiSnapMICRCompareInts(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static int MiSnapMICRCompareLeft(const void *a, const void *b)
+{
+    const MiSnapMICRComponent *x = a, *y = b;
+    return (x->x0 > y->x0) - (x->x0 < y->x0);
+}
+
+static bool MiSnapMICRIsCharacterHeight(const MiSnapMICRComponent *component, int minHeight, int maxHeight)
+{
+    int height = component->y1 - component->y0 + 1;
+    int width = component->x1 - component->x0 + 1;
+    return height >= minHeight && height <= maxHeight && width * 10 <= height * 11;
+}
+
+static bool MiSnapMICRSameRow(const MiSnapMICRComponent *anchor, const MiSnapMICRComponent *other)
+{
+    int anchorHeight = anchor->y1 - anchor->y0 + 1;
+    int height = other->y1 - other->y0 + 1;
+    double dx = fabs((other->x0 + other->x1) / 2.0 - (anchor->x0 + anchor->x1) / 2.0);
+    return abs(height - anchorHeight) * 5 <= anchorHeight
+        && fabs((double)(other->y1 - anchor->y1)) <= 0.3 * anchorHeight + 0.035 * dx;
+}
+
+//Finds the lowest row of at least six components of about the same height, up to about 2 degrees
+//off horizontal, among the components above ceiling. Fits the tops and the bottoms of its
+//characters and returns their median height, or 0 if there is no such row.
+static double MiSnapMICRFindLine(const MiSnapMICRComponent *components, size_t count, int minHeight, int maxHeight, MiSnapMICRFit ceiling, MiSnapMICRFit *top, MiSnapMICRFit *bottom)
+{
+    size_t candidates = 0;
+    size_t *indices = malloc(MAX(count, 1) * 2 * sizeof(size_t));
+    if (indices == NULL) {
+        return 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const MiSnapMICRComponent *component = &components[i];
+        if (MiSnapMICRIsCharacterHeight(component, minHeight, maxHeight)
+            && component->y1 < MiSnapMICRFitAt(ceiling, (component->x0 + component->x1) / 2.0)) {
+            indices[candidates++] = i;
+        }
+    }
+    const MiSnapMICRComponent *anchor = NULL;
+    for (size_t i = 0; i < candidates; i++) {
+        const MiSnapMICRComponent *candidate = &components[indices[i]];
+        if (anchor != NULL && candidate->y1 <= anchor->y1) {
+            continue;
+        }
+        size_t rowCount = 0;
+        for (size_t j = 0; j < candidates && rowCount < 6; j++) {
+            rowCount += MiSnapMICRSameRow(candidate, &components[indices[j]]);
+        }
+        if (rowCount >= 6) {
+            anchor = candidate;
+        }
+    }
+    if (anchor == NULL) {
+        free(indices);
+        return 0;
+    }
+    size_t *members = indices + count;
+    size_t memberCount = 0;
+    for (size_t j = 0; j < candidates; j++) {
+        if (MiSnapMICRSameRow(anchor, &components[indices[j]])) {
+            members[memberCount++] = indices[j];
+        }
+    }
+
+    //Fit the row, then refit without the members that are off the fit
+    double height = 0;
+    int anchorHeight = anchor->y1 - anchor->y0 + 1;
+    double *xs = malloc(memberCount * 3 * sizeof(double));
+    int *heights = malloc(memberCount * sizeof(int));
+    if (xs != NULL && heights != NULL) {
+        double *tops = xs + memberCount, *bottoms = tops + memberCount;
+        for (int pass = 0; pass < 2; pass++) {
+            size_t fitCount = 0;
+            for (size_t j = 0; j < memberCount; j++) {
+                const MiSnapMICRComponent *member = &components[members[j]];
+                double x = (member->x0 + member->x1) / 2.0;
+                if (pass == 1 && fabs(member->y1 - MiSnapMICRFitAt(*bottom, x)) > 0.12 * anchorHeight) {
+                    continue;
+                }
+                xs[fitCount] = x;
+                tops[fitCount] = member->y0;
+                bottoms[fitCount] = member->y1;
+                heights[fitCount] = member->y1 - member->y0 + 1;
+                fitCount++;
+            }
+            if (fitCount < 2) {
+                height = 0;
+                break;
+            }
+            *top = MiSnapMICRFitLine(xs, tops, fitCount);
+            *bottom = MiSnapMICRFitLine(xs, bottoms, fitCount);
+            qsort(heights, fitCount, sizeof(int), MiSnapMICRCompareInts);
+            height = heights[fitCount / 2];
+        }
+    }
+    free(xs);
+    free(heights);
+    free(indices);
+    return height;
+}
+
+//Samples the character whose left edge is at x on the 7x9 grid (ink fraction per cell) and matches
+//it against the glyphs
+static MiSnapMICRCharacter MiSnapMICRRecognize(const uint8_t *ink, int width, int height, double x, double unit, MiSnapMICRFit top, MiSnapMICRFit bottom)
+{
+    double cells[kMiSnapMICRGlyphRows][kMiSnapMICRGlyphColumns];
+    double middle = x + unit * kMiSnapMICRGlyphColumns / 2;
+    double y0 = MiSnapMICRFitAt(top, middle), y1 = MiSnapMICRFitAt(bottom, middle) + 1;
+    double rowHeight = (y1 - y0) / kMiSnapMICRGlyphRows;
+    for (int row = 0; row < kMiSnapMICRGlyphRows; row++) {
+        int cellTop = MAX((int)lround(y0 + row * rowHeight), 0);
+        int cellBottom = MIN((int)lround(y0 + (row + 1) * rowHeight), height);
+        for (int column = 0; column < kMiSnapMICRGlyphColumns; column++) {
+            int cellLeft = MAX((int)lround(x + column * unit), 0);
+            int cellRight = MIN((int)lround(x + (column + 1) * unit), width);
+            int inked = 0, total = 0;
+            for (int y = cellTop; y < cellBottom; y++) {
+                const uint8_t *pixels = ink + (size_t)y * width;
+                for (int cx = cellLeft; cx < cellRight; cx++) {
+                    inked += pixels[cx];
+                }
+                total += MAX(cellRight - cellLeft, 0);
+            }
+            cells[row][column] = total > 0 ? (double)inked / total : 0;
+        }
+    }
+
+    double best = INFINITY, second = INFINITY;
+    int bestGlyph = 0;
+    for (int glyph = 0; glyph < kMiSnapMICRGlyphCount; glyph++) {
+        double distance = 0;
+        for (int row = 0; row < kMiSnapMICRGlyphRows; row++) {
+            const char *pattern = kMiSnapMICRGlyphs[glyph][row];
+            for (int column = 0; column < kMiSnapMICRGlyphColumns; column++) {
+                double difference = cells[row][column] - (pattern[column] == 'X');
+                distance += difference * difference;
+            }
+        }
+        if (distance < best) {
+            second = best;
+            best = distance;
+            bestGlyph = glyph;
+        } else if (distance < second) {
+            second = distance;
+        }
+    }
+    MiSnapMICRCharacter character = { '?', 0 };
+    if (best <= kMiSnapMICRRejectDistance) {
+        character.character = kMiSnapMICRGlyphCharacters[bestGlyph];
+        character.confidence = second > 0 ? (float)((second - best) / second) : 0;
+    }
+    return character;
+}
+
+static void MiSnapMICRFindRouting(MiSnapMICRLine *line)
+{
+    const char *transit = strchr(line->text, 'T');
+    while (transit != NULL) {
+        bool digits = strlen(transit) >= 11 && transit[10] == 'T';
+        for (int i = 1; digits && i <= 9; i++) {
+            digits = transit[i] >= '0' && transit[i] <= '9';
+        }
+        if (digits) {
+            memcpy(line->routing, transit + 1, 9);
+            line->routing[9] = '\0';
+            line->routingValid = MiSnapMICRRoutingValid(line->routing);
+            return;
+        }
+        transit = strchr(transit + 1, 'T');
+    }
+}
+
+const char *const *MiSnapMICRGlyph(char character)
+{
+    for (int glyph = 0; glyph < kMiSnapMICRGlyphCount; glyph++) {
+        if (kMiSnapMICRGlyphCharacters[glyph] == character) {
+            return kMiSnapMICRGlyphs[glyph];
+        }
+    }
+    return NULL;
+}
+
+bool MiSnapMICRRoutingValid(const char *routing)
+{
+    static const int weights[9] = { 3, 7, 1, 3, 7, 1, 3, 7, 1 };
+    if (routing == NULL || strlen(routing) != 9) {
+        return false;
+    }
+    int sum = 0;
+    for (int i = 0; i < 9; i++) {
+        if (routing[i] < '0' || routing[i] > '9') {
+            return false;
+        }
+        sum += weights[i] * (routing[i] - '0');
+    }
+    return sum % 10 == 0;
+}
+
+//Cuts the line between top and bottom into characters and reads them. A character starts at the
+//leftmost part not yet taken and takes every part starting within its 7 unit width; what is left of
+//the pitch is the gap to the next one. False if fewer than six characters are read or more than a
+//quarter of them are rejected, i.e. this is not a MICR line.
+static bool MiSnapMICRReadLine(const MiSnapMICRComponent *components, size_t count, MiSnapMICRComponent *parts, const uint8_t *ink, int width, int height, double characterHeight, MiSnapMICRFit top, MiSnapMICRFit bottom, MiSnapMICRLine *line)
+{
+    memset(line, 0, sizeof(*line));
+
+    //Everything on the line, including the separate strokes of the symbols and the short parts of
+    //on-us and dash, sorted left to right
+    double unit = characterHeight / kMiSnapMICRGlyphRows;
+    double pitch = unit * kMiSnapMICRPitchUnits;
+    double slack = 0.15 * characterHeight;
+    int minArea = MAX(2, (int)(1.5 * unit * unit));
+    size_t partCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        const MiSnapMICRComponent *component = &components[i];
+        double x = (component->x0 + component->x1) / 2.0, y = (component->y0 + component->y1) / 2.0;
+        double lineTop = MiSnapMICRFitAt(top, x), lineBottom = MiSnapMICRFitAt(bottom, x);
+        if (component->area >= minArea && y > lineTop && y < lineBottom
+            && component->y0 >= lineTop - slack && component->y1 <= lineBottom + slack
+            && component->x1 - component->x0 + 1 <= 1.2 * characterHeight) {
+            parts[partCount++] = *component;
+        }
+    }
+    qsort(parts, partCount, sizeof(MiSnapMICRComponent), MiSnapMICRCompareLeft);
+
+    size_t length = 0, rejected = 0;
+    double previous = -INFINITY;
+    for (size_t i = 0; i < partCount && line->count < kMiSnapMICRMaxCharacters;) {
+        double left = parts[i].x0;
+        int area = 0;
+        for (; i < partCount && parts[i].x0 < left + 0.78 * pitch; i++) {
+            area += parts[i].area;
+        }
+        if (area < 6 * unit * unit) {
+            continue;
+        }
+        if (line->count > 0 && left - previous > 1.5 * pitch) {
+            line->text[length++] = ' ';
+        }
+        MiSnapMICRCharacter character = MiSnapMICRRecognize(ink, width, height, left, unit, top, bottom);
+        line->characters[line->count++] = character;
+        line->text[length++] = character.character;
+        rejected += character.character == '?';
+        previous = left;
+    }
+    line->text[length] = '\0';
+    return line->count >= 6 && rejected * 4 <= line->count;
+}
+
+bool MiSnapMICRRead(const uint8_t *luma, size_t width, size_t height, size_t rowBytes, MiSnapMICRLine *line)
+{
+    memset(line, 0, sizeof(*line));
+    if (width < 256 || height < 64 || width > INT32_MAX / 4) {
+        return false;
+    }
+
+    //The clear band of a check is its bottom 5/8"; a little more allows for the crop
+    int stripWidth = (int)width;
+    int stripHeight = (int)(height * 3 / 10);
+    const uint8_t *strip = luma + (height - stripHeight) * rowBytes;
+    size_t pixels = (size_t)stripWidth * stripHeight;
+    size_t maxLabels = (size_t)((stripWidth + 1) / 2) * ((stripHeight + 1) / 2) + 2;
+    MiSnapBufferPool *pool = MiSnapSharedBufferPool();
+    uint32_t *labels = MiSnapBufferAcquire(pool, pixels * sizeof(uint32_t));
+    uint32_t *parent = MiSnapBufferAcquire(pool, MAX(maxLabels, (size_t)(stripWidth + 1) * (stripHeight + 1)) * sizeof(uint32_t));
+    uint8_t *ink = MiSnapBufferAcquire(pool, pixels);
+    MiSnapMICRComponent *components = malloc(2 * kMiSnapMICRMaxComponents * sizeof(MiSnapMICRComponent));
+    bool found = false;
+    if (labels != NULL && parent != NULL && ink != NULL && components != NULL) {
+        //The integral image for the threshold goes in parent, which the labelling overwrites after
+        MiSnapMICRBinarize(strip, rowBytes, stripWidth, stripHeight, MAX(8, stripWidth / 64), parent, ink);
+        size_t count = MiSnapMICRComponents(ink, stripWidth, stripHeight, labels, parent, components, kMiSnapMICRMaxComponents);
+
+        //Characters are 0.117" tall on checks 6" to 8.75" wide. The MICR line is the lowest row of
+        //them; when a row turns out not to read as one (the bottom edge of the check, printing
+        //in the clear band) the next row up is tried.
+        int minHeight = MAX(9, stripWidth / 140), maxHeight = MAX(minHeight + 1, stripWidth / 30);
+        MiSnapMICRFit ceiling = { stripHeight + 1.0, 0 };
+        for (int attempt = 0; attempt < 3 && !found; attempt++) {
+            MiSnapMICRFit top, bottom;
+            double characterHeight = MiSnapMICRFindLine(components, count, minHeight, maxHeight, ceiling, &top, &bottom);
+            if (characterHeight <= 0) {
+                break;
+            }
+            found = MiSnapMICRReadLine(components, count, components + kMiSnapMICRMaxComponents, ink, stripWidth, stripHeight, characterHeight, top, bottom, line);
+            ceiling = top;
+        }
+    }
+    if (found) {
+        line->confidence = 1;
+        for (size_t i = 0; i < line->count; i++) {
+            line->confidence = MIN(line->confidence, line->characters[i].confidence);
+        }
+        MiSnapMICRFindRouting(line);
+    } else {
+        memset(line, 0, sizeof(*line));
+    }
+
+    MiSnapBufferRelease(pool, labels);
+    MiSnapBufferRelease(pool, parent);
+    MiSnapBufferRelease(pool, ink);
+    free(components);
+    return found;
+}
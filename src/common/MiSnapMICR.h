@@ -0,0 +1,43 @@
+#ifndef MiSnapMICR_h
+#define MiSnapMICR_h
+
+#include "MiSnapCore.h"
+
+//Reads the E-13B MICR line at the bottom of a check front on the device, so the routing number can
+//be checked before the image is uploaded. The bottom of the luma plane is binarized against its
+//local mean, the line is found as the lowest row of connected components of character height, it
+//is cut into characters at the fixed E-13B pitch (0.125" for characters 0.117" tall) and each
+//character, sampled on the 7x9 design grid of the font, is matched against the 14 E-13B glyphs.
+//
+//Characters are reported as the digits plus 'T' for transit, '$' for amount, 'U' for on-us and
+//'-' for dash; a character that matches no glyph well is '?'. Fields are separated by a space
+//wherever the gap between two characters is wider than one and a half character positions.
+
+#define kMiSnapMICRMaxCharacters 80
+
+typedef struct {
+    char character;
+    float confidence;                   //0 to 1: how much better the glyph matched than the runner up
+} MiSnapMICRCharacter;
+
+typedef struct {
+    char text[2 * kMiSnapMICRMaxCharacters + 1];
+    MiSnapMICRCharacter characters[kMiSnapMICRMaxCharacters];
+    size_t count;                       //characters, not counting the spaces in text
+    float confidence;                   //lowest character confidence
+    char routing[10];                   //the nine digits between the first two transit symbols, or empty
+    bool routingValid;                  //routing passes the ABA checksum
+} MiSnapMICRLine;
+
+//Returns false, with line emptied, if no MICR line is found in the bottom of the plane. The plane
+//should be the cropped check, at least 1000 pixels wide for characters to be read reliably.
+bool MiSnapMICRRead(const uint8_t *luma, size_t width, size_t height, size_t rowBytes, MiSnapMICRLine *line);
+
+//The design grid of a character as 9 rows of 7 cells, top row first, 'X' for ink, or NULL if the
+//character is not one of the 14 E-13B glyphs. For rendering test and benchmark frames.
+const char *const *MiSnapMICRGlyph(char character);
+
+//The ABA checksum of a nine digit routing number: 3, 7, 1 weighted digits summing to a multiple of 10
+bool MiSnapMICRRoutingValid(const char *routing);
+
+#endif
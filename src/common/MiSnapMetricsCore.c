@@ -0,0 +1,131 @@
+
+#include "MiSnapMetricsCore.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+static MiSnapHistogram kMiSnapHistograms[MiSnapMetricCount];
+static _Atomic uint64_t kMiSnapCounters[MiSnapCounterCount];
+
+static uint64_t MiSnapMetricsMonotonicClock(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static _Atomic(MiSnapMetricsClock) kMiSnapMetricsClock = MiSnapMetricsMonotonicClock;
+
+size_t MiSnapHistogramBucketOf(uint64_t value)
+{
+    const int subBits = kMiSnapHistogramSubBucketBits;
+    if (value < (1u << subBits)) {
+        return (size_t)value;
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent > kMiSnapHistogramMaxExponent) {
+        return kMiSnapHistogramBuckets - 1;
+    }
+    uint64_t subBucket = (value >> (exponent - subBits)) & ((1u << subBits) - 1);
+    return ((size_t)(exponent - subBits + 1) << subBits) + (size_t)subBucket;
+}
+
+uint64_t MiSnapHistogramBucketValue(size_t index)
+{
+    const int subBits = kMiSnapHistogramSubBucketBits;
+    if (index < (1u << subBits)) {
+        return index;
+    }
+    int exponent = (int)(index >> subBits) + subBits - 1;
+    uint64_t subBucket = index & ((1u << subBits) - 1);
+    uint64_t width = 1ull << (exponent - subBits);
+    return (((1ull << subBits) + subBucket) << (exponent - subBits)) + width / 2;
+}
+
+void MiSnapHistogramRecord(MiSnapHistogram *histogram, uint64_t value)
+{
+    atomic_fetch_add_explicit(&histogram->buckets[MiSnapHistogramBucketOf(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->sum, value, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    while (value > max && !atomic_compare_exchange_weak_explicit(&histogram->max, &max, value, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+void MiSnapHistogramSummarize(MiSnapHistogram *histogram, MiSnapHistogramSummary *summary)
+{
+    uint64_t counts[kMiSnapHistogramBuckets];
+    uint64_t total = 0;
+    for (size_t i = 0; i < kMiSnapHistogramBuckets; i++) {
+        counts[i] = atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+        total += counts[i];
+    }
+    memset(summary, 0, sizeof(*summary));
+    summary->count = total;
+    summary->max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    if (total == 0) {
+        return;
+    }
+    summary->mean = (double)atomic_load_explicit(&histogram->sum, memory_order_relaxed) / total;
+
+    const double quantiles[3] = { 0.5, 0.9, 0.99 };
+    uint64_t *values[3] = { &summary->p50, &summary->p90, &summary->p99 };
+    uint64_t seen = 0;
+    size_t bucket = 0;
+    for (int q = 0; q < 3; q++) {
+        uint64_t rank = (uint64_t)ceil(quantiles[q] * total);
+        while (bucket < kMiSnapHistogramBuckets && seen + counts[bucket] < rank) {
+            seen += counts[bucket++];
+        }
+        *values[q] = MIN(MiSnapHistogramBucketValue(MIN(bucket, (size_t)kMiSnapHistogramBuckets - 1)), summary->max);
+    }
+}
+
+void MiSnapHistogramReset(MiSnapHistogram *histogram)
+{
+    for (size_t i = 0; i < kMiSnapHistogramBuckets; i++) {
+        atomic_store_explicit(&histogram->buckets[i], 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&histogram->count, 0, memory_order_relaxed);
+    atomic_store_explicit(&histogram->sum, 0, memory_order_relaxed);
+    atomic_store_explicit(&histogram->max, 0, memory_order_relaxed);
+}
+
+void MiSnapMetricsSetClock(MiSnapMetricsClock clock)
+{
+    atomic_store(&kMiSnapMetricsClock, clock != NULL ? clock : MiSnapMetricsMonotonicClock);
+}
+
+uint64_t MiSnapMetricsNow(void)
+{
+    return atomic_load_explicit(&kMiSnapMetricsClock, memory_order_relaxed)();
+}
+
+double MiSnapMetricsMsSince(uint64_t start)
+{
+    return (MiSnapMetricsNow() - start) / 1e6;
+}
+
+void MiSnapMetricsRecordMs(MiSnapMetric metric, double milliseconds)
+{
+    MiSnapHistogramRecord(&kMiSnapHistograms[metric], milliseconds > 0 ? (uint64_t)llround(milliseconds * 1000) : 0);
+}
+
+void MiSnapMetricsIncrement(MiSnapCounter counter)
+{
+    atomic_fetch_add_explicit(&kMiSnapCounters[counter], 1, memory_order_relaxed);
+}
+
+void MiSnapMetricsSummarize(MiSnapMetric metric, bool reset, MiSnapHistogramSummary *summary)
+{
+    MiSnapHistogramSummarize(&kMiSnapHistograms[metric], summary);
+    if (reset) {
+        MiSnapHistogramReset(&kMiSnapHistograms[metric]);
+    }
+}
+
+uint64_t MiSnapMetricsCounterValue(MiSnapCounter counter, bool reset)
+{
+    return reset ? atomic_exchange_explicit(&kMiSnapCounters[counter], 0, memory_order_relaxed)
+                 : atomic_load_explicit(&kMiSnapCounters[counter], memory_order_relaxed);
+}
@@ -0,0 +1,88 @@
+
+#ifndef MiSnapMetricsCore_h
+#define MiSnapMetricsCore_h
+
+#include "MiSnapCore.h"
+#include <stdatomic.h>
+
+//Process-wide capture instrumentation: latency histograms per stage and event counters. Recording
+//is lock-free and allocation-free (a few relaxed atomic adds), so it can be called from the
+//camera queue, the staging queues and the main thread alike. The clock is injectable so stages
+//can be timed on a fake clock.
+
+//Log-linear buckets: exact below 16, then 16 buckets per power of two (at most 6.25% wide),
+//up to 2^40 microseconds. Larger values land in the last bucket.
+#define kMiSnapHistogramSubBucketBits 4
+#define kMiSnapHistogramMaxExponent 40
+#define kMiSnapHistogramBuckets ((kMiSnapHistogramMaxExponent - kMiSnapHistogramSubBucketBits + 2) << kMiSnapHistogramSubBucketBits)
+
+typedef struct {
+    _Atomic uint64_t buckets[kMiSnapHistogramBuckets];
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum;
+    _Atomic uint64_t max;
+} MiSnapHistogram;
+
+typedef struct {
+    uint64_t count;
+    double mean;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t max;
+} MiSnapHistogramSummary;
+
+//The bucket a value is counted in, and the midpoint of the values a bucket counts
+size_t MiSnapHistogramBucketOf(uint64_t value);
+uint64_t MiSnapHistogramBucketValue(size_t index);
+
+void MiSnapHistogramRecord(MiSnapHistogram *histogram, uint64_t value);
+
+//Percentiles are the midpoint of their bucket, capped at the maximum. Concurrent recording can
+//make the summary slightly inconsistent but never invalid.
+void MiSnapHistogramSummarize(MiSnapHistogram *histogram, MiSnapHistogramSummary *summary);
+void MiSnapHistogramReset(MiSnapHistogram *histogram);
+
+typedef enum {
+    MiSnapMetricStartup,                //building and presenting the controller
+    MiSnapMetricFirstFrame,             //presenting until the first camera frame
+    MiSnapMetricTimeToAccept,           //presenting until the SDK returns the capture
+    MiSnapMetricEncode,                 //staging the image: decode, scale, re-encode, scoring
+    MiSnapMetricDelivery,               //building and sending the plugin result over the bridge
+    MiSnapMetricQueueWait,              //a capture call waiting for the camera
+    MiSnapMetricFinish,                 //a capture over until its result has been sent
+    MiSnapMetricMICR,                   //reading the MICR line of a check front
+    MiSnapMetricCount
+} MiSnapMetric;
+
+typedef enum {
+    MiSnapCounterCaptures,
+    MiSnapCounterCancellations,
+    MiSnapCounterTimeouts,              //auto-capture gave up after kMiSnapMaxTimeouts
+    MiSnapCounterFailovers,             //auto-capture failed over to the still camera
+    MiSnapCounterCameraNotSufficient,
+    MiSnapCounterRejections,            //capture calls refused by their sessionPolicy or a full queue
+    MiSnapCounterPreemptions,
+    MiSnapCounterCount
+} MiSnapCounter;
+
+//Nanoseconds on a monotonic clock
+typedef uint64_t (*MiSnapMetricsClock)(void);
+
+//clock may be NULL for the system's monotonic clock. Set it before timing anything: stages timed
+//across the change mix the two clocks.
+void MiSnapMetricsSetClock(MiSnapMetricsClock clock);
+
+//A timestamp in nanoseconds, for timing a stage with MiSnapMetricsMsSince
+uint64_t MiSnapMetricsNow(void);
+double MiSnapMetricsMsSince(uint64_t start);
+
+//Histograms hold microseconds
+void MiSnapMetricsRecordMs(MiSnapMetric metric, double milliseconds);
+void MiSnapMetricsIncrement(MiSnapCounter counter);
+
+//In microseconds. reset starts a new measurement period once read.
+void MiSnapMetricsSummarize(MiSnapMetric metric, bool reset, MiSnapHistogramSummary *summary);
+uint64_t MiSnapMetricsCounterValue(MiSnapCounter counter, bool reset);
+
+#endif
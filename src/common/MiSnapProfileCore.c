@@ -0,0 +1,153 @@
+
+#include "MiSnapProfileCore.h"
+#include <math.h>
+
+//Documented parameter ranges
+#define kMinCaptureMode 0
+#define kMaxCaptureMode 5
+#define kMinAutoCaptureFailover 0
+#define kMaxAutoCaptureFailover 1
+#define kMinMinHorizontalFill 500
+#define kMaxMinHorizontalFill 1000
+#define kMinUnnecessaryTouchLimit 2
+#define kMaxUnnecessaryTouchLimit 9
+#define kMinInitialTimeout 15
+#define kMaxInitialTimeout 90
+#define kMinTimeout 15
+#define kMaxTimeout 90
+#define kMinMaxTimeouts 0
+#define kMaxMaxTimeouts 10
+#define kMinImageQuality 0
+#define kMaxImageQuality 100
+#define kMinBrightness 0
+#define kMaxBrightness 1000
+#define kMinMaxBrightness 0
+#define kMaxMaxBrightness 1000
+#define kMinSharpness 0
+#define kMaxSharpness 1000
+#define kMinAngle 0
+#define kMaxAngle 1000
+#define kMinTorchMode 0
+#define kMaxTorchMode 2
+
+//Evaluates to value, or fails to compile (negative bit-field width) when value is out of range
+#define MISNAP_RANGED(value, min, max) \
+    ((value) + 0 * (int)sizeof(struct { int : ((value) >= (min) && (value) <= (max)) ? 1 : -1; }))
+
+#define MISNAP_FIELD(field, value) [MiSnapProfileField##field] = MISNAP_RANGED(value, kMin##field, kMax##field)
+
+//Values shared by every document type, plus the documented per-document ones
+#define MISNAP_PROFILE(documentKind, documentName, sharpness, timeout, fill, torch) \
+    [documentKind] = { documentKind, documentName, { \
+        MISNAP_FIELD(CaptureMode, 2), \
+        MISNAP_FIELD(AutoCaptureFailover, 1), \
+        MISNAP_FIELD(MinHorizontalFill, fill), \
+        MISNAP_FIELD(UnnecessaryTouchLimit, 4), \
+        MISNAP_FIELD(InitialTimeout, 30), \
+        MISNAP_FIELD(Timeout, timeout), \
+        MISNAP_FIELD(MaxTimeouts, 0), \
+        MISNAP_FIELD(ImageQuality, 50), \
+        MISNAP_FIELD(Brightness, 400), \
+        MISNAP_FIELD(MaxBrightness, 700), \
+        MISNAP_FIELD(Sharpness, sharpness), \
+        MISNAP_FIELD(Angle, 150), \
+        MISNAP_FIELD(TorchMode, torch) }, 0 }
+
+static const MiSnapProfile kProfiles[MiSnapDocumentKindCount] = {
+    MISNAP_PROFILE(MiSnapDocumentKindACH,               "ACH",               600, 20, 800, 1),
+    MISNAP_PROFILE(MiSnapDocumentKindCheckFront,        "CheckFront",        600, 20, 800, 1),
+    MISNAP_PROFILE(MiSnapDocumentKindCheckBack,         "CheckBack",         100, 20, 800, 1),
+    MISNAP_PROFILE(MiSnapDocumentKindRemittance,        "Remittance",        850, 20, 800, 1),
+    MISNAP_PROFILE(MiSnapDocumentKindBalanceTransfer,   "BalanceTransfer",   850, 20, 800, 1),
+    MISNAP_PROFILE(MiSnapDocumentKindW2,                "W2",                400, 20, 800, 1),
+    MISNAP_PROFILE(MiSnapDocumentKindDriversLicense,    "DriversLicense",    350, 30, 700, 0),
+    MISNAP_PROFILE(MiSnapDocumentKindLandscapeDocument, "LandscapeDocument", 400, 20, 800, 1),
+    MISNAP_PROFILE(MiSnapDocumentKindPDF417,            "PDF417",            350, 30, 700, 0),
+};
+
+#define MISNAP_RANGE(field, fieldName) [MiSnapProfileField##field] = { fieldName, kMin##field, kMax##field }
+
+static const MiSnapProfileFieldRange kFieldRanges[MiSnapProfileFieldCount] = {
+    MISNAP_RANGE(CaptureMode, "captureMode"),
+    MISNAP_RANGE(AutoCaptureFailover, "autoCaptureFailover"),
+    MISNAP_RANGE(MinHorizontalFill, "minHorizontalFill"),
+    MISNAP_RANGE(UnnecessaryTouchLimit, "unnecessaryTouchLimit"),
+    MISNAP_RANGE(InitialTimeout, "initialTimeout"),
+    MISNAP_RANGE(Timeout, "timeout"),
+    MISNAP_RANGE(MaxTimeouts, "maxTimeouts"),
+    MISNAP_RANGE(ImageQuality, "imageQuality"),
+    MISNAP_RANGE(Brightness, "brightness"),
+    MISNAP_RANGE(MaxBrightness, "maxBrightness"),
+    MISNAP_RANGE(Sharpness, "sharpness"),
+    MISNAP_RANGE(Angle, "angle"),
+    MISNAP_RANGE(TorchMode, "torchMode"),
+};
+
+_Static_assert(MiSnapProfileFieldCount <= 32, "MiSnapProfile.set has a bit per field");
+
+const MiSnapProfile *MiSnapProfileForKind(MiSnapDocumentKind kind)
+{
+    if ((int)kind < 0 || kind >= MiSnapDocumentKindCount) {
+        return NULL;
+    }
+    return &kProfiles[kind];
+}
+
+const MiSnapProfile *MiSnapProfileNamed(const char *name)
+{
+    if (name == NULL) {
+        return NULL;
+    }
+    for (int kind = 0; kind < MiSnapDocumentKindCount; kind++) {
+        if (strcmp(kProfiles[kind].name, name) == 0) {
+            return &kProfiles[kind];
+        }
+    }
+    return NULL;
+}
+
+const MiSnapProfileFieldRange *MiSnapProfileFieldRangeOf(MiSnapProfileField field)
+{
+    if ((int)field < 0 || field >= MiSnapProfileFieldCount) {
+        return NULL;
+    }
+    return &kFieldRanges[field];
+}
+
+MiSnapProfileField MiSnapProfileFieldNamed(const char *name)
+{
+    for (int field = 0; name != NULL && field < MiSnapProfileFieldCount; field++) {
+        if (strcmp(kFieldRanges[field].name, name) == 0) {
+            return (MiSnapProfileField)field;
+        }
+    }
+    return MiSnapProfileFieldCount;
+}
+
+bool MiSnapProfileSetValue(MiSnapProfile *profile, MiSnapProfileField field, double value)
+{
+    const MiSnapProfileFieldRange *range = MiSnapProfileFieldRangeOf(field);
+    //Written so that NaN fails every comparison
+    if (range == NULL || !(value >= range->min && value <= range->max) || value != floor(value)) {
+        return false;
+    }
+    profile->values[field] = (int)value;
+    profile->set |= 1u << field;
+    return true;
+}
+
+bool MiSnapProfileConsistent(const MiSnapProfile *profile)
+{
+    int maxBrightness = profile->values[MiSnapProfileFieldMaxBrightness];
+    return maxBrightness == 0 || maxBrightness >= profile->values[MiSnapProfileFieldBrightness];
+}
+
+MiSnapFrameThresholds MiSnapProfileThresholds(const MiSnapProfile *profile)
+{
+    MiSnapFrameThresholds thresholds;
+    thresholds.minBrightness = profile->values[MiSnapProfileFieldBrightness];
+    thresholds.maxBrightness = profile->values[MiSnapProfileFieldMaxBrightness];
+    thresholds.sharpness = profile->values[MiSnapProfileFieldSharpness];
+    thresholds.angle = profile->values[MiSnapProfileFieldAngle];
+    return thresholds;
+}
@@ -0,0 +1,98 @@
+
+#ifndef MiSnapProfileCore_h
+#define MiSnapProfileCore_h
+
+#include "MiSnapFrameScoreCore.h"
+#include <string.h>
+
+//Typed capture parameter profiles for every document type. The default table is checked against
+//the documented parameter ranges at compile time, fields are read by index, and overrides from the
+//web layer are validated before a session starts instead of being discovered by the SDK.
+
+typedef enum {
+    MiSnapDocumentKindACH,
+    MiSnapDocumentKindCheckFront,
+    MiSnapDocumentKindCheckBack,
+    MiSnapDocumentKindRemittance,
+    MiSnapDocumentKindBalanceTransfer,
+    MiSnapDocumentKindW2,
+    MiSnapDocumentKindDriversLicense,
+    MiSnapDocumentKindLandscapeDocument,
+    MiSnapDocumentKindPDF417,
+    MiSnapDocumentKindCount
+} MiSnapDocumentKind;
+
+typedef enum {
+    MiSnapProfileFieldCaptureMode,              //kMiSnapCaptureMode
+    MiSnapProfileFieldAutoCaptureFailover,      //kMiSnapAutoCaptureFailoverToStillCapture
+    MiSnapProfileFieldMinHorizontalFill,        //kMiSnapViewfinderMinHorizontalFill
+    MiSnapProfileFieldUnnecessaryTouchLimit,    //kMiSnapUnnecessaryScreenTouchLimit
+    MiSnapProfileFieldInitialTimeout,           //kMiSnapInitialTimeout
+    MiSnapProfileFieldTimeout,                  //kMiSnapTimeout
+    MiSnapProfileFieldMaxTimeouts,              //kMiSnapMaxTimeouts
+    MiSnapProfileFieldImageQuality,             //kMiSnapImageQuality
+    MiSnapProfileFieldBrightness,               //kMiSnapBrightness
+    MiSnapProfileFieldMaxBrightness,            //kMiSnapMaxBrightness
+    MiSnapProfileFieldSharpness,                //kMiSnapSharpness
+    MiSnapProfileFieldAngle,                    //kMiSnapAngle
+    MiSnapProfileFieldTorchMode,                //kMiSnapTorchMode
+    MiSnapProfileFieldCount
+} MiSnapProfileField;
+
+typedef struct {
+    MiSnapDocumentKind kind;
+    const char *name;
+    int values[MiSnapProfileFieldCount];
+    unsigned set;                       //bit per field given as an override
+} MiSnapProfile;
+
+//The web layer name of a field, such as "sharpness", and its documented range
+typedef struct {
+    const char *name;
+    int min;
+    int max;
+} MiSnapProfileFieldRange;
+
+//The default profile for a document type
+const MiSnapProfile *MiSnapProfileForKind(MiSnapDocumentKind kind);
+
+//The default profile for a web layer document type name such as "CheckFront", or NULL
+const MiSnapProfile *MiSnapProfileNamed(const char *name);
+
+const MiSnapProfileFieldRange *MiSnapProfileFieldRangeOf(MiSnapProfileField field);
+
+//The field with a web layer name, or MiSnapProfileFieldCount if there is none
+MiSnapProfileField MiSnapProfileFieldNamed(const char *name);
+
+//Overrides one field and marks it as set. Returns false, leaving the profile untouched, if value
+//is not a whole number within the field's range (NaN and infinities included).
+bool MiSnapProfileSetValue(MiSnapProfile *profile, MiSnapProfileField field, double value);
+
+//Whether the fields are consistent with each other: maxBrightness, unless 0, is not below
+//brightness. The SDK raises a timeout below initialTimeout itself, so the two are not compared.
+bool MiSnapProfileConsistent(const MiSnapProfile *profile);
+
+static inline int MiSnapProfileValue(const MiSnapProfile *profile, MiSnapProfileField field)
+{
+    return profile->values[field];
+}
+
+static inline bool MiSnapProfileIsSet(const MiSnapProfile *profile, MiSnapProfileField field)
+{
+    return (profile->set & (1u << field)) != 0;
+}
+
+//kMiSnapDocumentType contains DRIVER_LICENSE, which changes what the SDK does with an AUTO torch
+static inline bool MiSnapProfileIsDriversLicense(const MiSnapProfile *profile)
+{
+    return profile->kind == MiSnapDocumentKindDriversLicense;
+}
+
+static inline bool MiSnapProfileEqual(const MiSnapProfile *a, const MiSnapProfile *b)
+{
+    return a->kind == b->kind && a->set == b->set && memcmp(a->values, b->values, sizeof(a->values)) == 0;
+}
+
+MiSnapFrameThresholds MiSnapProfileThresholds(const MiSnapProfile *profile);
+
+#endif
@@ -0,0 +1,304 @@
+
+#include "MiSnapQuadCore.h"
+#include "MiSnapBufferPoolCore.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define kMiSnapScoreMax 1000
+
+//Scan lines per side
+#define kScanLines 32
+//Coarse step box size as a fraction of the longer frame side; the fine box is a quarter of it
+static const size_t kCoarseBoxDivisor = 64;
+//Mean step across an edge (on the 0-255 scale) below which a scan line has no edge
+static const uint32_t kMinContrast = 12;
+//A side needs this many collinear edge points
+static const int kMinInliers = 6;
+//Steepest side accepted, as a slope
+static const float kMaxSlope = 0.5f;
+//The document must cover this fraction of the frame
+static const float kMinArea = 0.1f;
+
+typedef struct {
+    float slope;
+    float offset;
+} MiSnapLine;
+
+//Integral image with one leading row and column of zeros. Sums wrap modulo 2^32, which keeps
+//differences exact for any box whose sum fits in 32 bits.
+static uint32_t *MiSnapIntegralImage(const uint8_t *luma, size_t width, size_t height, size_t rowBytes)
+{
+    size_t stride = width + 1;
+    uint32_t *integral = MiSnapBufferAcquire(MiSnapSharedBufferPool(), stride * (height + 1) * sizeof(uint32_t));
+    if (integral == NULL) {
+        return NULL;
+    }
+    memset(integral, 0, stride * sizeof(uint32_t));
+    for (size_t y = 0; y < height; y++) {
+        const uint8_t *row = luma + y * rowBytes;
+        const uint32_t *above = integral + y * stride;
+        uint32_t *out = integral + (y + 1) * stride;
+        uint32_t sum = 0;
+        out[0] = 0;
+        for (size_t x = 0; x < width; x++) {
+            sum += row[x];
+            out[x + 1] = above[x + 1] + sum;
+        }
+    }
+    return integral;
+}
+
+//Column sums of rows [y0, y1) at every boundary position: prefix[x] = sum of columns [0, x)
+static void MiSnapRowBandPrefix(const uint32_t *integral, size_t width, size_t y0, size_t y1, uint32_t *prefix)
+{
+    size_t stride = width + 1;
+    const uint32_t *top = integral + y0 * stride;
+    const uint32_t *bottom = integral + y1 * stride;
+    size_t x = 0;
+#if defined(__aarch64__)
+    for (; x + 4 <= stride; x += 4) {
+        vst1q_u32(prefix + x, vsubq_u32(vld1q_u32(bottom + x), vld1q_u32(top + x)));
+    }
+#endif
+    for (; x < stride; x++) {
+        prefix[x] = bottom[x] - top[x];
+    }
+}
+
+//Row sums of columns [x0, x1) at every boundary position: prefix[y] = sum of rows [0, y)
+static void MiSnapColumnBandPrefix(const uint32_t *integral, size_t width, size_t height, size_t x0, size_t x1, uint32_t *prefix)
+{
+    size_t stride = width + 1;
+    for (size_t y = 0; y <= height; y++) {
+        prefix[y] = integral[y * stride + x1] - integral[y * stride + x0];
+    }
+}
+
+//|sum of the box after p - sum of the box before p| for p in [box, count - box], 0 elsewhere.
+//count is the number of boundary positions (pixels + 1).
+static void MiSnapStepResponses(const uint32_t *prefix, size_t count, size_t box, uint32_t *responses)
+{
+    memset(responses, 0, count * sizeof(uint32_t));
+    if (count <= 2 * box) {
+        return;
+    }
+    size_t p = box;
+    size_t end = count - box;
+#if defined(__aarch64__)
+    for (; p + 4 <= end; p += 4) {
+        uint32x4_t centre = vld1q_u32(prefix + p);
+        uint32x4_t after = vsubq_u32(vld1q_u32(prefix + p + box), centre);
+        uint32x4_t before = vsubq_u32(centre, vld1q_u32(prefix + p - box));
+        int32x4_t step = vreinterpretq_s32_u32(vsubq_u32(after, before));
+        vst1q_u32(responses + p, vreinterpretq_u32_s32(vabsq_s32(step)));
+    }
+#endif
+    for (; p < end; p++) {
+        int32_t step = (int32_t)((prefix[p + box] - prefix[p]) - (prefix[p] - prefix[p - box]));
+        responses[p] = (uint32_t)abs(step);
+    }
+}
+
+//The outermost strong edge between from and to (either direction): the first local maximum of
+//the coarse response reaching half the strongest one, refined to sub-pixel precision with the
+//fine response. Returns -1 if there is none.
+static float MiSnapFindEdge(const uint32_t *coarse, const uint32_t *fine, size_t count, long from, long to, size_t box, uint32_t minResponse)
+{
+    long direction = to > from ? 1 : -1;
+    uint32_t strongest = 0;
+    for (long p = from; p != to; p += direction) {
+        strongest = MAX(strongest, coarse[p]);
+    }
+    uint32_t threshold = MAX(strongest / 2, minResponse);
+    if (strongest < threshold) {
+        return -1;
+    }
+    
+    long edge = -1;
+    for (long p = from; p != to; p += direction) {
+        if (coarse[p] >= threshold && coarse[p] >= coarse[p - direction] && coarse[p] >= coarse[p + direction]) {
+            edge = p;
+            break;
+        }
+    }
+    if (edge < 0) {
+        return -1;
+    }
+    
+    long lo = MAX(1L, edge - (long)box);
+    long hi = MIN((long)count - 2, edge + (long)box);
+    long peak = edge;
+    for (long p = lo; p <= hi; p++) {
+        if (fine[p] > fine[peak]) {
+            peak = p;
+        }
+    }
+    float left = fine[peak - 1], centre = fine[peak], right = fine[peak + 1];
+    float curvature = left - 2 * centre + right;
+    float offset = curvature < 0 ? 0.5f * (left - right) / curvature : 0;
+    return peak + MAX(-0.5f, MIN(0.5f, offset));
+}
+
+//Fits u = slope * t + offset through the largest set of points within tolerance of a line
+//through two of them, then refines it by least squares over that set
+static bool MiSnapFitLine(const float *t, const float *u, int count, float tolerance, MiSnapLine *line)
+{
+    int bestInliers = 0;
+    float bestError = 0;
+    MiSnapLine best = { 0, 0 };
+    for (int i = 0; i < count; i++) {
+        for (int j = i + 1; j < count; j++) {
+            if (t[j] == t[i]) {
+                continue;
+            }
+            float slope = (u[j] - u[i]) / (t[j] - t[i]);
+            if (fabsf(slope) > kMaxSlope) {
+                continue;
+            }
+            float offset = u[i] - slope * t[i];
+            int inliers = 0;
+            float error = 0;
+            for (int k = 0; k < count; k++) {
+                float residual = fabsf(u[k] - (slope * t[k] + offset));
+                if (residual <= tolerance) {
+                    inliers++;
+                    error += residual;
+                }
+            }
+            if (inliers > bestInliers || (inliers == bestInliers && error < bestError)) {
+                bestInliers = inliers;
+                bestError = error;
+                best = (MiSnapLine){ slope, offset };
+            }
+        }
+    }
+    if (bestInliers < kMinInliers) {
+        return false;
+    }
+    
+    double n = 0, st = 0, su = 0, stt = 0, stu = 0;
+    for (int k = 0; k < count; k++) {
+        if (fabsf(u[k] - (best.slope * t[k] + best.offset)) <= tolerance) {
+            n++;
+            st += t[k];
+            su += u[k];
+            stt += (double)t[k] * t[k];
+            stu += (double)t[k] * u[k];
+        }
+    }
+    double denominator = n * stt - st * st;
+    if (denominator > 0) {
+        best.slope = (float)((n * stu - st * su) / denominator);
+        best.offset = (float)((su - best.slope * st) / n);
+    }
+    *line = best;
+    return fabsf(best.slope) <= kMaxSlope;
+}
+
+//Intersection of a vertical side x = a * y + b with a horizontal side y = c * x + d
+static MiSnapQuadPoint MiSnapIntersect(MiSnapLine vertical, MiSnapLine horizontal)
+{
+    float x = (vertical.slope * horizontal.offset + vertical.offset) / (1 - vertical.slope * horizontal.slope);
+    return (MiSnapQuadPoint){ x, horizontal.slope * x + horizontal.offset };
+}
+
+bool MiSnapDetectQuad(const uint8_t *luma, size_t width, size_t height, size_t rowBytes, MiSnapQuad *quad)
+{
+    memset(quad, 0, sizeof(*quad));
+    size_t longSide = MAX(width, height);
+    size_t coarseBox = MAX((size_t)4, longSide / kCoarseBoxDivisor);
+    size_t fineBox = coarseBox / 4;
+    if (width < 8 * coarseBox || height < 8 * coarseBox) {
+        return false;
+    }
+    
+    uint32_t *integral = MiSnapIntegralImage(luma, width, height, rowBytes);
+    uint32_t *buffers = MiSnapBufferAcquire(MiSnapSharedBufferPool(), 3 * (longSide + 1) * sizeof(uint32_t));
+    if (integral == NULL || buffers == NULL) {
+        MiSnapBufferRelease(MiSnapSharedBufferPool(), integral);
+        MiSnapBufferRelease(MiSnapSharedBufferPool(), buffers);
+        return false;
+    }
+    uint32_t *prefix = buffers;
+    uint32_t *coarse = prefix + longSide + 1;
+    uint32_t *fine = coarse + longSide + 1;
+    
+    //Edge points per side: t runs along the side, u across it
+    float t[4][kScanLines], u[4][kScanLines];
+    int points[4] = { 0, 0, 0, 0 };
+    for (int vertical = 0; vertical < 2; vertical++) {
+        //Scan rows for the left and right sides, columns for the top and bottom ones
+        size_t across = vertical ? height : width;
+        size_t along = vertical ? width : height;
+        size_t band = coarseBox;
+        uint32_t minCoarse = kMinContrast * (uint32_t)(coarseBox * band);
+        for (int line = 0; line < kScanLines; line++) {
+            size_t centre = (2 * line + 1) * along / (2 * kScanLines);
+            size_t start = centre > band / 2 ? centre - band / 2 : 0;
+            size_t end = MIN(start + band, along);
+            if (vertical) {
+                MiSnapColumnBandPrefix(integral, width, height, start, end, prefix);
+            } else {
+                MiSnapRowBandPrefix(integral, width, start, end, prefix);
+            }
+            MiSnapStepResponses(prefix, across + 1, coarseBox, coarse);
+            MiSnapStepResponses(prefix, across + 1, fineBox, fine);
+            
+            long first = (long)coarseBox, last = (long)(across - coarseBox), middle = (long)(across / 2);
+            float edges[2] = {
+                MiSnapFindEdge(coarse, fine, across + 1, first, middle, coarseBox, minCoarse),
+                MiSnapFindEdge(coarse, fine, across + 1, last, middle, coarseBox, minCoarse)
+            };
+            for (int side = 0; side < 2; side++) {
+                //Sides: 0 left, 1 right, 2 top, 3 bottom
+                int index = 2 * vertical + side;
+                if (edges[side] >= 0) {
+                    t[index][points[index]] = centre;
+                    u[index][points[index]] = edges[side];
+                    points[index]++;
+                }
+            }
+        }
+    }
+    MiSnapBufferRelease(MiSnapSharedBufferPool(), buffers);
+    MiSnapBufferRelease(MiSnapSharedBufferPool(), integral);
+    
+    MiSnapLine sides[4];
+    float tolerance = MAX(1.5f, longSide / 400.0f);
+    for (int side = 0; side < 4; side++) {
+        if (!MiSnapFitLine(t[side], u[side], points[side], tolerance, &sides[side])) {
+            return false;
+        }
+    }
+    MiSnapQuadPoint topLeft = MiSnapIntersect(sides[0], sides[2]);
+    MiSnapQuadPoint topRight = MiSnapIntersect(sides[1], sides[2]);
+    MiSnapQuadPoint bottomRight = MiSnapIntersect(sides[1], sides[3]);
+    MiSnapQuadPoint bottomLeft = MiSnapIntersect(sides[0], sides[3]);
+    if (topLeft.x >= topRight.x || bottomLeft.x >= bottomRight.x || topLeft.y >= bottomLeft.y || topRight.y >= bottomRight.y) {
+        return false;
+    }
+    float area = 0.5f * fabsf((topLeft.x - bottomRight.x) * (topRight.y - bottomLeft.y) - (topRight.x - bottomLeft.x) * (topLeft.y - bottomRight.y));
+    if (area < kMinArea * width * height) {
+        return false;
+    }
+    
+    quad->found = true;
+    quad->corners[0] = topLeft;
+    quad->corners[1] = topRight;
+    quad->corners[2] = bottomRight;
+    quad->corners[3] = bottomLeft;
+    float slope = 0;
+    for (int side = 0; side < 4; side++) {
+        slope = MAX(slope, fabsf(sides[side].slope));
+    }
+    quad->angle = MIN((int)lroundf(slope * kMiSnapScoreMax), kMiSnapScoreMax);
+    float padding = MIN(MIN(topLeft.x, bottomLeft.x), MIN(width - topRight.x, width - bottomRight.x)) / width;
+    padding = MIN(padding, MIN(MIN(topLeft.y, topRight.y), MIN(height - bottomLeft.y, height - bottomRight.y)) / height);
+    quad->padding = (int)lroundf(padding * kMiSnapScoreMax);
+    return true;
+}
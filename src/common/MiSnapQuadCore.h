@@ -0,0 +1,31 @@
+
+#ifndef MiSnapQuadCore_h
+#define MiSnapQuadCore_h
+
+#include "MiSnapCore.h"
+
+//Finds the four edges of a document in a luma frame and reports its corners, its skew on the
+//SDK's angle scale and how close it comes to the frame edges. Edges are located with box-filter
+//step responses at two scales, both read from a single integral image, and each side is fitted
+//robustly through the edge points found on a set of scan lines.
+
+typedef struct {
+    float x;
+    float y;
+} MiSnapQuadPoint;
+
+typedef struct {
+    bool found;
+    //Top left, top right, bottom right, bottom left, in pixels of the frame
+    MiSnapQuadPoint corners[4];
+    //Skew of the most skewed side in tenths of a percent, as kMiSnapAngle
+    int angle;
+    //Smallest distance between a corner and the frame edge, per mille of the frame width or
+    //height; negative when a corner lies outside the frame
+    int padding;
+} MiSnapQuad;
+
+//Returns false, with quad->found false, when no document is found
+bool MiSnapDetectQuad(const uint8_t *luma, size_t width, size_t height, size_t rowBytes, MiSnapQuad *quad);
+
+#endif
@@ -0,0 +1,179 @@
+
+#include "MiSnapSessions.h"
+#include <string.h>
+
+void MiSnapSessionTableInit(MiSnapSessionTable *table, size_t maxQueued, size_t maxFinishing)
+{
+    memset(table, 0, sizeof(*table));
+    table->maxQueued = maxQueued;
+    table->maxFinishing = MAX(maxFinishing, 1);
+}
+
+static MiSnapSession *MiSnapSessionLookup(const MiSnapSessionTable *table, const char *key)
+{
+    for (size_t i = 0; i < kMiSnapSessionCapacity; i++) {
+        const MiSnapSession *session = &table->sessions[i];
+        if (session->state != MiSnapSessionStateFree && strcmp(session->key, key) == 0) {
+            return (MiSnapSession *)session;
+        }
+    }
+    return NULL;
+}
+
+static MiSnapSession *MiSnapSessionInState(const MiSnapSessionTable *table, MiSnapSessionState state)
+{
+    for (size_t i = 0; i < kMiSnapSessionCapacity; i++) {
+        if (table->sessions[i].state == state) {
+            return (MiSnapSession *)&table->sessions[i];
+        }
+    }
+    return NULL;
+}
+
+static bool MiSnapSessionCameraAvailable(const MiSnapSessionTable *table)
+{
+    return MiSnapSessionInState(table, MiSnapSessionStateCapturing) == NULL
+        && MiSnapSessionCount(table, MiSnapSessionStateFinishing) < table->maxFinishing;
+}
+
+static void MiSnapSessionStart(MiSnapSession *session, double nowMs)
+{
+    session->state = MiSnapSessionStateCapturing;
+    session->startedMs = nowMs;
+}
+
+MiSnapSessionAdmission MiSnapSessionAdmit(MiSnapSessionTable *table, const char *key, MiSnapSessionPolicy policy, double nowMs, char *preempted)
+{
+    MiSnapSessionAdmission admission;
+    MiSnapSession *session = NULL;
+    MiSnapSession *capturing = MiSnapSessionInState(table, MiSnapSessionStateCapturing);
+    if (key == NULL || strlen(key) >= kMiSnapSessionKeyBytes) {
+        admission = MiSnapSessionAdmitFull;
+    } else if (MiSnapSessionLookup(table, key) != NULL) {
+        admission = MiSnapSessionAdmitDuplicate;
+    } else if ((session = MiSnapSessionInState(table, MiSnapSessionStateFree)) == NULL) {
+        admission = MiSnapSessionAdmitFull;
+    } else if (MiSnapSessionCameraAvailable(table) && MiSnapSessionCount(table, MiSnapSessionStateQueued) == 0) {
+        admission = MiSnapSessionAdmitStarted;
+    } else if (policy == MiSnapSessionPolicyPreempt && capturing != NULL) {
+        admission = MiSnapSessionAdmitPreempted;
+    } else if (policy == MiSnapSessionPolicyReject) {
+        admission = MiSnapSessionAdmitBusy;
+    } else if (MiSnapSessionCount(table, MiSnapSessionStateQueued) >= table->maxQueued) {
+        admission = MiSnapSessionAdmitFull;
+    } else {
+        admission = MiSnapSessionAdmitQueued;
+    }
+    if (admission >= MiSnapSessionAdmitBusy) {
+        table->statistics.rejected++;
+        return admission;
+    }
+
+    memset(session, 0, sizeof(*session));
+    strcpy(session->key, key);
+    session->sequence = table->sequence++;
+    session->admittedMs = nowMs;
+    table->statistics.admitted++;
+    if (admission == MiSnapSessionAdmitQueued) {
+        session->state = MiSnapSessionStateQueued;
+        table->statistics.queued++;
+        return admission;
+    }
+    if (admission == MiSnapSessionAdmitPreempted) {
+        strcpy(preempted, capturing->key);
+        capturing->state = MiSnapSessionStateFree;
+        table->statistics.preempted++;
+    }
+    MiSnapSessionStart(session, nowMs);
+    return admission;
+}
+
+const char *MiSnapSessionNext(MiSnapSessionTable *table, double nowMs)
+{
+    if (!MiSnapSessionCameraAvailable(table)) {
+        return NULL;
+    }
+    MiSnapSession *next = NULL;
+    for (size_t i = 0; i < kMiSnapSessionCapacity; i++) {
+        MiSnapSession *session = &table->sessions[i];
+        if (session->state == MiSnapSessionStateQueued && (next == NULL || session->sequence < next->sequence)) {
+            next = session;
+        }
+    }
+    if (next == NULL) {
+        return NULL;
+    }
+    MiSnapSessionStart(next, nowMs);
+    return next->key;
+}
+
+bool MiSnapSessionCaptured(MiSnapSessionTable *table, const char *key, double nowMs)
+{
+    MiSnapSession *session = MiSnapSessionLookup(table, key);
+    if (session == NULL || session->state != MiSnapSessionStateCapturing) {
+        return false;
+    }
+    session->state = MiSnapSessionStateFinishing;
+    session->capturedMs = nowMs;
+    return true;
+}
+
+bool MiSnapSessionGetTiming(const MiSnapSessionTable *table, const char *key, double nowMs, MiSnapSessionTiming *timing)
+{
+    const MiSnapSession *session = MiSnapSessionLookup(table, key);
+    if (session == NULL) {
+        return false;
+    }
+    memset(timing, 0, sizeof(*timing));
+    switch (session->state) {
+        case MiSnapSessionStateQueued:
+            timing->queuedMs = nowMs - session->admittedMs;
+            break;
+        case MiSnapSessionStateCapturing:
+            timing->queuedMs = session->startedMs - session->admittedMs;
+            timing->captureMs = nowMs - session->startedMs;
+            break;
+        case MiSnapSessionStateFinishing:
+            timing->queuedMs = session->startedMs - session->admittedMs;
+            timing->captureMs = session->capturedMs - session->startedMs;
+            timing->finishMs = nowMs - session->capturedMs;
+            break;
+        case MiSnapSessionStateFree:
+            break;
+    }
+    timing->totalMs = nowMs - session->admittedMs;
+    return true;
+}
+
+bool MiSnapSessionFinish(MiSnapSessionTable *table, const char *key, double nowMs, MiSnapSessionTiming *timing)
+{
+    MiSnapSession *session = MiSnapSessionLookup(table, key);
+    if (session == NULL) {
+        return false;
+    }
+    if (timing != NULL) {
+        MiSnapSessionGetTiming(table, key, nowMs, timing);
+    }
+    session->state = MiSnapSessionStateFree;
+    table->statistics.finished++;
+    return true;
+}
+
+const MiSnapSession *MiSnapSessionFind(const MiSnapSessionTable *table, const char *key)
+{
+    return key != NULL ? MiSnapSessionLookup(table, key) : NULL;
+}
+
+const MiSnapSession *MiSnapSessionCapturing(const MiSnapSessionTable *table)
+{
+    return MiSnapSessionInState(table, MiSnapSessionStateCapturing);
+}
+
+size_t MiSnapSessionCount(const MiSnapSessionTable *table, MiSnapSessionState state)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < kMiSnapSessionCapacity; i++) {
+        count += table->sessions[i].state == state;
+    }
+    return count;
+}
@@ -0,0 +1,95 @@
+#ifndef MiSnapSessions_h
+#define MiSnapSessions_h
+
+#include "MiSnapCore.h"
+
+//Capture sessions keyed by the callback that started them. Only one session at a time owns the
+//camera; once its capture is over it moves on to finishing (staging, spooling, delivery) in the
+//background and frees the camera for the next queued session, so the two overlap. How many
+//sessions may wait and how many may be finishing at once is bounded. The table is not thread
+//safe: the plugins drive it from their main thread and pass in the time, in milliseconds.
+
+#define kMiSnapSessionKeyBytes 64
+#define kMiSnapSessionCapacity 16
+
+typedef enum {
+    MiSnapSessionStateFree,
+    MiSnapSessionStateQueued,           //waiting for the camera
+    MiSnapSessionStateCapturing,        //owns the camera
+    MiSnapSessionStateFinishing         //capture over, result being delivered
+} MiSnapSessionState;
+
+//What a new session does when it cannot have the camera right away
+typedef enum {
+    MiSnapSessionPolicyQueue,           //waits behind the sessions queued before it
+    MiSnapSessionPolicyReject,          //is refused
+    MiSnapSessionPolicyPreempt          //takes the camera from the capturing session, or queues
+} MiSnapSessionPolicy;
+
+typedef enum {
+    MiSnapSessionAdmitStarted,          //the session owns the camera
+    MiSnapSessionAdmitQueued,
+    MiSnapSessionAdmitPreempted,        //owns the camera; the session it was taken from has ended
+    MiSnapSessionAdmitBusy,             //refused by MiSnapSessionPolicyReject
+    MiSnapSessionAdmitFull,             //refused: the queue or the table is full
+    MiSnapSessionAdmitDuplicate         //refused: the key is already in use
+} MiSnapSessionAdmission;
+
+typedef struct {
+    char key[kMiSnapSessionKeyBytes];
+    MiSnapSessionState state;
+    uint64_t sequence;                  //admission order, for first come first served
+    double admittedMs;
+    double startedMs;
+    double capturedMs;
+} MiSnapSession;
+
+typedef struct {
+    double queuedMs;                    //admitted until it got the camera
+    double captureMs;                   //owning the camera
+    double finishMs;                    //capture over until finished
+    double totalMs;
+} MiSnapSessionTiming;
+
+typedef struct {
+    uint64_t admitted;
+    uint64_t queued;
+    uint64_t rejected;
+    uint64_t preempted;
+    uint64_t finished;
+} MiSnapSessionStatistics;
+
+typedef struct {
+    MiSnapSession sessions[kMiSnapSessionCapacity];
+    size_t maxQueued;
+    size_t maxFinishing;
+    uint64_t sequence;
+    MiSnapSessionStatistics statistics;
+} MiSnapSessionTable;
+
+//maxFinishing of 0 is taken as 1; maxQueued of 0 refuses every session that cannot start at once
+void MiSnapSessionTableInit(MiSnapSessionTable *table, size_t maxQueued, size_t maxFinishing);
+
+//Adds a session. When the camera is taken from another session its key is copied to preempted,
+//which must hold kMiSnapSessionKeyBytes. Longer keys are refused as full.
+MiSnapSessionAdmission MiSnapSessionAdmit(MiSnapSessionTable *table, const char *key, MiSnapSessionPolicy policy, double nowMs, char *preempted);
+
+//Hands the camera to the oldest queued session if it is free and fewer than maxFinishing sessions
+//are finishing. Returns its key, or NULL if no session was started.
+const char *MiSnapSessionNext(MiSnapSessionTable *table, double nowMs);
+
+//Moves the capturing session to finishing, which frees the camera
+bool MiSnapSessionCaptured(MiSnapSessionTable *table, const char *key, double nowMs);
+
+//Removes a session in any state, e.g. once its result has been delivered or when it is cancelled
+bool MiSnapSessionFinish(MiSnapSessionTable *table, const char *key, double nowMs, MiSnapSessionTiming *timing);
+
+//Timing of a session so far; false if there is no such session
+bool MiSnapSessionGetTiming(const MiSnapSessionTable *table, const char *key, double nowMs, MiSnapSessionTiming *timing);
+
+const MiSnapSession *MiSnapSessionFind(const MiSnapSessionTable *table, const char *key);
+//NULL when the camera is free
+const MiSnapSession *MiSnapSessionCapturing(const MiSnapSessionTable *table);
+size_t MiSnapSessionCount(const MiSnapSessionTable *table, MiSnapSessionState state);
+
+#endif
@@ -0,0 +1,495 @@
+
+#include "MiSnapSpoolCore.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//EFTYPE is BSD only
+#ifndef EFTYPE
+#define EFTYPE EINVAL
+#endif
+
+#define kMiSnapSpoolFileMagic 0x5053534Du       //"MSSP"
+#define kMiSnapSpoolRecordMagic 0x4352534Du     //"MSRC"
+#define kMiSnapSpoolVersion 1
+
+//Compact on open once at least half of the file, and this much, is deleted records
+#define kMiSnapSpoolCompactBytes (4 * 1024 * 1024)
+
+enum {
+    MiSnapSpoolRecordCapture = 1,
+    MiSnapSpoolRecordTombstone = 2
+};
+
+//Host byte order; the spool never leaves the device. nextId is at least the id the next append
+//gets: compaction drops deleted records, so the records alone cannot tell which ids were handed
+//out. Spools written before it was kept have 0 here.
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t nextId;
+} MiSnapSpoolFileHeader;
+
+//Followed by length payload bytes, zero padded to a multiple of 8. crc covers this header (with
+//crc set to 0) and the payload. A tombstone has no payload and the id of the deleted record.
+typedef struct {
+    uint32_t magic;
+    uint32_t type;
+    uint64_t id;
+    uint64_t length;
+    uint32_t crc;
+    uint32_t reserved;
+} MiSnapSpoolRecordHeader;
+
+typedef struct {
+    uint64_t id;
+    uint64_t offset;            //of the payload
+    uint64_t length;
+} MiSnapSpoolIndexEntry;
+
+struct MiSnapSpoolMap {
+    _Atomic int references;
+    uint8_t *bytes;
+    size_t length;
+};
+
+struct MiSnapSpool {
+    int fd;
+    char *path;
+    uint64_t end;
+    uint64_t nextId;
+    uint64_t deadBytes;
+    MiSnapSpoolIndexEntry *index;
+    size_t count;
+    size_t capacity;
+    MiSnapSpoolEntry *entries;
+    MiSnapSpoolMap *map;
+};
+
+static uint32_t kMiSnapCRCTable[256];
+
+static void MiSnapBuildCRCTable(void)
+{
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t value = i;
+        for (int bit = 0; bit < 8; bit++) {
+            value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+        }
+        kMiSnapCRCTable[i] = value;
+    }
+}
+
+static uint32_t MiSnapCRC32(uint32_t crc, const void *bytes, size_t length)
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, MiSnapBuildCRCTable);
+    const uint8_t *p = bytes;
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = kMiSnapCRCTable[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static inline uint64_t MiSnapSpoolPadded(uint64_t length)
+{
+    return (length + 7) & ~(uint64_t)7;
+}
+
+static inline uint64_t MiSnapSpoolRecordSize(uint64_t length)
+{
+    return sizeof(MiSnapSpoolRecordHeader) + MiSnapSpoolPadded(length);
+}
+
+static bool MiSnapWriteFully(int fd, const void *bytes, size_t length, off_t offset)
+{
+    const uint8_t *p = bytes;
+    while (length > 0) {
+        ssize_t written = pwrite(fd, p, length, offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += written;
+        length -= (size_t)written;
+        offset += written;
+    }
+    return true;
+}
+
+#pragma mark -
+#pragma mark Index
+
+static ssize_t MiSnapSpoolFind(const MiSnapSpool *spool, uint64_t id)
+{
+    size_t low = 0, high = spool->count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (spool->index[middle].id < id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < spool->count && spool->index[low].id == id ? (ssize_t)low : -1;
+}
+
+//Ids only grow, so new entries always go at the end
+static bool MiSnapSpoolIndexAppend(MiSnapSpool *spool, uint64_t id, uint64_t offset, uint64_t length)
+{
+    if (spool->count == spool->capacity) {
+        size_t capacity = spool->capacity ? 2 * spool->capacity : 64;
+        MiSnapSpoolIndexEntry *index = realloc(spool->index, capacity * sizeof(*index));
+        if (index == NULL) {
+            return false;
+        }
+        spool->index = index;
+        spool->capacity = capacity;
+    }
+    spool->index[spool->count++] = (MiSnapSpoolIndexEntry){ id, offset, length };
+    return true;
+}
+
+static void MiSnapSpoolIndexRemove(MiSnapSpool *spool, size_t position)
+{
+    spool->deadBytes += MiSnapSpoolRecordSize(spool->index[position].length) + MiSnapSpoolRecordSize(0);
+    memmove(spool->index + position, spool->index + position + 1, (spool->count - position - 1) * sizeof(*spool->index));
+    spool->count--;
+}
+
+#pragma mark -
+#pragma mark Mapping
+
+static MiSnapSpoolMap *MiSnapSpoolMapCreate(int fd, size_t length)
+{
+    MiSnapSpoolMap *map = malloc(sizeof(*map));
+    if (map == NULL) {
+        return NULL;
+    }
+    map->bytes = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (map->bytes == MAP_FAILED) {
+        free(map);
+        return NULL;
+    }
+    map->length = length;
+    atomic_init(&map->references, 1);
+    return map;
+}
+
+void MiSnapSpoolMapRelease(MiSnapSpoolMap *map)
+{
+    if (map != NULL && atomic_fetch_sub_explicit(&map->references, 1, memory_order_acq_rel) == 1) {
+        munmap(map->bytes, map->length);
+        free(map);
+    }
+}
+
+//A mapping covering every record written so far
+static MiSnapSpoolMap *MiSnapSpoolCurrentMap(MiSnapSpool *spool)
+{
+    if (spool->map == NULL || spool->map->length < spool->end) {
+        MiSnapSpoolMap *map = MiSnapSpoolMapCreate(spool->fd, (size_t)spool->end);
+        if (map == NULL) {
+            return NULL;
+        }
+        MiSnapSpoolMapRelease(spool->map);
+        spool->map = map;
+    }
+    return spool->map;
+}
+
+#pragma mark -
+#pragma mark Recovery
+
+//Rebuilds the index from the file and truncates everything after the last intact record
+static bool MiSnapSpoolRecover(MiSnapSpool *spool, uint64_t fileSize, uint64_t nextId)
+{
+    uint64_t offset = sizeof(MiSnapSpoolFileHeader);
+    MiSnapSpoolMap *map = fileSize > offset ? MiSnapSpoolMapCreate(spool->fd, (size_t)fileSize) : NULL;
+    if (fileSize > offset && map == NULL) {
+        return false;
+    }
+    while (map != NULL && fileSize - offset >= sizeof(MiSnapSpoolRecordHeader)) {
+        MiSnapSpoolRecordHeader header;
+        memcpy(&header, map->bytes + offset, sizeof(header));
+        uint64_t available = fileSize - offset - sizeof(header);
+        if (header.magic != kMiSnapSpoolRecordMagic || header.length > available || MiSnapSpoolPadded(header.length) > available) {
+            break;
+        }
+        uint32_t crc = header.crc;
+        header.crc = 0;
+        uint32_t actual = MiSnapCRC32(0, &header, sizeof(header));
+        actual = MiSnapCRC32(actual, map->bytes + offset + sizeof(header), (size_t)header.length);
+        if (actual != crc) {
+            break;
+        }
+        if (header.type == MiSnapSpoolRecordCapture) {
+            if (header.id < spool->nextId || !MiSnapSpoolIndexAppend(spool, header.id, offset + sizeof(header), header.length)) {
+                break;
+            }
+            spool->nextId = header.id + 1;
+        } else if (header.type == MiSnapSpoolRecordTombstone) {
+            ssize_t position = MiSnapSpoolFind(spool, header.id);
+            if (position >= 0) {
+                MiSnapSpoolIndexRemove(spool, (size_t)position);
+            } else {
+                spool->deadBytes += MiSnapSpoolRecordSize(0);
+            }
+        } else {
+            break;
+        }
+        offset += MiSnapSpoolRecordSize(header.length);
+    }
+    MiSnapSpoolMapRelease(map);
+
+    if (offset < fileSize && (ftruncate(spool->fd, (off_t)offset) != 0 || fsync(spool->fd) != 0)) {
+        return false;
+    }
+    spool->end = offset;
+    spool->nextId = MAX(spool->nextId, nextId);
+    return true;
+}
+
+//Makes a rename in the directory of path durable
+static bool MiSnapSpoolSyncDirectory(const char *path)
+{
+    char *copy = strdup(path);
+    if (copy == NULL) {
+        return false;
+    }
+    int fd = open(dirname(copy), O_RDONLY);
+    free(copy);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+//Rewrites the live records into a new file that atomically replaces the spool
+static bool MiSnapSpoolCompact(MiSnapSpool *spool)
+{
+    MiSnapSpoolMap *map = MiSnapSpoolCurrentMap(spool);
+    size_t pathLength = strlen(spool->path);
+    char *temporaryPath = malloc(pathLength + 5);
+    if (map == NULL || temporaryPath == NULL) {
+        free(temporaryPath);
+        return false;
+    }
+    memcpy(temporaryPath, spool->path, pathLength);
+    memcpy(temporaryPath + pathLength, ".tmp", 5);
+
+    int fd = open(temporaryPath, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    bool written = fd >= 0;
+    uint64_t end = 0;
+    if (written) {
+        MiSnapSpoolFileHeader header = { kMiSnapSpoolFileMagic, kMiSnapSpoolVersion, spool->nextId };
+        written = MiSnapWriteFully(fd, &header, sizeof(header), 0);
+        end = sizeof(header);
+    }
+    for (size_t i = 0; written && i < spool->count; i++) {
+        uint64_t size = MiSnapSpoolRecordSize(spool->index[i].length);
+        written = MiSnapWriteFully(fd, map->bytes + spool->index[i].offset - sizeof(MiSnapSpoolRecordHeader), (size_t)size, (off_t)end);
+        end += size;
+    }
+    written = written && fsync(fd) == 0 && rename(temporaryPath, spool->path) == 0;
+    if (!written) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        unlink(temporaryPath);
+        free(temporaryPath);
+        return false;
+    }
+    free(temporaryPath);
+    //The old file is gone either way; a crash before this could only bring it back
+    MiSnapSpoolSyncDirectory(spool->path);
+
+    //Records keep their order, so only the offsets move
+    uint64_t offset = sizeof(MiSnapSpoolFileHeader);
+    for (size_t i = 0; i < spool->count; i++) {
+        spool->index[i].offset = offset + sizeof(MiSnapSpoolRecordHeader);
+        offset += MiSnapSpoolRecordSize(spool->index[i].length);
+    }
+    close(spool->fd);
+    spool->fd = fd;
+    spool->end = end;
+    spool->deadBytes = 0;
+    MiSnapSpoolMapRelease(spool->map);
+    spool->map = NULL;
+    return true;
+}
+
+#pragma mark -
+#pragma mark Spool
+
+MiSnapSpool *MiSnapSpoolOpen(const char *path)
+{
+    MiSnapSpool *spool = calloc(1, sizeof(*spool));
+    if (spool == NULL) {
+        return NULL;
+    }
+    spool->nextId = 1;
+    spool->path = strdup(path);
+    spool->fd = open(path, O_RDWR | O_CREAT, 0600);
+    struct stat status;
+    if (spool->path == NULL || spool->fd < 0 || fstat(spool->fd, &status) != 0) {
+        MiSnapSpoolClose(spool);
+        return NULL;
+    }
+
+    MiSnapSpoolFileHeader header;
+    uint64_t fileSize = (uint64_t)status.st_size;
+    if (fileSize < sizeof(header)) {
+        //New, or torn while its header was being written
+        header = (MiSnapSpoolFileHeader){ kMiSnapSpoolFileMagic, kMiSnapSpoolVersion, spool->nextId };
+        if (ftruncate(spool->fd, 0) != 0 || !MiSnapWriteFully(spool->fd, &header, sizeof(header), 0) || fsync(spool->fd) != 0) {
+            MiSnapSpoolClose(spool);
+            return NULL;
+        }
+        fileSize = sizeof(header);
+    } else if (pread(spool->fd, &header, sizeof(header), 0) != sizeof(header) || header.magic != kMiSnapSpoolFileMagic || header.version != kMiSnapSpoolVersion) {
+        //Not ours: leave the file alone
+        MiSnapSpoolClose(spool);
+        errno = EFTYPE;
+        return NULL;
+    }
+
+    if (!MiSnapSpoolRecover(spool, fileSize, header.nextId)) {
+        MiSnapSpoolClose(spool);
+        return NULL;
+    }
+    if (spool->deadBytes >= kMiSnapSpoolCompactBytes && 2 * spool->deadBytes >= spool->end) {
+        //A failed compaction leaves the spool as it was
+        MiSnapSpoolCompact(spool);
+    }
+    return spool;
+}
+
+void MiSnapSpoolClose(MiSnapSpool *spool)
+{
+    if (spool == NULL) {
+        return;
+    }
+    if (spool->fd >= 0) {
+        close(spool->fd);
+    }
+    MiSnapSpoolMapRelease(spool->map);
+    free(spool->path);
+    free(spool->index);
+    free(spool->entries);
+    free(spool);
+}
+
+static bool MiSnapSpoolWriteRecord(MiSnapSpool *spool, uint32_t type, uint64_t id, const void *const *parts, const size_t *lengths, size_t partCount, uint64_t *payloadOffset)
+{
+    MiSnapSpoolRecordHeader header = { kMiSnapSpoolRecordMagic, type, id, 0, 0, 0 };
+    for (size_t i = 0; i < partCount; i++) {
+        header.length += lengths[i];
+    }
+    uint32_t crc = MiSnapCRC32(0, &header, sizeof(header));
+    for (size_t i = 0; i < partCount; i++) {
+        crc = MiSnapCRC32(crc, parts[i], lengths[i]);
+    }
+    header.crc = crc;
+
+    //The CRC decides whether a record survived a crash; writing the header last also means a
+    //process killed mid-append leaves no header in front of a missing payload
+    uint64_t offset = spool->end + sizeof(header);
+    bool written = true;
+    for (size_t i = 0; written && i < partCount; i++) {
+        written = MiSnapWriteFully(spool->fd, parts[i], lengths[i], (off_t)offset);
+        offset += lengths[i];
+    }
+    static const uint8_t padding[8];
+    size_t paddingLength = (size_t)(MiSnapSpoolPadded(header.length) - header.length);
+    written = written && MiSnapWriteFully(spool->fd, padding, paddingLength, (off_t)offset);
+    written = written && MiSnapWriteFully(spool->fd, &header, sizeof(header), (off_t)spool->end);
+    //Only the nextId field of the file header is rewritten, so a torn write cannot touch its magic
+    uint64_t nextId = id + 1;
+    written = written && (type != MiSnapSpoolRecordCapture || MiSnapWriteFully(spool->fd, &nextId, sizeof(nextId), offsetof(MiSnapSpoolFileHeader, nextId)));
+    written = written && fsync(spool->fd) == 0;
+    if (!written) {
+        ftruncate(spool->fd, (off_t)spool->end);
+        return false;
+    }
+    *payloadOffset = spool->end + sizeof(header);
+    spool->end += MiSnapSpoolRecordSize(header.length);
+    return true;
+}
+
+uint64_t MiSnapSpoolAppend(MiSnapSpool *spool, const void *const *parts, const size_t *lengths, size_t partCount)
+{
+    uint64_t id = spool->nextId;
+    uint64_t offset;
+    if (!MiSnapSpoolWriteRecord(spool, MiSnapSpoolRecordCapture, id, parts, lengths, partCount, &offset)) {
+        return 0;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < partCount; i++) {
+        total += lengths[i];
+    }
+    spool->nextId++;
+    if (!MiSnapSpoolIndexAppend(spool, id, offset, total)) {
+        //Durable but not indexed: it will show up on the next open
+        return 0;
+    }
+    return id;
+}
+
+bool MiSnapSpoolDelete(MiSnapSpool *spool, uint64_t id)
+{
+    ssize_t position = MiSnapSpoolFind(spool, id);
+    uint64_t offset;
+    if (position < 0 || !MiSnapSpoolWriteRecord(spool, MiSnapSpoolRecordTombstone, id, NULL, NULL, 0, &offset)) {
+        return false;
+    }
+    MiSnapSpoolIndexRemove(spool, (size_t)position);
+    return true;
+}
+
+const uint8_t *MiSnapSpoolRead(MiSnapSpool *spool, uint64_t id, size_t *length, MiSnapSpoolMap **map)
+{
+    ssize_t position = MiSnapSpoolFind(spool, id);
+    MiSnapSpoolMap *current = position >= 0 ? MiSnapSpoolCurrentMap(spool) : NULL;
+    if (current == NULL) {
+        return NULL;
+    }
+    atomic_fetch_add_explicit(&current->references, 1, memory_order_relaxed);
+    *map = current;
+    *length = (size_t)spool->index[position].length;
+    return current->bytes + spool->index[position].offset;
+}
+
+const MiSnapSpoolEntry *MiSnapSpoolEntries(MiSnapSpool *spool, size_t *count)
+{
+    MiSnapSpoolEntry *entries = realloc(spool->entries, MAX(spool->count, (size_t)1) * sizeof(*entries));
+    if (entries == NULL) {
+        *count = 0;
+        return NULL;
+    }
+    spool->entries = entries;
+    for (size_t i = 0; i < spool->count; i++) {
+        entries[i] = (MiSnapSpoolEntry){ spool->index[i].id, spool->index[i].length };
+    }
+    *count = spool->count;
+    return entries;
+}
+
+MiSnapSpoolChunk MiSnapSpoolChunkRange(size_t total, int64_t offset, int64_t length)
+{
+    size_t bytes = length <= 0 ? kMiSnapSpoolDefaultChunkBytes : (size_t)MIN(MAX(length, kMiSnapSpoolMinChunkBytes), kMiSnapSpoolMaxChunkBytes);
+    size_t start = offset <= 0 ? 0 : (uint64_t)offset >= total ? total : (size_t)offset;
+    return (MiSnapSpoolChunk){ start, MIN(bytes, total - start) };
+}
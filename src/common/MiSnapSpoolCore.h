@@ -0,0 +1,57 @@
+
+#ifndef MiSnapSpoolCore_h
+#define MiSnapSpoolCore_h
+
+#include "MiSnapCore.h"
+
+//Append-only, crash-consistent store for captures. Every record carries a CRC over its header and
+//payload and is fsync'ed before its id is handed out; on open the file is scanned and anything
+//after the last intact record (a write torn by a crash or kill) is truncated away. Deletes append
+//a tombstone, and the file is compacted when it opens mostly dead. Records are read through a
+//read-only memory mapping, so payloads are never copied into the heap.
+//
+//Not thread safe; callers serialize access to a spool.
+
+typedef struct MiSnapSpool MiSnapSpool;
+typedef struct MiSnapSpoolMap MiSnapSpoolMap;
+
+//Bounds of a chunk read from a record; see MiSnapSpoolChunkRange
+#define kMiSnapSpoolDefaultChunkBytes (256 * 1024)
+#define kMiSnapSpoolMinChunkBytes (16 * 1024)
+#define kMiSnapSpoolMaxChunkBytes (4 * 1024 * 1024)
+
+typedef struct {
+    uint64_t id;
+    uint64_t length;
+} MiSnapSpoolEntry;
+
+typedef struct {
+    size_t offset;
+    size_t length;
+} MiSnapSpoolChunk;
+
+//Opens or creates the spool at path, recovering it if needed. Returns NULL with errno set on failure.
+MiSnapSpool *MiSnapSpoolOpen(const char *path);
+void MiSnapSpoolClose(MiSnapSpool *spool);
+
+//Appends one record made of partCount byte ranges and returns its id, or 0 on failure. Ids are
+//never handed out twice, even after the records that had them are deleted and compacted away.
+uint64_t MiSnapSpoolAppend(MiSnapSpool *spool, const void *const *parts, const size_t *lengths, size_t partCount);
+
+bool MiSnapSpoolDelete(MiSnapSpool *spool, uint64_t id);
+
+//Returns the payload of a record, or NULL if there is no such record. The bytes stay valid until
+//the map returned in *map is released, even if the spool is appended to, compacted or closed.
+const uint8_t *MiSnapSpoolRead(MiSnapSpool *spool, uint64_t id, size_t *length, MiSnapSpoolMap **map);
+void MiSnapSpoolMapRelease(MiSnapSpoolMap *map);
+
+//Live records in id order; valid until the next append or delete
+const MiSnapSpoolEntry *MiSnapSpoolEntries(MiSnapSpool *spool, size_t *count);
+
+//The part of total bytes a request for length bytes from offset reads, so large payloads can be
+//handed out a bounded piece at a time. The length is clamped to the chunk bounds, 0 or less
+//meaning the default; a negative offset reads from the start, and at or past the end the chunk is
+//empty and starts at the end.
+MiSnapSpoolChunk MiSnapSpoolChunkRange(size_t total, int64_t offset, int64_t length);
+
+#endif
@@ -0,0 +1,106 @@
+
+#include "MiSnapStartupCore.h"
+#include <string.h>
+#include <time.h>
+
+static uint64_t MiSnapMonotonicClock(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static void MiSnapStartupReset(MiSnapStartupTimeline *timeline)
+{
+    timeline->begun = 0;
+    timeline->ended = 0;
+}
+
+void MiSnapStartupInit(MiSnapStartupTimeline *timeline, MiSnapStartupClock clock)
+{
+    memset(timeline, 0, sizeof(*timeline));
+    timeline->clock = clock != NULL ? clock : MiSnapMonotonicClock;
+    timeline->state = MiSnapStartupStateCold;
+}
+
+bool MiSnapStartupHandle(MiSnapStartupTimeline *timeline, MiSnapStartupEvent event)
+{
+    MiSnapStartupState state = timeline->state;
+    switch (event) {
+        case MiSnapStartupEventPrewarm:
+            if (state != MiSnapStartupStateCold) {
+                return false;
+            }
+            MiSnapStartupReset(timeline);
+            timeline->state = MiSnapStartupStateWarm;
+            return true;
+        case MiSnapStartupEventPresent:
+            if (state != MiSnapStartupStateCold && state != MiSnapStartupStateWarm) {
+                return false;
+            }
+            MiSnapStartupReset(timeline);
+            timeline->prewarmed = false;
+            timeline->state = MiSnapStartupStatePresenting;
+            return true;
+        case MiSnapStartupEventPresentWarm:
+            if (state != MiSnapStartupStateWarm) {
+                return false;
+            }
+            timeline->prewarmed = true;
+            timeline->state = MiSnapStartupStatePresenting;
+            return true;
+        case MiSnapStartupEventFirstFrame:
+            if (state != MiSnapStartupStatePresenting) {
+                return false;
+            }
+            timeline->state = MiSnapStartupStateCapturing;
+            return true;
+        case MiSnapStartupEventFinish:
+            timeline->state = MiSnapStartupStateCold;
+            return true;
+    }
+    return false;
+}
+
+void MiSnapStartupBegin(MiSnapStartupTimeline *timeline, MiSnapStartupPhase phase)
+{
+    timeline->begin[phase] = timeline->clock();
+    timeline->begun |= 1u << phase;
+    timeline->ended &= ~(1u << phase);
+}
+
+void MiSnapStartupEnd(MiSnapStartupTimeline *timeline, MiSnapStartupPhase phase)
+{
+    if ((timeline->begun & ~timeline->ended) & (1u << phase)) {
+        timeline->end[phase] = timeline->clock();
+        timeline->ended |= 1u << phase;
+    }
+}
+
+double MiSnapStartupPhaseMs(const MiSnapStartupTimeline *timeline, MiSnapStartupPhase phase)
+{
+    if (!(timeline->ended & (1u << phase))) {
+        return -1;
+    }
+    return (timeline->end[phase] - timeline->begin[phase]) / 1e6;
+}
+
+double MiSnapStartupMsSince(const MiSnapStartupTimeline *timeline, MiSnapStartupPhase phase)
+{
+    if (!(timeline->begun & (1u << phase))) {
+        return -1;
+    }
+    return (timeline->clock() - timeline->begin[phase]) / 1e6;
+}
+
+double MiSnapStartupVisibleMs(const MiSnapStartupTimeline *timeline)
+{
+    double present = MiSnapStartupPhaseMs(timeline, MiSnapStartupPhasePresent);
+    if (present < 0 || timeline->prewarmed) {
+        return present;
+    }
+    for (int phase = MiSnapStartupPhaseParameters; phase < MiSnapStartupPhasePresent; phase++) {
+        present += MAX(MiSnapStartupPhaseMs(timeline, phase), 0.0);
+    }
+    return present;
+}
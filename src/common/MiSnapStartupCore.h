@@ -0,0 +1,69 @@
+
+#ifndef MiSnapStartupCore_h
+#define MiSnapStartupCore_h
+
+#include "MiSnapCore.h"
+
+//Timing and state of MiSnap controller startup. A controller is either built on demand when a
+//capture starts (cold) or ahead of time by the prewarm action (warm), and every startup phase is
+//timed so the two can be compared. The clock is injectable so the state machine can be driven
+//with a fake clock.
+
+typedef enum {
+    MiSnapStartupPhaseParameters,       //building the SDK parameter dictionary
+    MiSnapStartupPhaseController,       //allocating the MiSnapViewController
+    MiSnapStartupPhaseSetup,            //setupMiSnapWithParams:
+    MiSnapStartupPhaseView,             //loading the controller's view and nib
+    MiSnapStartupPhasePresent,          //presentViewController: until its completion
+    MiSnapStartupPhaseFirstFrame,       //presentViewController: until the first camera frame
+    MiSnapStartupPhaseCount
+} MiSnapStartupPhase;
+
+typedef enum {
+    MiSnapStartupStateCold,             //no controller
+    MiSnapStartupStateWarm,             //a prewarmed controller is waiting to be presented
+    MiSnapStartupStatePresenting,
+    MiSnapStartupStateCapturing         //the camera is delivering frames
+} MiSnapStartupState;
+
+typedef enum {
+    MiSnapStartupEventPrewarm,          //Cold -> Warm, phases restart
+    MiSnapStartupEventPresent,          //Cold or Warm -> Presenting with a new controller, phases restart
+    MiSnapStartupEventPresentWarm,      //Warm -> Presenting with the prewarmed controller
+    MiSnapStartupEventFirstFrame,       //Presenting -> Capturing
+    MiSnapStartupEventFinish            //any -> Cold
+} MiSnapStartupEvent;
+
+//Nanoseconds on a monotonic clock
+typedef uint64_t (*MiSnapStartupClock)(void);
+
+typedef struct {
+    MiSnapStartupClock clock;
+    MiSnapStartupState state;
+    bool prewarmed;                     //the presented controller was built by prewarm
+    uint32_t begun;                     //bit per phase
+    uint32_t ended;
+    uint64_t begin[MiSnapStartupPhaseCount];
+    uint64_t end[MiSnapStartupPhaseCount];
+} MiSnapStartupTimeline;
+
+//clock may be NULL for the system's monotonic clock
+void MiSnapStartupInit(MiSnapStartupTimeline *timeline, MiSnapStartupClock clock);
+
+//Returns false, leaving the state alone, if the event is not valid in the current state
+bool MiSnapStartupHandle(MiSnapStartupTimeline *timeline, MiSnapStartupEvent event);
+
+void MiSnapStartupBegin(MiSnapStartupTimeline *timeline, MiSnapStartupPhase phase);
+void MiSnapStartupEnd(MiSnapStartupTimeline *timeline, MiSnapStartupPhase phase);
+
+//Duration of a finished phase in milliseconds, or -1
+double MiSnapStartupPhaseMs(const MiSnapStartupTimeline *timeline, MiSnapStartupPhase phase);
+
+//Time since a phase began in milliseconds, or -1 if it has not
+double MiSnapStartupMsSince(const MiSnapStartupTimeline *timeline, MiSnapStartupPhase phase);
+
+//Time the user waited for the controller: every phase up to presenting, or only presenting for
+//a prewarmed controller. -1 until presenting has finished.
+double MiSnapStartupVisibleMs(const MiSnapStartupTimeline *timeline);
+
+#endif
@@ -0,0 +1,91 @@
+
+#include "MiSnapTorchCore.h"
+#include <math.h>
+#include <string.h>
+
+//Sample grid, independent of the frame size
+#define kGridColumns 32
+#define kGridRows 24
+
+//Weight of the newest frame in the running histogram
+static const float kSmoothing = 0.25f;
+//The brightest samples (glare, the torch reflection) are left out of the estimate
+static const float kTrimmedFraction = 0.05f;
+
+void MiSnapTorchInit(MiSnapTorchEstimator *estimator, MiSnapTorchMode mode, bool driversLicense, int minBrightness)
+{
+    memset(estimator, 0, sizeof(*estimator));
+    estimator->mode = mode;
+    estimator->automatic = mode == MiSnapTorchModeAutoDriversLicense || (mode == MiSnapTorchModeAuto && !driversLicense);
+    estimator->torch = mode == MiSnapTorchModeOn;
+    estimator->onBrightness = minBrightness;
+    estimator->offBrightness = minBrightness + kMiSnapTorchHysteresis;
+    estimator->torchGain = -1;
+    estimator->sinceSwitch = kMiSnapTorchHoldFrames;
+}
+
+//Trimmed mean of the running histogram on the 0-1000 scale
+static int MiSnapTorchEstimate(const float *histogram)
+{
+    float total = 0;
+    for (int bin = 0; bin < kMiSnapTorchBins; bin++) {
+        total += histogram[bin];
+    }
+    float remaining = total * (1 - kTrimmedFraction);
+    float weight = 0, sum = 0;
+    for (int bin = 0; bin < kMiSnapTorchBins && remaining > 0; bin++) {
+        float take = MIN(histogram[bin], remaining);
+        weight += take;
+        sum += take * (bin + 0.5f);
+        remaining -= take;
+    }
+    return weight > 0 ? (int)lroundf(sum / weight * 1000 / kMiSnapTorchBins) : 0;
+}
+
+bool MiSnapTorchUpdate(MiSnapTorchEstimator *estimator, const uint8_t *luma, size_t width, size_t height, size_t rowBytes)
+{
+    if (width == 0 || height == 0) {
+        return estimator->torch;
+    }
+
+    uint16_t counts[kMiSnapTorchBins] = { 0 };
+    for (int row = 0; row < kGridRows; row++) {
+        const uint8_t *line = luma + (2 * row + 1) * height / (2 * kGridRows) * rowBytes;
+        for (int column = 0; column < kGridColumns; column++) {
+            counts[line[(2 * column + 1) * width / (2 * kGridColumns)] * kMiSnapTorchBins / 256]++;
+        }
+    }
+    float weight = estimator->primed ? kSmoothing : 1;
+    for (int bin = 0; bin < kMiSnapTorchBins; bin++) {
+        estimator->histogram[bin] += weight * (counts[bin] - estimator->histogram[bin]);
+    }
+    estimator->primed = true;
+    estimator->frames++;
+    estimator->brightness = MiSnapTorchEstimate(estimator->histogram);
+
+    if (estimator->sinceSwitch < kMiSnapTorchHoldFrames) {
+        estimator->sinceSwitch++;
+        if (estimator->sinceSwitch == kMiSnapTorchHoldFrames && estimator->torch && estimator->torchGain < 0) {
+            estimator->torchGain = MAX(0, estimator->brightness - estimator->ambientAtSwitch);
+        }
+    }
+    estimator->ambient = estimator->torch ? estimator->brightness - MAX(0, estimator->torchGain) : estimator->brightness;
+    if (!estimator->automatic || estimator->sinceSwitch < kMiSnapTorchHoldFrames) {
+        estimator->pending = 0;
+        return estimator->torch;
+    }
+
+    bool wantsSwitch = estimator->torch ? estimator->ambient > estimator->offBrightness : estimator->ambient < estimator->onBrightness;
+    estimator->pending = wantsSwitch ? estimator->pending + 1 : 0;
+    if (estimator->pending >= kMiSnapTorchDwellFrames) {
+        estimator->torch = !estimator->torch;
+        if (estimator->torch) {
+            estimator->ambientAtSwitch = estimator->ambient;
+            estimator->torchGain = -1;
+        }
+        estimator->pending = 0;
+        estimator->sinceSwitch = 0;
+        estimator->switches++;
+    }
+    return estimator->torch;
+}
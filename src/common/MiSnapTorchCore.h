@@ -0,0 +1,61 @@
+
+#ifndef MiSnapTorchCore_h
+#define MiSnapTorchCore_h
+
+#include "MiSnapCore.h"
+
+//Auto-torch decisions from live frames. Luminance is sampled on a fixed grid, so the per-frame
+//cost does not depend on the resolution, and accumulated into a running histogram that smooths it
+//over time. The torch switches only after the estimate has stayed past a threshold for a number
+//of frames, with separate on and off thresholds, and never twice within a hold period. While the
+//torch is on, its own contribution (measured after it settles) is subtracted so that it does not
+//switch itself back off.
+//
+//The SDK's kMiSnapTorchMode rules apply: AUTO leaves the torch off for driver's licenses and
+//AUTO+DL does not. The user's torch button belongs to the SDK's view controller and is not seen
+//here, so the decisions do not account for it.
+
+typedef enum {
+    MiSnapTorchModeOff,
+    MiSnapTorchModeAuto,
+    MiSnapTorchModeOn,
+    //AUTO+DL. MiSnap.h names this setting but gives no kMiSnapTorchMode value for it, so 3 is the
+    //plugin's own: the profiles (0-2) never hold it and it only reaches the estimator through the
+    //torchMode override of replayFrames. It is never passed to the SDK.
+    MiSnapTorchModeAutoDriversLicense
+} MiSnapTorchMode;
+
+#define kMiSnapTorchBins 64
+//Off threshold above the on threshold, on the 0-1000 scale
+#define kMiSnapTorchHysteresis 100
+//Frames the estimate must stay past a threshold before the torch switches
+#define kMiSnapTorchDwellFrames 6
+//Frames after a switch before the torch may switch again; the torch gain is measured at the end
+#define kMiSnapTorchHoldFrames 15
+
+typedef struct {
+    MiSnapTorchMode mode;
+    bool automatic;                     //mode resolved against the document type
+    int onBrightness;                   //0-1000, as kMiSnapBrightness
+    int offBrightness;
+    float histogram[kMiSnapTorchBins];
+    bool primed;
+    bool torch;
+    int brightness;                     //smoothed estimate of the last frame
+    int ambient;                        //the estimate without the torch's contribution
+    int torchGain;                      //-1 until measured
+    int ambientAtSwitch;
+    int pending;                        //consecutive frames past the switching threshold
+    int sinceSwitch;
+    uint64_t frames;
+    uint64_t switches;
+} MiSnapTorchEstimator;
+
+//minBrightness is the kMiSnapBrightness threshold; driversLicense is true when kMiSnapDocumentType
+//contains DRIVER_LICENSE
+void MiSnapTorchInit(MiSnapTorchEstimator *estimator, MiSnapTorchMode mode, bool driversLicense, int minBrightness);
+
+//Feeds one luma frame and returns whether the torch should be on
+bool MiSnapTorchUpdate(MiSnapTorchEstimator *estimator, const uint8_t *luma, size_t width, size_t height, size_t rowBytes);
+
+#endif
@@ -0,0 +1,432 @@
+
+#include "MiSnapBase64Core.h"
+#include "MiSnapBenchmarkFrame.h"
+#include "MiSnapFrameRingCore.h"
+#include "MiSnapFrameScoreCore.h"
+#include "MiSnapImageHash.h"
+#include "MiSnapImageScalerCore.h"
+#include "MiSnapMIBICore.h"
+#include "MiSnapMICR.h"
+#include "MiSnapMetricsCore.h"
+#include "MiSnapProfileCore.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+
+//misnap_core_bench: times the portable capture kernels on the benchmark frame at the frame sizes
+//of the plugin's benchmark action, outside the app, and prints a JSON report in the same shape:
+//
+//    misnap_core_bench [--iterations N] [--sizes 720p,1080p,photo] [--output report.json]
+//
+//The kernels are BGRA to luma conversion, scoring (quad detection included), reading the MICR
+//line, hashing the check, scaling the frame to half its size as a capture is scaled to its
+//targetWidth, base64 encoding and decoding the luma plane, and serializing the results of a text
+//capture that carry it. The core has no JPEG encoder, so the app's "encode" and "fit" kernels have
+//no counterpart here; the encoder timed is the MIBI one, per call. The exit status is non-zero if
+//the MICR line is not read, so a run never reports the timing of a failed read as the reader's.
+//Work done once per call rather than per frame, such as setting up the profile of a capture, is
+//timed in nanoseconds under "calls". An unknown size is a usage error (status 2).
+
+//Bumped whenever kernels are added or the synthetic frame changes
+#define kMiSnapCoreBenchVersion 5
+#define kMiSnapCoreBenchMaxIterations 1000
+//Calls timed together for one sample of a per-call kernel, too short to time one by one
+#define kMiSnapCoreBenchCallBatch 1000
+
+typedef struct {
+    const char *name;
+    int captureMode;
+    size_t width;
+    size_t height;
+} MiSnapBenchSize;
+
+static const MiSnapBenchSize kMiSnapBenchSizes[] = {
+    { "720p", 3, 1280, 720 },
+    { "1080p", 4, 1920, 1080 },
+    { "photo", 5, 3264, 2448 }
+};
+
+typedef enum {
+    MiSnapBenchKernelConvert,
+    MiSnapBenchKernelScore,
+    MiSnapBenchKernelMICR,
+    MiSnapBenchKernelHash,
+    MiSnapBenchKernelScale,
+    MiSnapBenchKernelBase64Encode,
+    MiSnapBenchKernelBase64Decode,
+    MiSnapBenchKernelSerialize,
+    MiSnapBenchKernelCount
+} MiSnapBenchKernel;
+
+static const char *const kMiSnapBenchKernelNames[MiSnapBenchKernelCount] = { "convert", "score", "micr", "hash", "scale", "base64Encode", "base64Decode", "serialize" };
+
+static double MiSnapBenchNowMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+static int MiSnapBenchCompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+//Sorts samples in place; unit is the suffix of the keys, "Ms" or "Ns"
+static void MiSnapBenchPrintSummary(FILE *out, double *samples, size_t count, const char *unit)
+{
+    double total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += samples[i];
+    }
+    qsort(samples, count, sizeof(double), MiSnapBenchCompareDoubles);
+    fprintf(out, "{ \"mean%s\": %.4f, \"min%s\": %.4f, \"p50%s\": %.4f, \"p95%s\": %.4f, \"max%s\": %.4f }",
+            unit, total / count, unit, samples[0], unit, samples[count / 2], unit, samples[MIN(count - 1, count * 95 / 100)], unit, samples[count - 1]);
+}
+
+//The results of a text capture as JSON, the way the bridge serializes them: the encoded image,
+//its decoded length and the frame score. Slashes are escaped as NSJSONSerialization does.
+//results must hold twice the characters and 512 bytes more. Returns the length written.
+static size_t MiSnapBenchSerializeResults(char *results, const char *encoded, size_t characters, size_t bytes, const MiSnapFrameScore *score)
+{
+    size_t length = (size_t)sprintf(results, "{\"EncodedImage\":\"");
+    for (size_t i = 0; i < characters; i++) {
+        if (encoded[i] == '/') {
+            results[length++] = '\\';
+        }
+        results[length++] = encoded[i];
+    }
+    length += (size_t)sprintf(results + length, "\",\"bytes\":%zu,\"frameScore\":{\"brightness\":%d,\"sharpness\":%d,\"angle\":%d,\"quad\":",
+                              bytes, score->brightness, score->sharpness, score->angle);
+    const MiSnapQuad *quad = &score->quad;
+    if (!quad->found) {
+        length += (size_t)sprintf(results + length, "{\"found\":false}}}");
+        return length;
+    }
+    length += (size_t)sprintf(results + length, "{\"found\":true,\"corners\":[");
+    for (int corner = 0; corner < 4; corner++) {
+        length += (size_t)sprintf(results + length, "%s[%ld,%ld]", corner > 0 ? "," : "",
+                                  lroundf(quad->corners[corner].x), lroundf(quad->corners[corner].y));
+    }
+    length += (size_t)sprintf(results + length, "],\"angle\":%d,\"padding\":%d}}}", quad->angle, quad->padding);
+    return length;
+}
+
+//Every kernel works on the output of the previous one, as in a capture. Returns false if the
+//frame could not be allocated or the MICR line was not read.
+static bool MiSnapBenchRunSize(FILE *out, const MiSnapBenchSize *size, size_t iterations)
+{
+    size_t width = size->width, height = size->height, rowBytes = width * 4;
+    uint8_t *bgra = malloc(rowBytes * height);
+    uint8_t *luma = malloc(width * height);
+    uint8_t *scaled = malloc(width / 2 * 4 * (height / 2));
+    char *encoded = malloc(MiSnapBase64EncodedLength(width * height));
+    uint8_t *decoded = malloc(MiSnapBase64DecodedLength(MiSnapBase64EncodedLength(width * height)));
+    char *results = malloc(MiSnapBase64EncodedLength(width * height) * 2 + 512);
+    double *samples = malloc(sizeof(double) * iterations * MiSnapBenchKernelCount);
+    if (bgra == NULL || luma == NULL || scaled == NULL || encoded == NULL || decoded == NULL || results == NULL || samples == NULL) {
+        free(bgra);
+        free(luma);
+        free(scaled);
+        free(encoded);
+        free(decoded);
+        free(results);
+        free(samples);
+        fprintf(out, "{ \"name\": \"%s\", \"error\": \"Out of memory\" }", size->name);
+        return false;
+    }
+    MiSnapBenchmarkRect check = MiSnapBenchmarkDrawFrame(bgra, width, height, rowBytes);
+    const uint8_t *checkLuma = luma + check.top * width + check.left;
+
+    //The first run warms caches and lazily built tables and is overwritten by the second
+    bool read = true;
+    for (size_t i = 0; i <= iterations; i++) {
+        double *sample = samples + (i > 0 ? i - 1 : 0) * MiSnapBenchKernelCount;
+
+        double start = MiSnapBenchNowMs();
+        MiSnapExtractLuma(bgra, width, height, rowBytes, luma, width);
+        sample[MiSnapBenchKernelConvert] = MiSnapBenchNowMs() - start;
+
+        start = MiSnapBenchNowMs();
+        MiSnapFrameScore score;
+        MiSnapScoreLumaFrame(luma, width, height, width, &score);
+        sample[MiSnapBenchKernelScore] = MiSnapBenchNowMs() - start;
+
+        start = MiSnapBenchNowMs();
+        MiSnapMICRLine micr;
+        read = MiSnapMICRRead(checkLuma, check.width, check.height, width, &micr) && strcmp(micr.text, kMiSnapBenchmarkMICRLine) == 0 && read;
+        sample[MiSnapBenchKernelMICR] = MiSnapBenchNowMs() - start;
+
+        start = MiSnapBenchNowMs();
+        MiSnapImageHash hash;
+        MiSnapImageHashLuma(checkLuma, check.width, check.height, width, &hash);
+        sample[MiSnapBenchKernelHash] = MiSnapBenchNowMs() - start;
+
+        start = MiSnapBenchNowMs();
+        MiSnapScaleImage(bgra, width, height, rowBytes, scaled, width / 2, height / 2, width / 2 * 4, 4);
+        sample[MiSnapBenchKernelScale] = MiSnapBenchNowMs() - start;
+
+        start = MiSnapBenchNowMs();
+        size_t characters = MiSnapBase64EncodeBytes(luma, width * height, encoded);
+        sample[MiSnapBenchKernelBase64Encode] = MiSnapBenchNowMs() - start;
+
+        start = MiSnapBenchNowMs();
+        size_t bytes = MiSnapBase64DecodeBytes(encoded, characters, decoded);
+        sample[MiSnapBenchKernelBase64Decode] = MiSnapBenchNowMs() - start;
+
+        start = MiSnapBenchNowMs();
+        MiSnapBenchSerializeResults(results, encoded, characters, bytes, &score);
+        sample[MiSnapBenchKernelSerialize] = MiSnapBenchNowMs() - start;
+    }
+    free(bgra);
+    free(luma);
+    free(scaled);
+    free(encoded);
+    free(decoded);
+    free(results);
+
+    fprintf(out, "{ \"name\": \"%s\", \"captureMode\": %d, \"width\": %zu, \"height\": %zu, \"micrRead\": %s, \"kernels\": {",
+            size->name, size->captureMode, width, height, read ? "true" : "false");
+    double *kernelSamples = malloc(sizeof(double) * iterations);
+    for (int k = 0; k < MiSnapBenchKernelCount && kernelSamples != NULL; k++) {
+        for (size_t i = 0; i < iterations; i++) {
+            kernelSamples[i] = samples[i * MiSnapBenchKernelCount + k];
+        }
+        fprintf(out, "%s\n      \"%s\": ", k > 0 ? "," : "", kMiSnapBenchKernelNames[k]);
+        MiSnapBenchPrintSummary(out, kernelSamples, iterations, "Ms");
+    }
+    fprintf(out, "\n    } }");
+    free(kernelSamples);
+    free(samples);
+    return read;
+}
+
+//What the plugin does before every capture: the document type's profile, overrides by name,
+//their validation and the scoring thresholds. Returns a value that depends on every step, so none
+//of them is optimized away.
+static int MiSnapBenchProfileSetup(size_t call)
+{
+    static const char *const documentTypes[] = { "CheckFront", "CheckBack", "DriversLicense" };
+    static const char *const names[] = { "sharpness", "timeout", "torchMode" };
+    MiSnapProfile profile = *MiSnapProfileNamed(documentTypes[call % 3]);
+    for (int i = 0; i < 3; i++) {
+        MiSnapProfileSetValue(&profile, MiSnapProfileFieldNamed(names[i]), 20 + (double)(call % 2));
+    }
+    MiSnapFrameThresholds thresholds = MiSnapProfileThresholds(&profile);
+    return MiSnapProfileConsistent(&profile) + thresholds.sharpness + (int)profile.set;
+}
+
+//The hand-off of one frame from the camera callback to the analysis worker, without the copy:
+//taking the write slot, publishing it and acquiring it on the other side
+static int MiSnapBenchRingHandoff(size_t call)
+{
+    static MiSnapFrameRing ring;
+    static bool ready;
+    if (!ready) {
+        ready = MiSnapFrameRingInit(&ring, 64, 64);
+        if (!ready) {
+            return 0;
+        }
+    }
+    MiSnapRingFrame *slot = MiSnapFrameRingWriteSlot(&ring);
+    slot->sequence = call;
+    MiSnapFrameRingPublish(&ring);
+    MiSnapRingFrame *frame = MiSnapFrameRingAcquire(&ring);
+    return frame != NULL ? (int)frame->sequence : 0;
+}
+
+//Recording one stage latency into a metrics histogram, with values spread over the buckets a
+//capture's stages reach, from a few microseconds to seconds
+static int MiSnapBenchHistogramRecord(size_t call)
+{
+    static MiSnapHistogram histogram;
+    uint64_t value = (call * 2654435761u) & ((1u << (4 + call % 18)) - 1);
+    MiSnapHistogramRecord(&histogram, value);
+    return (int)(value & 1);
+}
+
+//Encoding the MIBI data of one capture into the session's compact stream and handing it out:
+//the SDK and device strings repeat from capture to capture and the frame statistics are delta
+//coded, as in the plugin
+static int MiSnapBenchMIBIEncode(size_t call)
+{
+    static MiSnapMIBIEncoder *encoder;
+    if (encoder == NULL) {
+        encoder = MiSnapMIBIEncoderCreate();
+        if (encoder == NULL) {
+            return 0;
+        }
+    }
+    static const char *const parameters[][2] = {
+        { "MiSnapDocumentType", "CheckFront" }, { "MiSnapCaptureMode", "2" }, { "MiSnapTorchMode", "1" },
+        { "MiSnapSharpness", "500" }, { "MiSnapAngle", "150" }, { "MiSnapTimeout", "30000" }
+    };
+    int64_t frames[24];
+    for (int i = 0; i < 24; i++) {
+        frames[i] = 500 + (int64_t)((call + (size_t)i) * 37 % 200);
+    }
+    MiSnapMIBIWriteObject(encoder, 5);
+    MiSnapMIBIWriteString(encoder, "MiSnapVersion", 13);
+    MiSnapMIBIWriteString(encoder, "4.6.1", 5);
+    MiSnapMIBIWriteString(encoder, "Device", 6);
+    MiSnapMIBIWriteString(encoder, "iPhone14,2", 10);
+    MiSnapMIBIWriteString(encoder, "Parameters", 10);
+    MiSnapMIBIWriteObject(encoder, 6);
+    for (int i = 0; i < 6; i++) {
+        MiSnapMIBIWriteString(encoder, parameters[i][0], strlen(parameters[i][0]));
+        MiSnapMIBIWriteString(encoder, parameters[i][1], strlen(parameters[i][1]));
+    }
+    MiSnapMIBIWriteString(encoder, "Sharpness", 9);
+    MiSnapMIBIWriteIntegers(encoder, frames, 24);
+    MiSnapMIBIWriteString(encoder, "Duration", 8);
+    MiSnapMIBIWriteDouble(encoder, 1.5 + (double)(call % 100) / 10);
+    size_t length;
+    MiSnapMIBIEncoderBytes(encoder, &length);
+    MiSnapMIBIEncoderDrain(encoder);
+    return (int)length;
+}
+
+typedef int (*MiSnapBenchCall)(size_t call);
+
+typedef struct {
+    const char *name;
+    MiSnapBenchCall call;
+} MiSnapBenchCallKernel;
+
+static const MiSnapBenchCallKernel kMiSnapBenchCallKernels[] = {
+    { "profileSetup", MiSnapBenchProfileSetup },
+    { "ringHandoff", MiSnapBenchRingHandoff },
+    { "histogramRecord", MiSnapBenchHistogramRecord },
+    { "mibiEncode", MiSnapBenchMIBIEncode },
+};
+
+static volatile int MiSnapBenchSink;
+
+static bool MiSnapBenchRunCalls(FILE *out, size_t iterations)
+{
+    double *samples = malloc(sizeof(double) * iterations);
+    if (samples == NULL) {
+        fprintf(out, "{ \"error\": \"Out of memory\" }");
+        return false;
+    }
+    fprintf(out, "{");
+    for (size_t k = 0; k < sizeof(kMiSnapBenchCallKernels) / sizeof(kMiSnapBenchCallKernels[0]); k++) {
+        const MiSnapBenchCallKernel *kernel = &kMiSnapBenchCallKernels[k];
+        for (size_t i = 0; i <= iterations; i++) {
+            int sink = 0;
+            double start = MiSnapBenchNowMs();
+            for (size_t call = 0; call < kMiSnapCoreBenchCallBatch; call++) {
+                sink += kernel->call(call);
+            }
+            samples[i > 0 ? i - 1 : 0] = (MiSnapBenchNowMs() - start) * 1e6 / kMiSnapCoreBenchCallBatch;
+            MiSnapBenchSink = sink;
+        }
+        fprintf(out, "%s\n    \"%s\": ", k > 0 ? "," : "", kernel->name);
+        MiSnapBenchPrintSummary(out, samples, iterations, "Ns");
+    }
+    fprintf(out, "\n  }");
+    free(samples);
+    return true;
+}
+
+static bool MiSnapBenchSizeSelected(const char *sizes, const char *name)
+{
+    if (sizes == NULL) {
+        return true;
+    }
+    size_t length = strlen(name);
+    for (const char *p = sizes; (p = strstr(p, name)) != NULL; p += length) {
+        if ((p == sizes || p[-1] == ',') && (p[length] == '\0' || p[length] == ',')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//Whether every name of a comma separated list is one of the sizes
+static bool MiSnapBenchSizesKnown(const char *sizes)
+{
+    for (const char *name = sizes; ; name++) {
+        size_t length = strcspn(name, ",");
+        bool known = false;
+        for (size_t i = 0; i < sizeof(kMiSnapBenchSizes) / sizeof(kMiSnapBenchSizes[0]) && !known; i++) {
+            known = strlen(kMiSnapBenchSizes[i].name) == length && strncmp(name, kMiSnapBenchSizes[i].name, length) == 0;
+        }
+        if (!known) {
+            fprintf(stderr, "misnap_core_bench: unknown size \"%.*s\"\n", (int)length, name);
+            return false;
+        }
+        name += length;
+        if (*name == '\0') {
+            return true;
+        }
+    }
+}
+
+static void MiSnapBenchUsage(void)
+{
+    fprintf(stderr, "usage: misnap_core_bench [--iterations N] [--sizes 720p,1080p,photo] [--output report.json]\n");
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = 10;
+    const char *sizes = NULL, *output = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+            sizes = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            MiSnapBenchUsage();
+            return 2;
+        }
+    }
+    if (sizes != NULL && !MiSnapBenchSizesKnown(sizes)) {
+        MiSnapBenchUsage();
+        return 2;
+    }
+    iterations = MIN(MAX(iterations, 1), kMiSnapCoreBenchMaxIterations);
+
+    FILE *out = output != NULL ? fopen(output, "w") : stdout;
+    if (out == NULL) {
+        perror(output);
+        return 1;
+    }
+    struct utsname system;
+    if (uname(&system) != 0) {
+        strcpy(system.machine, "unknown");
+        strcpy(system.sysname, "unknown");
+        system.release[0] = '\0';
+    }
+    fprintf(out, "{\n  \"version\": %d,\n  \"iterations\": %ld,\n", kMiSnapCoreBenchVersion, iterations);
+    fprintf(out, "  \"device\": { \"machine\": \"%s\", \"system\": \"%s %s\", \"cores\": %ld },\n",
+            system.machine, system.sysname, system.release, sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(out, "  \"sizes\": [");
+    bool succeeded = true, first = true;
+    for (size_t i = 0; i < sizeof(kMiSnapBenchSizes) / sizeof(kMiSnapBenchSizes[0]); i++) {
+        if (!MiSnapBenchSizeSelected(sizes, kMiSnapBenchSizes[i].name)) {
+            continue;
+        }
+        fprintf(out, "%s\n    ", first ? "" : ",");
+        first = false;
+        succeeded = MiSnapBenchRunSize(out, &kMiSnapBenchSizes[i], (size_t)iterations) && succeeded;
+    }
+    fprintf(out, "\n  ],\n  \"calls\": ");
+    bool timedCalls = MiSnapBenchRunCalls(out, (size_t)iterations);
+    fprintf(out, "\n}\n");
+    if (output != NULL) {
+        fclose(out);
+    }
+    if (!succeeded) {
+        fprintf(stderr, "misnap_core_bench: the MICR line of the benchmark frame was not read\n");
+    }
+    return succeeded && timedCalls ? 0 : 1;
+}
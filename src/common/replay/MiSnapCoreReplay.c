@@ -0,0 +1,196 @@
+
+#include "MiSnapFrameReplayCore.h"
+#include "MiSnapProfileCore.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//misnap_core_replay: replays a raw frame dump (back-to-back NV12 or BGRA frames) through the
+//frame analysis pipeline of the core, as replayFrames does on iOS, and prints the same report as
+//JSON, so a slow auto-capture session recorded on a device can be replayed on a host and
+//releases can be gated on its latency:
+//
+//    misnap_core_replay --width W --height H [--row-bytes N] [--format nv12|bgra]
+//                       [--document-type CheckFront] [--torch-mode 0-3] [--frame-rate 30]
+//                       [--best-of-window-ms N] [--candidates N] [--output report.json] dump
+//
+//The document type sets the thresholds and the torch policy as on iOS; --torch-mode overrides the
+//policy. Usage errors exit with status 2, a dump that cannot be replayed with 1.
+
+static void MiSnapReplayPrintLatency(FILE *out, const MiSnapReplayLatency *latency)
+{
+    fprintf(out, "{ \"meanMs\": %.4f, \"p50Ms\": %.4f, \"p95Ms\": %.4f, \"maxMs\": %.4f }",
+            latency->meanMs, latency->p50Ms, latency->p95Ms, latency->maxMs);
+}
+
+static void MiSnapReplayPrintScore(FILE *out, const MiSnapFrameScore *score)
+{
+    fprintf(out, "{ \"brightness\": %d, \"sharpness\": %d, \"angle\": %d, \"quad\": ", score->brightness, score->sharpness, score->angle);
+    const MiSnapQuad *quad = &score->quad;
+    if (!quad->found) {
+        fprintf(out, "{ \"found\": false } }");
+        return;
+    }
+    fprintf(out, "{ \"found\": true, \"corners\": [");
+    for (int corner = 0; corner < 4; corner++) {
+        fprintf(out, "%s[%ld, %ld]", corner > 0 ? ", " : "", lroundf(quad->corners[corner].x), lroundf(quad->corners[corner].y));
+    }
+    fprintf(out, "], \"angle\": %d, \"padding\": %d } }", quad->angle, quad->padding);
+}
+
+//The keys of the replayFrames report
+static void MiSnapReplayPrintReport(FILE *out, const MiSnapReplayReport *report)
+{
+    static const char *const modes[] = { "off", "auto", "on", "autoDriversLicense" };
+    fprintf(out, "{\n  \"frames\": %zu,\n  \"wallMs\": %.4f,\n  \"framesPerSecond\": %.2f,\n  \"acceptedFrame\": %ld,\n",
+            report->frames, report->wallMs, report->framesPerSecond, report->acceptedFrame);
+    if (report->acceptedFrame >= 0) {
+        fprintf(out, "  \"timeToAcceptMs\": %.4f,\n  \"wallTimeToAcceptMs\": %.4f,\n  \"acceptedScore\": ",
+                report->timeToAcceptMs, report->wallTimeToAcceptMs);
+        MiSnapReplayPrintScore(out, &report->acceptedScore);
+        fprintf(out, ",\n  \"bestOfWindow\": { \"windowMs\": %g, \"firstPassingFrame\": %ld, \"framesOffered\": %llu, \"candidates\": %zu },\n",
+                report->windowMs, report->firstPassingFrame, (unsigned long long)report->framesOffered, report->candidates);
+    }
+    const MiSnapTorchEstimator *torch = &report->torch;
+    fprintf(out, "  \"torch\": { \"mode\": \"%s\", \"torch\": %s, \"brightness\": %d, \"ambient\": %d, \"torchGain\": %d, \"frames\": %llu, \"switches\": %llu, \"decisions\": [",
+            modes[torch->mode], torch->torch ? "true" : "false", torch->brightness, torch->ambient, torch->torchGain,
+            (unsigned long long)torch->frames, (unsigned long long)torch->switches);
+    for (size_t i = 0; i < report->decisionCount; i++) {
+        const MiSnapReplayTorchDecision *decision = &report->decisions[i];
+        fprintf(out, "%s\n    { \"frame\": %zu, \"torch\": %s, \"brightness\": %d, \"ambient\": %d, \"torchGain\": %d }",
+                i > 0 ? "," : "", decision->frame, decision->torch ? "true" : "false", decision->brightness, decision->ambient, decision->torchGain);
+    }
+    fprintf(out, "%s] },\n  \"stages\": {", report->decisionCount > 0 ? "\n  " : "");
+    for (int s = 0; s < MiSnapReplayStageCount; s++) {
+        fprintf(out, "%s\n    \"%s\": ", s > 0 ? "," : "", kMiSnapReplayStageNames[s]);
+        MiSnapReplayPrintLatency(out, &report->stages[s]);
+    }
+    fprintf(out, "\n  }\n}\n");
+}
+
+static int MiSnapReplayUsage(void)
+{
+    fprintf(stderr, "usage: misnap_core_replay --width W --height H [--row-bytes N] [--format nv12|bgra]\n"
+                    "                          [--document-type CheckFront] [--torch-mode 0-3] [--frame-rate 30]\n"
+                    "                          [--best-of-window-ms N] [--candidates N] [--output report.json] dump\n");
+    return 2;
+}
+
+//A whole number of at least 0, or -1
+static long MiSnapReplayCount(const char *text)
+{
+    char *end;
+    long value = strtol(text, &end, 10);
+    return *text != '\0' && *end == '\0' && value >= 0 ? value : -1;
+}
+
+int main(int argc, char **argv)
+{
+    long width = -1, height = -1, rowBytes = 0, torchMode = -1, candidates = 4;
+    double frameRate = 30, bestOfWindowMs = 0;
+    MiSnapFrameFormat format = MiSnapFrameFormatNV12;
+    const char *documentType = NULL, *output = NULL, *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        const char *option = argv[i], *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (option[0] != '-' && path == NULL) {
+            path = option;
+            continue;
+        }
+        if (value == NULL) {
+            return MiSnapReplayUsage();
+        }
+        i++;
+        if (strcmp(option, "--width") == 0) {
+            width = MiSnapReplayCount(value);
+        } else if (strcmp(option, "--height") == 0) {
+            height = MiSnapReplayCount(value);
+        } else if (strcmp(option, "--row-bytes") == 0) {
+            rowBytes = MiSnapReplayCount(value);
+        } else if (strcmp(option, "--format") == 0 && (strcmp(value, "nv12") == 0 || strcmp(value, "bgra") == 0)) {
+            format = strcmp(value, "bgra") == 0 ? MiSnapFrameFormatBGRA : MiSnapFrameFormatNV12;
+        } else if (strcmp(option, "--document-type") == 0) {
+            documentType = value;
+        } else if (strcmp(option, "--torch-mode") == 0) {
+            torchMode = MiSnapReplayCount(value);
+            if (torchMode < MiSnapTorchModeOff || torchMode > MiSnapTorchModeAutoDriversLicense) {
+                return MiSnapReplayUsage();
+            }
+        } else if (strcmp(option, "--frame-rate") == 0) {
+            frameRate = atof(value);
+        } else if (strcmp(option, "--best-of-window-ms") == 0) {
+            bestOfWindowMs = atof(value);
+        } else if (strcmp(option, "--candidates") == 0) {
+            candidates = MiSnapReplayCount(value);
+        } else if (strcmp(option, "--output") == 0) {
+            output = value;
+        } else {
+            return MiSnapReplayUsage();
+        }
+    }
+    if (path == NULL || width < 0 || height < 0 || rowBytes < 0 || candidates < 0) {
+        return MiSnapReplayUsage();
+    }
+
+    MiSnapReplayOptions options;
+    MiSnapReplayOptionsInit(&options, (size_t)width, (size_t)height, (size_t)rowBytes, format);
+    if (documentType != NULL) {
+        const MiSnapProfile *profile = MiSnapProfileNamed(documentType);
+        if (profile == NULL) {
+            fprintf(stderr, "misnap_core_replay: unknown document type \"%s\"\n", documentType);
+            return MiSnapReplayUsage();
+        }
+        options.thresholds = MiSnapProfileThresholds(profile);
+        options.torchMode = MiSnapProfileValue(profile, MiSnapProfileFieldTorchMode);
+        options.driversLicense = MiSnapProfileIsDriversLicense(profile);
+    }
+    if (torchMode >= 0) {
+        options.torchMode = (MiSnapTorchMode)torchMode;
+    }
+    options.frameRate = frameRate;
+    options.bestOfWindowMs = bestOfWindowMs;
+    options.candidates = (size_t)candidates;
+
+    int file = open(path, O_RDONLY);
+    struct stat status;
+    if (file < 0 || fstat(file, &status) != 0) {
+        perror(path);
+        if (file >= 0) {
+            close(file);
+        }
+        return 1;
+    }
+    size_t length = (size_t)status.st_size;
+    const uint8_t *dump = length > 0 ? mmap(NULL, length, PROT_READ, MAP_PRIVATE, file, 0) : NULL;
+    close(file);
+    if (dump == MAP_FAILED) {
+        perror(path);
+        return 1;
+    }
+
+    MiSnapReplayReport report;
+    MiSnapReplayStatus result = MiSnapReplayRun(&options, dump, length, &report);
+    if (dump != NULL) {
+        munmap((void *)dump, length);
+    }
+    if (result != MiSnapReplayOK) {
+        fprintf(stderr, "misnap_core_replay: %s: %s\n", path, MiSnapReplayStatusMessage(result));
+        return 1;
+    }
+    FILE *out = output != NULL ? fopen(output, "w") : stdout;
+    if (out == NULL) {
+        perror(output);
+        MiSnapReplayReportFree(&report);
+        return 1;
+    }
+    MiSnapReplayPrintReport(out, &report);
+    if (output != NULL) {
+        fclose(out);
+    }
+    MiSnapReplayReportFree(&report);
+    return 0;
+}
@@ -0,0 +1,178 @@
+
+#include "MiSnapAAMVACore.h"
+#include "MiSnapTests.h"
+
+//Payloads as PDF417 readers return them: well formed ones of several versions and issuers, and
+//the damage seen in the field (separators dropped, designators pointing at the wrong place or
+//giving lengths too short to hold a subfile). The values are made up.
+typedef struct {
+    const char *name;
+    const char *payload;
+    bool parses;
+    const char *subfileType;
+    int version;
+    const char *issuer;
+    const char *fields[MiSnapAAMVAFieldCount];
+    const char *dateOfBirth;            //as MiSnapAAMVAFormatDate writes it
+} MiSnapTestPayload;
+
+static const MiSnapTestPayload kMiSnapTestCorpus[] = {
+    { "version 8 license with a jurisdiction subfile",
+        "@\n\x1e" "\rANSI 636014080102DL00410143ZC01840010DLDAQD1234567\nDCSSAMPLE\nDACALEXANDRA\nDADJANE\nDBB01311990\nDBA01312030\nDBD02012022\nDBC2\nDAG123 MAIN ST\nDAISACRAMENTO\nDAJCA\nDAK958140000  \nDCGUSA\rZCZCAPINK\r",
+        true, "DL", 8, "636014", {
+            [MiSnapAAMVAFieldFamilyName] = "SAMPLE", [MiSnapAAMVAFieldFirstName] = "ALEXANDRA", [MiSnapAAMVAFieldMiddleName] = "JANE",
+            [MiSnapAAMVAFieldLicenseNumber] = "D1234567", [MiSnapAAMVAFieldStreet] = "123 MAIN ST", [MiSnapAAMVAFieldCity] = "SACRAMENTO",
+            [MiSnapAAMVAFieldState] = "CA", [MiSnapAAMVAFieldPostalCode] = "958140000", [MiSnapAAMVAFieldSex] = "2", [MiSnapAAMVAFieldCountry] = "USA",
+            [MiSnapAAMVAFieldExpiry] = "01312030", [MiSnapAAMVAFieldIssueDate] = "02012022" },
+        "1990-01-31" },
+    { "version 10 ID card with padded values",
+        "@\n\x1e" "\rANSI 636026100101ID00310079IDDAQ12345678   \nDCSPUBLIC\nDACJOHN\nDADNONE\nDBB12251975\nDBA12252027\nDBC1\nDCGUSA\r",
+        true, "ID", 10, "636026", {
+            [MiSnapAAMVAFieldFamilyName] = "PUBLIC", [MiSnapAAMVAFieldFirstName] = "JOHN", [MiSnapAAMVAFieldMiddleName] = "NONE",
+            [MiSnapAAMVAFieldLicenseNumber] = "12345678", [MiSnapAAMVAFieldSex] = "1" },
+        "1975-12-25" },
+    { "Canadian license with CCYYMMDD dates",
+        "@\n\x1e" "\rANSI 636012090101DL00310079DLDAQON-4521-88\nDCSTREMBLAY\nDACMARIE\nDBB19850704\nDBA20290704\nDBC2\nDAJON\nDCGCAN\r",
+        true, "DL", 9, "636012", {
+            [MiSnapAAMVAFieldFamilyName] = "TREMBLAY", [MiSnapAAMVAFieldLicenseNumber] = "ON-4521-88", [MiSnapAAMVAFieldCountry] = "CAN" },
+        "1985-07-04" },
+    { "version 1 with one full name element",
+        "@\n\x1e" "\rANSI 6360000101DL00290048DLDAQ0001\nDAADOE,JOHN,Q\nDAG1 ELM ST\nDBB07041970\r",
+        true, "DL", 1, "636000", {
+            [MiSnapAAMVAFieldFullName] = "DOE,JOHN,Q", [MiSnapAAMVAFieldLicenseNumber] = "0001", [MiSnapAAMVAFieldStreet] = "1 ELM ST" },
+        "1970-07-04" },
+    { "separators dropped and offsets wrong",
+        "@ANSI 636014080101DL00990143DLDAQD7654321\nDCSROE\nDACRICHARD\nDBB03151982\r",
+        true, "DL", 8, "636014", {
+            [MiSnapAAMVAFieldFamilyName] = "ROE", [MiSnapAAMVAFieldFirstName] = "RICHARD", [MiSnapAAMVAFieldLicenseNumber] = "D7654321" },
+        "1982-03-15" },
+    { "designator length of zero",
+        "@\n\x1e" "\rANSI 636014080101DL00310000DLDAQX1\nDCSZERO\r",
+        true, "DL", 8, "636014", { [MiSnapAAMVAFieldLicenseNumber] = "X1", [MiSnapAAMVAFieldFamilyName] = "ZERO" }, NULL },
+    { "designator length of one at the end of the payload",
+        "@\n\x1e" "\rANSI 636014080101DL00310001DL",
+        false, NULL, 8, "636014", { NULL }, NULL },
+    { "designator past the end of the payload",
+        "@\n\x1e" "\rANSI 636014080101DL99990100",
+        false, NULL, 8, "636014", { NULL }, NULL },
+    { "header cut short", "@\n\x1e" "\rANSI 6360", false, NULL, 0, NULL, { NULL }, NULL },
+    { "not AAMVA data", "https://example.com/DL?ID=1", false, NULL, 0, NULL, { NULL }, NULL },
+    { "empty", "", false, NULL, 0, NULL, { NULL }, NULL },
+};
+
+#define kMiSnapTestCorpusCount (sizeof(kMiSnapTestCorpus) / sizeof(kMiSnapTestCorpus[0]))
+
+static bool MiSnapTestSliceIs(MiSnapSlice slice, const char *expected)
+{
+    return expected == NULL ? slice.length == 0 : slice.length == strlen(expected) && memcmp(slice.bytes, expected, slice.length) == 0;
+}
+
+static void MiSnapTestCorpusPayloads(void)
+{
+    for (size_t i = 0; i < kMiSnapTestCorpusCount; i++) {
+        const MiSnapTestPayload *test = &kMiSnapTestCorpus[i];
+        MiSnapAAMVARecord record;
+        bool parsed = MiSnapAAMVAParse(test->payload, strlen(test->payload), &record);
+        if (parsed != test->parses) {
+            fprintf(stderr, "%s: %s\n", test->name, parsed ? "parsed" : "not parsed");
+        }
+        MiSnapCheck(parsed == test->parses);
+        MiSnapCheck(record.version == test->version);
+        MiSnapCheck(MiSnapTestSliceIs(record.issuer, test->issuer));
+        if (!parsed) {
+            continue;
+        }
+        MiSnapCheck(MiSnapTestSliceIs(record.subfileType, test->subfileType));
+        for (int field = 0; field < MiSnapAAMVAFieldCount; field++) {
+            if (test->fields[field] != NULL && !MiSnapTestSliceIs(record.fields[field], test->fields[field])) {
+                fprintf(stderr, "%s: field %d is %.*s\n", test->name, field, (int)record.fields[field].length, record.fields[field].bytes);
+                MiSnapTestFailures++;
+            }
+        }
+        char iso[11];
+        if (test->dateOfBirth != NULL) {
+            MiSnapCheck(MiSnapAAMVAFormatDate(&record, MiSnapAAMVAFieldDateOfBirth, iso) && strcmp(iso, test->dateOfBirth) == 0);
+        }
+        MiSnapCheck(!MiSnapAAMVAFormatDate(&record, MiSnapAAMVAFieldFamilyName, iso));
+    }
+}
+
+//Every slice of a record lies in the payload it was parsed from
+static bool MiSnapTestRecordInside(const MiSnapAAMVARecord *record, const char *payload, size_t length)
+{
+    const MiSnapSlice *slices[MiSnapAAMVAFieldCount + 2] = { &record->issuer, &record->subfileType };
+    for (int field = 0; field < MiSnapAAMVAFieldCount; field++) {
+        slices[field + 2] = &record->fields[field];
+    }
+    for (size_t i = 0; i < sizeof(slices) / sizeof(slices[0]); i++) {
+        if (slices[i]->length > 0 && (slices[i]->bytes < payload || slices[i]->bytes + slices[i]->length > payload + length)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//Mutations of the corpus: bytes overwritten with digits, separators, letters of element ids or
+//anything, bytes inserted and deleted, and the payload truncated. Each mutant is parsed from a
+//buffer of exactly its length, so a read past the end trips the address sanitizer in a
+//MISNAP_SANITIZE build; in any build every slice must stay inside the payload.
+static void MiSnapTestFuzz(void)
+{
+    static const char alphabet[] = "0123456789DLIDACSQBZ\n\r\x1e @ANSI";
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 15);
+    char mutant[512];
+    int parsed = 0, outside = 0, mutants = 0;
+    for (int round = 0; round < 20000; round++) {
+        const char *seed = kMiSnapTestCorpus[round % kMiSnapTestCorpusCount].payload;
+        size_t length = strlen(seed);
+        memcpy(mutant, seed, length);
+        int mutations = 1 + (int)(MiSnapTestNext(&random) % 4);
+        for (int m = 0; m < mutations; m++) {
+            size_t at = length > 0 ? MiSnapTestNext(&random) % length : 0;
+            char byte = MiSnapTestNext(&random) % 4 == 0 ? (char)MiSnapTestNext(&random) : alphabet[MiSnapTestNext(&random) % (sizeof(alphabet) - 1)];
+            switch (MiSnapTestNext(&random) % 4) {
+                case 0:
+                    if (length > 0) {
+                        mutant[at] = byte;
+                    }
+                    break;
+                case 1:
+                    if (length < sizeof(mutant)) {
+                        memmove(mutant + at + 1, mutant + at, length - at);
+                        mutant[at] = byte;
+                        length++;
+                    }
+                    break;
+                case 2:
+                    if (length > 0) {
+                        memmove(mutant + at, mutant + at + 1, length - at - 1);
+                        length--;
+                    }
+                    break;
+                default:
+                    length = at;
+                    break;
+            }
+        }
+        char *payload = malloc(MAX(length, 1));
+        memcpy(payload, mutant, length);
+        MiSnapAAMVARecord record;
+        parsed += MiSnapAAMVAParse(payload, length, &record);
+        outside += !MiSnapTestRecordInside(&record, payload, length);
+        char iso[11];
+        MiSnapAAMVAFormatDate(&record, MiSnapAAMVAFieldDateOfBirth, iso);
+        MiSnapAAMVAFormatDate(&record, MiSnapAAMVAFieldExpiry, iso);
+        free(payload);
+        mutants++;
+    }
+    printf("%d mutants, %d parsed\n", mutants, parsed);
+    MiSnapCheck(outside == 0);
+}
+
+int main(void)
+{
+    MiSnapTestCorpusPayloads();
+    MiSnapTestFuzz();
+    return MiSnapTestResult();
+}
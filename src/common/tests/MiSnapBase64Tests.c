@@ -0,0 +1,190 @@
+
+#include "MiSnapBase64Core.h"
+#include "MiSnapTests.h"
+
+//Lengths around the vector blocks, 48 bytes to encode and 64 characters to decode
+#define kMiSnapTestMaxLength 4096
+#define kMiSnapTestCanary 0xA5
+
+static const char kMiSnapTestAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+//A reference encoder a bit at a time, sharing nothing with the codec but the alphabet
+static size_t MiSnapTestReferenceEncode(const uint8_t *src, size_t len, char *dst)
+{
+    size_t written = 0, bits = len * 8;
+    for (size_t bit = 0; bit < bits; bit += 6) {
+        int value = 0;
+        for (size_t b = bit; b < bit + 6; b++) {
+            value = value << 1 | (b < bits ? (src[b / 8] >> (7 - b % 8)) & 1 : 0);
+        }
+        dst[written++] = kMiSnapTestAlphabet[value];
+    }
+    while (written % 4 != 0) {
+        dst[written++] = '=';
+    }
+    return written;
+}
+
+static bool MiSnapTestEncodes(const char *text, const char *expected)
+{
+    char encoded[64];
+    uint8_t decoded[64];
+    size_t length = strlen(text);
+    size_t written = MiSnapBase64EncodeBytes((const uint8_t *)text, length, encoded);
+    size_t read = MiSnapBase64DecodeBytes(expected, strlen(expected), decoded);
+    return written == strlen(expected) && memcmp(encoded, expected, written) == 0 && read == length && memcmp(decoded, text, length) == 0;
+}
+
+//The RFC 4648 test vectors, which cover every amount of padding
+static void MiSnapTestVectors(void)
+{
+    MiSnapCheck(MiSnapTestEncodes("", ""));
+    MiSnapCheck(MiSnapTestEncodes("f", "Zg=="));
+    MiSnapCheck(MiSnapTestEncodes("fo", "Zm8="));
+    MiSnapCheck(MiSnapTestEncodes("foo", "Zm9v"));
+    MiSnapCheck(MiSnapTestEncodes("foob", "Zm9vYg=="));
+    MiSnapCheck(MiSnapTestEncodes("fooba", "Zm9vYmE="));
+    MiSnapCheck(MiSnapTestEncodes("foobar", "Zm9vYmFy"));
+}
+
+//Random data of every length up to a few vector blocks and then of random lengths: the encoding
+//matches the reference, has the padding its length calls for, stays within the documented sizes
+//and decodes back
+static void MiSnapTestRoundTrips(void)
+{
+    uint8_t *data = malloc(kMiSnapTestMaxLength);
+    uint8_t *decoded = malloc(MiSnapBase64DecodedLength(MiSnapBase64EncodedLength(kMiSnapTestMaxLength)) + 1);
+    char *encoded = malloc(MiSnapBase64EncodedLength(kMiSnapTestMaxLength) + 1);
+    char *reference = malloc(MiSnapBase64EncodedLength(kMiSnapTestMaxLength));
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 64);
+    for (size_t i = 0; i < kMiSnapTestMaxLength; i++) {
+        data[i] = (uint8_t)MiSnapTestNext(&random);
+    }
+    int mismatches = 0;
+    for (size_t trial = 0; trial < 600; trial++) {
+        size_t length = trial < 400 ? trial : MiSnapTestNext(&random) % kMiSnapTestMaxLength;
+        size_t capacity = MiSnapBase64EncodedLength(length);
+        encoded[capacity] = (char)kMiSnapTestCanary;
+        size_t written = MiSnapBase64EncodeBytes(data, length, encoded);
+        size_t expected = MiSnapTestReferenceEncode(data, length, reference);
+        size_t padding = 0;
+        while (padding < written && encoded[written - 1 - padding] == '=') {
+            padding++;
+        }
+
+        size_t bound = MiSnapBase64DecodedLength(written);
+        decoded[bound] = kMiSnapTestCanary;
+        size_t read = MiSnapBase64DecodeBytes(encoded, written, decoded);
+        mismatches += written != capacity || written != expected || memcmp(encoded, reference, written) != 0 ||
+                      padding != (3 - length % 3) % 3 || (uint8_t)encoded[capacity] != kMiSnapTestCanary ||
+                      read != length || memcmp(decoded, data, length) != 0 || decoded[bound] != kMiSnapTestCanary;
+    }
+    MiSnapCheck(mismatches == 0);
+
+    //Unpadded input decodes the same; a lone trailing character carries no whole byte
+    MiSnapCheck(MiSnapBase64DecodeBytes("Zm9vYg", 6, decoded) == 4 && memcmp(decoded, "foob", 4) == 0);
+    MiSnapCheck(MiSnapBase64DecodeBytes("Zm9vY", 5, decoded) == 3 && memcmp(decoded, "foo", 3) == 0);
+    MiSnapCheck(MiSnapBase64DecodeBytes("Q", 1, decoded) == 0);
+    MiSnapCheck(MiSnapBase64DecodeBytes("QQ", 2, decoded) == 1 && decoded[0] == 'A');
+    free(data);
+    free(decoded);
+    free(encoded);
+    free(reference);
+}
+
+//Characters outside the alphabet are skipped wherever they are: line breaks, spaces, the URL-safe
+//alphabet's - and _, bytes with the high bit set and padding in the middle. Each is tried at
+//every position of the first two vector blocks and further in, and the result must be that of
+//the text without it.
+static void MiSnapTestInvalidInput(void)
+{
+    const size_t length = 300;
+    uint8_t data[300], decoded[512], expected[512];
+    char encoded[512], damaged[512];
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 2);
+    for (size_t i = 0; i < length; i++) {
+        data[i] = (uint8_t)MiSnapTestNext(&random);
+    }
+    size_t written = MiSnapBase64EncodeBytes(data, length, encoded);
+    const char inserted[] = { '\n', '\r', ' ', '-', '_', '*', '=', (char)0x80, (char)0xC3, (char)0xFF, '\0' };
+    int mismatches = 0;
+    for (size_t c = 0; c < sizeof(inserted); c++) {
+        for (size_t position = 0; position <= written; position += position < 140 ? 1 : 37) {
+            memcpy(damaged, encoded, position);
+            damaged[position] = inserted[c];
+            memcpy(damaged + position + 1, encoded + position, written - position);
+            size_t read = MiSnapBase64DecodeBytes(damaged, written + 1, decoded);
+            mismatches += read != length || memcmp(decoded, data, length) != 0;
+        }
+    }
+    MiSnapCheck(mismatches == 0);
+
+    //MIME line breaks every 76 characters
+    size_t wrapped = 0;
+    for (size_t i = 0; i < written; i++) {
+        damaged[wrapped++] = encoded[i];
+        if (i % 76 == 75) {
+            damaged[wrapped++] = '\r';
+            damaged[wrapped++] = '\n';
+        }
+    }
+    MiSnapCheck(MiSnapBase64DecodeBytes(damaged, wrapped, decoded) == length && memcmp(decoded, data, length) == 0);
+
+    //Nothing but invalid characters decodes to nothing, and concatenated padded texts decode as one
+    MiSnapCheck(MiSnapBase64DecodeBytes("*** ---\n", 8, decoded) == 0);
+    size_t read = MiSnapBase64DecodeBytes("Zg==Zg==", 8, decoded);
+    MiSnapCheck(read == MiSnapBase64DecodeBytes("ZgZg", 4, expected) && memcmp(decoded, expected, read) == 0);
+}
+
+//The NEON paths against the scalar ones on the same inputs, clean and damaged, at lengths
+//around the block sizes. On hosts without NEON both calls take the scalar path.
+static void MiSnapTestVectorMatchesScalar(void)
+{
+    uint8_t *data = malloc(kMiSnapTestMaxLength);
+    char *vector = malloc(MiSnapBase64EncodedLength(kMiSnapTestMaxLength) + 8);
+    char *scalar = malloc(MiSnapBase64EncodedLength(kMiSnapTestMaxLength) + 8);
+    uint8_t *vectorBytes = malloc(kMiSnapTestMaxLength + 8);
+    uint8_t *scalarBytes = malloc(kMiSnapTestMaxLength + 8);
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 48);
+    int mismatches = 0;
+    for (size_t trial = 0; trial < 500; trial++) {
+        size_t length = trial < 200 ? trial : MiSnapTestNext(&random) % kMiSnapTestMaxLength;
+        for (size_t i = 0; i < length; i++) {
+            data[i] = (uint8_t)MiSnapTestNext(&random);
+        }
+        size_t a = MiSnapBase64EncodeBytes(data, length, vector);
+        size_t b = MiSnapBase64EncodeBytesScalar(data, length, scalar);
+        mismatches += a != b || memcmp(vector, scalar, a) != 0;
+
+        //Damage a few characters, sometimes none
+        for (int damage = MiSnapTestNext(&random) % 4; damage > 0 && a > 0; damage--) {
+            vector[MiSnapTestNext(&random) % a] = (char)(MiSnapTestNext(&random) % 256);
+        }
+        size_t x = MiSnapBase64DecodeBytes(vector, a, vectorBytes);
+        size_t y = MiSnapBase64DecodeBytesScalar(vector, a, scalarBytes);
+        mismatches += x != y || memcmp(vectorBytes, scalarBytes, x) != 0;
+    }
+    MiSnapCheck(mismatches == 0);
+#if defined(__aarch64__)
+    printf("NEON checked against the scalar path\n");
+#else
+    printf("no NEON on this host; the scalar path was checked against itself\n");
+#endif
+    free(data);
+    free(vector);
+    free(scalar);
+    free(vectorBytes);
+    free(scalarBytes);
+}
+
+int main(void)
+{
+    MiSnapTestVectors();
+    MiSnapTestRoundTrips();
+    MiSnapTestInvalidInput();
+    MiSnapTestVectorMatchesScalar();
+    return MiSnapTestResult();
+}
@@ -0,0 +1,74 @@
+
+#include "MiSnapBufferPoolCore.h"
+#include "MiSnapTests.h"
+
+#define kMiSnapTestSlots 64
+
+//Random acquires and releases, including requests too large to pool. Buffers must be aligned and
+//must not overlap: each is marked at both ends with its slot and checked on release.
+static void MiSnapTestChurn(MiSnapBufferPool *pool)
+{
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 5);
+    uint8_t *buffers[kMiSnapTestSlots] = { NULL };
+    size_t sizes[kMiSnapTestSlots];
+    for (int i = 0; i < 100000; i++) {
+        int slot = (int)(MiSnapTestNext(&random) % kMiSnapTestSlots);
+        if (buffers[slot] != NULL) {
+            MiSnapCheck(buffers[slot][0] == slot && buffers[slot][sizes[slot] - 1] == slot);
+            MiSnapBufferRelease(pool, buffers[slot]);
+            buffers[slot] = NULL;
+            continue;
+        }
+        sizes[slot] = 1 + MiSnapTestNext(&random) % (3 << 20);
+        if (MiSnapTestNext(&random) % 50 == 0) {
+            sizes[slot] = 200 << 20;
+        }
+        buffers[slot] = MiSnapBufferAcquire(pool, sizes[slot]);
+        MiSnapCheck(buffers[slot] != NULL && (uintptr_t)buffers[slot] % 64 == 0);
+        buffers[slot][0] = buffers[slot][sizes[slot] - 1] = (uint8_t)slot;
+    }
+    for (int slot = 0; slot < kMiSnapTestSlots; slot++) {
+        MiSnapBufferRelease(pool, buffers[slot]);
+    }
+}
+
+int main(void)
+{
+    MiSnapBufferPool *pool = MiSnapBufferPoolCreate(32 << 20);
+    MiSnapBufferPoolStatistics statistics;
+
+    //A released buffer serves the next request of its class
+    void *buffer = MiSnapBufferAcquire(pool, 100000);
+    MiSnapBufferPoolGetStatistics(pool, &statistics, false);
+    MiSnapCheck(statistics.misses == 1 && statistics.hits == 0 && statistics.inUseBytes >= 100000);
+    MiSnapBufferRelease(pool, buffer);
+    void *reused = MiSnapBufferAcquire(pool, 120000);
+    MiSnapCheck(reused == buffer);
+    MiSnapBufferRelease(pool, reused);
+    MiSnapBufferRelease(pool, NULL);
+    MiSnapBufferPoolGetStatistics(pool, &statistics, true);
+    MiSnapCheck(statistics.hits == 1 && statistics.inUseBytes == 0 && statistics.idleBytes >= 100000);
+    MiSnapBufferPoolGetStatistics(pool, &statistics, false);
+    MiSnapCheck(statistics.hits == 0 && statistics.misses == 0);
+
+    MiSnapTestChurn(pool);
+    MiSnapBufferPoolGetStatistics(pool, &statistics, false);
+    printf("hits %llu misses %llu trimmed %llu peak %zu\n", (unsigned long long)statistics.hits, (unsigned long long)statistics.misses, (unsigned long long)statistics.trimmed, statistics.peakBytes);
+    MiSnapCheck(statistics.inUseBytes == 0);
+    MiSnapCheck(statistics.idleBytes <= statistics.highWaterBytes);
+    MiSnapCheck(statistics.hits > statistics.misses);
+    MiSnapCheck(statistics.trimmed > 0);
+    MiSnapCheck(statistics.peakBytes >= statistics.idleBytes);
+
+    //Lowering the high-water mark frees idle buffers down to it; trimming frees them all
+    MiSnapBufferPoolSetHighWater(pool, 1 << 20);
+    MiSnapBufferPoolGetStatistics(pool, &statistics, false);
+    MiSnapCheck(statistics.highWaterBytes == 1 << 20 && statistics.idleBytes <= 1 << 20);
+    MiSnapBufferPoolTrim(pool);
+    MiSnapBufferPoolGetStatistics(pool, &statistics, false);
+    MiSnapCheck(statistics.idleBytes == 0);
+
+    MiSnapBufferPoolDestroy(pool);
+    return MiSnapTestResult();
+}
@@ -0,0 +1,89 @@
+
+#include "MiSnapFeedback.h"
+#include "MiSnapTests.h"
+
+//A minute of frames at 60 fps, with a millisecond of jitter on each timestamp and the torch
+//switched every ten seconds, offered at each rate. Every frame must be folded into exactly one
+//event, and events must be at least one interval apart but no further than the next frame.
+static void MiSnapTestRate(double rate)
+{
+    MiSnapFeedbackThrottle throttle;
+    MiSnapFeedbackInit(&throttle, rate);
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 7);
+
+    double clamped = MIN(MAX(rate, 0.1), 60);
+    uint64_t frames = 0, folded = 0, passing = 0, passingFolded = 0, events = 0;
+    uint32_t torchSwitches = 0, torchSwitchesFolded = 0;
+    double lastEventMs = -1, minGapMs = INFINITY;
+    bool torch = false;
+    MiSnapFeedbackEvent event;
+    for (uint64_t frame = 0; frame < 60 * 60; frame++) {
+        if (frame % 600 == 300) {
+            torch = !torch;
+            torchSwitches++;
+        }
+        MiSnapFeedbackSample sample = {
+            .frame = frame,
+            .timeMs = frame * 1000.0 / 60 + MiSnapTestUniform(&random) * 2 - 1,
+            .brightness = (int)(MiSnapTestNext(&random) % 1000),
+            .sharpness = (int)(MiSnapTestNext(&random) % 1000),
+            .angle = 10,
+            .torch = torch,
+            .passes = frame % 3 == 0
+        };
+        frames++;
+        passing += sample.passes;
+        if (MiSnapFeedbackOffer(&throttle, &sample, &event)) {
+            MiSnapCheck(event.last.frame == frame);
+            if (lastEventMs >= 0) {
+                minGapMs = MIN(minGapMs, event.last.timeMs - lastEventMs);
+            }
+            lastEventMs = event.last.timeMs;
+            events++;
+            folded += event.frames;
+            passingFolded += event.passingFrames;
+            torchSwitchesFolded += event.torchSwitches;
+        }
+    }
+    if (MiSnapFeedbackFlush(&throttle, &event)) {
+        events++;
+        folded += event.frames;
+        passingFolded += event.passingFrames;
+        torchSwitchesFolded += event.torchSwitches;
+    }
+    MiSnapCheck(!MiSnapFeedbackFlush(&throttle, &event));
+
+    MiSnapCheck(folded == frames);
+    MiSnapCheck(passingFolded == passing);
+    MiSnapCheck(torchSwitchesFolded == torchSwitches);
+    MiSnapCheck(events <= 60 * clamped + 2);
+    MiSnapCheck(events >= 60000 / (1000 / clamped + 1000.0 / 60 + 2) - 1);
+    MiSnapCheck(minGapMs >= 1000 / clamped - 1e-9);
+    printf("rate %5.1f: %llu events, closest %.1f ms apart\n", rate, (unsigned long long)events, minGapMs);
+}
+
+int main(void)
+{
+    const double rates[] = { 0, 1, 4, 10, 15, 30, 60, 120 };
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        MiSnapTestRate(rates[i]);
+    }
+
+    //The aggregates of an event cover only the frames folded into it
+    MiSnapFeedbackThrottle throttle;
+    MiSnapFeedbackInit(&throttle, 10);
+    MiSnapFeedbackEvent event;
+    MiSnapFeedbackSample first = { 0, 0, 500, 300, 0, false, true };
+    MiSnapCheck(MiSnapFeedbackOffer(&throttle, &first, &event) && event.frames == 1);
+    MiSnapFeedbackSample dark = { 1, 40, 100, 900, 0, false, false };
+    MiSnapFeedbackSample bright = { 2, 80, 800, 200, 0, false, true };
+    MiSnapCheck(!MiSnapFeedbackOffer(&throttle, &dark, &event));
+    MiSnapCheck(!MiSnapFeedbackOffer(&throttle, &bright, &event));
+    MiSnapCheck(MiSnapFeedbackFlush(&throttle, &event));
+    MiSnapCheck(event.frames == 2 && event.passingFrames == 1);
+    MiSnapCheck(event.minBrightness == 100 && event.maxBrightness == 800 && event.bestSharpness == 900);
+    MiSnapCheck(event.last.frame == 2);
+
+    return MiSnapTestResult();
+}
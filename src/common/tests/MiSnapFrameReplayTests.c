@@ -0,0 +1,231 @@
+
+#include "MiSnapBenchmarkFrame.h"
+#include "MiSnapFrameReplayCore.h"
+#include "MiSnapMetricsCore.h"
+#include "MiSnapTests.h"
+
+//A recorded auto-capture session, rendered from the benchmark check: the scene starts too dark,
+//then the check is in focus more and more, sharpest at kMiSnapTestSharpest, and stays in focus.
+//It is written to replay.bgra and replay.nv12, which the misnap_core_replay test replays.
+
+#define kMiSnapTestWidth 640
+#define kMiSnapTestHeight 360
+#define kMiSnapTestFrames 40
+#define kMiSnapTestFirstPassing 20
+#define kMiSnapTestSharpest 23
+//Frames of session time a 190 ms window stays open at 30 frames per second, the one it opens on
+//included
+#define kMiSnapTestWindowFrames 6
+
+typedef enum {
+    MiSnapTestSceneDark,
+    MiSnapTestSceneBlur4,
+    MiSnapTestSceneBlur3,
+    MiSnapTestSceneBlur2,
+    MiSnapTestSceneBlur1,
+    MiSnapTestSceneSharp
+} MiSnapTestScene;
+
+static MiSnapTestScene MiSnapTestSceneOf(size_t frame)
+{
+    static const MiSnapTestScene around[] = {
+        MiSnapTestSceneBlur3, MiSnapTestSceneBlur2, MiSnapTestSceneBlur2, MiSnapTestSceneSharp, MiSnapTestSceneBlur1, MiSnapTestSceneBlur2
+    };
+    if (frame < 12) {
+        return MiSnapTestSceneDark;
+    }
+    if (frame < kMiSnapTestFirstPassing) {
+        return MiSnapTestSceneBlur4;
+    }
+    return frame < kMiSnapTestFirstPassing + 6 ? around[frame - kMiSnapTestFirstPassing] : MiSnapTestSceneSharp;
+}
+
+//A box blur of the given radius, clamped at the edges
+static void MiSnapTestBlur(const uint8_t *src, uint8_t *dst, int radius)
+{
+    for (int y = 0; y < kMiSnapTestHeight; y++) {
+        for (int x = 0; x < kMiSnapTestWidth; x++) {
+            int sum = 0, count = 0;
+            for (int dy = -radius; dy <= radius; dy++) {
+                for (int dx = -radius; dx <= radius; dx++) {
+                    if (y + dy >= 0 && y + dy < kMiSnapTestHeight && x + dx >= 0 && x + dx < kMiSnapTestWidth) {
+                        sum += src[(y + dy) * kMiSnapTestWidth + x + dx];
+                        count++;
+                    }
+                }
+            }
+            dst[y * kMiSnapTestWidth + x] = (uint8_t)(sum / count);
+        }
+    }
+}
+
+//Renders the luma of every scene, then the session as BGRA (gray pixels, so the luma converts
+//back to itself) and as NV12 (the luma and a neutral CbCr plane)
+static bool MiSnapTestWriteSession(uint8_t **bgra, size_t *bgraLength, uint8_t **nv12, size_t *nv12Length)
+{
+    const size_t pixels = kMiSnapTestWidth * kMiSnapTestHeight;
+    uint8_t *frame = malloc(pixels * 4);
+    uint8_t *scenes[MiSnapTestSceneSharp + 1];
+    for (int s = 0; s <= MiSnapTestSceneSharp; s++) {
+        scenes[s] = malloc(pixels);
+    }
+    MiSnapBenchmarkDrawFrame(frame, kMiSnapTestWidth, kMiSnapTestHeight, kMiSnapTestWidth * 4);
+    MiSnapExtractLuma(frame, kMiSnapTestWidth, kMiSnapTestHeight, kMiSnapTestWidth * 4, scenes[MiSnapTestSceneSharp], kMiSnapTestWidth);
+    for (size_t i = 0; i < pixels; i++) {
+        scenes[MiSnapTestSceneDark][i] = scenes[MiSnapTestSceneSharp][i] / 5;
+    }
+    for (int radius = 1; radius <= 4; radius++) {
+        MiSnapTestBlur(scenes[MiSnapTestSceneSharp], scenes[MiSnapTestSceneBlur1 - (radius - 1)], radius);
+    }
+
+    *bgraLength = pixels * 4 * kMiSnapTestFrames;
+    *nv12Length = pixels * 3 / 2 * kMiSnapTestFrames;
+    *bgra = malloc(*bgraLength);
+    *nv12 = malloc(*nv12Length);
+    for (size_t f = 0; f < kMiSnapTestFrames; f++) {
+        const uint8_t *luma = scenes[MiSnapTestSceneOf(f)];
+        uint8_t *pixel = *bgra + f * pixels * 4, *plane = *nv12 + f * pixels * 3 / 2;
+        for (size_t i = 0; i < pixels; i++) {
+            pixel[4 * i] = pixel[4 * i + 1] = pixel[4 * i + 2] = luma[i];
+            pixel[4 * i + 3] = 255;
+        }
+        memcpy(plane, luma, pixels);
+        memset(plane + pixels, 128, pixels / 2);
+    }
+    free(frame);
+    for (int s = 0; s <= MiSnapTestSceneSharp; s++) {
+        free(scenes[s]);
+    }
+
+    FILE *bgraFile = fopen("replay.bgra", "wb"), *nv12File = fopen("replay.nv12", "wb");
+    bool written = bgraFile != NULL && nv12File != NULL &&
+                   fwrite(*bgra, 1, *bgraLength, bgraFile) == *bgraLength && fwrite(*nv12, 1, *nv12Length, nv12File) == *nv12Length;
+    if (bgraFile != NULL) {
+        written = fclose(bgraFile) == 0 && written;
+    }
+    if (nv12File != NULL) {
+        written = fclose(nv12File) == 0 && written;
+    }
+    return written;
+}
+
+static MiSnapReplayStatus MiSnapTestReplay(const uint8_t *dump, size_t length, MiSnapFrameFormat format, double bestOfWindowMs, MiSnapReplayReport *report)
+{
+    MiSnapReplayOptions options;
+    MiSnapReplayOptionsInit(&options, kMiSnapTestWidth, kMiSnapTestHeight, 0, format);
+    options.bestOfWindowMs = bestOfWindowMs;
+    return MiSnapReplayRun(&options, dump, length, report);
+}
+
+//The first passing frame is accepted without a window, the sharpest one of the window with one,
+//on the frame that closes it; both formats replay the same session alike
+static void MiSnapTestAcceptance(const uint8_t *bgra, size_t bgraLength, const uint8_t *nv12, size_t nv12Length)
+{
+    MiSnapReplayReport report, other;
+    MiSnapCheck(MiSnapTestReplay(bgra, bgraLength, MiSnapFrameFormatBGRA, 0, &report) == MiSnapReplayOK);
+    MiSnapCheck(report.frames == kMiSnapTestFrames);
+    MiSnapCheck(report.firstPassingFrame == kMiSnapTestFirstPassing && report.acceptedFrame == kMiSnapTestFirstPassing);
+    MiSnapCheck(report.decisionFrame == kMiSnapTestFirstPassing);
+    MiSnapCheck(report.timeToAcceptMs == kMiSnapTestFirstPassing * 1000.0 / 30);
+    MiSnapCheck(report.framesOffered == 1 && report.candidates == 1 && report.windowMs == 0);
+    MiSnapReplayReportFree(&report);
+
+    MiSnapCheck(MiSnapTestReplay(bgra, bgraLength, MiSnapFrameFormatBGRA, 190, &report) == MiSnapReplayOK);
+    MiSnapCheck(MiSnapTestReplay(nv12, nv12Length, MiSnapFrameFormatNV12, 190, &other) == MiSnapReplayOK);
+    printf("accepted frame %ld (sharpness %d) on frame %ld\n", report.acceptedFrame, report.acceptedScore.sharpness, report.decisionFrame);
+    MiSnapCheck(report.firstPassingFrame == kMiSnapTestFirstPassing && report.acceptedFrame == kMiSnapTestSharpest);
+    MiSnapCheck(report.decisionFrame == kMiSnapTestFirstPassing + kMiSnapTestWindowFrames);
+    MiSnapCheck(report.framesOffered == kMiSnapTestWindowFrames && report.candidates == 4);
+    MiSnapCheck(report.acceptedScore.quad.found);
+    MiSnapCheck(other.acceptedFrame == report.acceptedFrame && other.decisionFrame == report.decisionFrame);
+    MiSnapCheck(memcmp(&other.acceptedScore, &report.acceptedScore, sizeof(MiSnapFrameScore)) == 0);
+    MiSnapCheck(other.decisionCount == report.decisionCount && other.torch.switches == report.torch.switches);
+    MiSnapReplayReportFree(&report);
+    MiSnapReplayReportFree(&other);
+
+    //A dump that ends while the window is open decides on its last frame, among the frames so
+    //far; earlier frames win ties
+    MiSnapCheck(MiSnapTestReplay(bgra, bgraLength / kMiSnapTestFrames * kMiSnapTestSharpest, MiSnapFrameFormatBGRA, 190, &report) == MiSnapReplayOK);
+    MiSnapCheck(report.decisionFrame == kMiSnapTestSharpest - 1 && report.acceptedFrame == kMiSnapTestFirstPassing + 1);
+    MiSnapReplayReportFree(&report);
+
+    //Without a passing frame nothing is accepted
+    MiSnapCheck(MiSnapTestReplay(bgra, bgraLength / kMiSnapTestFrames * kMiSnapTestFirstPassing, MiSnapFrameFormatBGRA, 190, &report) == MiSnapReplayOK);
+    MiSnapCheck(report.acceptedFrame == -1 && report.firstPassingFrame == -1 && report.decisionFrame == -1);
+    MiSnapReplayReportFree(&report);
+}
+
+//The dark start turns the torch on once the dwell is over, with the estimate that did it
+static void MiSnapTestTorchDecisions(const uint8_t *bgra, size_t bgraLength)
+{
+    MiSnapReplayReport report;
+    MiSnapCheck(MiSnapTestReplay(bgra, bgraLength, MiSnapFrameFormatBGRA, 0, &report) == MiSnapReplayOK);
+    MiSnapCheck(report.decisionCount >= 1 && report.decisionCount == report.torch.switches);
+    if (report.decisionCount >= 1) {
+        const MiSnapReplayTorchDecision *first = &report.decisions[0];
+        MiSnapCheck(first->frame == kMiSnapTorchDwellFrames - 1 && first->torch);
+        MiSnapCheck(first->ambient < 400 && first->torchGain == -1);
+    }
+    MiSnapCheck(report.torch.frames == kMiSnapTestFrames);
+    MiSnapReplayReportFree(&report);
+}
+
+static uint64_t MiSnapTestClockNs;
+
+//Every reading of the clock is a millisecond after the previous one
+static uint64_t MiSnapTestClock(void)
+{
+    MiSnapTestClockNs += 1000000;
+    return MiSnapTestClockNs;
+}
+
+//On a clock that moves a millisecond per reading every stage of every frame takes a millisecond,
+//so the stage summaries, the wall time and the throughput are exact
+static void MiSnapTestLatencies(const uint8_t *nv12, size_t nv12Length)
+{
+    MiSnapMetricsSetClock(MiSnapTestClock);
+    MiSnapReplayReport report;
+    MiSnapCheck(MiSnapTestReplay(nv12, nv12Length, MiSnapFrameFormatNV12, 0, &report) == MiSnapReplayOK);
+    MiSnapMetricsSetClock(NULL);
+    for (int s = 0; s < MiSnapReplayStageCount; s++) {
+        const MiSnapReplayLatency *latency = &report.stages[s];
+        MiSnapCheck(latency->meanMs == 1 && latency->p50Ms == 1 && latency->p95Ms == 1 && latency->maxMs == 1);
+    }
+    //Two readings per stage, one more for the acceptance and one at the end
+    double wallMs = kMiSnapTestFrames * MiSnapReplayStageCount * 2 + 2;
+    MiSnapCheck(report.wallMs == wallMs);
+    MiSnapCheck(fabs(report.framesPerSecond - kMiSnapTestFrames * 1000.0 / wallMs) < 1e-9);
+    MiSnapCheck(report.wallTimeToAcceptMs == (kMiSnapTestFirstPassing + 1) * MiSnapReplayStageCount * 2 + 1);
+    MiSnapCheck(strcmp(kMiSnapReplayStageNames[MiSnapReplayStageQuad], "quad") == 0);
+    MiSnapReplayReportFree(&report);
+}
+
+static void MiSnapTestErrors(const uint8_t *bgra, size_t bgraLength)
+{
+    MiSnapReplayOptions options;
+    MiSnapReplayReport report;
+    MiSnapReplayOptionsInit(&options, 1, kMiSnapTestHeight, 0, MiSnapFrameFormatBGRA);
+    MiSnapCheck(MiSnapReplayRun(&options, bgra, bgraLength, &report) == MiSnapReplayInvalidGeometry);
+    MiSnapReplayOptionsInit(&options, kMiSnapTestWidth, kMiSnapTestHeight, kMiSnapTestWidth * 4 - 1, MiSnapFrameFormatBGRA);
+    MiSnapCheck(MiSnapReplayRun(&options, bgra, bgraLength, &report) == MiSnapReplayInvalidGeometry);
+    MiSnapReplayOptionsInit(&options, kMiSnapTestWidth, kMiSnapTestHeight, 0, MiSnapFrameFormatBGRA);
+    MiSnapCheck(MiSnapReplayFrameSize(&options) == kMiSnapTestWidth * 4 * kMiSnapTestHeight);
+    MiSnapCheck(MiSnapReplayRun(&options, bgra, MiSnapReplayFrameSize(&options) - 1, &report) == MiSnapReplayTooShort);
+    MiSnapReplayOptionsInit(&options, kMiSnapTestWidth, kMiSnapTestHeight, 0, MiSnapFrameFormatNV12);
+    MiSnapCheck(MiSnapReplayFrameSize(&options) == kMiSnapTestWidth * kMiSnapTestHeight * 3 / 2);
+    MiSnapCheck(strcmp(MiSnapReplayStatusMessage(MiSnapReplayTooShort), "Dump is smaller than one frame") == 0);
+}
+
+int main(void)
+{
+    uint8_t *bgra, *nv12;
+    size_t bgraLength, nv12Length;
+    MiSnapCheck(MiSnapTestWriteSession(&bgra, &bgraLength, &nv12, &nv12Length));
+    MiSnapTestAcceptance(bgra, bgraLength, nv12, nv12Length);
+    MiSnapTestTorchDecisions(bgra, bgraLength);
+    MiSnapTestLatencies(nv12, nv12Length);
+    MiSnapTestErrors(bgra, bgraLength);
+    free(bgra);
+    free(nv12);
+    return MiSnapTestResult();
+}
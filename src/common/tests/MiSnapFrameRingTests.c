@@ -0,0 +1,166 @@
+
+#include "MiSnapFrameRingCore.h"
+#include "MiSnapTests.h"
+#include <pthread.h>
+#include <sched.h>
+
+//Stress test of the frame ring: several rings run at once, each with its own producer and
+//consumer thread as in the analyzer. Every frame carries a pattern derived from its sequence
+//number over its whole plane, so a frame read while it is being written (a torn frame) shows up as
+//a pattern that does not match its header.
+
+#define kMiSnapTestRings 4
+#define kMiSnapTestFrames 20000
+#define kMiSnapTestMaxWidth 96
+#define kMiSnapTestMaxHeight 64
+
+typedef struct {
+    MiSnapFrameRing ring;
+    _Atomic bool done;
+    uint64_t seen;
+    uint64_t skipped;
+    uint64_t torn;
+    uint64_t reordered;
+} MiSnapTestRing;
+
+static uint8_t MiSnapTestPixel(uint64_t sequence, size_t x, size_t y)
+{
+    return (uint8_t)(sequence * 131 + x * 7 + y * 13);
+}
+
+static void *MiSnapTestProduce(void *argument)
+{
+    MiSnapTestRing *test = argument;
+    for (uint64_t sequence = 1; sequence <= kMiSnapTestFrames; sequence++) {
+        MiSnapRingFrame *slot = MiSnapFrameRingWriteSlot(&test->ring);
+        slot->width = kMiSnapTestMaxWidth - sequence % 17;
+        slot->height = kMiSnapTestMaxHeight - sequence % 11;
+        for (size_t y = 0; y < slot->height; y++) {
+            for (size_t x = 0; x < slot->width; x++) {
+                slot->luma[y * slot->rowBytes + x] = MiSnapTestPixel(sequence, x, y);
+            }
+        }
+        slot->sequence = sequence;
+        slot->timestamp = sequence * 1000;
+        MiSnapFrameRingPublish(&test->ring);
+        if (sequence % 64 == 0) {
+            sched_yield();
+        }
+    }
+    atomic_store(&test->done, true);
+    return NULL;
+}
+
+static bool MiSnapTestFrameIntact(const MiSnapRingFrame *frame)
+{
+    if (frame->width != kMiSnapTestMaxWidth - frame->sequence % 17 || frame->height != kMiSnapTestMaxHeight - frame->sequence % 11 || frame->timestamp != frame->sequence * 1000) {
+        return false;
+    }
+    for (size_t y = 0; y < frame->height; y++) {
+        for (size_t x = 0; x < frame->width; x++) {
+            if (frame->luma[y * frame->rowBytes + x] != MiSnapTestPixel(frame->sequence, x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//Takes frames until the producer is done and nothing is left; sequences must only grow, and the
+//gaps between them are the frames the ring dropped
+static void *MiSnapTestConsume(void *argument)
+{
+    MiSnapTestRing *test = argument;
+    uint64_t last = 0;
+    for (;;) {
+        bool done = atomic_load(&test->done);
+        MiSnapRingFrame *frame = MiSnapFrameRingAcquire(&test->ring);
+        if (frame == NULL) {
+            if (done) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        test->seen++;
+        test->torn += !MiSnapTestFrameIntact(frame);
+        if (frame->sequence <= last) {
+            test->reordered++;
+        } else {
+            test->skipped += frame->sequence - last - 1;
+        }
+        last = frame->sequence;
+    }
+    test->skipped += kMiSnapTestFrames - last;
+    return NULL;
+}
+
+static void MiSnapTestStress(void)
+{
+    static MiSnapTestRing tests[kMiSnapTestRings];
+    pthread_t producers[kMiSnapTestRings], consumers[kMiSnapTestRings];
+    for (int i = 0; i < kMiSnapTestRings; i++) {
+        MiSnapCheck(MiSnapFrameRingInit(&tests[i].ring, kMiSnapTestMaxWidth, kMiSnapTestMaxHeight));
+        atomic_init(&tests[i].done, false);
+    }
+    for (int i = 0; i < kMiSnapTestRings; i++) {
+        pthread_create(&consumers[i], NULL, MiSnapTestConsume, &tests[i]);
+        pthread_create(&producers[i], NULL, MiSnapTestProduce, &tests[i]);
+    }
+    for (int i = 0; i < kMiSnapTestRings; i++) {
+        pthread_join(producers[i], NULL);
+        pthread_join(consumers[i], NULL);
+    }
+    for (int i = 0; i < kMiSnapTestRings; i++) {
+        MiSnapFrameRing *ring = &tests[i].ring;
+        uint64_t published = atomic_load(&ring->published), consumed = atomic_load(&ring->consumed), dropped = atomic_load(&ring->dropped);
+        printf("ring %d: %llu published, %llu consumed, %llu dropped\n", i, (unsigned long long)published, (unsigned long long)consumed, (unsigned long long)dropped);
+        MiSnapCheck(published == kMiSnapTestFrames);
+        MiSnapCheck(consumed == tests[i].seen);
+        MiSnapCheck(published == consumed + dropped);
+        MiSnapCheck(dropped == tests[i].skipped);
+        MiSnapCheck(tests[i].torn == 0);
+        MiSnapCheck(tests[i].reordered == 0);
+        MiSnapCheck(!MiSnapFrameRingHasFrame(ring));
+        MiSnapFrameRingDestroy(ring);
+    }
+}
+
+//On one thread: the consumer gets the newest frame only, the frames it replaced are counted as
+//dropped, and a frame taken stays valid while the producer keeps publishing
+static void MiSnapTestNewestWins(void)
+{
+    MiSnapFrameRing ring;
+    MiSnapCheck(MiSnapFrameRingInit(&ring, 8, 8));
+    MiSnapCheck(!MiSnapFrameRingHasFrame(&ring) && MiSnapFrameRingAcquire(&ring) == NULL);
+    for (uint64_t sequence = 1; sequence <= 3; sequence++) {
+        MiSnapRingFrame *slot = MiSnapFrameRingWriteSlot(&ring);
+        slot->sequence = sequence;
+        slot->luma[0] = (uint8_t)sequence;
+        MiSnapFrameRingPublish(&ring);
+    }
+    MiSnapCheck(MiSnapFrameRingHasFrame(&ring));
+    MiSnapRingFrame *frame = MiSnapFrameRingAcquire(&ring);
+    MiSnapCheck(frame != NULL && frame->sequence == 3 && frame->luma[0] == 3);
+    MiSnapCheck(atomic_load(&ring.dropped) == 2 && atomic_load(&ring.consumed) == 1);
+    MiSnapCheck(MiSnapFrameRingAcquire(&ring) == NULL);
+
+    for (uint64_t sequence = 4; sequence <= 9; sequence++) {
+        MiSnapRingFrame *slot = MiSnapFrameRingWriteSlot(&ring);
+        MiSnapCheck(slot != frame);
+        slot->sequence = sequence;
+        MiSnapFrameRingPublish(&ring);
+    }
+    MiSnapCheck(frame->sequence == 3 && frame->luma[0] == 3);
+    frame = MiSnapFrameRingAcquire(&ring);
+    MiSnapCheck(frame != NULL && frame->sequence == 9);
+    MiSnapCheck(atomic_load(&ring.published) == atomic_load(&ring.consumed) + atomic_load(&ring.dropped));
+    MiSnapFrameRingDestroy(&ring);
+}
+
+int main(void)
+{
+    MiSnapTestNewestWins();
+    MiSnapTestStress();
+    return MiSnapTestResult();
+}
@@ -0,0 +1,197 @@
+
+#include "MiSnapFrameScoreCore.h"
+#include "MiSnapProfileCore.h"
+#include "MiSnapTests.h"
+
+//Brightness is the mean luma on the 0-1000 scale: exact for flat frames, and for a noisy frame
+//whose mean is known, at widths that leave a tail after the vector body of each row
+static void MiSnapTestBrightness(void)
+{
+    const size_t width = 333, height = 101, rowBytes = width + 19;
+    uint8_t *luma = malloc(rowBytes * height);
+    const int levels[] = { 0, 51, 128, 200, 255 };
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        memset(luma, levels[i], rowBytes * height);
+        MiSnapFrameScore score;
+        MiSnapScoreLumaFrame(luma, width, height, rowBytes, &score);
+        MiSnapCheck(score.brightness == levels[i] * 1000 / 255);
+        MiSnapCheck(score.sharpness == 0);
+    }
+
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 5);
+    uint64_t sum = 0;
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < rowBytes; x++) {
+            luma[y * rowBytes + x] = (uint8_t)MiSnapTestNext(&random);
+            sum += x < width ? luma[y * rowBytes + x] : 0;
+        }
+    }
+    MiSnapFrameScore score;
+    MiSnapScoreLumaFrame(luma, width, height, rowBytes, &score);
+    MiSnapCheck(score.brightness == (int)(sum * 1000 / (255 * width * height)));
+    free(luma);
+
+    uint8_t tiny[4] = { 255, 255, 255, 255 };
+    MiSnapScoreLumaFrame(tiny, 1, 4, 1, &score);
+    MiSnapCheck(score.brightness == 0 && score.sharpness == 0 && score.angle == 0);
+}
+
+//Fine vertical bars with hard edges, then the same bars box-blurred over a growing radius.
+//Sharpness is the mean gradient, which a blur keeps across an isolated edge, so the bars are
+//narrower than the blur and lose contrast to it: sharpness falls with every blur while brightness
+//stays put, until the bars no longer clear the sharpness of a check front.
+static void MiSnapTestSharpness(void)
+{
+    const size_t width = 640, height = 360;
+    uint8_t *sharp = malloc(width * height), *blurred = malloc(width * height);
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            sharp[y * width + x] = (x / 2) % 2 ? 210 : 50;
+        }
+    }
+    MiSnapFrameScore score;
+    MiSnapScoreLumaFrame(sharp, width, height, width, &score);
+    int previous = score.sharpness;
+    int sharpest = score.sharpness;
+    MiSnapCheck(sharpest > 900);
+    for (int radius = 1; radius <= 6; radius++) {
+        for (size_t y = 0; y < height; y++) {
+            for (size_t x = 0; x < width; x++) {
+                int sum = 0, count = 0;
+                for (int dx = -radius; dx <= radius; dx++) {
+                    long sx = (long)x + dx;
+                    if (sx >= 0 && sx < (long)width) {
+                        sum += sharp[y * width + sx];
+                        count++;
+                    }
+                }
+                blurred[y * width + x] = (uint8_t)((sum + count / 2) / count);
+            }
+        }
+        MiSnapScoreLumaFrame(blurred, width, height, width, &score);
+        MiSnapCheck(score.sharpness < previous);
+        MiSnapCheck(abs(score.brightness - 509) <= 3);
+        previous = score.sharpness;
+    }
+    printf("sharpness %d sharp, %d blurred\n", sharpest, previous);
+    MiSnapCheck(previous < MiSnapProfileThresholds(MiSnapProfileForKind(MiSnapDocumentKindCheckFront)).sharpness);
+    free(blurred);
+    free(sharp);
+}
+
+//A light document rotated on a dark background, 4x4 supersampled; its skew is reported as the
+//tangent of the angle in tenths of a percent, as kMiSnapAngle
+static void MiSnapTestRenderDocument(uint8_t *luma, int width, int height, float degrees, MiSnapTestRandom *random)
+{
+    float angle = degrees * (float)M_PI / 180, c = cosf(angle), s = sinf(angle);
+    float dw = width * 0.7f, dh = dw * 0.45f;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int inside = 0;
+            for (int sy = 0; sy < 4; sy++) {
+                for (int sx = 0; sx < 4; sx++) {
+                    float dx = x + (sx + 0.5f) / 4 - width / 2.0f, dy = y + (sy + 0.5f) / 4 - height / 2.0f;
+                    inside += fabsf(dx * c + dy * s) < dw / 2 && fabsf(-dx * s + dy * c) < dh / 2;
+                }
+            }
+            float value = 45 + 175 * inside / 16.0f + (int)(MiSnapTestNext(random) % 13) - 6;
+            luma[y * width + x] = (uint8_t)MIN(MAX(value, 0), 255);
+        }
+    }
+}
+
+static void MiSnapTestAngle(void)
+{
+    const int width = 960, height = 540;
+    uint8_t *luma = malloc((size_t)width * height);
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 7);
+    const float skews[] = { 0, 2, -4, 6.5f, -8 };
+    for (size_t i = 0; i < sizeof(skews) / sizeof(skews[0]); i++) {
+        MiSnapTestRenderDocument(luma, width, height, skews[i], &random);
+        MiSnapFrameScore score;
+        MiSnapScoreLumaFrame(luma, width, height, width, &score);
+        int expected = (int)lroundf(fabsf(tanf(skews[i] * (float)M_PI / 180)) * 1000);
+        MiSnapCheck(score.quad.found);
+        MiSnapCheck(score.angle == score.quad.angle);
+        MiSnapCheck(abs(score.angle - expected) <= 4);
+    }
+    free(luma);
+}
+
+//The documented per-document thresholds from the profiles, with a score that clears the sharpness
+//of a check back and a W2 but not of a check front or a remittance
+static void MiSnapTestThresholds(void)
+{
+    MiSnapFrameScore score = { 500, 500, 100, { 0 } };
+    static const struct {
+        MiSnapDocumentKind kind;
+        bool passes;
+    } documents[] = {
+        { MiSnapDocumentKindCheckFront, false },
+        { MiSnapDocumentKindCheckBack, true },
+        { MiSnapDocumentKindRemittance, false },
+        { MiSnapDocumentKindW2, true },
+        { MiSnapDocumentKindDriversLicense, true },
+    };
+    for (size_t i = 0; i < sizeof(documents) / sizeof(documents[0]); i++) {
+        MiSnapFrameThresholds thresholds = MiSnapProfileThresholds(MiSnapProfileForKind(documents[i].kind));
+        MiSnapCheck(MiSnapFrameScorePasses(&score, &thresholds) == documents[i].passes);
+    }
+
+    //Each bound on its own, at and just past it
+    MiSnapFrameThresholds thresholds = MiSnapProfileThresholds(MiSnapProfileForKind(MiSnapDocumentKindCheckBack));
+    MiSnapFrameScore edge = { thresholds.minBrightness, thresholds.sharpness, thresholds.angle, { 0 } };
+    MiSnapCheck(MiSnapFrameScorePasses(&edge, &thresholds));
+    edge.brightness = thresholds.minBrightness - 1;
+    MiSnapCheck(!MiSnapFrameScorePasses(&edge, &thresholds));
+    edge.brightness = thresholds.maxBrightness;
+    MiSnapCheck(MiSnapFrameScorePasses(&edge, &thresholds));
+    edge.brightness = thresholds.maxBrightness + 1;
+    MiSnapCheck(!MiSnapFrameScorePasses(&edge, &thresholds));
+    edge.brightness = thresholds.minBrightness;
+    edge.sharpness = thresholds.sharpness - 1;
+    MiSnapCheck(!MiSnapFrameScorePasses(&edge, &thresholds));
+    edge.sharpness = thresholds.sharpness;
+    edge.angle = thresholds.angle + 1;
+    MiSnapCheck(!MiSnapFrameScorePasses(&edge, &thresholds));
+}
+
+//A threshold of 0 ignores its check: a score failing every check passes once all are 0, and
+//fails again as soon as any one is set
+static void MiSnapTestIgnoredChecks(void)
+{
+    MiSnapFrameScore dark = { 10, 5, 900, { 0 } }, glare = { 990, 5, 900, { 0 } };
+    MiSnapFrameThresholds none = { 0, 0, 0, 0 };
+    MiSnapCheck(MiSnapFrameScorePasses(&dark, &none));
+    MiSnapCheck(MiSnapFrameScorePasses(&glare, &none));
+
+    MiSnapFrameThresholds minBrightness = { 400, 0, 0, 0 }, maxBrightness = { 0, 700, 0, 0 };
+    MiSnapFrameThresholds sharpness = { 0, 0, 400, 0 }, angle = { 0, 0, 0, 150 };
+    MiSnapCheck(!MiSnapFrameScorePasses(&dark, &minBrightness));
+    MiSnapCheck(MiSnapFrameScorePasses(&glare, &minBrightness));
+    MiSnapCheck(MiSnapFrameScorePasses(&dark, &maxBrightness));
+    MiSnapCheck(!MiSnapFrameScorePasses(&glare, &maxBrightness));
+    MiSnapCheck(!MiSnapFrameScorePasses(&dark, &sharpness));
+    MiSnapCheck(!MiSnapFrameScorePasses(&dark, &angle));
+
+    //maxBrightness 0 as a profile override turns off the glare check only
+    MiSnapProfile profile = *MiSnapProfileForKind(MiSnapDocumentKindCheckBack);
+    MiSnapCheck(MiSnapProfileSetValue(&profile, MiSnapProfileFieldMaxBrightness, 0));
+    MiSnapFrameThresholds thresholds = MiSnapProfileThresholds(&profile);
+    MiSnapFrameScore bright = { 990, 500, 100, { 0 } };
+    MiSnapCheck(MiSnapFrameScorePasses(&bright, &thresholds));
+    bright.brightness = 300;
+    MiSnapCheck(!MiSnapFrameScorePasses(&bright, &thresholds));
+}
+
+int main(void)
+{
+    MiSnapTestBrightness();
+    MiSnapTestSharpness();
+    MiSnapTestAngle();
+    MiSnapTestThresholds();
+    MiSnapTestIgnoredChecks();
+    return MiSnapTestResult();
+}
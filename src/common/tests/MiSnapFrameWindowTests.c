@@ -0,0 +1,180 @@
+
+#include "MiSnapFrameWindowCore.h"
+#include "MiSnapTests.h"
+
+#define kMiSnapTestMaxWidth 48
+#define kMiSnapTestMaxHeight 32
+#define kMiSnapTestOffers 200
+
+typedef struct {
+    MiSnapFrameScore score;
+    size_t width;
+    size_t height;
+    double timeMs;
+} MiSnapTestOffer;
+
+static uint8_t MiSnapTestPixel(uint64_t sequence, size_t x, size_t y)
+{
+    return (uint8_t)(sequence * 37 + x * 3 + y * 11);
+}
+
+static bool MiSnapTestOfferFrame(MiSnapFrameWindow *window, const MiSnapTestOffer *offer, uint64_t sequence)
+{
+    static uint8_t luma[(kMiSnapTestMaxWidth + 8) * (kMiSnapTestMaxHeight + 8)];
+    const size_t rowBytes = kMiSnapTestMaxWidth + 8;
+    for (size_t y = 0; y < offer->height; y++) {
+        for (size_t x = 0; x < offer->width; x++) {
+            luma[y * rowBytes + x] = MiSnapTestPixel(sequence, x, y);
+        }
+    }
+    return MiSnapFrameWindowOffer(window, &offer->score, luma, offer->width, offer->height, rowBytes, sequence, offer->timeMs);
+}
+
+static bool MiSnapTestCandidateIntact(const MiSnapWindowCandidate *candidate, const MiSnapTestOffer *offer)
+{
+    if (candidate->frame.width != offer->width || candidate->frame.height != offer->height || candidate->timeMs != offer->timeMs) {
+        return false;
+    }
+    for (size_t y = 0; y < offer->height; y++) {
+        for (size_t x = 0; x < offer->width; x++) {
+            if (candidate->frame.luma[y * candidate->frame.rowBytes + x] != MiSnapTestPixel(candidate->frame.sequence, x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//Random sessions of passing frames against a brute-force best-of-N: of the frames that fit the
+//slots and came no later than the window's length after the first of them, the top candidates by
+//sharpness then angle, earlier frames winning ties. Scores are drawn from a narrow range so ties
+//are common, and frames arrive with jitter so none lands exactly on the deadline.
+static void MiSnapTestBruteForce(void)
+{
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 18);
+    static MiSnapTestOffer offers[kMiSnapTestOffers];
+    for (int session = 0; session < 300; session++) {
+        size_t capacity = 1 + MiSnapTestNext(&random) % kMiSnapFrameWindowMaxCandidates;
+        double windowMs = session % 10 == 0 ? 0 : 50 + MiSnapTestNext(&random) % 400;
+        MiSnapFrameWindow window;
+        MiSnapCheck(MiSnapFrameWindowInit(&window, capacity, kMiSnapTestMaxWidth, kMiSnapTestMaxHeight, windowMs));
+
+        double timeMs = MiSnapTestNext(&random) % 1000;
+        size_t count = 1 + MiSnapTestNext(&random) % kMiSnapTestOffers;
+        for (size_t i = 0; i < count; i++) {
+            timeMs += 33.3 + MiSnapTestUniform(&random) * 0.5 - 0.25;
+            offers[i].score = (MiSnapFrameScore){ 500, 600 + (int)(MiSnapTestNext(&random) % 8), (int)(MiSnapTestNext(&random) % 4), { 0 } };
+            offers[i].width = kMiSnapTestMaxWidth - MiSnapTestNext(&random) % 8 + (MiSnapTestNext(&random) % 10 == 0 ? 4 : 0);
+            offers[i].height = kMiSnapTestMaxHeight - MiSnapTestNext(&random) % 8;
+            offers[i].timeMs = timeMs;
+        }
+
+        //Brute force: every eligible frame, then sorted on its own terms rather than the window's
+        size_t ranked[kMiSnapTestOffers];
+        size_t eligible = 0;
+        double openedMs = -1;
+        for (size_t i = 0; i < count; i++) {
+            if (offers[i].width > kMiSnapTestMaxWidth) {
+                continue;
+            }
+            if (openedMs < 0) {
+                openedMs = offers[i].timeMs;
+            }
+            if (offers[i].timeMs - openedMs > windowMs) {
+                break;
+            }
+            ranked[eligible++] = i;
+        }
+        for (size_t a = 0; a < eligible; a++) {
+            for (size_t b = a + 1; b < eligible; b++) {
+                const MiSnapFrameScore *x = &offers[ranked[a]].score, *y = &offers[ranked[b]].score;
+                bool before = y->sharpness > x->sharpness || (y->sharpness == x->sharpness && (y->angle < x->angle || (y->angle == x->angle && ranked[b] < ranked[a])));
+                if (before) {
+                    size_t swap = ranked[a];
+                    ranked[a] = ranked[b];
+                    ranked[b] = swap;
+                }
+            }
+        }
+
+        bool closed = false;
+        for (size_t i = 0; i < count; i++) {
+            closed = MiSnapTestOfferFrame(&window, &offers[i], i);
+        }
+        const MiSnapWindowCandidate *best = MiSnapFrameWindowFinish(&window);
+        MiSnapCheck(closed == (openedMs >= 0 && offers[count - 1].timeMs - openedMs >= windowMs));
+        MiSnapCheck(window.count == MIN(eligible, capacity));
+        MiSnapCheck((best == NULL) == (eligible == 0));
+        for (size_t c = 0; c < window.count; c++) {
+            const MiSnapWindowCandidate *candidate = &window.candidates[c];
+            MiSnapCheck(candidate->frame.sequence == ranked[c]);
+            MiSnapCheck(MiSnapTestCandidateIntact(candidate, &offers[ranked[c]]));
+        }
+        MiSnapFrameWindowDestroy(&window);
+    }
+}
+
+//The window closes on its deadline when it is polled, without another passing frame: not before
+//it opens, not before the deadline and at it. A closed window ignores later frames.
+static void MiSnapTestDeadline(void)
+{
+    MiSnapFrameWindow window;
+    MiSnapCheck(MiSnapFrameWindowInit(&window, 3, kMiSnapTestMaxWidth, kMiSnapTestMaxHeight, 300));
+    MiSnapCheck(!MiSnapFrameWindowPoll(&window, 5000));
+    MiSnapCheck(MiSnapFrameWindowBest(&window) == NULL);
+
+    MiSnapTestOffer offer = { { 500, 700, 10, { 0 } }, kMiSnapTestMaxWidth, kMiSnapTestMaxHeight, 1000 };
+    MiSnapCheck(!MiSnapTestOfferFrame(&window, &offer, 1));
+    MiSnapCheck(window.open && window.openedMs == 1000);
+    MiSnapCheck(!MiSnapFrameWindowPoll(&window, 1299.9));
+    MiSnapCheck(!window.closed);
+    MiSnapCheck(MiSnapFrameWindowPoll(&window, 1300));
+    MiSnapCheck(window.closed && MiSnapFrameWindowPoll(&window, 1300));
+
+    offer.score.sharpness = 900;
+    offer.timeMs = 1301;
+    MiSnapCheck(MiSnapTestOfferFrame(&window, &offer, 2));
+    MiSnapCheck(window.count == 1 && window.offered == 1 && MiSnapFrameWindowBest(&window)->frame.sequence == 1);
+
+    //Reset reopens it for a new session; a frame past the deadline closes it and is left out
+    MiSnapFrameWindowReset(&window);
+    MiSnapCheck(!window.open && !window.closed && MiSnapFrameWindowBest(&window) == NULL);
+    offer.timeMs = 2000;
+    MiSnapCheck(!MiSnapTestOfferFrame(&window, &offer, 3));
+    MiSnapCheck(!MiSnapFrameWindowPoll(&window, 2150));
+    offer.timeMs = 2300.5;
+    MiSnapCheck(MiSnapTestOfferFrame(&window, &offer, 4));
+    MiSnapCheck(window.count == 1 && MiSnapFrameWindowBest(&window)->frame.sequence == 3);
+
+    //Finishing closes an open window early, and one that never opened
+    MiSnapFrameWindowReset(&window);
+    offer.timeMs = 3000;
+    MiSnapTestOfferFrame(&window, &offer, 5);
+    const MiSnapWindowCandidate *best = MiSnapFrameWindowFinish(&window);
+    MiSnapCheck(window.closed && best != NULL && best->frame.sequence == 5);
+    MiSnapFrameWindowReset(&window);
+    MiSnapCheck(MiSnapFrameWindowFinish(&window) == NULL && window.closed);
+    MiSnapCheck(MiSnapTestOfferFrame(&window, &offer, 6) && window.count == 0);
+
+    //Frames larger than the slots neither open the window nor count
+    MiSnapFrameWindowReset(&window);
+    MiSnapTestOffer large = { { 500, 990, 0, { 0 } }, kMiSnapTestMaxWidth + 1, kMiSnapTestMaxHeight, 4000 };
+    MiSnapCheck(!MiSnapTestOfferFrame(&window, &large, 7));
+    MiSnapCheck(!window.open && window.offered == 0 && !MiSnapFrameWindowPoll(&window, 9000));
+    MiSnapFrameWindowDestroy(&window);
+
+    //A window of 0 ms takes the first frame
+    MiSnapCheck(MiSnapFrameWindowInit(&window, 3, kMiSnapTestMaxWidth, kMiSnapTestMaxHeight, 0));
+    offer.timeMs = 10;
+    MiSnapCheck(MiSnapTestOfferFrame(&window, &offer, 8));
+    MiSnapCheck(window.count == 1 && MiSnapFrameWindowBest(&window)->frame.sequence == 8);
+    MiSnapFrameWindowDestroy(&window);
+}
+
+int main(void)
+{
+    MiSnapTestBruteForce();
+    MiSnapTestDeadline();
+    return MiSnapTestResult();
+}
@@ -0,0 +1,190 @@
+
+#include "MiSnapImageHash.h"
+#include "MiSnapTests.h"
+#include <unistd.h>
+
+#define kMiSnapTestWidth 1600
+#define kMiSnapTestHeight 700
+#define kMiSnapTestChecks 36
+#define kMiSnapTestStocks 6
+#define kMiSnapTestRecaptures 5
+#define kMiSnapTestIndexPath "MiSnapImageHashTests.index"
+
+static void MiSnapTestRect(uint8_t *luma, int x0, int y0, int x1, int y1, int value)
+{
+    for (int y = MAX(y0, 0); y < MIN(y1, kMiSnapTestHeight); y++) {
+        for (int x = MAX(x0, 0); x < MIN(x1, kMiSnapTestWidth); x++) {
+            luma[y * kMiSnapTestWidth + x] = (uint8_t)value;
+        }
+    }
+}
+
+//A check front: the stock (background pattern, border, logo, printed lines and the MICR band)
+//comes from one seed and the handwritten content (payee, amount, signature) from another, so
+//checks on the same stock share everything but what was written on them.
+static void MiSnapTestDrawCheck(uint8_t *luma, uint64_t stock, uint64_t content)
+{
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, stock);
+    int base = 200 + (int)(MiSnapTestNext(&random) % 40);
+    double fx = 0.01 + MiSnapTestUniform(&random) * 0.03, fy = 0.01 + MiSnapTestUniform(&random) * 0.03;
+    int amplitude = 5 + (int)(MiSnapTestNext(&random) % 12);
+    for (int y = 0; y < kMiSnapTestHeight; y++) {
+        for (int x = 0; x < kMiSnapTestWidth; x++) {
+            luma[y * kMiSnapTestWidth + x] = (uint8_t)(base + amplitude * sin(x * fx + y * fy) * sin(y * fx * 0.7));
+        }
+    }
+    int w = kMiSnapTestWidth, h = kMiSnapTestHeight;
+    MiSnapTestRect(luma, 10, 10, w - 10, 14, 60);
+    MiSnapTestRect(luma, 10, h - 14, w - 10, h - 10, 60);
+    MiSnapTestRect(luma, 10, 10, 14, h - 10, 60);
+    MiSnapTestRect(luma, w - 14, 10, w - 10, h - 10, 60);
+    int logoX = 40 + (int)(MiSnapTestNext(&random) % 100), logoY = 40 + (int)(MiSnapTestNext(&random) % 40);
+    MiSnapTestRect(luma, logoX, logoY, logoX + 150 + (int)(MiSnapTestNext(&random) % 100), logoY + 60 + (int)(MiSnapTestNext(&random) % 40), 90);
+    MiSnapTestRect(luma, w - 400, 60, w - 60, 64, 80);
+    MiSnapTestRect(luma, 100, 330, w - 500, 334, 80);
+    MiSnapTestRect(luma, w - 420, 300, w - 80, 380, 170);
+    MiSnapTestRect(luma, 100, 470, w - 200, 474, 80);
+    for (int i = 0; i < 40; i++) {
+        MiSnapTestRect(luma, 200 + i * 28, h - 100, 214 + i * 28, h - 70, 40);
+    }
+
+    MiSnapTestRandomInit(&random, content ^ 0x9E3779B9u);
+    for (int block = 0; block < 6; block++) {
+        int x = 120 + (int)(MiSnapTestNext(&random) % 800), y = 200 + (int)(MiSnapTestNext(&random) % 320);
+        int length = 100 + (int)(MiSnapTestNext(&random) % 500);
+        for (int i = 0; i < length; i += 12 + (int)(MiSnapTestNext(&random) % 8)) {
+            int stroke = 18 + (int)(MiSnapTestNext(&random) % 20);
+            MiSnapTestRect(luma, x + i, y - stroke, x + i + 5 + (int)(MiSnapTestNext(&random) % 5), y, 30 + (int)(MiSnapTestNext(&random) % 40));
+        }
+    }
+    int amountX = w - 400 + (int)(MiSnapTestNext(&random) % 60);
+    for (int i = 0; i < 6; i++) {
+        MiSnapTestRect(luma, amountX + i * 40, 320, amountX + i * 40 + 22, 360, 30);
+    }
+    for (int stroke = 0; stroke < 3; stroke++) {
+        double x = w - 700 + MiSnapTestNext(&random) % 300, y = 540 + MiSnapTestNext(&random) % 60;
+        for (int i = 0; i < 300; i++) {
+            x += MiSnapTestUniform(&random) * 3;
+            y += (MiSnapTestUniform(&random) - 0.5) * 6;
+            MiSnapTestRect(luma, (int)x, (int)y, (int)x + 3, (int)y + 3, 20);
+        }
+    }
+}
+
+//Another capture of the same check: cropped at a different size, slightly rotated, scaled and
+//shifted, with a different exposure, a lighting gradient and sensor noise
+static void MiSnapTestRecapture(const uint8_t *check, uint8_t *luma, int width, int height, uint64_t seed, double strength)
+{
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, seed);
+    double angle = (MiSnapTestUniform(&random) - 0.5) * 0.02 * strength;
+    double scale = 1 + (MiSnapTestUniform(&random) - 0.5) * 0.02 * strength;
+    double tx = (MiSnapTestUniform(&random) - 0.5) * 0.01 * kMiSnapTestWidth * strength;
+    double ty = (MiSnapTestUniform(&random) - 0.5) * 0.01 * kMiSnapTestHeight * strength;
+    double gain = 1 + (MiSnapTestUniform(&random) - 0.5) * 0.3 * strength;
+    double offset = (MiSnapTestUniform(&random) - 0.5) * 40 * strength;
+    double gradient = (MiSnapTestUniform(&random) - 0.5) * 40 * strength;
+    double c = cos(angle) / scale * kMiSnapTestWidth / width, s = sin(angle) / scale * kMiSnapTestWidth / width;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            double cx = x - width / 2.0, cy = y - height / 2.0;
+            double u = c * cx - s * cy + kMiSnapTestWidth / 2.0 + tx, v = s * cx + c * cy + kMiSnapTestHeight / 2.0 + ty;
+            int iu = (int)floor(u), iv = (int)floor(v);
+            double fu = u - iu, fv = v - iv, value = 50;
+            if (iu >= 0 && iv >= 0 && iu < kMiSnapTestWidth - 1 && iv < kMiSnapTestHeight - 1) {
+                const uint8_t *p = check + iv * kMiSnapTestWidth + iu;
+                value = p[0] * (1 - fu) * (1 - fv) + p[1] * fu * (1 - fv) + p[kMiSnapTestWidth] * (1 - fu) * fv + p[kMiSnapTestWidth + 1] * fu * fv;
+            }
+            value = value * gain + offset + gradient * x / width + ((int)(MiSnapTestNext(&random) % 21) - 10) * strength;
+            luma[y * width + x] = (uint8_t)MIN(MAX(value, 0), 255);
+        }
+    }
+}
+
+//Recaptures of a check must land within the duplicate distance of its first capture; different
+//checks, even on the same stock, must not
+static void MiSnapTestCorpus(MiSnapImageHash *hashes)
+{
+    uint8_t *check = malloc(kMiSnapTestWidth * kMiSnapTestHeight);
+    uint8_t *luma = malloc(1700 * 1700 * 7 / 16);
+    int missed = 0, worstDuplicate = 0;
+    for (int i = 0; i < kMiSnapTestChecks; i++) {
+        MiSnapTestDrawCheck(check, i % kMiSnapTestStocks + 1, 1000 + i);
+        MiSnapTestRecapture(check, luma, 1400, 612, i * 7 + 1, 1);
+        MiSnapCheck(MiSnapImageHashLuma(luma, 1400, 612, 1400, &hashes[i]));
+        for (int k = 0; k < kMiSnapTestRecaptures; k++) {
+            int width = 1100 + k * 150, height = width * 7 / 16;
+            MiSnapImageHash hash;
+            MiSnapTestRecapture(check, luma, width, height, i * 131 + k * 17 + 5, k == kMiSnapTestRecaptures - 1 ? 2 : 1);
+            MiSnapImageHashLuma(luma, width, height, width, &hash);
+            int distance = MiSnapImageHashDistance(&hashes[i], &hash);
+            worstDuplicate = MAX(worstDuplicate, distance);
+            missed += distance > kMiSnapImageHashDuplicateDistance;
+        }
+    }
+
+    int closestSameStock = kMiSnapImageHashBits, closestOtherStock = kMiSnapImageHashBits;
+    for (int i = 0; i < kMiSnapTestChecks; i++) {
+        for (int j = i + 1; j < kMiSnapTestChecks; j++) {
+            int distance = MiSnapImageHashDistance(&hashes[i], &hashes[j]);
+            if (i % kMiSnapTestStocks == j % kMiSnapTestStocks) {
+                closestSameStock = MIN(closestSameStock, distance);
+            } else {
+                closestOtherStock = MIN(closestOtherStock, distance);
+            }
+        }
+    }
+    printf("recaptures: %d of %d missed, worst %d; different checks: closest %d on the same stock, %d on another\n", missed, kMiSnapTestChecks * kMiSnapTestRecaptures, worstDuplicate, closestSameStock, closestOtherStock);
+    MiSnapCheck(missed * 10 <= kMiSnapTestChecks * kMiSnapTestRecaptures);
+    MiSnapCheck(closestSameStock > kMiSnapImageHashDuplicateDistance);
+    MiSnapCheck(closestOtherStock > kMiSnapImageHashDuplicateDistance);
+
+    uint8_t tiny[31 * 31] = { 0 };
+    MiSnapImageHash hash;
+    MiSnapCheck(!MiSnapImageHashLuma(tiny, 31, 31, 31, &hash));
+    free(luma);
+    free(check);
+}
+
+static void MiSnapTestIndex(const MiSnapImageHash *hashes)
+{
+    MiSnapHashIndex index;
+    MiSnapHashIndexInit(&index);
+    for (int i = 0; i < 100; i++) {
+        MiSnapHashEntry entry = { .hash = hashes[i % kMiSnapTestChecks], .timeMs = i, .tag = i < 90 ? 1 : 2 };
+        MiSnapHashIndexAdd(&index, &entry);
+    }
+    MiSnapCheck(index.count == kMiSnapHashIndexCapacity);
+
+    //The most recent exact copy wins; the tag and the time window are honoured
+    MiSnapHashEntry match;
+    int distance;
+    MiSnapCheck(MiSnapHashIndexNearest(&index, &hashes[5], 1, kMiSnapImageHashDuplicateDistance, 0, &match, &distance));
+    MiSnapCheck(distance == 0 && match.timeMs == 5 + 2 * kMiSnapTestChecks);
+    MiSnapCheck(!MiSnapHashIndexNearest(&index, &hashes[5], 2, kMiSnapImageHashDuplicateDistance, 0, &match, &distance));
+    MiSnapCheck(MiSnapHashIndexNearest(&index, &hashes[92 % kMiSnapTestChecks], 2, 0, 0, &match, &distance) && match.timeMs == 92);
+    MiSnapCheck(!MiSnapHashIndexNearest(&index, &hashes[5], 1, kMiSnapImageHashDuplicateDistance, 78, &match, &distance));
+
+    //Saved and loaded intact; a file that is not an index, or is cut short, loads as an empty one
+    MiSnapHashIndex loaded;
+    MiSnapCheck(MiSnapHashIndexSave(&index, kMiSnapTestIndexPath));
+    MiSnapCheck(MiSnapHashIndexLoad(&loaded, kMiSnapTestIndexPath) && memcmp(&loaded, &index, sizeof(index)) == 0);
+    FILE *file = fopen(kMiSnapTestIndexPath, "r+b");
+    fputc('X', file);
+    fclose(file);
+    MiSnapCheck(!MiSnapHashIndexLoad(&loaded, kMiSnapTestIndexPath) && loaded.count == 0);
+    MiSnapCheck(MiSnapHashIndexSave(&index, kMiSnapTestIndexPath));
+    MiSnapCheck(truncate(kMiSnapTestIndexPath, 1000) == 0);
+    MiSnapCheck(!MiSnapHashIndexLoad(&loaded, kMiSnapTestIndexPath) && loaded.count == 0);
+    unlink(kMiSnapTestIndexPath);
+    MiSnapCheck(!MiSnapHashIndexLoad(&loaded, kMiSnapTestIndexPath) && loaded.count == 0);
+}
+
+int main(void)
+{
+    MiSnapImageHash hashes[kMiSnapTestChecks];
+    MiSnapTestCorpus(hashes);
+    MiSnapTestIndex(hashes);
+    return MiSnapTestResult();
+}
@@ -0,0 +1,184 @@
+
+#include "MiSnapImageScalerCore.h"
+#include "MiSnapTests.h"
+
+#define kMiSnapTestCanary 0x5A
+//Bytes past the end of every destination row, which the scaler must not touch
+#define kMiSnapTestRowPadding 7
+
+//A document-like test image: a smooth gradient, noise, and sharp-edged bars and text-sized
+//strokes, which are where a resize that does not average the whole area shows
+static void MiSnapTestDrawImage(uint8_t *pixels, size_t width, size_t height, size_t rowBytes, size_t channels, uint64_t seed)
+{
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, seed);
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            for (size_t c = 0; c < channels; c++) {
+                int value = (int)((x * 160) / width + (y * 60) / height) + (int)(c * 13);
+                if ((x / 3 + y / 11) % 7 == 0) {
+                    value = (x + y) % 2 == 0 ? 5 : 250;
+                }
+                value += (int)(MiSnapTestNext(&random) % 31) - 15;
+                pixels[y * rowBytes + x * channels + c] = (uint8_t)MAX(0, MIN(255, value));
+            }
+        }
+    }
+}
+
+//The reference: every output pixel is the average of the source over its rectangle, each source
+//pixel weighted by the area of it the rectangle covers, in doubles and rounded once
+static void MiSnapTestReferenceScale(const uint8_t *src, size_t srcWidth, size_t srcHeight, size_t srcRowBytes,
+                                     uint8_t *dst, size_t dstWidth, size_t dstHeight, size_t dstRowBytes, size_t channels)
+{
+    double sx = (double)srcWidth / dstWidth, sy = (double)srcHeight / dstHeight;
+    for (size_t y = 0; y < dstHeight; y++) {
+        double top = y * sy, bottom = (y + 1) * sy;
+        for (size_t x = 0; x < dstWidth; x++) {
+            double left = x * sx, right = (x + 1) * sx;
+            for (size_t c = 0; c < channels; c++) {
+                double sum = 0, area = 0;
+                for (size_t j = (size_t)floor(top); j < srcHeight && j < bottom; j++) {
+                    double h = fmin(bottom, j + 1.0) - fmax(top, (double)j);
+                    for (size_t i = (size_t)floor(left); i < srcWidth && i < right; i++) {
+                        double w = fmin(right, i + 1.0) - fmax(left, (double)i);
+                        sum += w * h * src[j * srcRowBytes + i * channels + c];
+                        area += w * h;
+                    }
+                }
+                dst[y * dstRowBytes + x * channels + c] = (uint8_t)lround(sum / area);
+            }
+        }
+    }
+}
+
+typedef struct {
+    size_t srcWidth, srcHeight, dstWidth, dstHeight, channels;
+} MiSnapTestScaleCase;
+
+//Scales the test image and diffs it against the reference: no pixel off by more than one level,
+//few off at all, and the padding after every row untouched. Returns the share of pixels off.
+static double MiSnapTestDiff(const MiSnapTestScaleCase *test, uint64_t seed)
+{
+    size_t srcRowBytes = test->srcWidth * test->channels + 5;
+    size_t dstRowBytes = test->dstWidth * test->channels + kMiSnapTestRowPadding;
+    uint8_t *src = malloc(srcRowBytes * test->srcHeight);
+    uint8_t *scaled = malloc(dstRowBytes * test->dstHeight);
+    uint8_t *reference = malloc(dstRowBytes * test->dstHeight);
+    MiSnapTestDrawImage(src, test->srcWidth, test->srcHeight, srcRowBytes, test->channels, seed);
+    memset(scaled, kMiSnapTestCanary, dstRowBytes * test->dstHeight);
+    MiSnapCheck(MiSnapScaleImage(src, test->srcWidth, test->srcHeight, srcRowBytes,
+                                 scaled, test->dstWidth, test->dstHeight, dstRowBytes, test->channels));
+    MiSnapTestReferenceScale(src, test->srcWidth, test->srcHeight, srcRowBytes,
+                             reference, test->dstWidth, test->dstHeight, dstRowBytes, test->channels);
+
+    size_t off = 0, far = 0, overwritten = 0, rowLength = test->dstWidth * test->channels;
+    for (size_t y = 0; y < test->dstHeight; y++) {
+        for (size_t i = 0; i < rowLength; i++) {
+            int difference = abs(scaled[y * dstRowBytes + i] - reference[y * dstRowBytes + i]);
+            off += difference > 0;
+            far += difference > 1;
+        }
+        for (size_t i = rowLength; i < dstRowBytes; i++) {
+            overwritten += scaled[y * dstRowBytes + i] != kMiSnapTestCanary;
+        }
+    }
+    double share = (double)off / (rowLength * test->dstHeight);
+    printf("%zux%zu to %zux%zu, %zu channels: %.2f%% of values off by one, %zu further\n",
+           test->srcWidth, test->srcHeight, test->dstWidth, test->dstHeight, test->channels, share * 100, far);
+    MiSnapCheck(far == 0);
+    MiSnapCheck(overwritten == 0);
+    free(src);
+    free(scaled);
+    free(reference);
+    return share;
+}
+
+//Downscales by whole and fractional factors, to a single pixel, in one dimension only and
+//upscales, for grayscale and BGRA, against the reference. A single pixel may well be off.
+static void MiSnapTestAgainstReference(void)
+{
+    static const MiSnapTestScaleCase cases[] = {
+        { 640, 480, 320, 240, 4 },
+        { 640, 480, 320, 240, 1 },
+        { 1000, 700, 333, 251, 4 },
+        { 1000, 700, 333, 251, 1 },
+        { 1280, 720, 427, 240, 1 },
+        { 37, 29, 5, 4, 4 },
+        { 97, 61, 1, 1, 1 },
+        { 400, 50, 400, 17, 1 },
+        { 50, 400, 17, 400, 4 },
+        { 64, 48, 100, 75, 4 },
+        { 300, 200, 300, 200, 1 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        double share = MiSnapTestDiff(&cases[i], 10 + i);
+        MiSnapCheck(cases[i].dstWidth * cases[i].dstHeight < 100 || share < 0.05);
+    }
+}
+
+//Flat areas stay exactly flat at every level, since the weights of every output pixel sum to one
+//however many taps their rounding is spread over
+static void MiSnapTestFlat(size_t srcWidth, size_t srcHeight, size_t dstWidth, size_t dstHeight)
+{
+    uint8_t *src = malloc(srcWidth * 4 * srcHeight);
+    uint8_t *dst = malloc(dstWidth * 4 * dstHeight);
+    size_t wrong = 0;
+    for (int level = 0; level < 256; level += 5) {
+        memset(src, level, srcWidth * 4 * srcHeight);
+        MiSnapCheck(MiSnapScaleImage(src, srcWidth, srcHeight, srcWidth * 4, dst, dstWidth, dstHeight, dstWidth * 4, 4));
+        for (size_t i = 0; i < dstWidth * 4 * dstHeight; i++) {
+            wrong += dst[i] != level;
+        }
+    }
+    memset(src, 255, srcWidth * srcHeight);
+    MiSnapCheck(MiSnapScaleImage(src, srcWidth, srcHeight, srcWidth, dst, dstWidth, dstHeight, dstWidth, 1));
+    for (size_t i = 0; i < dstWidth * dstHeight; i++) {
+        wrong += dst[i] != 255;
+    }
+    MiSnapCheck(wrong == 0);
+    free(src);
+    free(dst);
+}
+
+//The bands run on several threads; the result must not depend on which ran which band
+static void MiSnapTestRepeatable(void)
+{
+    const size_t srcWidth = 1920, srcHeight = 1080, dstWidth = 960, dstHeight = 540;
+    uint8_t *src = malloc(srcWidth * 4 * srcHeight);
+    uint8_t *first = malloc(dstWidth * 4 * dstHeight);
+    uint8_t *again = malloc(dstWidth * 4 * dstHeight);
+    MiSnapTestDrawImage(src, srcWidth, srcHeight, srcWidth * 4, 4, 3);
+    MiSnapCheck(MiSnapScaleImage(src, srcWidth, srcHeight, srcWidth * 4, first, dstWidth, dstHeight, dstWidth * 4, 4));
+    int differing = 0;
+    for (int run = 0; run < 5; run++) {
+        MiSnapCheck(MiSnapScaleImage(src, srcWidth, srcHeight, srcWidth * 4, again, dstWidth, dstHeight, dstWidth * 4, 4));
+        differing += memcmp(first, again, dstWidth * 4 * dstHeight) != 0;
+    }
+    MiSnapCheck(differing == 0);
+    free(src);
+    free(first);
+    free(again);
+}
+
+static void MiSnapTestArguments(void)
+{
+    uint8_t src[16] = { 0 }, dst[16];
+    MiSnapCheck(!MiSnapScaleImage(src, 4, 4, 4, dst, 2, 2, 2, 3));
+    MiSnapCheck(!MiSnapScaleImage(src, 4, 4, 4, dst, 2, 2, 2, 2));
+    MiSnapCheck(!MiSnapScaleImage(src, 0, 4, 4, dst, 2, 2, 2, 1));
+    MiSnapCheck(!MiSnapScaleImage(src, 4, 0, 4, dst, 2, 2, 2, 1));
+    MiSnapCheck(!MiSnapScaleImage(src, 4, 4, 4, dst, 0, 2, 2, 1));
+    MiSnapCheck(!MiSnapScaleImage(src, 4, 4, 4, dst, 2, 0, 2, 1));
+    MiSnapCheck(MiSnapScaleImage(src, 4, 4, 4, dst, 2, 2, 2, 1));
+}
+
+int main(void)
+{
+    MiSnapTestAgainstReference();
+    MiSnapTestFlat(301, 203, 97, 71);
+    MiSnapTestFlat(2999, 31, 7, 3);
+    MiSnapTestRepeatable();
+    MiSnapTestArguments();
+    return MiSnapTestResult();
+}
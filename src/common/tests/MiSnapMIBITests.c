@@ -0,0 +1,344 @@
+
+#include "MiSnapMIBICore.h"
+#include "MiSnapTests.h"
+#include <stdarg.h>
+
+//The JSON a record is expected to decode to, built next to the encoder calls
+typedef struct {
+    char text[1 << 16];
+    size_t length;
+} MiSnapTestText;
+
+static void MiSnapTestAppend(MiSnapTestText *text, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void MiSnapTestAppend(MiSnapTestText *text, const char *format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    int written = vsnprintf(text->text + text->length, sizeof(text->text) - text->length, format, arguments);
+    va_end(arguments);
+    text->length = MIN(text->length + (size_t)MAX(written, 0), sizeof(text->text) - 1);
+}
+
+static void MiSnapTestAppendString(MiSnapTestText *text, const char *bytes, size_t length)
+{
+    MiSnapTestAppend(text, "\"");
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = (uint8_t)bytes[i];
+        if (byte == '"' || byte == '\\') {
+            MiSnapTestAppend(text, "\\%c", byte);
+        } else if (byte < 0x20) {
+            MiSnapTestAppend(text, "\\u%04x", byte);
+        } else {
+            MiSnapTestAppend(text, "%c", byte);
+        }
+    }
+    MiSnapTestAppend(text, "\"");
+}
+
+//Strings as MIBI carries them: repeated keys and values, numbers as strings (some canonical and
+//turned into varints, some not), escapes and UTF-8
+static const char *const kMiSnapTestStrings[] = {
+    "MiSnapVersion", "Device", "iPhone14,2", "Parameters", "Frames", "Brightness", "Sharpness",
+    "0", "-12", "345", "007", "+1", "-0", "123456789012345678", "1234567890123456789", "1.5",
+    "quote \" and backslash \\", "tab\tnewline\n", "caf\xc3\xa9", ""
+};
+
+#define kMiSnapTestStringCount (sizeof(kMiSnapTestStrings) / sizeof(kMiSnapTestStrings[0]))
+
+static int64_t MiSnapTestInteger(MiSnapTestRandom *random)
+{
+    switch (MiSnapTestNext(random) % 6) {
+        case 0: return INT64_MIN;
+        case 1: return INT64_MAX;
+        case 2: return -(int64_t)(MiSnapTestNext(random) % 1000);
+        case 3: return (int64_t)(((uint64_t)MiSnapTestNext(random) << 32) | MiSnapTestNext(random));
+        default: return MiSnapTestNext(random) % 100000;
+    }
+}
+
+static void MiSnapTestWriteString(MiSnapMIBIEncoder *encoder, MiSnapTestText *expected, MiSnapTestRandom *random)
+{
+    char generated[16] = { 0 };
+    const char *string;
+    size_t length;
+    if (MiSnapTestNext(random) % 4 == 0) {
+        length = MiSnapTestNext(random) % sizeof(generated);
+        for (size_t i = 0; i < length; i++) {
+            generated[i] = (char)(1 + MiSnapTestNext(random) % 127);
+        }
+        string = generated;
+    } else {
+        string = kMiSnapTestStrings[MiSnapTestNext(random) % kMiSnapTestStringCount];
+        length = strlen(string);
+    }
+    MiSnapMIBIWriteString(encoder, string, length);
+    MiSnapTestAppendString(expected, string, length);
+}
+
+static void MiSnapTestWriteValue(MiSnapMIBIEncoder *encoder, MiSnapTestText *expected, MiSnapTestRandom *random, int depth)
+{
+    int kinds = depth < 5 ? 10 : 7;
+    switch (MiSnapTestNext(random) % kinds) {
+        case 0:
+            MiSnapMIBIWriteNull(encoder);
+            MiSnapTestAppend(expected, "null");
+            break;
+        case 1: {
+            bool value = MiSnapTestNext(random) % 2;
+            MiSnapMIBIWriteBool(encoder, value);
+            MiSnapTestAppend(expected, value ? "true" : "false");
+            break;
+        }
+        case 2: {
+            int64_t value = MiSnapTestInteger(random);
+            MiSnapMIBIWriteInteger(encoder, value);
+            MiSnapTestAppend(expected, "%lld", (long long)value);
+            break;
+        }
+        case 3: {
+            uint64_t value = ((uint64_t)MiSnapTestNext(random) << 32) | MiSnapTestNext(random);
+            MiSnapMIBIWriteUnsigned(encoder, value);
+            MiSnapTestAppend(expected, "%llu", (unsigned long long)value);
+            break;
+        }
+        case 4: {
+            double value = MiSnapTestGaussian(random) * pow(10, (int)(MiSnapTestNext(random) % 20) - 10);
+            MiSnapMIBIWriteDouble(encoder, value);
+            MiSnapTestAppend(expected, "%.17g", value);
+            break;
+        }
+        case 5:
+        case 6:
+            MiSnapTestWriteString(encoder, expected, random);
+            break;
+        case 7: {
+            int64_t values[12];
+            size_t count = MiSnapTestNext(random) % 12;
+            MiSnapTestAppend(expected, "[");
+            for (size_t i = 0; i < count; i++) {
+                values[i] = MiSnapTestInteger(random);
+                MiSnapTestAppend(expected, "%s%lld", i > 0 ? "," : "", (long long)values[i]);
+            }
+            MiSnapTestAppend(expected, "]");
+            MiSnapMIBIWriteIntegers(encoder, values, count);
+            break;
+        }
+        case 8: {
+            size_t count = MiSnapTestNext(random) % 5;
+            MiSnapMIBIWriteArray(encoder, count);
+            MiSnapTestAppend(expected, "[");
+            for (size_t i = 0; i < count; i++) {
+                MiSnapTestAppend(expected, "%s", i > 0 ? "," : "");
+                MiSnapTestWriteValue(encoder, expected, random, depth + 1);
+            }
+            MiSnapTestAppend(expected, "]");
+            break;
+        }
+        default: {
+            size_t count = MiSnapTestNext(random) % 5;
+            MiSnapMIBIWriteObject(encoder, count);
+            MiSnapTestAppend(expected, "{");
+            for (size_t i = 0; i < count; i++) {
+                MiSnapTestAppend(expected, "%s", i > 0 ? "," : "");
+                MiSnapTestWriteString(encoder, expected, random);
+                MiSnapTestAppend(expected, ":");
+                MiSnapTestWriteValue(encoder, expected, random, depth + 1);
+            }
+            MiSnapTestAppend(expected, "}");
+            break;
+        }
+    }
+}
+
+//A session's stream, as the plugin hands it out: the pending bytes after each few records
+typedef struct {
+    uint8_t *bytes;
+    size_t length;
+} MiSnapTestStream;
+
+static void MiSnapTestTake(MiSnapMIBIEncoder *encoder, MiSnapTestStream *stream)
+{
+    size_t length;
+    const uint8_t *bytes = MiSnapMIBIEncoderBytes(encoder, &length);
+    MiSnapCheck(!MiSnapMIBIEncoderFailed(encoder));
+    stream->bytes = realloc(stream->bytes, stream->length + length + 1);
+    if (length > 0) {
+        memcpy(stream->bytes + stream->length, bytes, length);
+    }
+    stream->length += length;
+    MiSnapMIBIEncoderDrain(encoder);
+}
+
+#define kMiSnapTestRecords 12
+
+//Random records written in chunks decode to exactly the JSON they were written from, with the
+//string table carried from chunk to chunk. The first streams are kept for the mutation test.
+static void MiSnapTestRoundTrip(MiSnapTestStream *corpus, size_t corpusCount)
+{
+    static MiSnapTestText expected[kMiSnapTestRecords];
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 8);
+    size_t records = 0, mismatches = 0;
+    for (int round = 0; round < 2000; round++) {
+        MiSnapMIBIEncoder *encoder = MiSnapMIBIEncoderCreate();
+        MiSnapTestStream stream = { NULL, 0 };
+        bool raw[kMiSnapTestRecords];
+        for (int i = 0; i < kMiSnapTestRecords; i++) {
+            expected[i].length = 0;
+            raw[i] = MiSnapTestNext(&random) % 8 == 0;
+            if (raw[i]) {
+                const char *payload = "MIBI unavailable: {not json";
+                MiSnapMIBIWriteRaw(encoder, payload, strlen(payload));
+                MiSnapTestAppend(&expected[i], "%s", payload);
+            } else {
+                MiSnapTestWriteValue(encoder, &expected[i], &random, 0);
+            }
+            if (MiSnapTestNext(&random) % 3 == 0) {
+                MiSnapTestTake(encoder, &stream);
+            }
+        }
+        MiSnapTestTake(encoder, &stream);
+        MiSnapMIBIEncoderFree(encoder);
+
+        MiSnapMIBIDecoder decoder;
+        MiSnapCheck(MiSnapMIBIDecoderInit(&decoder, stream.bytes, stream.length));
+        for (int i = 0; i <= kMiSnapTestRecords; i++) {
+            MiSnapMIBIBuffer text = { 0 };
+            MiSnapMIBIRecord record = MiSnapMIBIReadRecord(&decoder, &text);
+            if (i == kMiSnapTestRecords) {
+                MiSnapCheck(record == MiSnapMIBIRecordEnd);
+            } else if (record != (raw[i] ? MiSnapMIBIRecordRaw : MiSnapMIBIRecordJSON) || text.length != expected[i].length ||
+                       memcmp(text.bytes, expected[i].text, text.length) != 0) {
+                if (mismatches++ == 0) {
+                    fprintf(stderr, "record %d: %.*s\nexpected: %s\n", i, (int)text.length, text.bytes, expected[i].text);
+                }
+            }
+            records++;
+            MiSnapMIBIBufferFree(&text);
+        }
+        MiSnapMIBIDecoderFree(&decoder);
+        if ((size_t)round < corpusCount) {
+            corpus[round] = stream;
+        } else {
+            free(stream.bytes);
+        }
+    }
+    printf("%zu records round tripped\n", records);
+    MiSnapCheck(mismatches == 0);
+}
+
+//Deltas between the extremes wrap instead of overflowing, and integers above INT64_MAX keep
+//their value
+static void MiSnapTestExtremes(void)
+{
+    static const int64_t values[] = { INT64_MIN, INT64_MAX, INT64_MIN, 0, -1, INT64_MAX };
+    MiSnapMIBIEncoder *encoder = MiSnapMIBIEncoderCreate();
+    MiSnapMIBIWriteArray(encoder, 2);
+    MiSnapMIBIWriteIntegers(encoder, values, sizeof(values) / sizeof(values[0]));
+    MiSnapMIBIWriteUnsigned(encoder, UINT64_MAX);
+    size_t length;
+    const uint8_t *bytes = MiSnapMIBIEncoderBytes(encoder, &length);
+    MiSnapMIBIDecoder decoder;
+    MiSnapCheck(MiSnapMIBIDecoderInit(&decoder, bytes, length));
+    MiSnapMIBIBuffer text = { 0 };
+    MiSnapCheck(MiSnapMIBIReadRecord(&decoder, &text) == MiSnapMIBIRecordJSON);
+    const char *expected = "[[-9223372036854775808,9223372036854775807,-9223372036854775808,0,-1,9223372036854775807],18446744073709551615]";
+    MiSnapCheck(text.length == strlen(expected) && memcmp(text.bytes, expected, text.length) == 0);
+    MiSnapMIBIBufferFree(&text);
+    MiSnapMIBIDecoderFree(&decoder);
+    MiSnapMIBIEncoderFree(encoder);
+}
+
+//Two payloads of one session: the second mostly references strings of the first
+static void MiSnapTestInterningAcrossPayloads(void)
+{
+    static const char *const keys[] = { "MiSnapVersion", "DeviceModel", "DocumentType", "CaptureMode", "TorchMode", "Orientation" };
+    MiSnapMIBIEncoder *encoder = MiSnapMIBIEncoderCreate();
+    size_t sizes[2];
+    for (int payload = 0; payload < 2; payload++) {
+        MiSnapMIBIWriteObject(encoder, 6);
+        for (int i = 0; i < 6; i++) {
+            MiSnapMIBIWriteString(encoder, keys[i], strlen(keys[i]));
+            MiSnapMIBIWriteString(encoder, keys[(i + 1) % 6], strlen(keys[(i + 1) % 6]));
+        }
+        MiSnapMIBIEncoderBytes(encoder, &sizes[payload]);
+        MiSnapMIBIEncoderDrain(encoder);
+    }
+    printf("first payload %zu bytes, second %zu\n", sizes[0], sizes[1]);
+    MiSnapCheck(sizes[1] * 3 < sizes[0]);
+    MiSnapMIBIEncoderFree(encoder);
+}
+
+//Damaged streams: bytes overwritten, inserted and dropped, and streams cut short. Each is read
+//from a buffer of exactly its length, so a read past the end trips the address sanitizer in a
+//MISNAP_SANITIZE build; in any build the decoder must stop with a malformed record or the end.
+static void MiSnapTestFuzz(const MiSnapTestStream *corpus, size_t corpusCount)
+{
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 80);
+    int mutants = 0, malformed = 0, runaway = 0;
+    for (int round = 0; round < 20000; round++) {
+        const MiSnapTestStream *seed = &corpus[round % corpusCount];
+        size_t length = seed->length;
+        uint8_t *mutant = malloc(length + 8);
+        memcpy(mutant, seed->bytes, length);
+        int mutations = 1 + (int)(MiSnapTestNext(&random) % 4);
+        for (int m = 0; m < mutations && length > 0; m++) {
+            size_t at = MiSnapTestNext(&random) % length;
+            uint8_t byte = MiSnapTestNext(&random) % 2 ? (uint8_t)(MiSnapTestNext(&random) % 13) : (uint8_t)MiSnapTestNext(&random);
+            switch (MiSnapTestNext(&random) % 4) {
+                case 0:
+                    mutant[at] = byte;
+                    break;
+                case 1:
+                    memmove(mutant + at + 1, mutant + at, length - at);
+                    mutant[at] = byte;
+                    length++;
+                    break;
+                case 2:
+                    memmove(mutant + at, mutant + at + 1, length - at - 1);
+                    length--;
+                    break;
+                default:
+                    length = at;
+                    break;
+            }
+        }
+        uint8_t *exact = malloc(MAX(length, 1));
+        memcpy(exact, mutant, length);
+        free(mutant);
+
+        MiSnapMIBIDecoder decoder;
+        if (MiSnapMIBIDecoderInit(&decoder, exact, length)) {
+            MiSnapMIBIRecord record;
+            int count = 0;
+            do {
+                MiSnapMIBIBuffer text = { 0 };
+                record = MiSnapMIBIReadRecord(&decoder, &text);
+                MiSnapMIBIBufferFree(&text);
+            } while (record != MiSnapMIBIRecordEnd && record != MiSnapMIBIRecordMalformed && ++count < 1000);
+            malformed += record == MiSnapMIBIRecordMalformed;
+            runaway += count >= 1000;
+            MiSnapMIBIDecoderFree(&decoder);
+        }
+        free(exact);
+        mutants++;
+    }
+    printf("%d mutants, %d malformed\n", mutants, malformed);
+    MiSnapCheck(runaway == 0);
+}
+
+int main(void)
+{
+    MiSnapTestStream corpus[32];
+    size_t corpusCount = sizeof(corpus) / sizeof(corpus[0]);
+    MiSnapTestRoundTrip(corpus, corpusCount);
+    MiSnapTestExtremes();
+    MiSnapTestInterningAcrossPayloads();
+    MiSnapTestFuzz(corpus, corpusCount);
+    for (size_t i = 0; i < corpusCount; i++) {
+        free(corpus[i].bytes);
+    }
+    return MiSnapTestResult();
+}
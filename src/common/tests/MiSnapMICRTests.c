@@ -0,0 +1,247 @@
+
+#include "MiSnapMICR.h"
+#include "MiSnapTests.h"
+
+#define kMiSnapTestLines 90
+#define kMiSnapTestBlanks 40
+
+//A MICR line as printed on personal checks: an optional on-us serial, the routing number between
+//transit symbols with a valid ABA checksum, the account number closed by on-us, the check number
+//and sometimes an amount field
+static void MiSnapTestMakeLine(MiSnapTestRandom *random, char *text)
+{
+    static const int weights[9] = { 3, 7, 1, 3, 7, 1, 3, 7, 1 };
+    char routing[10];
+    int sum;
+    do {
+        sum = 0;
+        for (int i = 0; i < 9; i++) {
+            routing[i] = (char)('0' + MiSnapTestNext(random) % 10);
+            sum += weights[i] * (routing[i] - '0');
+        }
+    } while (sum % 10 != 0);
+    routing[9] = '\0';
+
+    int n = 0;
+    if (MiSnapTestUniform(random) < 0.3) {
+        n += sprintf(text + n, "U%04uU ", MiSnapTestNext(random) % 10000);
+    }
+    n += sprintf(text + n, "T%sT ", routing);
+    int accountLength = 8 + (int)(MiSnapTestNext(random) % 5);
+    for (int i = 0; i < accountLength; i++) {
+        text[n++] = i == 3 && MiSnapTestUniform(random) < 0.3 ? '-' : (char)('0' + MiSnapTestNext(random) % 10);
+    }
+    text[n++] = 'U';
+    if (MiSnapTestUniform(random) < 0.7) {
+        n += sprintf(text + n, " %04u", MiSnapTestNext(random) % 10000);
+    }
+    if (MiSnapTestUniform(random) < 0.3 && n < 32) {
+        n += sprintf(text + n, " $%010u$", MiSnapTestNext(random) % 100000);
+    }
+    text[n] = '\0';
+}
+
+//Renders a cropped check front width pixels wide (6" by 2.75") with a patterned background,
+//text-like clutter and a signature line above the MICR line, which is printed right aligned 0.19"
+//from the bottom edge and skewed by skew degrees. The ink is supersampled, blurred by a Gaussian
+//of blur pixels and the frame gets sensor noise. text may be NULL for a check without a MICR line.
+static uint8_t *MiSnapTestRenderCheck(MiSnapTestRandom *random, int width, const char *text, double skew, double blur, double noise, int ink, int *height)
+{
+    int h = (int)(width * 2.75 / 6.0);
+    double dpi = width / 6.0 * (0.95 + 0.1 * MiSnapTestUniform(random));
+    double unit = dpi * 0.013;
+    float *image = malloc(sizeof(float) * width * h);
+    double phase = MiSnapTestUniform(random) * 6;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < width; x++) {
+            image[y * width + x] = (float)(215 + 12 * sin(x * 0.05 + phase + 5 * sin(y * 0.02)) + 10.0 * x / width);
+        }
+    }
+    for (int block = 0; block < 40; block++) {
+        int bx = (int)(MiSnapTestUniform(random) * (width - 100)), by = (int)(MiSnapTestUniform(random) * h * 0.75);
+        int characterHeight = (int)(unit * (4 + MiSnapTestUniform(random) * 6)), characterWidth = characterHeight * 6 / 10;
+        int characters = 3 + (int)(MiSnapTestNext(random) % 15);
+        for (int k = 0; k < characters; k++) {
+            int x0 = bx + k * (characterWidth + 2);
+            for (int y = by; y < MIN(by + characterHeight, h); y++) {
+                for (int x = x0; x < MIN(x0 + characterWidth, width); x++) {
+                    if (MiSnapTestUniform(random) < 0.5) {
+                        image[y * width + x] = 60;
+                    }
+                }
+            }
+        }
+    }
+    int signatureY = (int)(h * 0.68);
+    for (int x = width / 2; x < width - 40; x++) {
+        image[signatureY * width + x] = image[(signatureY + 1) * width + x] = 40;
+    }
+
+    if (text != NULL) {
+        size_t length = strlen(text);
+        double theta = skew * M_PI / 180, c = cos(theta), s = sin(theta);
+        double bottom = h - dpi * 0.19, left = MAX(width - dpi * 0.25 - length * dpi * 0.125, dpi * 0.15);
+        double cx = width / 2.0, step = unit / 6, coverage = step * step;
+        for (size_t i = 0; i < length; i++) {
+            const char *const *glyph = MiSnapMICRGlyph(text[i]);
+            if (glyph == NULL) {
+                continue;
+            }
+            double gx = left + i * dpi * 0.125, gy = bottom - 9 * unit;
+            for (int row = 0; row < 9; row++) {
+                for (int column = 0; column < 7; column++) {
+                    if (glyph[row][column] != 'X') {
+                        continue;
+                    }
+                    for (double yy = gy + row * unit; yy < gy + (row + 1) * unit; yy += step) {
+                        for (double xx = gx + column * unit; xx < gx + (column + 1) * unit; xx += step) {
+                            int px = (int)(cx + (xx - cx) * c - (yy - bottom) * s), py = (int)(bottom + (xx - cx) * s + (yy - bottom) * c);
+                            if (px >= 0 && py >= 0 && px < width && py < h) {
+                                float *pixel = &image[py * width + px];
+                                *pixel = (float)MAX(*pixel - (215 - ink) * coverage, ink);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    int radius = (int)ceil(blur * 3);
+    double kernel[64], kernelSum = 0;
+    for (int i = -radius; i <= radius; i++) {
+        kernel[i + radius] = exp(-i * i / (2 * blur * blur));
+        kernelSum += kernel[i + radius];
+    }
+    float *blurred = malloc(sizeof(float) * width * h);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < width; x++) {
+            double sum = 0;
+            for (int i = -radius; i <= radius; i++) {
+                sum += kernel[i + radius] * image[y * width + MIN(MAX(x + i, 0), width - 1)];
+            }
+            blurred[y * width + x] = (float)(sum / kernelSum);
+        }
+    }
+    uint8_t *luma = malloc((size_t)width * h);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < width; x++) {
+            double sum = 0;
+            for (int i = -radius; i <= radius; i++) {
+                sum += kernel[i + radius] * blurred[MIN(MAX(y + i, 0), h - 1) * width + x];
+            }
+            double value = sum / kernelSum + noise * MiSnapTestGaussian(random);
+            luma[y * width + x] = (uint8_t)MIN(MAX(value, 0), 255);
+        }
+    }
+    free(blurred);
+    free(image);
+    *height = h;
+    return luma;
+}
+
+//Lines across the widths the plugin reads at, with up to 1.5 degrees of skew, blur, noise and
+//faded ink. These are renderings of the font the reader matches against, so they bound what it
+//can do rather than predict its accuracy on camera captures.
+static void MiSnapTestAccuracy(void)
+{
+    const int widths[3] = { 1200, 1600, 1920 };
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 11);
+    int exact = 0, routings = 0;
+    double totalMs = 0, worstMs = 0;
+    for (int n = 0; n < kMiSnapTestLines; n++) {
+        char text[128];
+        MiSnapTestMakeLine(&random, text);
+        double skew = (MiSnapTestUniform(&random) * 2 - 1) * 1.5, blur = 0.4 + MiSnapTestUniform(&random) * 1.1;
+        double noise = 2 + MiSnapTestUniform(&random) * 10;
+        int ink = 20 + (int)(MiSnapTestNext(&random) % 70), width = widths[n % 3], height;
+        uint8_t *luma = MiSnapTestRenderCheck(&random, width, text, skew, blur, noise, ink, &height);
+
+        MiSnapMICRLine line;
+        double startMs = MiSnapTestNowMs();
+        bool read = MiSnapMICRRead(luma, width, height, width, &line);
+        double ms = MiSnapTestNowMs() - startMs;
+        totalMs += ms;
+        worstMs = MAX(worstMs, ms);
+        if (read && strcmp(line.text, text) == 0) {
+            exact++;
+        } else {
+            printf("expected %s\n    read %s\n", text, read ? line.text : "nothing");
+        }
+        if (read && line.routingValid && strncmp(line.routing, strchr(text, 'T') + 1, 9) == 0) {
+            routings++;
+        }
+        free(luma);
+    }
+    printf("%d of %d lines exact, %d routing numbers, %.2f ms a check (worst %.2f)\n", exact, kMiSnapTestLines, routings, totalMs / kMiSnapTestLines, worstMs);
+    MiSnapCheck(exact * 100 >= kMiSnapTestLines * 98);
+    MiSnapCheck(routings >= exact);
+}
+
+//Checks without a MICR line, and planes too small to hold one, read as nothing
+static void MiSnapTestFalsePositives(void)
+{
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 13);
+    int falsePositives = 0;
+    for (int n = 0; n < kMiSnapTestBlanks; n++) {
+        int width = 1200 + (int)(MiSnapTestNext(&random) % 720), height;
+        uint8_t *luma = MiSnapTestRenderCheck(&random, width, NULL, 0, 0.4 + MiSnapTestUniform(&random), 2 + MiSnapTestUniform(&random) * 10, 40, &height);
+        MiSnapMICRLine line;
+        if (MiSnapMICRRead(luma, width, height, width, &line)) {
+            printf("read %s from a check without a MICR line\n", line.text);
+            falsePositives++;
+        }
+        MiSnapCheck(line.count == 0 || falsePositives > 0);
+        free(luma);
+    }
+    MiSnapCheck(falsePositives == 0);
+
+    uint8_t tiny[16 * 16];
+    memset(tiny, 200, sizeof(tiny));
+    MiSnapMICRLine line;
+    MiSnapCheck(!MiSnapMICRRead(tiny, 16, 16, 16, &line) && line.text[0] == '\0');
+}
+
+//Rows padded beyond the width read the same as tight ones
+static void MiSnapTestRowPadding(void)
+{
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 17);
+    const char *text = "T021000021T 1234567890U 0042";
+    int width = 1600, height;
+    uint8_t *luma = MiSnapTestRenderCheck(&random, width, text, 0.5, 0.6, 4, 40, &height);
+    size_t rowBytes = width + 64;
+    uint8_t *padded = malloc(rowBytes * height);
+    for (int y = 0; y < height; y++) {
+        memcpy(padded + y * rowBytes, luma + y * width, width);
+        memset(padded + y * rowBytes + width, 0, 64);
+    }
+    MiSnapMICRLine line;
+    MiSnapCheck(MiSnapMICRRead(padded, width, height, rowBytes, &line) && strcmp(line.text, text) == 0);
+    MiSnapCheck(strcmp(line.routing, "021000021") == 0 && line.routingValid);
+    MiSnapCheck(line.count == strlen(text) - 2 && line.confidence > 0 && line.confidence <= 1);
+    free(padded);
+    free(luma);
+}
+
+static void MiSnapTestRouting(void)
+{
+    MiSnapCheck(MiSnapMICRRoutingValid("021000021"));
+    MiSnapCheck(MiSnapMICRRoutingValid("011000015"));
+    MiSnapCheck(!MiSnapMICRRoutingValid("021000022"));
+    MiSnapCheck(!MiSnapMICRRoutingValid("02100002"));
+    MiSnapCheck(!MiSnapMICRRoutingValid("02100002?"));
+    MiSnapCheck(!MiSnapMICRRoutingValid(NULL));
+    MiSnapCheck(MiSnapMICRGlyph('T') != NULL && MiSnapMICRGlyph('A') == NULL);
+}
+
+int main(void)
+{
+    MiSnapTestAccuracy();
+    MiSnapTestFalsePositives();
+    MiSnapTestRowPadding();
+    MiSnapTestRouting();
+    return MiSnapTestResult();
+}
@@ -0,0 +1,214 @@
+
+#include "MiSnapMetricsCore.h"
+#include "MiSnapTests.h"
+#include <pthread.h>
+
+static uint64_t MiSnapTestClockNs;
+
+static uint64_t MiSnapTestClock(void)
+{
+    return MiSnapTestClockNs;
+}
+
+static int MiSnapTestCompareValues(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+//Values below 16 have a bucket each; above, every power of two is split in 16 buckets that
+//tile it without gaps, each at most 6.25% of its lowest value wide with its midpoint inside it.
+//Everything from 2^41 on shares the last bucket.
+static void MiSnapTestBuckets(void)
+{
+    MiSnapCheck(kMiSnapHistogramBuckets == 608);
+    for (uint64_t value = 0; value < 16; value++) {
+        MiSnapCheck(MiSnapHistogramBucketOf(value) == value && MiSnapHistogramBucketValue(value) == value);
+    }
+    size_t expected = 16;
+    for (int exponent = 4; exponent <= kMiSnapHistogramMaxExponent; exponent++) {
+        uint64_t width = 1ull << (exponent - 4);
+        for (uint64_t sub = 0; sub < 16; sub++, expected++) {
+            uint64_t low = (16 + sub) << (exponent - 4), high = low + width - 1;
+            MiSnapCheck(MiSnapHistogramBucketOf(low) == expected);
+            MiSnapCheck(MiSnapHistogramBucketOf(high) == expected);
+            MiSnapCheck(MiSnapHistogramBucketOf(low - 1) == expected - 1);
+            uint64_t middle = MiSnapHistogramBucketValue(expected);
+            MiSnapCheck(middle >= low && middle <= high);
+            MiSnapCheck(width * 16 <= low);
+        }
+    }
+    MiSnapCheck(expected == kMiSnapHistogramBuckets);
+    MiSnapCheck(MiSnapHistogramBucketOf(1ull << (kMiSnapHistogramMaxExponent + 1)) == kMiSnapHistogramBuckets - 1);
+    MiSnapCheck(MiSnapHistogramBucketOf(UINT64_MAX) == kMiSnapHistogramBuckets - 1);
+}
+
+//Percentiles of a long-tailed latency distribution against the exact ones of the same samples:
+//a bucket midpoint is within half a bucket, 3.125%, of anything in the bucket. Count, mean and
+//max are exact.
+static void MiSnapTestPercentiles(void)
+{
+    static MiSnapHistogram histogram;
+    const size_t count = 100000;
+    uint64_t *values = malloc(count * sizeof(uint64_t));
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 14);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        values[i] = (uint64_t)llround(exp(9 + 0.8 * MiSnapTestGaussian(&random)));
+        sum += values[i];
+        MiSnapHistogramRecord(&histogram, values[i]);
+    }
+    qsort(values, count, sizeof(uint64_t), MiSnapTestCompareValues);
+
+    MiSnapHistogramSummary summary;
+    MiSnapHistogramSummarize(&histogram, &summary);
+    MiSnapCheck(summary.count == count);
+    MiSnapCheck(fabs(summary.mean - (double)sum / count) < 1e-6 * summary.mean);
+    MiSnapCheck(summary.max == values[count - 1]);
+    const double quantiles[3] = { 0.5, 0.9, 0.99 };
+    const uint64_t estimates[3] = { summary.p50, summary.p90, summary.p99 };
+    for (int q = 0; q < 3; q++) {
+        uint64_t exact = values[(size_t)ceil(quantiles[q] * count) - 1];
+        double error = fabs((double)estimates[q] - exact) / exact;
+        printf("p%g: %llu, exact %llu, %.2f%% off\n", quantiles[q] * 100, (unsigned long long)estimates[q], (unsigned long long)exact, error * 100);
+        MiSnapCheck(error <= 0.03125);
+    }
+
+    //Small values are exact, and a single value is every percentile
+    MiSnapHistogramReset(&histogram);
+    MiSnapHistogramSummarize(&histogram, &summary);
+    MiSnapCheck(summary.count == 0 && summary.p50 == 0 && summary.max == 0 && summary.mean == 0);
+    for (uint64_t value = 1; value <= 10; value++) {
+        MiSnapHistogramRecord(&histogram, value);
+    }
+    MiSnapHistogramSummarize(&histogram, &summary);
+    MiSnapCheck(summary.p50 == 5 && summary.p90 == 9 && summary.p99 == 10 && summary.max == 10);
+    MiSnapHistogramReset(&histogram);
+    MiSnapHistogramRecord(&histogram, 123456789);
+    MiSnapHistogramSummarize(&histogram, &summary);
+    MiSnapCheck(summary.max == 123456789 && summary.p99 <= summary.max);
+    MiSnapCheck(summary.p50 == summary.p99 && summary.p50 >= 123456789 - 123456789 / 32);
+    free(values);
+}
+
+#define kMiSnapTestThreads 4
+#define kMiSnapTestRecords 200000
+
+typedef struct {
+    MiSnapHistogram *histogram;
+    uint64_t seed;
+    _Atomic bool *done;
+} MiSnapTestRecorder;
+
+static uint64_t MiSnapTestRecordValue(MiSnapTestRandom *random)
+{
+    return MiSnapTestNext(random) >> (MiSnapTestNext(random) % 32);
+}
+
+static void *MiSnapTestRecord(void *argument)
+{
+    MiSnapTestRecorder *recorder = argument;
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, recorder->seed);
+    for (int i = 0; i < kMiSnapTestRecords; i++) {
+        MiSnapHistogramRecord(recorder->histogram, MiSnapTestRecordValue(&random));
+    }
+    return NULL;
+}
+
+//Summaries taken while the recorders run: never more than was recorded, the count never goes
+//down and the percentiles stay ordered and under the max
+static void *MiSnapTestWatch(void *argument)
+{
+    MiSnapTestRecorder *watcher = argument;
+    uint64_t last = 0;
+    int summaries = 0;
+    while (!atomic_load(watcher->done) || summaries == 0) {
+        MiSnapHistogramSummary summary;
+        MiSnapHistogramSummarize(watcher->histogram, &summary);
+        MiSnapCheck(summary.count >= last && summary.count <= (uint64_t)kMiSnapTestThreads * kMiSnapTestRecords);
+        MiSnapCheck(summary.p50 <= summary.p90 && summary.p90 <= summary.p99 && summary.p99 <= summary.max);
+        last = summary.count;
+        summaries++;
+    }
+    return NULL;
+}
+
+//Recording from several threads at once loses nothing: every bucket, the count, the sum and the
+//max match the same values recorded on one thread
+static void MiSnapTestConcurrentRecording(void)
+{
+    static MiSnapHistogram shared, serial;
+    _Atomic bool done;
+    atomic_init(&done, false);
+    MiSnapTestRecorder recorders[kMiSnapTestThreads], watcher = { &shared, 0, &done };
+    pthread_t threads[kMiSnapTestThreads], watch;
+    pthread_create(&watch, NULL, MiSnapTestWatch, &watcher);
+    for (int i = 0; i < kMiSnapTestThreads; i++) {
+        recorders[i] = (MiSnapTestRecorder){ &shared, 100 + (uint64_t)i, &done };
+        pthread_create(&threads[i], NULL, MiSnapTestRecord, &recorders[i]);
+    }
+    for (int i = 0; i < kMiSnapTestThreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    atomic_store(&done, true);
+    pthread_join(watch, NULL);
+
+    for (int i = 0; i < kMiSnapTestThreads; i++) {
+        recorders[i].histogram = &serial;
+        MiSnapTestRecord(&recorders[i]);
+    }
+    size_t differing = 0;
+    for (size_t i = 0; i < kMiSnapHistogramBuckets; i++) {
+        differing += atomic_load(&shared.buckets[i]) != atomic_load(&serial.buckets[i]);
+    }
+    MiSnapCheck(differing == 0);
+    MiSnapCheck(atomic_load(&shared.count) == (uint64_t)kMiSnapTestThreads * kMiSnapTestRecords);
+    MiSnapCheck(atomic_load(&shared.sum) == atomic_load(&serial.sum));
+    MiSnapCheck(atomic_load(&shared.max) == atomic_load(&serial.max));
+}
+
+//Stages timed on a fake clock land in their metric in microseconds; reset starts a new period
+//for histograms and counters alike
+static void MiSnapTestStages(void)
+{
+    MiSnapMetricsSetClock(MiSnapTestClock);
+    MiSnapTestClockNs = 5000000000ull;
+    uint64_t start = MiSnapMetricsNow();
+    MiSnapCheck(start == MiSnapTestClockNs);
+    MiSnapTestClockNs += 12500000;
+    MiSnapCheck(MiSnapMetricsMsSince(start) == 12.5);
+    MiSnapMetricsRecordMs(MiSnapMetricEncode, MiSnapMetricsMsSince(start));
+    MiSnapMetricsRecordMs(MiSnapMetricEncode, -3);
+    MiSnapMetricsIncrement(MiSnapCounterCaptures);
+    MiSnapMetricsIncrement(MiSnapCounterCaptures);
+
+    MiSnapHistogramSummary summary;
+    MiSnapMetricsSummarize(MiSnapMetricEncode, false, &summary);
+    MiSnapCheck(summary.count == 2 && summary.max == 12500 && summary.mean == 6250);
+    MiSnapMetricsSummarize(MiSnapMetricDelivery, false, &summary);
+    MiSnapCheck(summary.count == 0);
+    MiSnapCheck(MiSnapMetricsCounterValue(MiSnapCounterCaptures, false) == 2);
+    MiSnapCheck(MiSnapMetricsCounterValue(MiSnapCounterCancellations, false) == 0);
+
+    MiSnapMetricsSummarize(MiSnapMetricEncode, true, &summary);
+    MiSnapCheck(summary.count == 2);
+    MiSnapMetricsSummarize(MiSnapMetricEncode, false, &summary);
+    MiSnapCheck(summary.count == 0 && summary.max == 0);
+    MiSnapCheck(MiSnapMetricsCounterValue(MiSnapCounterCaptures, true) == 2);
+    MiSnapCheck(MiSnapMetricsCounterValue(MiSnapCounterCaptures, false) == 0);
+
+    MiSnapMetricsSetClock(NULL);
+    start = MiSnapMetricsNow();
+    MiSnapCheck(start != MiSnapTestClockNs && MiSnapMetricsMsSince(start) >= 0);
+}
+
+int main(void)
+{
+    MiSnapTestBuckets();
+    MiSnapTestPercentiles();
+    MiSnapTestConcurrentRecording();
+    MiSnapTestStages();
+    return MiSnapTestResult();
+}
@@ -0,0 +1,444 @@
+
+#include "MiSnapNative.c"
+#include "MiSnapTests.h"
+#include <stddef.h>
+#include <unistd.h>
+
+//Drives the JNI entry points of src/android/jni/MiSnapNative.c through a JNIEnv of our own, whose
+//objects are plain structs: direct buffers with an address and a capacity (a heap buffer has no
+//address), strings, and int and long arrays. Exceptions are recorded rather than thrown, so every
+//check can see which one an entry point left pending. The program takes the path of
+//MiSnapNative.java, whose SCORE_* offsets must match MiSnapScoreRecord.
+
+typedef enum {
+    MiSnapTestObjectClass,
+    MiSnapTestObjectBuffer,
+    MiSnapTestObjectString,
+    MiSnapTestObjectIntArray,
+    MiSnapTestObjectLongArray
+} MiSnapTestObjectKind;
+
+struct _jobject {
+    MiSnapTestObjectKind kind;
+    void *address;
+    jlong capacity;
+    const char *utf;
+    jsize length;
+    jint ints[16];
+    jlong longs[1024];
+    struct _jobject *next;
+};
+
+static struct _jobject *MiSnapTestObjects;
+static char MiSnapTestException[64];
+static int MiSnapTestStringsHeld;
+
+static jobject MiSnapTestObject(MiSnapTestObjectKind kind)
+{
+    struct _jobject *object = calloc(1, sizeof(*object));
+    object->kind = kind;
+    object->next = MiSnapTestObjects;
+    MiSnapTestObjects = object;
+    return object;
+}
+
+static jobject MiSnapTestBuffer(void *address, jlong capacity)
+{
+    jobject buffer = MiSnapTestObject(MiSnapTestObjectBuffer);
+    buffer->address = address;
+    buffer->capacity = capacity;
+    return buffer;
+}
+
+static jobject MiSnapTestString(const char *utf)
+{
+    jobject string = MiSnapTestObject(MiSnapTestObjectString);
+    string->utf = utf;
+    return string;
+}
+
+static jclass JNICALL MiSnapTestFindClass(JNIEnv *env, const char *name)
+{
+    jclass class = MiSnapTestObject(MiSnapTestObjectClass);
+    class->utf = name;
+    return class;
+}
+
+static jint JNICALL MiSnapTestThrowNew(JNIEnv *env, jclass class, const char *message)
+{
+    MiSnapCheck(MiSnapTestException[0] == '\0' && message != NULL);
+    snprintf(MiSnapTestException, sizeof(MiSnapTestException), "%s", class->utf);
+    return 0;
+}
+
+static const char *JNICALL MiSnapTestGetStringUTFChars(JNIEnv *env, jstring string, jboolean *isCopy)
+{
+    MiSnapCheck(string != NULL && string->kind == MiSnapTestObjectString);
+    MiSnapTestStringsHeld++;
+    return string->utf;
+}
+
+static void JNICALL MiSnapTestReleaseStringUTFChars(JNIEnv *env, jstring string, const char *utf)
+{
+    MiSnapCheck(utf == string->utf);
+    MiSnapTestStringsHeld--;
+}
+
+static jintArray JNICALL MiSnapTestNewIntArray(JNIEnv *env, jsize length)
+{
+    MiSnapCheck(length >= 0 && length <= 16);
+    jintArray array = MiSnapTestObject(MiSnapTestObjectIntArray);
+    array->length = length;
+    return array;
+}
+
+static jlongArray JNICALL MiSnapTestNewLongArray(JNIEnv *env, jsize length)
+{
+    MiSnapCheck(length >= 0 && length <= 1024);
+    jlongArray array = MiSnapTestObject(MiSnapTestObjectLongArray);
+    array->length = length;
+    return array;
+}
+
+static void JNICALL MiSnapTestSetIntArrayRegion(JNIEnv *env, jintArray array, jsize start, jsize length, const jint *values)
+{
+    MiSnapCheck(array->kind == MiSnapTestObjectIntArray && start >= 0 && length >= 0 && start + length <= array->length);
+    memcpy(array->ints + start, values, sizeof(jint) * length);
+}
+
+static void JNICALL MiSnapTestSetLongArrayRegion(JNIEnv *env, jlongArray array, jsize start, jsize length, const jlong *values)
+{
+    MiSnapCheck(array->kind == MiSnapTestObjectLongArray && start >= 0 && length >= 0 && start + length <= array->length);
+    memcpy(array->longs + start, values, sizeof(jlong) * length);
+}
+
+static jobject JNICALL MiSnapTestNewDirectByteBuffer(JNIEnv *env, void *address, jlong capacity)
+{
+    return MiSnapTestBuffer(address, capacity);
+}
+
+static void *JNICALL MiSnapTestGetDirectBufferAddress(JNIEnv *env, jobject buffer)
+{
+    return buffer->kind == MiSnapTestObjectBuffer ? buffer->address : NULL;
+}
+
+static jlong JNICALL MiSnapTestGetDirectBufferCapacity(JNIEnv *env, jobject buffer)
+{
+    return buffer->kind == MiSnapTestObjectBuffer && buffer->address != NULL ? buffer->capacity : -1;
+}
+
+static struct JNINativeInterface_ MiSnapTestInterface = {
+    .FindClass = MiSnapTestFindClass,
+    .ThrowNew = MiSnapTestThrowNew,
+    .GetStringUTFChars = MiSnapTestGetStringUTFChars,
+    .ReleaseStringUTFChars = MiSnapTestReleaseStringUTFChars,
+    .NewIntArray = MiSnapTestNewIntArray,
+    .NewLongArray = MiSnapTestNewLongArray,
+    .SetIntArrayRegion = MiSnapTestSetIntArrayRegion,
+    .SetLongArrayRegion = MiSnapTestSetLongArrayRegion,
+    .NewDirectByteBuffer = MiSnapTestNewDirectByteBuffer,
+    .GetDirectBufferAddress = MiSnapTestGetDirectBufferAddress,
+    .GetDirectBufferCapacity = MiSnapTestGetDirectBufferCapacity,
+};
+
+static JNIEnv MiSnapTestEnv = &MiSnapTestInterface;
+
+//The exception left pending since the last call, "" for none; clears it
+static bool MiSnapTestThrew(const char *className)
+{
+    bool threw = strcmp(MiSnapTestException, className) == 0;
+    MiSnapTestException[0] = '\0';
+    return threw;
+}
+
+//Every SCORE_* constant of MiSnapNative.java is the offset of the same field of
+//MiSnapScoreRecord, and SCORE_BYTES its size
+static void MiSnapTestScoreLayout(const char *javaPath)
+{
+    static const struct {
+        const char *name;
+        long offset;
+    } fields[] = {
+        { "SCORE_BRIGHTNESS", offsetof(MiSnapScoreRecord, brightness) },
+        { "SCORE_SHARPNESS", offsetof(MiSnapScoreRecord, sharpness) },
+        { "SCORE_ANGLE", offsetof(MiSnapScoreRecord, angle) },
+        { "SCORE_QUAD_FOUND", offsetof(MiSnapScoreRecord, quadFound) },
+        { "SCORE_QUAD_ANGLE", offsetof(MiSnapScoreRecord, quadAngle) },
+        { "SCORE_QUAD_PADDING", offsetof(MiSnapScoreRecord, quadPadding) },
+        { "SCORE_QUAD_CORNERS", offsetof(MiSnapScoreRecord, corners) },
+        { "SCORE_BYTES", sizeof(MiSnapScoreRecord) },
+    };
+    FILE *file = javaPath != NULL ? fopen(javaPath, "r") : NULL;
+    MiSnapCheck(file != NULL);
+    if (file == NULL) {
+        return;
+    }
+    int found = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char name[64];
+        long value;
+        if (sscanf(line, " static final int %63[A-Z_] = %ld;", name, &value) != 2 || strncmp(name, "SCORE_", 6) != 0) {
+            continue;
+        }
+        bool known = false;
+        for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+            if (strcmp(fields[i].name, name) == 0) {
+                known = true;
+                found++;
+                if (fields[i].offset != value) {
+                    fprintf(stderr, "%s is %ld in MiSnapNative.java, %ld in MiSnapScoreRecord\n", name, value, fields[i].offset);
+                    MiSnapTestFailures++;
+                }
+            }
+        }
+        MiSnapCheck(known);
+    }
+    fclose(file);
+    MiSnapCheck(found == sizeof(fields) / sizeof(fields[0]));
+}
+
+//A frame is scored into the score buffer exactly as the core scores it; buffers that are not
+//direct or too small, and impossible geometry, throw IllegalArgumentException and leave the score
+//buffer alone
+static void MiSnapTestScoring(void)
+{
+    const jint width = 321, height = 200, rowStride = 336;
+    const jlong lumaLength = (jlong)rowStride * (height - 1) + width;
+    uint8_t *luma = malloc(lumaLength);
+    for (jlong i = 0; i < lumaLength; i++) {
+        luma[i] = (uint8_t)((i % rowStride) / 20 % 2 ? 200 : 60);
+    }
+    uint8_t scoreBytes[sizeof(MiSnapScoreRecord) + 8];
+    memset(scoreBytes, 0xA5, sizeof(scoreBytes));
+    jobject lumaBuffer = MiSnapTestBuffer(luma, lumaLength);
+    jobject scoreBuffer = MiSnapTestBuffer(scoreBytes, sizeof(MiSnapScoreRecord));
+
+    Java_com_keybank_misnap_MiSnapNative_scoreLumaFrame(&MiSnapTestEnv, NULL, lumaBuffer, width, height, rowStride, scoreBuffer);
+    MiSnapCheck(MiSnapTestThrew(""));
+    MiSnapFrameScore expected;
+    MiSnapScoreLumaFrame(luma, width, height, rowStride, &expected);
+    MiSnapScoreRecord record;
+    memcpy(&record, scoreBytes, sizeof(record));
+    MiSnapCheck(record.brightness == expected.brightness && record.sharpness == expected.sharpness && record.angle == expected.angle);
+    MiSnapCheck(record.quadFound == expected.quad.found && record.quadAngle == expected.quad.angle && record.quadPadding == expected.quad.padding);
+    for (int corner = 0; corner < 4; corner++) {
+        MiSnapCheck(record.corners[2 * corner] == expected.quad.corners[corner].x && record.corners[2 * corner + 1] == expected.quad.corners[corner].y);
+    }
+    //Nothing is written past the record
+    MiSnapCheck(scoreBytes[sizeof(MiSnapScoreRecord)] == 0xA5 && scoreBytes[sizeof(scoreBytes) - 1] == 0xA5);
+
+    //scorePasses reads the record back
+    jboolean passes = Java_com_keybank_misnap_MiSnapNative_scorePasses(&MiSnapTestEnv, NULL, scoreBuffer, 0, 0, 0, 0);
+    MiSnapCheck(passes == JNI_TRUE);
+    passes = Java_com_keybank_misnap_MiSnapNative_scorePasses(&MiSnapTestEnv, NULL, scoreBuffer, 0, 0, expected.sharpness + 1, 0);
+    MiSnapCheck(passes == JNI_FALSE && MiSnapTestThrew(""));
+
+    memset(scoreBytes, 0xA5, sizeof(scoreBytes));
+    const struct {
+        jobject luma;
+        jint width;
+        jint height;
+        jint rowStride;
+        jobject score;
+    } rejected[] = {
+        { MiSnapTestBuffer(luma, lumaLength - 1), width, height, rowStride, scoreBuffer },
+        { lumaBuffer, width, height, rowStride, MiSnapTestBuffer(scoreBytes, sizeof(MiSnapScoreRecord) - 1) },
+        { MiSnapTestBuffer(NULL, lumaLength), width, height, rowStride, scoreBuffer },
+        { lumaBuffer, width, height, rowStride, MiSnapTestBuffer(NULL, sizeof(MiSnapScoreRecord)) },
+        { NULL, width, height, rowStride, scoreBuffer },
+        { lumaBuffer, width, height, rowStride, NULL },
+        { lumaBuffer, width, height, width - 1, scoreBuffer },
+        { lumaBuffer, -1, height, rowStride, scoreBuffer },
+        { lumaBuffer, width, -1, rowStride, scoreBuffer },
+    };
+    for (size_t i = 0; i < sizeof(rejected) / sizeof(rejected[0]); i++) {
+        Java_com_keybank_misnap_MiSnapNative_scoreLumaFrame(&MiSnapTestEnv, NULL, rejected[i].luma, rejected[i].width, rejected[i].height, rejected[i].rowStride, rejected[i].score);
+        if (!MiSnapTestThrew("java/lang/IllegalArgumentException")) {
+            fprintf(stderr, "rejected case %zu did not throw\n", i);
+            MiSnapTestFailures++;
+        }
+        MiSnapCheck(scoreBytes[0] == 0xA5);
+    }
+    passes = Java_com_keybank_misnap_MiSnapNative_scorePasses(&MiSnapTestEnv, NULL, MiSnapTestBuffer(scoreBytes, 12), 0, 0, 0, 0);
+    MiSnapCheck(passes == JNI_FALSE && MiSnapTestThrew("java/lang/IllegalArgumentException"));
+    free(luma);
+}
+
+//Thresholds come from the document type's profile, as on iOS; unknown types give null
+static void MiSnapTestProfileThresholds(void)
+{
+    static const struct {
+        const char *documentType;
+        jint sharpness;
+    } documents[] = { { "CheckFront", 600 }, { "ACH", 600 }, { "CheckBack", 100 }, { "Remittance", 850 }, { "DriversLicense", 350 } };
+    for (size_t i = 0; i < sizeof(documents) / sizeof(documents[0]); i++) {
+        jintArray thresholds = Java_com_keybank_misnap_MiSnapNative_profileThresholds(&MiSnapTestEnv, NULL, MiSnapTestString(documents[i].documentType));
+        MiSnapCheck(thresholds != NULL && thresholds->length == 4);
+        if (thresholds != NULL) {
+            MiSnapCheck(thresholds->ints[0] == 400 && thresholds->ints[1] == 700);
+            MiSnapCheck(thresholds->ints[2] == documents[i].sharpness && thresholds->ints[3] == 150);
+        }
+    }
+    MiSnapCheck(Java_com_keybank_misnap_MiSnapNative_profileThresholds(&MiSnapTestEnv, NULL, MiSnapTestString("Passport")) == NULL);
+    MiSnapCheck(Java_com_keybank_misnap_MiSnapNative_profileThresholds(&MiSnapTestEnv, NULL, NULL) == NULL);
+    MiSnapCheck(MiSnapTestThrew("") && MiSnapTestStringsHeld == 0);
+}
+
+//Pooled buffers come back as direct buffers of the size asked for; a size of 0 throws
+static void MiSnapTestBufferPool(void)
+{
+    jobject buffer = Java_com_keybank_misnap_MiSnapNative_acquireBuffer(&MiSnapTestEnv, NULL, 1000);
+    MiSnapCheck(buffer != NULL && buffer->address != NULL && buffer->capacity == 1000);
+    if (buffer != NULL) {
+        memset(buffer->address, 1, 1000);
+        Java_com_keybank_misnap_MiSnapNative_releaseBuffer(&MiSnapTestEnv, NULL, buffer);
+    }
+    MiSnapCheck(Java_com_keybank_misnap_MiSnapNative_acquireBuffer(&MiSnapTestEnv, NULL, 0) == NULL);
+    MiSnapCheck(MiSnapTestThrew("java/lang/OutOfMemoryError"));
+    jlongArray statistics = Java_com_keybank_misnap_MiSnapNative_bufferPoolStatistics(&MiSnapTestEnv, NULL, JNI_FALSE);
+    MiSnapCheck(statistics != NULL && statistics->length == 7);
+    if (statistics != NULL) {
+        MiSnapCheck(statistics->longs[0] + statistics->longs[1] >= 1);
+    }
+}
+
+#define kMiSnapTestSpoolPath "MiSnapNativeTests.spool"
+
+static jlong MiSnapTestSpoolAppend(jlong spool, const char *json, size_t jpegLength, uint8_t seed)
+{
+    uint8_t *jpeg = malloc(jpegLength + 1);
+    for (size_t i = 0; i < jpegLength; i++) {
+        jpeg[i] = (uint8_t)(seed + i * 13);
+    }
+    jlong id = Java_com_keybank_misnap_MiSnapNative_spoolAppend(&MiSnapTestEnv, NULL, spool, MiSnapTestBuffer((void *)json, (jlong)strlen(json)), (jint)strlen(json), MiSnapTestBuffer(jpeg, (jlong)jpegLength), (jint)jpegLength);
+    free(jpeg);
+    return id;
+}
+
+//A record read back is the JSON length, the JSON and the JPEG
+static bool MiSnapTestCaptureIntact(const uint8_t *bytes, jlong length, const char *json, size_t jpegLength, uint8_t seed)
+{
+    uint32_t jsonLength;
+    size_t expected = sizeof(jsonLength) + strlen(json) + jpegLength;
+    if (bytes == NULL || (size_t)length != expected) {
+        return false;
+    }
+    memcpy(&jsonLength, bytes, sizeof(jsonLength));
+    if (jsonLength != strlen(json) || memcmp(bytes + sizeof(jsonLength), json, jsonLength) != 0) {
+        return false;
+    }
+    const uint8_t *jpeg = bytes + sizeof(jsonLength) + jsonLength;
+    for (size_t i = 0; i < jpegLength; i++) {
+        if (jpeg[i] != (uint8_t)(seed + i * 13)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//Appends, reads, entries and deletes through the entry points. A buffer from spoolRead stays
+//readable until spoolReleaseMap, across deleting its record, compacting the spool and closing it.
+static void MiSnapTestSpool(void)
+{
+    unlink(kMiSnapTestSpoolPath);
+    jlong spool = Java_com_keybank_misnap_MiSnapNative_spoolOpen(&MiSnapTestEnv, NULL, MiSnapTestString(kMiSnapTestSpoolPath));
+    MiSnapCheck(spool != 0 && MiSnapTestThrew("") && MiSnapTestStringsHeld == 0);
+    if (spool == 0) {
+        return;
+    }
+    const char *json = "{\"resultCode\":\"SuccessVideo\"}";
+    jlong first = MiSnapTestSpoolAppend(spool, json, 70000, 1);
+    jlong second = MiSnapTestSpoolAppend(spool, "{}", 0, 2);
+    MiSnapCheck(first > 0 && second > first);
+
+    jlongArray entries = Java_com_keybank_misnap_MiSnapNative_spoolEntries(&MiSnapTestEnv, NULL, spool);
+    MiSnapCheck(entries != NULL && entries->length == 4);
+    if (entries != NULL && entries->length == 4) {
+        MiSnapCheck(entries->longs[0] == first && entries->longs[1] == (jlong)(4 + strlen(json) + 70000));
+        MiSnapCheck(entries->longs[2] == second && entries->longs[3] == 4 + 2);
+    }
+
+    jlongArray map = MiSnapTestObject(MiSnapTestObjectLongArray);
+    map->length = 1;
+    jobject record = Java_com_keybank_misnap_MiSnapNative_spoolRead(&MiSnapTestEnv, NULL, spool, first, map);
+    MiSnapCheck(record != NULL && map->longs[0] != 0);
+    if (record == NULL) {
+        return;
+    }
+    MiSnapCheck(MiSnapTestCaptureIntact(record->address, record->capacity, json, 70000, 1));
+
+    //Unknown ids give null and leave the map alone
+    jlongArray otherMap = MiSnapTestObject(MiSnapTestObjectLongArray);
+    otherMap->length = 1;
+    MiSnapCheck(Java_com_keybank_misnap_MiSnapNative_spoolRead(&MiSnapTestEnv, NULL, spool, second + 100, otherMap) == NULL);
+    MiSnapCheck(otherMap->longs[0] == 0);
+
+    //Enough appends after the delete that the record's bytes would be overwritten if they could be
+    MiSnapCheck(Java_com_keybank_misnap_MiSnapNative_spoolDelete(&MiSnapTestEnv, NULL, spool, first) == JNI_TRUE);
+    MiSnapCheck(Java_com_keybank_misnap_MiSnapNative_spoolDelete(&MiSnapTestEnv, NULL, spool, first) == JNI_FALSE);
+    MiSnapCheck(Java_com_keybank_misnap_MiSnapNative_spoolDelete(&MiSnapTestEnv, NULL, spool, second) == JNI_TRUE);
+    jlong third = MiSnapTestSpoolAppend(spool, "{\"n\":3}", 100, 3);
+    Java_com_keybank_misnap_MiSnapNative_spoolClose(&MiSnapTestEnv, NULL, spool);
+    spool = Java_com_keybank_misnap_MiSnapNative_spoolOpen(&MiSnapTestEnv, NULL, MiSnapTestString(kMiSnapTestSpoolPath));
+    MiSnapCheck(spool != 0);
+    MiSnapCheck(MiSnapTestCaptureIntact(record->address, record->capacity, json, 70000, 1));
+    Java_com_keybank_misnap_MiSnapNative_spoolReleaseMap(&MiSnapTestEnv, NULL, map->longs[0]);
+
+    entries = Java_com_keybank_misnap_MiSnapNative_spoolEntries(&MiSnapTestEnv, NULL, spool);
+    MiSnapCheck(entries != NULL && entries->length == 2 && entries->longs[0] == third);
+    record = Java_com_keybank_misnap_MiSnapNative_spoolRead(&MiSnapTestEnv, NULL, spool, third, map);
+    MiSnapCheck(record != NULL && MiSnapTestCaptureIntact(record->address, record->capacity, "{\"n\":3}", 100, 3));
+    if (record != NULL) {
+        Java_com_keybank_misnap_MiSnapNative_spoolReleaseMap(&MiSnapTestEnv, NULL, map->longs[0]);
+    }
+
+    //Lengths and buffers are checked before anything is stored
+    uint8_t bytes[8] = { 0 };
+    MiSnapCheck(Java_com_keybank_misnap_MiSnapNative_spoolAppend(&MiSnapTestEnv, NULL, spool, MiSnapTestBuffer(bytes, 8), -1, MiSnapTestBuffer(bytes, 8), 8) == 0);
+    MiSnapCheck(MiSnapTestThrew("java/lang/IllegalArgumentException"));
+    MiSnapCheck(Java_com_keybank_misnap_MiSnapNative_spoolAppend(&MiSnapTestEnv, NULL, spool, MiSnapTestBuffer(bytes, 8), 8, MiSnapTestBuffer(bytes, 8), 9) == 0);
+    MiSnapCheck(MiSnapTestThrew("java/lang/IllegalArgumentException"));
+    MiSnapCheck(Java_com_keybank_misnap_MiSnapNative_spoolAppend(&MiSnapTestEnv, NULL, spool, MiSnapTestBuffer(NULL, 8), 8, MiSnapTestBuffer(bytes, 8), 8) == 0);
+    MiSnapCheck(MiSnapTestThrew("java/lang/IllegalArgumentException"));
+    entries = Java_com_keybank_misnap_MiSnapNative_spoolEntries(&MiSnapTestEnv, NULL, spool);
+    MiSnapCheck(entries != NULL && entries->length == 2);
+    Java_com_keybank_misnap_MiSnapNative_spoolClose(&MiSnapTestEnv, NULL, spool);
+
+    MiSnapCheck(Java_com_keybank_misnap_MiSnapNative_spoolOpen(&MiSnapTestEnv, NULL, MiSnapTestString("missing/directory/captures.spool")) == 0);
+    MiSnapCheck(MiSnapTestThrew("java/io/IOException"));
+    MiSnapCheck(MiSnapTestStringsHeld == 0);
+    unlink(kMiSnapTestSpoolPath);
+}
+
+//The { offset, length } pair readCaptureChunk reads, including a negative total and requests at and
+//past the end
+static void MiSnapTestSpoolChunkRange(void)
+{
+    jlongArray range = Java_com_keybank_misnap_MiSnapNative_spoolChunkRange(&MiSnapTestEnv, NULL, 100000, 90000, 0);
+    MiSnapCheck(range != NULL && range->length == 2 && range->longs[0] == 90000 && range->longs[1] == 10000);
+    range = Java_com_keybank_misnap_MiSnapNative_spoolChunkRange(&MiSnapTestEnv, NULL, 100000, 0, 1);
+    MiSnapCheck(range != NULL && range->longs[0] == 0 && range->longs[1] == kMiSnapSpoolMinChunkBytes);
+    range = Java_com_keybank_misnap_MiSnapNative_spoolChunkRange(&MiSnapTestEnv, NULL, 100000, 100000, 0);
+    MiSnapCheck(range != NULL && range->longs[0] == 100000 && range->longs[1] == 0);
+    range = Java_com_keybank_misnap_MiSnapNative_spoolChunkRange(&MiSnapTestEnv, NULL, 100000, 200000, 0);
+    MiSnapCheck(range != NULL && range->longs[0] == 100000 && range->longs[1] == 0);
+    range = Java_com_keybank_misnap_MiSnapNative_spoolChunkRange(&MiSnapTestEnv, NULL, -1, 10, 0);
+    MiSnapCheck(range != NULL && range->longs[0] == 0 && range->longs[1] == 0);
+}
+
+int main(int argc, char **argv)
+{
+    MiSnapTestScoreLayout(argc > 1 ? argv[1] : NULL);
+    MiSnapTestScoring();
+    MiSnapTestProfileThresholds();
+    MiSnapTestBufferPool();
+    MiSnapTestSpool();
+    MiSnapTestSpoolChunkRange();
+    while (MiSnapTestObjects != NULL) {
+        struct _jobject *next = MiSnapTestObjects->next;
+        free(MiSnapTestObjects);
+        MiSnapTestObjects = next;
+    }
+    return MiSnapTestResult();
+}
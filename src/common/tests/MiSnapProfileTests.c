@@ -0,0 +1,156 @@
+
+#include "MiSnapProfileCore.h"
+#include "MiSnapTests.h"
+
+//The default table: every document type is found by its name, its values lie within the
+//documented ranges, nothing is marked as set, and the scoring thresholds are the documented
+//per-document ones
+static void MiSnapTestDefaults(void)
+{
+    static const struct {
+        const char *name;
+        MiSnapDocumentKind kind;
+        int sharpness;
+        int timeout;
+        int torchMode;
+    } documents[] = {
+        { "ACH", MiSnapDocumentKindACH, 600, 20, 1 },
+        { "CheckFront", MiSnapDocumentKindCheckFront, 600, 20, 1 },
+        { "CheckBack", MiSnapDocumentKindCheckBack, 100, 20, 1 },
+        { "Remittance", MiSnapDocumentKindRemittance, 850, 20, 1 },
+        { "BalanceTransfer", MiSnapDocumentKindBalanceTransfer, 850, 20, 1 },
+        { "W2", MiSnapDocumentKindW2, 400, 20, 1 },
+        { "DriversLicense", MiSnapDocumentKindDriversLicense, 350, 30, 0 },
+        { "LandscapeDocument", MiSnapDocumentKindLandscapeDocument, 400, 20, 1 },
+        { "PDF417", MiSnapDocumentKindPDF417, 350, 30, 0 },
+    };
+    MiSnapCheck(sizeof(documents) / sizeof(documents[0]) == MiSnapDocumentKindCount);
+    for (size_t i = 0; i < sizeof(documents) / sizeof(documents[0]); i++) {
+        const MiSnapProfile *profile = MiSnapProfileNamed(documents[i].name);
+        MiSnapCheck(profile != NULL && profile == MiSnapProfileForKind(documents[i].kind));
+        if (profile == NULL) {
+            continue;
+        }
+        MiSnapCheck(profile->kind == documents[i].kind && strcmp(profile->name, documents[i].name) == 0);
+        MiSnapCheck(profile->set == 0);
+        for (int field = 0; field < MiSnapProfileFieldCount; field++) {
+            const MiSnapProfileFieldRange *range = MiSnapProfileFieldRangeOf(field);
+            MiSnapCheck(profile->values[field] >= range->min && profile->values[field] <= range->max);
+        }
+        MiSnapCheck(MiSnapProfileValue(profile, MiSnapProfileFieldTimeout) == documents[i].timeout);
+        MiSnapCheck(MiSnapProfileValue(profile, MiSnapProfileFieldTorchMode) == documents[i].torchMode);
+        MiSnapCheck(MiSnapProfileConsistent(profile));
+        MiSnapCheck(MiSnapProfileIsDriversLicense(profile) == (documents[i].kind == MiSnapDocumentKindDriversLicense));
+
+        MiSnapFrameThresholds thresholds = MiSnapProfileThresholds(profile);
+        MiSnapCheck(thresholds.minBrightness == 400 && thresholds.maxBrightness == 700);
+        MiSnapCheck(thresholds.sharpness == documents[i].sharpness && thresholds.angle == 150);
+    }
+    MiSnapCheck(MiSnapProfileNamed("checkfront") == NULL);
+    MiSnapCheck(MiSnapProfileNamed("") == NULL);
+    MiSnapCheck(MiSnapProfileNamed(NULL) == NULL);
+    MiSnapCheck(MiSnapProfileForKind(MiSnapDocumentKindCount) == NULL);
+    MiSnapCheck(MiSnapProfileForKind((MiSnapDocumentKind)-1) == NULL);
+}
+
+//Every field is found by its web layer name and nothing else is
+static void MiSnapTestFieldNames(void)
+{
+    for (int field = 0; field < MiSnapProfileFieldCount; field++) {
+        MiSnapCheck(MiSnapProfileFieldNamed(MiSnapProfileFieldRangeOf(field)->name) == (MiSnapProfileField)field);
+    }
+    MiSnapCheck(MiSnapProfileFieldNamed("sharpness") == MiSnapProfileFieldSharpness);
+    MiSnapCheck(MiSnapProfileFieldNamed("Sharpness") == MiSnapProfileFieldCount);
+    MiSnapCheck(MiSnapProfileFieldNamed("documentType") == MiSnapProfileFieldCount);
+    MiSnapCheck(MiSnapProfileFieldNamed(NULL) == MiSnapProfileFieldCount);
+    MiSnapCheck(MiSnapProfileFieldRangeOf(MiSnapProfileFieldCount) == NULL);
+}
+
+//Both ends of every range are accepted and the values just outside them are not; a rejected
+//value leaves the profile as it was
+static void MiSnapTestRanges(void)
+{
+    for (int field = 0; field < MiSnapProfileFieldCount; field++) {
+        const MiSnapProfileFieldRange *range = MiSnapProfileFieldRangeOf(field);
+        MiSnapProfile profile = *MiSnapProfileForKind(MiSnapDocumentKindCheckFront);
+        MiSnapProfile before = profile;
+        MiSnapCheck(!MiSnapProfileSetValue(&profile, field, range->min - 1));
+        MiSnapCheck(!MiSnapProfileSetValue(&profile, field, range->max + 1));
+        MiSnapCheck(MiSnapProfileEqual(&profile, &before));
+
+        MiSnapCheck(MiSnapProfileSetValue(&profile, field, range->min));
+        MiSnapCheck(MiSnapProfileValue(&profile, field) == range->min);
+        MiSnapCheck(MiSnapProfileSetValue(&profile, field, range->max));
+        MiSnapCheck(MiSnapProfileValue(&profile, field) == range->max);
+    }
+    MiSnapProfile profile = *MiSnapProfileForKind(MiSnapDocumentKindCheckFront);
+    MiSnapCheck(!MiSnapProfileSetValue(&profile, MiSnapProfileFieldCount, 1));
+    MiSnapCheck(profile.set == 0);
+}
+
+//What a web layer value can be besides a whole number: a fraction, NaN or an infinity
+static void MiSnapTestTypes(void)
+{
+    const double rejected[] = { 600.5, -0.25, NAN, INFINITY, -INFINITY, 1e300 };
+    for (size_t i = 0; i < sizeof(rejected) / sizeof(rejected[0]); i++) {
+        MiSnapProfile profile = *MiSnapProfileForKind(MiSnapDocumentKindCheckFront);
+        MiSnapCheck(!MiSnapProfileSetValue(&profile, MiSnapProfileFieldSharpness, rejected[i]));
+        MiSnapCheck(profile.set == 0 && MiSnapProfileValue(&profile, MiSnapProfileFieldSharpness) == 600);
+    }
+    MiSnapProfile profile = *MiSnapProfileForKind(MiSnapDocumentKindCheckFront);
+    MiSnapCheck(MiSnapProfileSetValue(&profile, MiSnapProfileFieldSharpness, 700.0));
+    MiSnapCheck(MiSnapProfileValue(&profile, MiSnapProfileFieldSharpness) == 700);
+}
+
+//Only the fields given are marked, a value equal to the default included, and the mark makes
+//an otherwise equal profile different
+static void MiSnapTestOverrideMask(void)
+{
+    const MiSnapProfile *defaults = MiSnapProfileForKind(MiSnapDocumentKindCheckBack);
+    MiSnapProfile profile = *defaults;
+    MiSnapCheck(MiSnapProfileSetValue(&profile, MiSnapProfileFieldSharpness, 100));
+    MiSnapCheck(MiSnapProfileSetValue(&profile, MiSnapProfileFieldTorchMode, 2));
+    for (int field = 0; field < MiSnapProfileFieldCount; field++) {
+        bool given = field == MiSnapProfileFieldSharpness || field == MiSnapProfileFieldTorchMode;
+        MiSnapCheck(MiSnapProfileIsSet(&profile, field) == given);
+    }
+    MiSnapCheck(memcmp(profile.values, defaults->values, sizeof(profile.values)) != 0);
+
+    MiSnapProfile same = *defaults;
+    MiSnapCheck(MiSnapProfileSetValue(&same, MiSnapProfileFieldSharpness, 100));
+    MiSnapCheck(memcmp(same.values, defaults->values, sizeof(same.values)) == 0);
+    MiSnapCheck(!MiSnapProfileEqual(&same, defaults));
+    MiSnapCheck(MiSnapProfileEqual(defaults, MiSnapProfileForKind(MiSnapDocumentKindCheckBack)));
+    MiSnapCheck(!MiSnapProfileEqual(defaults, MiSnapProfileForKind(MiSnapDocumentKindCheckFront)));
+}
+
+//maxBrightness 0 turns the check off; the two timeouts are left to the SDK, so the default
+//timeout of 20 stays valid against the default initialTimeout of 30
+static void MiSnapTestConsistency(void)
+{
+    MiSnapProfile profile = *MiSnapProfileForKind(MiSnapDocumentKindCheckFront);
+    MiSnapCheck(MiSnapProfileSetValue(&profile, MiSnapProfileFieldMaxBrightness, 300));
+    MiSnapCheck(!MiSnapProfileConsistent(&profile));
+    MiSnapCheck(MiSnapProfileSetValue(&profile, MiSnapProfileFieldMaxBrightness, 0));
+    MiSnapCheck(MiSnapProfileConsistent(&profile));
+    MiSnapCheck(MiSnapProfileSetValue(&profile, MiSnapProfileFieldMaxBrightness, 400));
+    MiSnapCheck(MiSnapProfileConsistent(&profile));
+
+    profile = *MiSnapProfileForKind(MiSnapDocumentKindCheckFront);
+    MiSnapCheck(MiSnapProfileSetValue(&profile, MiSnapProfileFieldTimeout, 20));
+    MiSnapCheck(MiSnapProfileConsistent(&profile));
+    MiSnapCheck(MiSnapProfileSetValue(&profile, MiSnapProfileFieldInitialTimeout, 90));
+    MiSnapCheck(MiSnapProfileSetValue(&profile, MiSnapProfileFieldTimeout, 15));
+    MiSnapCheck(MiSnapProfileConsistent(&profile));
+}
+
+int main(void)
+{
+    MiSnapTestDefaults();
+    MiSnapTestFieldNames();
+    MiSnapTestRanges();
+    MiSnapTestTypes();
+    MiSnapTestOverrideMask();
+    MiSnapTestConsistency();
+    return MiSnapTestResult();
+}
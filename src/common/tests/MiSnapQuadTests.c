@@ -0,0 +1,121 @@
+
+#include "MiSnapQuadCore.h"
+#include "MiSnapFrameScoreCore.h"
+#include "MiSnapTests.h"
+
+//Renders a document of dw x dh centred on (cx, cy) and rotated by degrees, with lines of text on
+//it and sensor noise, 4x4 supersampled so its edges are as soft as a camera's. The corners it is
+//labelled with are returned in the detector's order.
+static void MiSnapTestRender(uint8_t *luma, int width, int height, float cx, float cy, float dw, float dh, float degrees, int background, int paper, MiSnapTestRandom *random, MiSnapQuadPoint *corners)
+{
+    float angle = degrees * (float)M_PI / 180, c = cosf(angle), s = sinf(angle);
+    const float px[4] = { -dw / 2, dw / 2, dw / 2, -dw / 2 }, py[4] = { -dh / 2, -dh / 2, dh / 2, dh / 2 };
+    for (int i = 0; i < 4; i++) {
+        corners[i].x = cx + px[i] * c - py[i] * s;
+        corners[i].y = cy + px[i] * s + py[i] * c;
+    }
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int inside = 0, text = 0;
+            for (int sy = 0; sy < 4; sy++) {
+                for (int sx = 0; sx < 4; sx++) {
+                    float dx = x + (sx + 0.5f) / 4 - cx, dy = y + (sy + 0.5f) / 4 - cy;
+                    float u = dx * c + dy * s, v = -dx * s + dy * c;
+                    if (fabsf(u) < dw / 2 && fabsf(v) < dh / 2) {
+                        inside++;
+                        text += fabsf(v) < dh * 0.4f && fmodf(v + dh, dh / 8) < dh / 40 && fabsf(u) < dw * 0.425f;
+                    }
+                }
+            }
+            float value = background + (paper - background) * (inside - 0.6f * text) / 16.0f;
+            value += (int)(MiSnapTestNext(random) % 25) - 12;
+            luma[y * width + x] = (uint8_t)MIN(MAX(value, 0), 255);
+        }
+    }
+}
+
+//Labelled frames at the 1080p and 540p analysis sizes, skewed from -8 to 8 degrees on dark and
+//mid-grey backgrounds. Corners must be found within 2 pixels (at 1080p scale) and the angle must be
+//the skew on the SDK's scale.
+static void MiSnapTestLabelledFrames(void)
+{
+    const int sizes[2][2] = { { 1920, 1080 }, { 960, 540 } };
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 1);
+    float worst = 0;
+    double totalMs = 0;
+    int frames = 0;
+    for (int size = 0; size < 2; size++) {
+        int width = sizes[size][0], height = sizes[size][1];
+        uint8_t *luma = malloc((size_t)width * height);
+        for (int trial = 0; trial < 12; trial++) {
+            float degrees = -8 + trial * 16.0f / 11;
+            float dw = width * (0.6f + 0.02f * (trial % 5)), dh = dw * 0.45f;
+            int background = trial % 3 == 0 ? 40 : 90, paper = trial % 3 == 2 ? 150 : 220;
+            MiSnapQuadPoint corners[4];
+            MiSnapTestRender(luma, width, height, width / 2 + (trial % 3 - 1) * width * 0.03f, height / 2 + (trial % 2) * height * 0.04f, dw, dh, degrees, background, paper, &random, corners);
+
+            MiSnapQuad quad;
+            double startMs = MiSnapTestNowMs();
+            bool found = MiSnapDetectQuad(luma, width, height, width, &quad);
+            totalMs += MiSnapTestNowMs() - startMs;
+            frames++;
+            MiSnapCheck(found && quad.found);
+            if (!found) {
+                continue;
+            }
+            float error = 0;
+            for (int i = 0; i < 4; i++) {
+                error = fmaxf(error, hypotf(quad.corners[i].x - corners[i].x, quad.corners[i].y - corners[i].y));
+            }
+            worst = fmaxf(worst, error * 1920 / width);
+            int angle = (int)lroundf(fabsf(tanf(degrees * (float)M_PI / 180)) * 1000);
+            MiSnapCheck(abs(quad.angle - angle) <= 3);
+            MiSnapCheck(quad.padding > 0);
+        }
+
+        for (int i = 0; i < width * height; i++) {
+            luma[i] = (uint8_t)(90 + MiSnapTestNext(&random) % 21);
+        }
+        MiSnapQuad quad;
+        MiSnapCheck(!MiSnapDetectQuad(luma, width, height, width, &quad) && !quad.found);
+        free(luma);
+    }
+    printf("worst corner error %.2f px, %.2f ms a frame\n", worst, totalMs / frames);
+    MiSnapCheck(worst < 2);
+}
+
+//Both luma extractions match the BT.601 weights used on the devices, across the vector body and
+//the scalar tail of each row
+static void MiSnapTestLuma(void)
+{
+    const size_t width = 1001, height = 7, rowBytes = width * 4 + 12, lumaRowBytes = width + 3;
+    uint8_t *pixels = malloc(rowBytes * height);
+    uint8_t *bgra = malloc(lumaRowBytes * height), *rgba = malloc(lumaRowBytes * height);
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 3);
+    for (size_t i = 0; i < rowBytes * height; i++) {
+        pixels[i] = (uint8_t)MiSnapTestNext(&random);
+    }
+    MiSnapExtractLuma(pixels, width, height, rowBytes, bgra, lumaRowBytes);
+    MiSnapExtractLumaRGBA(pixels, width, height, rowBytes, rgba, lumaRowBytes);
+    int mismatches = 0;
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            const uint8_t *p = pixels + y * rowBytes + x * 4;
+            mismatches += bgra[y * lumaRowBytes + x] != (29 * p[0] + 150 * p[1] + 77 * p[2] + 128) >> 8;
+            mismatches += rgba[y * lumaRowBytes + x] != (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+        }
+    }
+    MiSnapCheck(mismatches == 0);
+    free(rgba);
+    free(bgra);
+    free(pixels);
+}
+
+int main(void)
+{
+    MiSnapTestLabelledFrames();
+    MiSnapTestLuma();
+    return MiSnapTestResult();
+}
@@ -0,0 +1,99 @@
+
+#include "MiSnapSessions.h"
+#include "MiSnapTests.h"
+
+static bool MiSnapTestIs(const char *key, const char *expected)
+{
+    return key != NULL && strcmp(key, expected) == 0;
+}
+
+//Admission under each policy, with two sessions allowed to wait and one to finish
+static void MiSnapTestAdmission(void)
+{
+    MiSnapSessionTable table;
+    MiSnapSessionTableInit(&table, 2, 1);
+    char preempted[kMiSnapSessionKeyBytes];
+    MiSnapSessionTiming timing;
+
+    MiSnapCheck(MiSnapSessionAdmit(&table, "a", MiSnapSessionPolicyQueue, 0, preempted) == MiSnapSessionAdmitStarted);
+    MiSnapCheck(MiSnapSessionAdmit(&table, "a", MiSnapSessionPolicyQueue, 0, preempted) == MiSnapSessionAdmitDuplicate);
+    MiSnapCheck(MiSnapSessionAdmit(&table, "b", MiSnapSessionPolicyReject, 1, preempted) == MiSnapSessionAdmitBusy);
+    MiSnapCheck(MiSnapSessionAdmit(&table, "b", MiSnapSessionPolicyQueue, 1, preempted) == MiSnapSessionAdmitQueued);
+    MiSnapCheck(MiSnapSessionAdmit(&table, "c", MiSnapSessionPolicyQueue, 2, preempted) == MiSnapSessionAdmitQueued);
+    MiSnapCheck(MiSnapSessionAdmit(&table, "d", MiSnapSessionPolicyQueue, 2, preempted) == MiSnapSessionAdmitFull);
+    MiSnapCheck(MiSnapTestIs(MiSnapSessionCapturing(&table)->key, "a"));
+
+    //The camera is busy, then a is finishing and takes the only finishing slot
+    MiSnapCheck(MiSnapSessionNext(&table, 3) == NULL);
+    MiSnapCheck(MiSnapSessionCaptured(&table, "a", 10));
+    MiSnapCheck(MiSnapSessionCapturing(&table) == NULL);
+    MiSnapCheck(MiSnapSessionNext(&table, 10) == NULL);
+    MiSnapCheck(MiSnapSessionFinish(&table, "a", 15, &timing));
+    MiSnapCheck(timing.queuedMs == 0 && timing.captureMs == 10 && timing.finishMs == 5 && timing.totalMs == 15);
+    MiSnapCheck(!MiSnapSessionFinish(&table, "a", 15, &timing));
+
+    //First come first served
+    MiSnapCheck(MiSnapTestIs(MiSnapSessionNext(&table, 15), "b"));
+
+    //Preemption ends b and leaves c queued
+    MiSnapCheck(MiSnapSessionAdmit(&table, "p", MiSnapSessionPolicyPreempt, 20, preempted) == MiSnapSessionAdmitPreempted);
+    MiSnapCheck(MiSnapTestIs(preempted, "b"));
+    MiSnapCheck(MiSnapSessionFind(&table, "b") == NULL);
+    MiSnapCheck(MiSnapTestIs(MiSnapSessionCapturing(&table)->key, "p"));
+    MiSnapCheck(MiSnapSessionGetTiming(&table, "c", 20, &timing) && timing.queuedMs == 18);
+    MiSnapCheck(MiSnapSessionFinish(&table, "p", 25, &timing) && timing.captureMs == 5);
+    MiSnapCheck(MiSnapTestIs(MiSnapSessionNext(&table, 25), "c"));
+
+    //Preempting a free camera just starts
+    MiSnapCheck(MiSnapSessionFinish(&table, "c", 30, &timing));
+    MiSnapCheck(MiSnapSessionAdmit(&table, "q", MiSnapSessionPolicyPreempt, 30, preempted) == MiSnapSessionAdmitStarted);
+
+    MiSnapCheck(table.statistics.admitted == 5);
+    MiSnapCheck(table.statistics.preempted == 1);
+    MiSnapCheck(table.statistics.rejected == 3);
+}
+
+//Capacity, key length and capture overlapping with up to maxFinishing deliveries
+static void MiSnapTestCapacity(void)
+{
+    MiSnapSessionTable table;
+    MiSnapSessionTableInit(&table, 32, 4);
+    char preempted[kMiSnapSessionKeyBytes];
+
+    char key[80];
+    memset(key, 'x', sizeof(key) - 1);
+    key[sizeof(key) - 1] = '\0';
+    MiSnapCheck(MiSnapSessionAdmit(&table, key, MiSnapSessionPolicyQueue, 0, preempted) == MiSnapSessionAdmitFull);
+
+    for (int i = 0; i < kMiSnapSessionCapacity; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        MiSnapCheck(MiSnapSessionAdmit(&table, key, MiSnapSessionPolicyQueue, 0, preempted) == (i == 0 ? MiSnapSessionAdmitStarted : MiSnapSessionAdmitQueued));
+    }
+    MiSnapCheck(MiSnapSessionAdmit(&table, "z", MiSnapSessionPolicyQueue, 0, preempted) == MiSnapSessionAdmitFull);
+
+    int started = 1;
+    for (int i = 0; i < 8; i++) {
+        const MiSnapSession *capturing = MiSnapSessionCapturing(&table);
+        if (capturing == NULL) {
+            break;
+        }
+        MiSnapSessionCaptured(&table, capturing->key, i);
+        if (MiSnapSessionNext(&table, i) != NULL) {
+            started++;
+        }
+    }
+    MiSnapCheck(started == 4);
+    MiSnapCheck(MiSnapSessionCount(&table, MiSnapSessionStateFinishing) == 4);
+    MiSnapCheck(MiSnapSessionCount(&table, MiSnapSessionStateQueued) == kMiSnapSessionCapacity - 4);
+
+    //A delivery frees a slot for the next capture
+    MiSnapCheck(MiSnapSessionFinish(&table, "k0", 10, NULL));
+    MiSnapCheck(MiSnapTestIs(MiSnapSessionNext(&table, 10), "k4"));
+}
+
+int main(void)
+{
+    MiSnapTestAdmission();
+    MiSnapTestCapacity();
+    return MiSnapTestResult();
+}
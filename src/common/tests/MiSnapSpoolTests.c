@@ -0,0 +1,423 @@
+
+#include "MiSnapSpoolCore.h"
+#include "MiSnapTests.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define kMiSnapTestSpoolPath "MiSnapSpoolTests.spool"
+#define kMiSnapTestRecords 200
+
+//Record n has a length and contents derived from n, so any record can be checked on its own
+static size_t MiSnapTestLength(uint64_t n)
+{
+    return (n * 7919) % 5000 + (n % 3 == 0 ? 0 : 1);
+}
+
+static void MiSnapTestPayload(uint64_t n, uint8_t *payload)
+{
+    for (size_t i = 0; i < MiSnapTestLength(n); i++) {
+        payload[i] = (uint8_t)(n * 31 + i * 7);
+    }
+}
+
+static bool MiSnapTestRecordIntact(MiSnapSpool *spool, uint64_t id)
+{
+    static uint8_t expected[5000];
+    size_t length;
+    MiSnapSpoolMap *map;
+    const uint8_t *bytes = MiSnapSpoolRead(spool, id, &length, &map);
+    if (bytes == NULL) {
+        return false;
+    }
+    MiSnapTestPayload(id, expected);
+    bool intact = length == MiSnapTestLength(id) && memcmp(bytes, expected, length) == 0;
+    MiSnapSpoolMapRelease(map);
+    return intact;
+}
+
+static uint64_t MiSnapTestAppend(MiSnapSpool *spool, uint64_t n)
+{
+    static uint8_t payload[5000];
+    MiSnapTestPayload(n, payload);
+    size_t length = MiSnapTestLength(n);
+    const void *parts[2] = { payload, payload + length / 2 };
+    size_t lengths[2] = { length / 2, length - length / 2 };
+    return MiSnapSpoolAppend(spool, parts, lengths, 2);
+}
+
+//Exactly the live records can be read back, in id order
+static void MiSnapTestContents(MiSnapSpool *spool, const bool *live)
+{
+    size_t count;
+    const MiSnapSpoolEntry *entries = MiSnapSpoolEntries(spool, &count);
+    size_t next = 0;
+    for (uint64_t id = 1; id <= kMiSnapTestRecords; id++) {
+        if (live[id]) {
+            MiSnapCheck(MiSnapTestRecordIntact(spool, id));
+            MiSnapCheck(next < count && entries[next].id == id && entries[next].length == MiSnapTestLength(id));
+            next++;
+        } else {
+            size_t length;
+            MiSnapSpoolMap *map;
+            MiSnapCheck(MiSnapSpoolRead(spool, id, &length, &map) == NULL);
+        }
+    }
+    MiSnapCheck(next == count);
+}
+
+static uint8_t *MiSnapTestReadFile(off_t *size)
+{
+    struct stat status;
+    stat(kMiSnapTestSpoolPath, &status);
+    *size = status.st_size;
+    uint8_t *bytes = malloc((size_t)status.st_size);
+    int fd = open(kMiSnapTestSpoolPath, O_RDONLY);
+    MiSnapCheck(pread(fd, bytes, (size_t)status.st_size, 0) == status.st_size);
+    close(fd);
+    return bytes;
+}
+
+static void MiSnapTestWriteFile(const uint8_t *bytes, off_t size)
+{
+    int fd = open(kMiSnapTestSpoolPath, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    MiSnapCheck(pwrite(fd, bytes, (size_t)size, 0) == size);
+    close(fd);
+}
+
+//Appends and deletes, with a mapping held across appends and past the close, then reopens
+static void MiSnapTestRoundTrip(bool *live)
+{
+    unlink(kMiSnapTestSpoolPath);
+    MiSnapSpool *spool = MiSnapSpoolOpen(kMiSnapTestSpoolPath);
+    MiSnapCheck(spool != NULL);
+
+    size_t heldLength = 0;
+    MiSnapSpoolMap *heldMap = NULL;
+    const uint8_t *held = NULL;
+    for (uint64_t n = 1; n <= kMiSnapTestRecords; n++) {
+        MiSnapCheck(MiSnapTestAppend(spool, n) == n);
+        live[n] = true;
+        if (n == 5) {
+            held = MiSnapSpoolRead(spool, 5, &heldLength, &heldMap);
+        }
+        if (n % 4 == 0) {
+            MiSnapCheck(MiSnapSpoolDelete(spool, n - 1));
+            live[n - 1] = false;
+        }
+    }
+    MiSnapCheck(!MiSnapSpoolDelete(spool, 3));
+    MiSnapCheck(!MiSnapSpoolDelete(spool, kMiSnapTestRecords + 1));
+    MiSnapTestContents(spool, live);
+    MiSnapSpoolClose(spool);
+
+    uint8_t expected[5000];
+    MiSnapTestPayload(5, expected);
+    MiSnapCheck(held != NULL && heldLength == MiSnapTestLength(5) && memcmp(held, expected, heldLength) == 0);
+    MiSnapSpoolMapRelease(heldMap);
+
+    spool = MiSnapSpoolOpen(kMiSnapTestSpoolPath);
+    MiSnapTestContents(spool, live);
+    MiSnapSpoolClose(spool);
+}
+
+//A flipped payload bit fails the CRC of the last record, which is dropped; the rest survive
+static void MiSnapTestCRC(const bool *live)
+{
+    off_t size;
+    uint8_t *bytes = MiSnapTestReadFile(&size);
+
+    MiSnapSpool *spool = MiSnapSpoolOpen(kMiSnapTestSpoolPath);
+    uint64_t id = MiSnapTestAppend(spool, 1);
+    MiSnapSpoolClose(spool);
+    off_t corrupted;
+    uint8_t *appended = MiSnapTestReadFile(&corrupted);
+    appended[size + 40] ^= 0x10;
+    MiSnapTestWriteFile(appended, corrupted);
+
+    spool = MiSnapSpoolOpen(kMiSnapTestSpoolPath);
+    MiSnapCheck(spool != NULL);
+    size_t length;
+    MiSnapSpoolMap *map;
+    MiSnapCheck(MiSnapSpoolRead(spool, id, &length, &map) == NULL);
+    MiSnapTestContents(spool, live);
+    MiSnapSpoolClose(spool);
+
+    struct stat status;
+    stat(kMiSnapTestSpoolPath, &status);
+    MiSnapCheck(status.st_size == size);
+
+    free(appended);
+    free(bytes);
+}
+
+//Cuts the file anywhere, with junk after the cut or a corrupted byte before it, as a crash could
+//leave it. Whatever is recovered must read back intact and the spool must take appends again.
+static void MiSnapTestRecovery(void)
+{
+    off_t size;
+    uint8_t *original = MiSnapTestReadFile(&size);
+    MiSnapTestRandom random;
+    MiSnapTestRandomInit(&random, 1);
+
+    for (int trial = 0; trial < 300; trial++) {
+        off_t cut = 16 + (off_t)(MiSnapTestNext(&random) % (uint32_t)(size - 16));
+        uint8_t *bytes = malloc((size_t)cut + 64);
+        memcpy(bytes, original, (size_t)cut);
+        off_t length = cut;
+        if (trial % 2 == 1) {
+            for (int i = 0; i < 64; i++) {
+                bytes[length++] = (uint8_t)MiSnapTestNext(&random);
+            }
+        }
+        if (trial % 3 == 0 && cut > 200) {
+            bytes[cut - 100] ^= 0x40;
+        }
+        MiSnapTestWriteFile(bytes, length);
+        free(bytes);
+
+        MiSnapSpool *spool = MiSnapSpoolOpen(kMiSnapTestSpoolPath);
+        MiSnapCheck(spool != NULL);
+        if (spool == NULL) {
+            continue;
+        }
+        size_t count;
+        const MiSnapSpoolEntry *entries = MiSnapSpoolEntries(spool, &count);
+        for (size_t i = 0; i < count; i++) {
+            MiSnapCheck(MiSnapTestRecordIntact(spool, entries[i].id));
+        }
+
+        uint64_t id = MiSnapTestAppend(spool, 7);
+        MiSnapCheck(id != 0);
+        MiSnapSpoolClose(spool);
+        spool = MiSnapSpoolOpen(kMiSnapTestSpoolPath);
+        size_t readLength;
+        MiSnapSpoolMap *map;
+        const uint8_t *read = MiSnapSpoolRead(spool, id, &readLength, &map);
+        MiSnapCheck(read != NULL && readLength == MiSnapTestLength(7));
+        MiSnapSpoolMapRelease(map);
+        MiSnapSpoolClose(spool);
+    }
+    free(original);
+}
+
+//A spool opened mostly dead is compacted down to its live records
+static void MiSnapTestCompaction(void)
+{
+    unlink(kMiSnapTestSpoolPath);
+    MiSnapSpool *spool = MiSnapSpoolOpen(kMiSnapTestSpoolPath);
+    size_t length = 1 << 20;
+    uint8_t *big = malloc(length);
+    memset(big, 7, length);
+    const void *parts[1] = { big };
+    for (int i = 0; i < 10; i++) {
+        MiSnapSpoolAppend(spool, parts, &length, 1);
+    }
+    for (uint64_t id = 1; id <= 8; id++) {
+        MiSnapSpoolDelete(spool, id);
+    }
+    MiSnapSpoolClose(spool);
+
+    struct stat before, after;
+    stat(kMiSnapTestSpoolPath, &before);
+    spool = MiSnapSpoolOpen(kMiSnapTestSpoolPath);
+    stat(kMiSnapTestSpoolPath, &after);
+    MiSnapCheck(after.st_size < before.st_size / 4);
+
+    size_t count;
+    MiSnapSpoolEntries(spool, &count);
+    MiSnapCheck(count == 2);
+    for (uint64_t id = 9; id <= 10; id++) {
+        size_t readLength;
+        MiSnapSpoolMap *map;
+        const uint8_t *read = MiSnapSpoolRead(spool, id, &readLength, &map);
+        MiSnapCheck(read != NULL && readLength == length && read[0] == 7 && read[length - 1] == 7);
+        MiSnapSpoolMapRelease(map);
+    }
+    MiSnapSpoolClose(spool);
+    free(big);
+}
+
+//Ids are never handed out twice, even once compaction has dropped the records that carried them,
+//so a handle kept by the web layer cannot come to name another capture
+static void MiSnapTestIdsNotReused(void)
+{
+    unlink(kMiSnapTestSpoolPath);
+    MiSnapSpool *spool = MiSnapSpoolOpen(kMiSnapTestSpoolPath);
+    size_t length = 1 << 20;
+    uint8_t *big = calloc(1, length);
+    const void *parts[1] = { big };
+    for (int i = 0; i < 10; i++) {
+        MiSnapSpoolAppend(spool, parts, &length, 1);
+    }
+    for (uint64_t id = 1; id <= 10; id++) {
+        MiSnapSpoolDelete(spool, id);
+    }
+    MiSnapSpoolClose(spool);
+
+    //Reopening compacts the spool down to its header
+    spool = MiSnapSpoolOpen(kMiSnapTestSpoolPath);
+    MiSnapSpoolClose(spool);
+    struct stat status;
+    stat(kMiSnapTestSpoolPath, &status);
+    MiSnapCheck(status.st_size <= 64);
+
+    spool = MiSnapSpoolOpen(kMiSnapTestSpoolPath);
+    MiSnapCheck(MiSnapTestAppend(spool, 1) == 11);
+    MiSnapCheck(MiSnapSpoolDelete(spool, 11));
+    MiSnapSpoolClose(spool);
+    spool = MiSnapSpoolOpen(kMiSnapTestSpoolPath);
+    MiSnapCheck(MiSnapTestAppend(spool, 2) == 12);
+    MiSnapSpoolClose(spool);
+    free(big);
+}
+
+//Requests at, around and past the end of a payload, with lengths below, within and above the
+//chunk bounds
+static void MiSnapTestChunkRange(void)
+{
+    const size_t total = 1000000;
+    MiSnapSpoolChunk chunk = MiSnapSpoolChunkRange(total, 0, 0);
+    MiSnapCheck(chunk.offset == 0 && chunk.length == kMiSnapSpoolDefaultChunkBytes);
+    chunk = MiSnapSpoolChunkRange(total, -5, -1);
+    MiSnapCheck(chunk.offset == 0 && chunk.length == kMiSnapSpoolDefaultChunkBytes);
+    chunk = MiSnapSpoolChunkRange(total, 100, 1);
+    MiSnapCheck(chunk.offset == 100 && chunk.length == kMiSnapSpoolMinChunkBytes);
+    chunk = MiSnapSpoolChunkRange(total, 100, 20000);
+    MiSnapCheck(chunk.offset == 100 && chunk.length == 20000);
+    chunk = MiSnapSpoolChunkRange(8 * kMiSnapSpoolMaxChunkBytes, 0, INT64_MAX);
+    MiSnapCheck(chunk.offset == 0 && chunk.length == kMiSnapSpoolMaxChunkBytes);
+
+    //The last piece is short, and at or past the end nothing is read and the offset is the end
+    chunk = MiSnapSpoolChunkRange(total, total - 10, 20000);
+    MiSnapCheck(chunk.offset == total - 10 && chunk.length == 10);
+    chunk = MiSnapSpoolChunkRange(total, total - 1, 20000);
+    MiSnapCheck(chunk.offset == total - 1 && chunk.length == 1);
+    chunk = MiSnapSpoolChunkRange(total, total, 20000);
+    MiSnapCheck(chunk.offset == total && chunk.length == 0);
+    chunk = MiSnapSpoolChunkRange(total, total + 1, 20000);
+    MiSnapCheck(chunk.offset == total && chunk.length == 0);
+    chunk = MiSnapSpoolChunkRange(total, INT64_MAX, INT64_MAX);
+    MiSnapCheck(chunk.offset == total && chunk.length == 0);
+    chunk = MiSnapSpoolChunkRange(0, 0, 0);
+    MiSnapCheck(chunk.offset == 0 && chunk.length == 0);
+}
+
+//Resident anonymous memory in bytes: a copy of a record into the heap shows here, the spool's
+//file mapping does not. 0 where it cannot be read.
+static size_t MiSnapTestAnonymousBytes(void)
+{
+    size_t kilobytes = 0;
+#if defined(__linux__)
+    FILE *status = fopen("/proc/self/status", "r");
+    char line[128];
+    while (status != NULL && fgets(line, sizeof(line), status) != NULL) {
+        if (sscanf(line, "RssAnon: %zu kB", &kilobytes) == 1) {
+            break;
+        }
+    }
+    if (status != NULL) {
+        fclose(status);
+    }
+#endif
+    return kilobytes * 1024;
+}
+
+//Byte i of the large record, which is made of 1 MB parts each one byte further into the same
+//pattern, so a chunk read from the wrong part does not match
+static uint8_t MiSnapTestLargeByte(size_t i)
+{
+    size_t k = i % (1u << 20) + i / (1u << 20);
+    return (uint8_t)(k * 7 % 251);
+}
+
+//Streams a 32 MB record a default chunk at a time, the way readCaptureChunk hands it to the web
+//layer: the first chunk arrives long before the last, the heap never holds more than a chunk,
+//and requests at and past the end read nothing
+static void MiSnapTestChunkedRead(void)
+{
+    const size_t total = 32u << 20, piece = 1u << 20;
+    uint8_t *pattern = malloc(piece + 32);
+    uint8_t *chunkBytes = malloc(kMiSnapSpoolMaxChunkBytes);
+    for (size_t k = 0; k < piece + 32; k++) {
+        pattern[k] = (uint8_t)(k * 7 % 251);
+    }
+    const void *parts[32];
+    size_t lengths[32];
+    for (size_t p = 0; p < 32; p++) {
+        parts[p] = pattern + p;
+        lengths[p] = piece;
+    }
+    unlink(kMiSnapTestSpoolPath);
+    MiSnapSpool *spool = MiSnapSpoolOpen(kMiSnapTestSpoolPath);
+    uint64_t id = MiSnapSpoolAppend(spool, parts, lengths, 32);
+    MiSnapSpoolClose(spool);
+    MiSnapCheck(id != 0);
+
+    //Reopened, so the first read maps the file afresh
+    spool = MiSnapSpoolOpen(kMiSnapTestSpoolPath);
+    memset(chunkBytes, 0, kMiSnapSpoolMaxChunkBytes);
+    size_t baseline = MiSnapTestAnonymousBytes(), peak = baseline;
+    size_t offset = 0, delivered = 0, chunks = 0, largest = 0, wrong = 0;
+    double start = MiSnapTestNowMs(), firstChunkMs = 0;
+    for (;;) {
+        size_t length;
+        MiSnapSpoolMap *map;
+        const uint8_t *bytes = MiSnapSpoolRead(spool, id, &length, &map);
+        if (bytes == NULL) {
+            wrong++;
+            break;
+        }
+        MiSnapSpoolChunk chunk = MiSnapSpoolChunkRange(length, (int64_t)offset, 0);
+        memcpy(chunkBytes, bytes + chunk.offset, chunk.length);
+        MiSnapSpoolMapRelease(map);
+        if (chunks++ == 0) {
+            firstChunkMs = MiSnapTestNowMs() - start;
+        }
+        if (chunk.length == 0) {
+            MiSnapCheck(chunk.offset == total);
+            break;
+        }
+        for (size_t i = 0; i < chunk.length; i += 4093) {
+            wrong += chunkBytes[i] != MiSnapTestLargeByte(chunk.offset + i);
+        }
+        wrong += chunkBytes[chunk.length - 1] != MiSnapTestLargeByte(chunk.offset + chunk.length - 1);
+        offset += chunk.length;
+        delivered += chunk.length;
+        largest = MAX(largest, chunk.length);
+        peak = MAX(peak, MiSnapTestAnonymousBytes());
+    }
+    double totalMs = MiSnapTestNowMs() - start;
+    printf("32 MB in %zu chunks: first chunk after %.3f ms, all after %.3f ms, heap grew by %zu KB\n",
+           chunks - 1, firstChunkMs, totalMs, (peak - baseline) / 1024);
+    MiSnapCheck(wrong == 0);
+    MiSnapCheck(delivered == total && chunks == total / kMiSnapSpoolDefaultChunkBytes + 1);
+    MiSnapCheck(largest == kMiSnapSpoolDefaultChunkBytes);
+    MiSnapCheck(firstChunkMs * 8 < totalMs);
+    MiSnapCheck(peak - baseline < 2 * kMiSnapSpoolMaxChunkBytes);
+
+    //Past the end as well
+    size_t length;
+    MiSnapSpoolMap *map;
+    MiSnapCheck(MiSnapSpoolRead(spool, id, &length, &map) != NULL);
+    MiSnapSpoolChunk chunk = MiSnapSpoolChunkRange(length, (int64_t)total + 12345, kMiSnapSpoolMaxChunkBytes);
+    MiSnapCheck(chunk.offset == total && chunk.length == 0);
+    MiSnapSpoolMapRelease(map);
+    MiSnapSpoolClose(spool);
+    free(pattern);
+    free(chunkBytes);
+}
+
+int main(void)
+{
+    bool live[kMiSnapTestRecords + 1] = { false };
+    MiSnapTestRoundTrip(live);
+    MiSnapTestCRC(live);
+    MiSnapTestRecovery();
+    MiSnapTestCompaction();
+    MiSnapTestIdsNotReused();
+    MiSnapTestChunkRange();
+    MiSnapTestChunkedRead();
+    unlink(kMiSnapTestSpoolPath);
+    return MiSnapTestResult();
+}
@@ -0,0 +1,144 @@
+
+#include "MiSnapStartupCore.h"
+#include "MiSnapTests.h"
+
+//The timeline is driven with a fake clock that only moves when a test advances it
+static uint64_t MiSnapTestClockNs;
+
+static uint64_t MiSnapTestClock(void)
+{
+    return MiSnapTestClockNs;
+}
+
+static void MiSnapTestAdvanceMs(double ms)
+{
+    MiSnapTestClockNs += (uint64_t)(ms * 1e6);
+}
+
+static void MiSnapTestTimePhase(MiSnapStartupTimeline *timeline, MiSnapStartupPhase phase, double ms)
+{
+    MiSnapStartupBegin(timeline, phase);
+    MiSnapTestAdvanceMs(ms);
+    MiSnapStartupEnd(timeline, phase);
+}
+
+//Which events each state accepts, and where they lead
+static void MiSnapTestTransitions(void)
+{
+    static const struct {
+        MiSnapStartupState from;
+        MiSnapStartupEvent event;
+        bool accepted;
+        MiSnapStartupState to;
+    } cases[] = {
+        { MiSnapStartupStateCold, MiSnapStartupEventPrewarm, true, MiSnapStartupStateWarm },
+        { MiSnapStartupStateCold, MiSnapStartupEventPresent, true, MiSnapStartupStatePresenting },
+        { MiSnapStartupStateCold, MiSnapStartupEventPresentWarm, false, MiSnapStartupStateCold },
+        { MiSnapStartupStateCold, MiSnapStartupEventFirstFrame, false, MiSnapStartupStateCold },
+        { MiSnapStartupStateCold, MiSnapStartupEventFinish, true, MiSnapStartupStateCold },
+        { MiSnapStartupStateWarm, MiSnapStartupEventPrewarm, false, MiSnapStartupStateWarm },
+        { MiSnapStartupStateWarm, MiSnapStartupEventPresent, true, MiSnapStartupStatePresenting },
+        { MiSnapStartupStateWarm, MiSnapStartupEventPresentWarm, true, MiSnapStartupStatePresenting },
+        { MiSnapStartupStateWarm, MiSnapStartupEventFirstFrame, false, MiSnapStartupStateWarm },
+        { MiSnapStartupStateWarm, MiSnapStartupEventFinish, true, MiSnapStartupStateCold },
+        { MiSnapStartupStatePresenting, MiSnapStartupEventPrewarm, false, MiSnapStartupStatePresenting },
+        { MiSnapStartupStatePresenting, MiSnapStartupEventPresent, false, MiSnapStartupStatePresenting },
+        { MiSnapStartupStatePresenting, MiSnapStartupEventFirstFrame, true, MiSnapStartupStateCapturing },
+        { MiSnapStartupStatePresenting, MiSnapStartupEventFinish, true, MiSnapStartupStateCold },
+        { MiSnapStartupStateCapturing, MiSnapStartupEventPrewarm, false, MiSnapStartupStateCapturing },
+        { MiSnapStartupStateCapturing, MiSnapStartupEventFirstFrame, false, MiSnapStartupStateCapturing },
+        { MiSnapStartupStateCapturing, MiSnapStartupEventFinish, true, MiSnapStartupStateCold },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        MiSnapStartupTimeline timeline;
+        MiSnapStartupInit(&timeline, MiSnapTestClock);
+        timeline.state = cases[i].from;
+        bool accepted = MiSnapStartupHandle(&timeline, cases[i].event);
+        if (accepted != cases[i].accepted || timeline.state != cases[i].to) {
+            fprintf(stderr, "case %zu: state %d event %d: %s, now %d\n", i, cases[i].from, cases[i].event, accepted ? "accepted" : "refused", timeline.state);
+            MiSnapTestFailures++;
+        }
+    }
+}
+
+//A cold start: the user waits for every phase up to presenting
+static void MiSnapTestColdStart(void)
+{
+    MiSnapStartupTimeline timeline;
+    MiSnapStartupInit(&timeline, MiSnapTestClock);
+    MiSnapCheck(MiSnapStartupHandle(&timeline, MiSnapStartupEventPresent));
+    MiSnapCheck(MiSnapStartupMsSince(&timeline, MiSnapStartupPhasePresent) == -1);
+    MiSnapCheck(MiSnapStartupVisibleMs(&timeline) == -1);
+
+    MiSnapTestTimePhase(&timeline, MiSnapStartupPhaseParameters, 2);
+    MiSnapTestTimePhase(&timeline, MiSnapStartupPhaseController, 30);
+    MiSnapTestTimePhase(&timeline, MiSnapStartupPhaseSetup, 40);
+    MiSnapTestTimePhase(&timeline, MiSnapStartupPhaseView, 80);
+    MiSnapStartupBegin(&timeline, MiSnapStartupPhasePresent);
+    MiSnapStartupBegin(&timeline, MiSnapStartupPhaseFirstFrame);
+    MiSnapTestAdvanceMs(250);
+    MiSnapCheck(MiSnapStartupPhaseMs(&timeline, MiSnapStartupPhasePresent) == -1);
+    MiSnapCheck(MiSnapStartupMsSince(&timeline, MiSnapStartupPhasePresent) == 250);
+    MiSnapStartupEnd(&timeline, MiSnapStartupPhasePresent);
+    MiSnapTestAdvanceMs(100);
+    MiSnapCheck(MiSnapStartupHandle(&timeline, MiSnapStartupEventFirstFrame));
+    MiSnapStartupEnd(&timeline, MiSnapStartupPhaseFirstFrame);
+
+    MiSnapCheck(MiSnapStartupPhaseMs(&timeline, MiSnapStartupPhaseSetup) == 40);
+    MiSnapCheck(MiSnapStartupPhaseMs(&timeline, MiSnapStartupPhasePresent) == 250);
+    MiSnapCheck(MiSnapStartupPhaseMs(&timeline, MiSnapStartupPhaseFirstFrame) == 350);
+    MiSnapCheck(MiSnapStartupVisibleMs(&timeline) == 2 + 30 + 40 + 80 + 250);
+    MiSnapCheck(!timeline.prewarmed);
+
+    //Ending a phase twice keeps the first end
+    MiSnapTestAdvanceMs(10);
+    MiSnapStartupEnd(&timeline, MiSnapStartupPhaseFirstFrame);
+    MiSnapCheck(MiSnapStartupPhaseMs(&timeline, MiSnapStartupPhaseFirstFrame) == 350);
+}
+
+//A warm start: the phases timed by prewarm are kept, but the user only waits for presenting
+static void MiSnapTestWarmStart(void)
+{
+    MiSnapStartupTimeline timeline;
+    MiSnapStartupInit(&timeline, MiSnapTestClock);
+    MiSnapCheck(MiSnapStartupHandle(&timeline, MiSnapStartupEventPrewarm));
+    MiSnapTestTimePhase(&timeline, MiSnapStartupPhaseController, 30);
+    MiSnapTestTimePhase(&timeline, MiSnapStartupPhaseSetup, 40);
+    MiSnapTestAdvanceMs(5000);
+
+    MiSnapCheck(MiSnapStartupHandle(&timeline, MiSnapStartupEventPresentWarm));
+    MiSnapTestTimePhase(&timeline, MiSnapStartupPhasePresent, 120);
+    MiSnapCheck(timeline.prewarmed);
+    MiSnapCheck(MiSnapStartupPhaseMs(&timeline, MiSnapStartupPhaseSetup) == 40);
+    MiSnapCheck(MiSnapStartupVisibleMs(&timeline) == 120);
+
+    //A cold present after finishing starts over
+    MiSnapCheck(MiSnapStartupHandle(&timeline, MiSnapStartupEventFinish));
+    MiSnapCheck(MiSnapStartupHandle(&timeline, MiSnapStartupEventPresent));
+    MiSnapCheck(!timeline.prewarmed);
+    MiSnapCheck(MiSnapStartupPhaseMs(&timeline, MiSnapStartupPhaseSetup) == -1);
+    MiSnapCheck(MiSnapStartupMsSince(&timeline, MiSnapStartupPhasePresent) == -1);
+}
+
+//Without a clock the timeline reads the system's monotonic clock
+static void MiSnapTestDefaultClock(void)
+{
+    MiSnapStartupTimeline timeline;
+    MiSnapStartupInit(&timeline, NULL);
+    MiSnapStartupBegin(&timeline, MiSnapStartupPhaseParameters);
+    double start = MiSnapTestNowMs();
+    while (MiSnapTestNowMs() - start < 5) {
+    }
+    MiSnapStartupEnd(&timeline, MiSnapStartupPhaseParameters);
+    double ms = MiSnapStartupPhaseMs(&timeline, MiSnapStartupPhaseParameters);
+    MiSnapCheck(ms >= 5 && ms < 1000);
+}
+
+int main(void)
+{
+    MiSnapTestTransitions();
+    MiSnapTestColdStart();
+    MiSnapTestWarmStart();
+    MiSnapTestDefaultClock();
+    return MiSnapTestResult();
+}
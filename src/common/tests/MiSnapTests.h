@@ -0,0 +1,70 @@
+#ifndef MiSnapTests_h
+#define MiSnapTests_h
+
+#include "MiSnapCore.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//What the core's test programs share: checks that report their location and fail the program at
+//the end rather than at the first failure, and a seeded generator so every run sees the same
+//synthetic frames.
+
+static int MiSnapTestFailures;
+
+#define MiSnapCheck(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        MiSnapTestFailures++; \
+    } \
+} while (0)
+
+static inline int MiSnapTestResult(void)
+{
+    if (MiSnapTestFailures > 0) {
+        fprintf(stderr, "%d checks failed\n", MiSnapTestFailures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
+
+typedef struct {
+    uint64_t state;
+} MiSnapTestRandom;
+
+static inline void MiSnapTestRandomInit(MiSnapTestRandom *random, uint64_t seed)
+{
+    random->state = seed * 0x9E3779B97F4A7C15ull + 1;
+}
+
+static inline uint32_t MiSnapTestNext(MiSnapTestRandom *random)
+{
+    random->state ^= random->state << 13;
+    random->state ^= random->state >> 7;
+    random->state ^= random->state << 17;
+    return (uint32_t)(random->state >> 32);
+}
+
+//Uniform in [0, 1)
+static inline double MiSnapTestUniform(MiSnapTestRandom *random)
+{
+    return MiSnapTestNext(random) / 4294967296.0;
+}
+
+static inline double MiSnapTestGaussian(MiSnapTestRandom *random)
+{
+    double u = MiSnapTestUniform(random) + 1e-12, v = MiSnapTestUniform(random);
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static inline double MiSnapTestNowMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+#endif
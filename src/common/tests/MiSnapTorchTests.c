@@ -0,0 +1,198 @@
+
+#include "MiSnapProfileCore.h"
+#include "MiSnapTorchCore.h"
+#include "MiSnapTests.h"
+
+//Frame sequences through the auto-torch estimator. The scene is a flat frame whose luma is the
+//ambient light plus, while the torch the estimator asked for is on, the torch's own light, as a
+//camera would see it one frame after the decision.
+
+#define kMiSnapTestWidth 64
+#define kMiSnapTestHeight 48
+#define kMiSnapTestRowBytes 80
+#define kMiSnapTestMinBrightness 400
+
+//Ambient luma levels and what the torch adds to them
+#define kMiSnapTestDark 40
+#define kMiSnapTestDim 120
+#define kMiSnapTestBright 160
+#define kMiSnapTestDaylight 200
+#define kMiSnapTestTorchLight 80
+
+static bool MiSnapTestFeed(MiSnapTorchEstimator *estimator, int ambient)
+{
+    static uint8_t luma[kMiSnapTestRowBytes * kMiSnapTestHeight];
+    memset(luma, MIN(255, ambient + (estimator->torch ? kMiSnapTestTorchLight : 0)), sizeof(luma));
+    return MiSnapTorchUpdate(estimator, luma, kMiSnapTestWidth, kMiSnapTestHeight, kMiSnapTestRowBytes);
+}
+
+//Feeds frames until the torch switches, at most limit of them; returns the number fed, or 0 if
+//it did not switch
+static int MiSnapTestFeedUntilSwitch(MiSnapTorchEstimator *estimator, int ambient, int limit)
+{
+    uint64_t switches = estimator->switches;
+    for (int frame = 1; frame <= limit; frame++) {
+        MiSnapTestFeed(estimator, ambient);
+        if (estimator->switches != switches) {
+            return frame;
+        }
+    }
+    return 0;
+}
+
+static void MiSnapTestThresholds(void)
+{
+    MiSnapTorchEstimator estimator;
+    MiSnapTorchInit(&estimator, MiSnapTorchModeAuto, false, kMiSnapTestMinBrightness);
+    MiSnapCheck(estimator.onBrightness == kMiSnapTestMinBrightness);
+    MiSnapCheck(estimator.offBrightness == kMiSnapTestMinBrightness + 100 && kMiSnapTorchHysteresis == 100);
+    MiSnapCheck(kMiSnapTorchDwellFrames == 6 && kMiSnapTorchHoldFrames == 15);
+    MiSnapCheck(!estimator.torch && estimator.torchGain == -1);
+}
+
+//In the dark the torch comes on after the dwell, then measures its own light at the end of the
+//hold and does not switch itself back off however long the scene stays dark
+static void MiSnapTestOn(void)
+{
+    MiSnapTorchEstimator estimator;
+    MiSnapTorchInit(&estimator, MiSnapTorchModeAuto, false, kMiSnapTestMinBrightness);
+    MiSnapCheck(MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDark, 100) == kMiSnapTorchDwellFrames);
+    MiSnapCheck(estimator.torch && estimator.ambient < kMiSnapTestMinBrightness);
+    int ambientAtSwitch = estimator.ambient;
+
+    for (int frame = 1; frame <= kMiSnapTorchHoldFrames; frame++) {
+        MiSnapTestFeed(&estimator, kMiSnapTestDark);
+        MiSnapCheck(estimator.torchGain == (frame < kMiSnapTorchHoldFrames ? -1 : estimator.brightness - ambientAtSwitch));
+    }
+    MiSnapCheck(estimator.torchGain > 250);
+    MiSnapCheck(MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDark, 300) == 0);
+    MiSnapCheck(estimator.torch && estimator.switches == 1);
+    MiSnapCheck(abs(estimator.ambient - ambientAtSwitch) <= 10);
+}
+
+//Once the light comes back the torch goes off the dwell after its estimate, its own light taken
+//out, first rose past the off threshold
+static void MiSnapTestOff(void)
+{
+    MiSnapTorchEstimator estimator;
+    MiSnapTorchInit(&estimator, MiSnapTorchModeAuto, false, kMiSnapTestMinBrightness);
+    MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDark, 100);
+    MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDark, 60);
+    MiSnapCheck(estimator.torch && estimator.torchGain > 0);
+
+    int firstPast = 0, switched = 0;
+    for (int frame = 1; frame <= 100 && switched == 0; frame++) {
+        MiSnapTestFeed(&estimator, kMiSnapTestBright);
+        if (firstPast == 0 && estimator.ambient > estimator.offBrightness) {
+            firstPast = frame;
+        }
+        if (!estimator.torch) {
+            switched = frame;
+        }
+    }
+    MiSnapCheck(firstPast > 0 && switched == firstPast + kMiSnapTorchDwellFrames - 1);
+    MiSnapCheck(estimator.switches == 2);
+}
+
+//Within the hysteresis band the torch stays as it is: a dim scene just above the on threshold
+//does not turn it on, and the same scene does not turn it off once it is on
+static void MiSnapTestHysteresis(void)
+{
+    MiSnapTorchEstimator estimator;
+    MiSnapTorchInit(&estimator, MiSnapTorchModeAuto, false, kMiSnapTestMinBrightness);
+    MiSnapCheck(MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDim, 200) == 0);
+    MiSnapCheck(estimator.ambient >= estimator.onBrightness && estimator.ambient <= estimator.offBrightness);
+
+    MiSnapTorchInit(&estimator, MiSnapTorchModeAuto, false, kMiSnapTestMinBrightness);
+    MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDark, 100);
+    MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDark, 60);
+    MiSnapCheck(MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDim, 200) == 0);
+    MiSnapCheck(estimator.torch && estimator.ambient >= estimator.onBrightness && estimator.ambient <= estimator.offBrightness);
+}
+
+//Shadows passing over the document, each shorter than the dwell, never switch the torch however
+//often they dip the estimate under the on threshold; shadows one frame longer do
+static int MiSnapTestShadows(int shadowFrames, int *dips, int *longest)
+{
+    MiSnapTorchEstimator estimator;
+    MiSnapTorchInit(&estimator, MiSnapTorchModeAuto, false, kMiSnapTestMinBrightness);
+    int run = 0;
+    *dips = 0;
+    *longest = 0;
+    for (int frame = 0; frame < 600; frame++) {
+        MiSnapTestFeed(&estimator, frame % 8 < shadowFrames ? kMiSnapTestDark : kMiSnapTestDaylight);
+        run = estimator.ambient < estimator.onBrightness ? run + 1 : 0;
+        *dips += run == 1;
+        *longest = MAX(*longest, run);
+    }
+    return (int)estimator.switches;
+}
+
+static void MiSnapTestFlicker(void)
+{
+    int dips, longest;
+    MiSnapCheck(MiSnapTestShadows(4, &dips, &longest) == 0);
+    printf("flicker: %d dips under the on threshold, the longest %d frames\n", dips, longest);
+    MiSnapCheck(dips > 50 && longest == kMiSnapTorchDwellFrames - 1);
+    MiSnapCheck(MiSnapTestShadows(5, &dips, &longest) > 0);
+    MiSnapCheck(longest >= kMiSnapTorchDwellFrames);
+}
+
+//After a switch the torch holds: switched off in a bright scene that then goes dark, it comes back
+//on only once the hold and then the dwell are over
+static void MiSnapTestHold(void)
+{
+    MiSnapTorchEstimator estimator;
+    MiSnapTorchInit(&estimator, MiSnapTorchModeAuto, false, kMiSnapTestMinBrightness);
+    MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDark, 100);
+    MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDark, 60);
+    MiSnapCheck(MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestBright, 100) > 0);
+    MiSnapCheck(!estimator.torch);
+
+    int frames = MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDark, 100);
+    MiSnapCheck(frames == kMiSnapTorchHoldFrames + kMiSnapTorchDwellFrames - 1);
+    MiSnapCheck(estimator.torch && estimator.switches == 3);
+}
+
+//The torchMode settings: off and on never switch, AUTO leaves a driver's license alone and
+//AUTO+DL does not. AUTO+DL is the plugin's own mode 3, which the profiles reject, so it only
+//comes from the torchMode of replayFrames.
+static void MiSnapTestModes(void)
+{
+    MiSnapTorchEstimator estimator;
+    MiSnapTorchInit(&estimator, MiSnapTorchModeOff, false, kMiSnapTestMinBrightness);
+    MiSnapCheck(MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDark, 100) == 0 && !estimator.torch);
+    MiSnapTorchInit(&estimator, MiSnapTorchModeOn, false, kMiSnapTestMinBrightness);
+    MiSnapCheck(estimator.torch);
+    MiSnapCheck(MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDaylight, 100) == 0 && estimator.torch);
+
+    MiSnapTorchInit(&estimator, MiSnapTorchModeAuto, true, kMiSnapTestMinBrightness);
+    MiSnapCheck(MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDark, 100) == 0 && !estimator.torch);
+    MiSnapTorchInit(&estimator, MiSnapTorchModeAutoDriversLicense, true, kMiSnapTestMinBrightness);
+    MiSnapCheck(MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDark, 100) == kMiSnapTorchDwellFrames);
+    MiSnapTorchInit(&estimator, MiSnapTorchModeAutoDriversLicense, false, kMiSnapTestMinBrightness);
+    MiSnapCheck(MiSnapTestFeedUntilSwitch(&estimator, kMiSnapTestDark, 100) == kMiSnapTorchDwellFrames);
+
+    for (int kind = 0; kind < MiSnapDocumentKindCount; kind++) {
+        MiSnapProfile profile = *MiSnapProfileForKind(kind);
+        MiSnapCheck(MiSnapProfileValue(&profile, MiSnapProfileFieldTorchMode) <= MiSnapTorchModeOn);
+        MiSnapCheck(!MiSnapProfileSetValue(&profile, MiSnapProfileFieldTorchMode, MiSnapTorchModeAutoDriversLicense));
+    }
+
+    //An empty frame changes nothing
+    MiSnapTorchInit(&estimator, MiSnapTorchModeAuto, false, kMiSnapTestMinBrightness);
+    uint8_t pixel = 0;
+    MiSnapCheck(!MiSnapTorchUpdate(&estimator, &pixel, 0, 0, 0) && estimator.frames == 0);
+}
+
+int main(void)
+{
+    MiSnapTestThresholds();
+    MiSnapTestOn();
+    MiSnapTestOff();
+    MiSnapTestHysteresis();
+    MiSnapTestFlicker();
+    MiSnapTestHold();
+    MiSnapTestModes();
+    return MiSnapTestResult();
+}
@@ -0,0 +1,47 @@
+
+#ifndef MiSnapTestJNI_h
+#define MiSnapTestJNI_h
+
+//The part of jni.h that src/android/jni/MiSnapNative.c uses, for hosts without a JDK. Types and
+//member names are those of the JDK's header, so MiSnapNativeTests builds its JNIEnv the same way
+//against either; the table holds only these functions and is not binary compatible with a JVM.
+
+#include <stdint.h>
+
+typedef uint8_t jboolean;
+typedef int32_t jint;
+typedef int64_t jlong;
+typedef jint jsize;
+
+struct _jobject;
+typedef struct _jobject *jobject;
+typedef jobject jclass;
+typedef jobject jstring;
+typedef jobject jarray;
+typedef jarray jintArray;
+typedef jarray jlongArray;
+
+#define JNI_FALSE 0
+#define JNI_TRUE 1
+
+#define JNIEXPORT
+#define JNICALL
+
+struct JNINativeInterface_;
+typedef const struct JNINativeInterface_ *JNIEnv;
+
+struct JNINativeInterface_ {
+    jclass (JNICALL *FindClass)(JNIEnv *env, const char *name);
+    jint (JNICALL *ThrowNew)(JNIEnv *env, jclass clazz, const char *msg);
+    const char *(JNICALL *GetStringUTFChars)(JNIEnv *env, jstring str, jboolean *isCopy);
+    void (JNICALL *ReleaseStringUTFChars)(JNIEnv *env, jstring str, const char *chars);
+    jintArray (JNICALL *NewIntArray)(JNIEnv *env, jsize len);
+    jlongArray (JNICALL *NewLongArray)(JNIEnv *env, jsize len);
+    void (JNICALL *SetIntArrayRegion)(JNIEnv *env, jintArray array, jsize start, jsize len, const jint *buf);
+    void (JNICALL *SetLongArrayRegion)(JNIEnv *env, jlongArray array, jsize start, jsize len, const jlong *buf);
+    jobject (JNICALL *NewDirectByteBuffer)(JNIEnv *env, void *address, jlong capacity);
+    void *(JNICALL *GetDirectBufferAddress)(JNIEnv *env, jobject buf);
+    jlong (JNICALL *GetDirectBufferCapacity)(JNIEnv *env, jobject buf);
+};
+
+#endif
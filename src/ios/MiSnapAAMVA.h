@@ -0,0 +1,13 @@
+
+#import <Foundation/Foundation.h>
+
+#import "MiSnapAAMVACore.h"
+
+@interface MiSnapAAMVA : NSObject
+
+//{ documentType, version, issuer, familyName, firstName, middleName, dateOfBirth, licenseNumber,
+//street, street2, city, state, postalCode, expiry, issueDate, sex, country } with only the
+//fields present, dates as YYYY-MM-DD; nil if the payload is not AAMVA data
++ (NSDictionary *)fieldsFromPDF417String:(NSString *)payload;
+
+@end
@@ -0,0 +1,63 @@
+
+#import "MiSnapAAMVA.h"
+
+@implementation MiSnapAAMVA
+
++ (NSDictionary *)fieldsFromPDF417String:(NSString *)payload {
+    
+    if (![payload isKindOfClass:[NSString class]]) {
+        return nil;
+    }
+    const char *bytes = [payload UTF8String];
+    MiSnapAAMVARecord record;
+    if (bytes == NULL || !MiSnapAAMVAParse(bytes, strlen(bytes), &record)) {
+        return nil;
+    }
+    
+    static NSString *const fieldNames[MiSnapAAMVAFieldCount] = {
+        @"familyName", @"firstName", @"middleName", @"fullName", @"dateOfBirth", @"licenseNumber",
+        @"street", @"street2", @"city", @"state", @"postalCode", @"expiry", @"issueDate", @"sex", @"country"
+    };
+    NSMutableDictionary *fields = [NSMutableDictionary dictionary];
+    [fields setObject:[[NSString alloc] initWithBytes:record.subfileType.bytes length:record.subfileType.length encoding:NSUTF8StringEncoding] forKey:@"documentType"];
+    if (record.version > 0) {
+        [fields setObject:@(record.version) forKey:@"version"];
+        //The six bytes can split a multibyte character of a mangled header
+        NSString *issuer = [[NSString alloc] initWithBytes:record.issuer.bytes length:record.issuer.length encoding:NSUTF8StringEncoding];
+        if (issuer != nil) {
+            [fields setObject:issuer forKey:@"issuer"];
+        }
+    }
+    for (int field = 0; field < MiSnapAAMVAFieldCount; field++) {
+        const MiSnapSlice *slice = &record.fields[field];
+        if (slice->length == 0) {
+            continue;
+        }
+        char iso[11];
+        NSString *value;
+        if ((field == MiSnapAAMVAFieldDateOfBirth || field == MiSnapAAMVAFieldExpiry || field == MiSnapAAMVAFieldIssueDate) && MiSnapAAMVAFormatDate(&record, field, iso)) {
+            value = @(iso);
+        } else {
+            value = [[NSString alloc] initWithBytes:slice->bytes length:slice->length encoding:NSUTF8StringEncoding];
+        }
+        if (value != nil) {
+            [fields setObject:value forKey:fieldNames[field]];
+        }
+    }
+    
+    //Version 1 cards carry one "FAMILY,FIRST,MIDDLE" name
+    NSString *fullName = [fields objectForKey:@"fullName"];
+    if (fullName != nil && [fields objectForKey:@"familyName"] == nil) {
+        NSArray *names = [fullName componentsSeparatedByString:@","];
+        NSArray *keys = @[@"familyName", @"firstName", @"middleName"];
+        for (NSUInteger i = 0; i < MIN(names.count, keys.count); i++) {
+            NSString *name = [[names objectAtIndex:i] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+            if (name.length > 0 && [fields objectForKey:[keys objectAtIndex:i]] == nil) {
+                [fields setObject:name forKey:[keys objectAtIndex:i]];
+            }
+        }
+    }
+    return fields;
+}
+
+@end
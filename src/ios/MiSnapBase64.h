@@ -0,0 +1,10 @@
+
+#import <Foundation/Foundation.h>
+#import "MiSnapBase64Core.h"
+
+@interface MiSnapBase64 : NSObject
+
++ (NSData *)decodeString:(NSString *)string;
++ (NSString *)encodeData:(NSData *)data;
+
+@end
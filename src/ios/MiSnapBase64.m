@@ -0,0 +1,41 @@
+
+#import "MiSnapBase64.h"
+
+@implementation MiSnapBase64
+
++ (NSData *)decodeString:(NSString *)string {
+    
+    if (string == nil) {
+        return nil;
+    }
+    
+    //The SDK hands us ASCII strings, whose bytes can usually be read without a copy
+    const char *chars = CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingASCII);
+    size_t length = chars ? strlen(chars) : 0;
+    if (chars == NULL) {
+        chars = [string UTF8String];
+        length = strlen(chars);
+    }
+    
+    NSMutableData *data = [NSMutableData dataWithLength:MiSnapBase64DecodedLength(length)];
+    size_t written = MiSnapBase64DecodeBytes(chars, length, data.mutableBytes);
+    [data setLength:written];
+    return data;
+}
+
++ (NSString *)encodeData:(NSData *)data {
+    
+    if (data == nil) {
+        return nil;
+    }
+    
+    size_t capacity = MiSnapBase64EncodedLength(data.length);
+    char *chars = malloc(capacity);
+    if (chars == NULL) {
+        return nil;
+    }
+    size_t written = MiSnapBase64EncodeBytes(data.bytes, data.length, chars);
+    return [[NSString alloc] initWithBytesNoCopy:chars length:written encoding:NSASCIIStringEncoding freeWhenDone:YES];
+}
+
+@end
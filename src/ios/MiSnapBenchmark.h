@@ -0,0 +1,21 @@
+
+#import <Foundation/Foundation.h>
+
+//Times the capture kernels on a synthetic check frame at the video frame sizes of
+//kMiSnapCaptureMode 3 (720p), 4 (1080p) and 5 (hi-res photo): BGRA to luma conversion, scoring,
+//reading the MICR line, area-average scaling, JPEG encoding and fitting, base64 and the
+//serialization of a results dictionary. Needs no camera, so it runs on the simulator as well.
+//The report is plain JSON types, so reports from different releases and devices can be diffed.
+
+@interface MiSnapBenchmark : NSObject
+
+//Timed runs of each kernel per frame size, after one untimed warm-up run (default 10)
+@property(nonatomic,assign) NSUInteger iterations;
+//Names of the frame sizes to run ("720p", "1080p", "photo"), nil for all
+@property(nonatomic,copy) NSArray* sizes;
+
+//{ version, iterations, device: { ... }, sizes: [ { name, captureMode, width, height, kernels:
+//{ convert: { meanMs, minMs, p50Ms, p95Ms, maxMs }, ... } } ] }
+- (NSDictionary *)run;
+
+@end
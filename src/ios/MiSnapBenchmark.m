@@ -0,0 +1,215 @@
+
+#import "MiSnapBenchmark.h"
+#import "MiSnapFrameScorer.h"
+#import "MiSnapImageScaler.h"
+#import "MiSnapJPEGEncoder.h"
+#import "MiSnapBase64.h"
+#import "MiSnapMetrics.h"
+#import "MiSnapMICR.h"
+#import "MiSnapBenchmarkFrame.h"
+#import <UIKit/UIKit.h>
+#include <sys/sysctl.h>
+
+//Bumped whenever kernels are added or the synthetic frame changes, so reports are only compared
+//with reports of the same version
+static const NSInteger kMiSnapBenchmarkVersion = 3;
+static const NSUInteger kMiSnapBenchmarkMaxIterations = 1000;
+
+typedef struct {
+    const char *name;
+    int captureMode;
+    size_t width;
+    size_t height;
+} MiSnapBenchmarkSize;
+
+//Mode 5 is the hi-res mode of the iPhone 6, whose still photos are 8 megapixels
+static const MiSnapBenchmarkSize kMiSnapBenchmarkSizes[] = {
+    { "720p", 3, 1280, 720 },
+    { "1080p", 4, 1920, 1080 },
+    { "photo", 5, 3264, 2448 }
+};
+
+typedef enum {
+    MiSnapBenchmarkKernelConvert,
+    MiSnapBenchmarkKernelScore,
+    MiSnapBenchmarkKernelMICR,
+    MiSnapBenchmarkKernelScale,
+    MiSnapBenchmarkKernelEncode,
+    MiSnapBenchmarkKernelFit,
+    MiSnapBenchmarkKernelBase64Encode,
+    MiSnapBenchmarkKernelBase64Decode,
+    MiSnapBenchmarkKernelSerialize,
+    MiSnapBenchmarkKernelCount
+} MiSnapBenchmarkKernel;
+
+static NSString* const kKernelNames[MiSnapBenchmarkKernelCount] = {
+    @"convert", @"score", @"micr", @"scale", @"encode", @"fit", @"base64Encode", @"base64Decode", @"serialize"
+};
+
+static int MiSnapCompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+//Sorts samples in place
+static NSDictionary *MiSnapBenchmarkSummary(double *samples, size_t count)
+{
+    double total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += samples[i];
+    }
+    qsort(samples, count, sizeof(double), MiSnapCompareDoubles);
+    return @{ @"meanMs": @(total / count),
+              @"minMs": @(samples[0]),
+              @"p50Ms": @(samples[count / 2]),
+              @"p95Ms": @(samples[MIN(count - 1, count * 95 / 100)]),
+              @"maxMs": @(samples[count - 1]) };
+}
+
+static NSString *MiSnapBenchmarkMachine(void)
+{
+    char machine[64] = "";
+    size_t length = sizeof(machine);
+    if (sysctlbyname("hw.machine", machine, &length, NULL, 0) != 0) {
+        return @"unknown";
+    }
+    return [NSString stringWithUTF8String:machine];
+}
+
+@implementation MiSnapBenchmark
+
+- (instancetype)init {
+    
+    self = [super init];
+    if (self) {
+        _iterations = 10;
+    }
+    return self;
+}
+
+- (NSDictionary *)run {
+    
+    NSUInteger iterations = MIN(MAX(self.iterations, 1), kMiSnapBenchmarkMaxIterations);
+    NSMutableArray *sizes = [NSMutableArray array];
+    for (size_t i = 0; i < sizeof(kMiSnapBenchmarkSizes) / sizeof(kMiSnapBenchmarkSizes[0]); i++) {
+        const MiSnapBenchmarkSize *size = &kMiSnapBenchmarkSizes[i];
+        if (self.sizes != nil && ![self.sizes containsObject:@(size->name)]) {
+            continue;
+        }
+        @autoreleasepool {
+            NSDictionary *kernels = [self runSize:size iterations:iterations];
+            [sizes addObject:@{ @"name": @(size->name),
+                                @"captureMode": @(size->captureMode),
+                                @"width": @(size->width),
+                                @"height": @(size->height),
+                                @"kernels": kernels ?: @{ @"error": @"Out of memory" } }];
+        }
+    }
+    
+    UIDevice *device = [UIDevice currentDevice];
+    NSDictionary *deviceInfo = @{ @"machine": MiSnapBenchmarkMachine(),
+                                  @"system": [NSString stringWithFormat:@"%@ %@", device.systemName, device.systemVersion],
+                                  @"cores": @([[NSProcessInfo processInfo] activeProcessorCount]) };
+    return @{ @"version": @(kMiSnapBenchmarkVersion),
+              @"iterations": @(iterations),
+              @"device": deviceInfo,
+              @"sizes": sizes };
+}
+
+//Every kernel works on the output of the previous one, as in a capture: the luma plane is
+//scored, the MICR line is read from the check, the frame is scaled, encoded and fitted, and the
+//JPEG goes through base64 and into the results
+
+- (NSDictionary *)runSize:(const MiSnapBenchmarkSize *)size iterations:(NSUInteger)iterations {
+    
+    size_t width = size->width, height = size->height;
+    size_t rowBytes = width * 4;
+    size_t scaledWidth = width / 2, scaledHeight = height / 2;
+    uint8_t *bgra = malloc(rowBytes * height);
+    uint8_t *luma = malloc(width * height);
+    uint8_t *scaled = malloc(scaledWidth * 4 * scaledHeight);
+    double *samples = malloc(sizeof(double) * iterations * MiSnapBenchmarkKernelCount);
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = bgra ? CGBitmapContextCreate(bgra, width, height, 8, rowBytes, colorSpace, kCGImageAlphaNoneSkipFirst | kCGBitmapByteOrder32Little) : NULL;
+    CGColorSpaceRelease(colorSpace);
+    if (luma == NULL || scaled == NULL || samples == NULL || context == NULL) {
+        CGContextRelease(context);
+        free(bgra);
+        free(luma);
+        free(scaled);
+        free(samples);
+        return nil;
+    }
+    MiSnapBenchmarkRect check = MiSnapBenchmarkDrawFrame(bgra, width, height, rowBytes);
+    CGImageRef image = CGBitmapContextCreateImage(context);
+    
+    //The first run warms caches and lazily built tables and is overwritten by the second
+    for (NSUInteger i = 0; i <= iterations; i++) {
+        @autoreleasepool {
+            double *sample = samples + (i > 0 ? i - 1 : 0) * MiSnapBenchmarkKernelCount;
+        
+            uint64_t start = MiSnapMetricsNow();
+            MiSnapExtractLuma(bgra, width, height, rowBytes, luma, width);
+            sample[MiSnapBenchmarkKernelConvert] = MiSnapMetricsMsSince(start);
+        
+            start = MiSnapMetricsNow();
+            MiSnapFrameScore score;
+            MiSnapScoreLumaFrame(luma, width, height, width, &score);
+            sample[MiSnapBenchmarkKernelScore] = MiSnapMetricsMsSince(start);
+        
+            start = MiSnapMetricsNow();
+            MiSnapMICRLine micr;
+            MiSnapMICRRead(luma + check.top * width + check.left, check.width, check.height, width, &micr);
+            sample[MiSnapBenchmarkKernelMICR] = MiSnapMetricsMsSince(start);
+        
+            start = MiSnapMetricsNow();
+            MiSnapScaleImage(bgra, width, height, rowBytes, scaled, scaledWidth, scaledHeight, scaledWidth * 4, 4);
+            sample[MiSnapBenchmarkKernelScale] = MiSnapMetricsMsSince(start);
+        
+            start = MiSnapMetricsNow();
+            NSData *jpeg = [MiSnapJPEGEncoder JPEGDataFromImage:image quality:0.5 orientation:1 metadataFrom:nil];
+            sample[MiSnapBenchmarkKernelEncode] = MiSnapMetricsMsSince(start);
+        
+            //A budget the first probe cannot meet, so the search runs
+            start = MiSnapMetricsNow();
+            NSData *fitted = [MiSnapJPEGEncoder JPEGData:jpeg fittingBytes:jpeg.length / 2 report:NULL];
+            sample[MiSnapBenchmarkKernelFit] = MiSnapMetricsMsSince(start);
+        
+            start = MiSnapMetricsNow();
+            NSString *encoded = [MiSnapBase64 encodeData:fitted];
+            sample[MiSnapBenchmarkKernelBase64Encode] = MiSnapMetricsMsSince(start);
+        
+            start = MiSnapMetricsNow();
+            NSData *decoded = [MiSnapBase64 decodeString:encoded];
+            sample[MiSnapBenchmarkKernelBase64Decode] = MiSnapMetricsMsSince(start);
+        
+            //The results of a text capture, which carry the encoded image
+            start = MiSnapMetricsNow();
+            NSDictionary *results = @{ @"EncodedImage": encoded,
+                                       @"bytes": @(decoded.length),
+                                       @"frameScore": [MiSnapFrameScorer dictionaryFromScore:score] };
+            [NSJSONSerialization dataWithJSONObject:results options:0 error:NULL];
+            sample[MiSnapBenchmarkKernelSerialize] = MiSnapMetricsMsSince(start);
+        }
+    }
+    CGImageRelease(image);
+    CGContextRelease(context);
+    free(bgra);
+    free(luma);
+    free(scaled);
+    
+    NSMutableDictionary *kernels = [NSMutableDictionary dictionary];
+    double *kernelSamples = malloc(sizeof(double) * iterations);
+    for (int k = 0; k < MiSnapBenchmarkKernelCount && kernelSamples; k++) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            kernelSamples[i] = samples[i * MiSnapBenchmarkKernelCount + k];
+        }
+        [kernels setObject:MiSnapBenchmarkSummary(kernelSamples, iterations) forKey:kKernelNames[k]];
+    }
+    free(kernelSamples);
+    free(samples);
+    return kernels;
+}
+
+@end
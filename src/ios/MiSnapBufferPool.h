@@ -0,0 +1,6 @@
+
+#import <Foundation/Foundation.h>
+#import "MiSnapBufferPoolCore.h"
+
+//{ hits, misses, trimmed, hitRate, inUseBytes, idleBytes, peakBytes, highWaterBytes }
+NSDictionary *MiSnapBufferPoolDictionary(MiSnapBufferPool *pool, bool reset);
@@ -0,0 +1,16 @@
+#import "MiSnapBufferPool.h"
+
+NSDictionary *MiSnapBufferPoolDictionary(MiSnapBufferPool *pool, bool reset)
+{
+    MiSnapBufferPoolStatistics statistics;
+    MiSnapBufferPoolGetStatistics(pool, &statistics, reset);
+    uint64_t acquisitions = statistics.hits + statistics.misses;
+    return @{ @"hits": @(statistics.hits),
+              @"misses": @(statistics.misses),
+              @"trimmed": @(statistics.trimmed),
+              @"hitRate": @(acquisitions ? (double)statistics.hits / acquisitions : 0),
+              @"inUseBytes": @(statistics.inUseBytes),
+              @"idleBytes": @(statistics.idleBytes),
+              @"peakBytes": @(statistics.peakBytes),
+              @"highWaterBytes": @(statistics.highWaterBytes) };
+}
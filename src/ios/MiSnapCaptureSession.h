@@ -0,0 +1,47 @@
+
+#import <Cordova/CDV.h>
+#import "MiSnapFrameAnalyzer.h"
+#import "MiSnapProfiles.h"
+#import "MiSnapCaptureViewController.h"
+#import "MiSnapSessions.h"
+#import "MiSnapMIBICodec.h"
+
+//One cordovaCallMiSnap or captureBatch call, from its admission to the session table until its
+//result has been delivered. Everything a capture needs lives here rather than on the plugin, so
+//overlapping calls each get their own result on their own callback.
+
+@interface MiSnapCaptureSession : NSObject
+
+//Reads the capture options shared by both calls, including sessionPolicy
+- (instancetype)initWithCommand:(CDVInvokedUrlCommand *)command options:(NSDictionary *)options;
+
+@property(nonatomic,readonly) NSString* callbackId;
+@property(nonatomic,readonly) MiSnapSessionPolicy policy;
+@property(nonatomic,copy) NSString* resultType;
+@property(nonatomic,copy) NSString* mibiEncoding;
+//With mibiEncoding "compact", every MIBI payload of the session, so later payloads reference the
+//strings of earlier ones
+@property(nonatomic,readonly) MiSnapMIBIWriter* mibiWriter;
+//Byte budget for the delivered JPEG, 0 for the SDK encoding as is
+@property(nonatomic,assign) NSUInteger maxBytes;
+//Upright width of the delivered JPEG when scaled from the original image, 0 for the SDK scaling
+@property(nonatomic,assign) NSUInteger targetWidth;
+//Length of the advisory best-of-window selection run on the live frames, 0 for none
+@property(nonatomic,assign) double bestOfWindowMs;
+//Whether check fronts get an on-device MICR reading ("micr"), off unless readMICR is true
+@property(nonatomic,assign) BOOL readMICR;
+//Of the document being captured, or to be captured first while queued
+@property(nonatomic,assign) MiSnapProfile profile;
+@property(nonatomic,retain) MiSnapFrameAnalyzer* frameAnalyzer;
+@property(nonatomic,weak) MiSnapCaptureViewController* controller;
+
+//State of a captureBatch call, nil for a single capture
+@property(nonatomic,copy) NSArray* batchDocumentTypes;
+@property(nonatomic,copy) NSArray* batchProfiles;
+@property(nonatomic,retain) NSMutableArray* batchCaptures;
+@property(nonatomic,retain) NSMutableArray* batchImages;
+@property(nonatomic,retain) dispatch_group_t batchGroup;
+
+- (MiSnapProfile)batchProfileAtIndex:(NSUInteger)index;
+
+@end
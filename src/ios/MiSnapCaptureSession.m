@@ -0,0 +1,37 @@
+
+#import "MiSnapCaptureSession.h"
+#import "MiSnapPlugin.h"
+
+@implementation MiSnapCaptureSession
+
+- (instancetype)initWithCommand:(CDVInvokedUrlCommand *)command options:(NSDictionary *)options {
+
+    self = [super init];
+    if (self) {
+        _callbackId = [command.callbackId copy];
+        NSString *policy = [options objectForKey:@"sessionPolicy"];
+        if ([policy isEqual:@"reject"]) {
+            _policy = MiSnapSessionPolicyReject;
+        } else if ([policy isEqual:@"preempt"]) {
+            _policy = MiSnapSessionPolicyPreempt;
+        } else {
+            _policy = MiSnapSessionPolicyQueue;
+        }
+        NSString *resultType = [options objectForKey:@"resultType"];
+        _resultType = [resultType isKindOfClass:[NSString class]] ? [resultType copy] : kMiSnapPluginResultTypeText;
+        _mibiEncoding = [[options objectForKey:@"mibiEncoding"] copy];
+        _mibiWriter = [_mibiEncoding isEqual:kMiSnapPluginMIBIEncodingCompact] ? [[MiSnapMIBIWriter alloc] init] : nil;
+        _bestOfWindowMs = [[options objectForKey:@"bestOfWindowMs"] respondsToSelector:@selector(doubleValue)] ? [[options objectForKey:@"bestOfWindowMs"] doubleValue] : 0;
+        _readMICR = [[options objectForKey:@"readMICR"] isEqual:@YES];
+    }
+    return self;
+}
+
+- (MiSnapProfile)batchProfileAtIndex:(NSUInteger)index {
+
+    MiSnapProfile profile;
+    [[self.batchProfiles objectAtIndex:index] getValue:&profile];
+    return profile;
+}
+
+@end
@@ -0,0 +1,25 @@
+
+#import <Foundation/Foundation.h>
+#import "MiSnapSpoolCore.h"
+
+//Serializes access to a spool (see MiSnapSpoolCore.h) and stores each capture as its JPEG and
+//results JSON
+@interface MiSnapCaptureSpool : NSObject
+
+//The spool in Application Support, excluded from backups
++ (instancetype)sharedSpool;
+
+- (instancetype)initWithPath:(NSString *)path;
+
+//Stores a capture and returns its handle, or 0 on failure
+- (uint64_t)appendJPEG:(NSData *)jpeg results:(NSDictionary *)results;
+
+//Returns NO if there is no such capture. jpeg is not copied out of the spool.
+- (BOOL)readCapture:(uint64_t)handle jpeg:(NSData **)jpeg results:(NSDictionary **)results;
+
+- (BOOL)deleteCapture:(uint64_t)handle;
+
+//One { handle, bytes } dictionary per stored capture, oldest first
+- (NSArray *)captures;
+
+@end
@@ -0,0 +1,117 @@
+
+#import "MiSnapCaptureSpool.h"
+#include <errno.h>
+
+@implementation MiSnapCaptureSpool {
+    MiSnapSpool *_spool;
+    dispatch_queue_t _queue;
+}
+
++ (instancetype)sharedSpool {
+
+    static MiSnapCaptureSpool *shared;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        NSURL *directory = [[[NSFileManager defaultManager] URLsForDirectory:NSApplicationSupportDirectory inDomains:NSUserDomainMask] firstObject];
+        directory = [directory URLByAppendingPathComponent:@"MiSnap" isDirectory:YES];
+        [[NSFileManager defaultManager] createDirectoryAtURL:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+        [directory setResourceValue:@YES forKey:NSURLIsExcludedFromBackupKey error:NULL];
+        shared = [[MiSnapCaptureSpool alloc] initWithPath:[[directory URLByAppendingPathComponent:@"captures.spool"] path]];
+    });
+    return shared;
+}
+
+- (instancetype)initWithPath:(NSString *)path {
+
+    self = [super init];
+    if (self) {
+        _spool = MiSnapSpoolOpen([path fileSystemRepresentation]);
+        if (_spool == NULL) {
+            NSLog(@"MiSnap: cannot open capture spool %@: %s", path, strerror(errno));
+            return nil;
+        }
+        _queue = dispatch_queue_create("MiSnapCaptureSpool", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)dealloc {
+
+    MiSnapSpoolClose(_spool);
+}
+
+//A capture record is the length of the results JSON (uint32), the JSON, then the JPEG
+
+- (uint64_t)appendJPEG:(NSData *)jpeg results:(NSDictionary *)results {
+
+    NSData *json = [NSJSONSerialization dataWithJSONObject:results ?: @{} options:0 error:NULL];
+    if (json == nil || json.length > UINT32_MAX) {
+        return 0;
+    }
+    uint32_t jsonLength = (uint32_t)json.length;
+    const void *parts[3] = { &jsonLength, json.bytes, jpeg.bytes };
+    size_t lengths[3] = { sizeof(jsonLength), json.length, jpeg.length };
+    __block uint64_t handle;
+    dispatch_sync(_queue, ^{
+        handle = MiSnapSpoolAppend(_spool, parts, lengths, 3);
+    });
+    return handle;
+}
+
+- (BOOL)readCapture:(uint64_t)handle jpeg:(NSData **)jpeg results:(NSDictionary **)results {
+
+    __block const uint8_t *bytes;
+    __block size_t length;
+    __block MiSnapSpoolMap *map;
+    dispatch_sync(_queue, ^{
+        bytes = MiSnapSpoolRead(_spool, handle, &length, &map);
+    });
+    if (bytes == NULL) {
+        return NO;
+    }
+    uint32_t jsonLength = 0;
+    if (length >= sizeof(jsonLength)) {
+        memcpy(&jsonLength, bytes, sizeof(jsonLength));
+    }
+    if (length < sizeof(jsonLength) || jsonLength > length - sizeof(jsonLength)) {
+        MiSnapSpoolMapRelease(map);
+        return NO;
+    }
+    if (results) {
+        NSData *json = [NSData dataWithBytesNoCopy:(void *)(bytes + sizeof(jsonLength)) length:jsonLength freeWhenDone:NO];
+        *results = [NSJSONSerialization JSONObjectWithData:json options:0 error:NULL];
+    }
+    if (jpeg) {
+        size_t offset = sizeof(jsonLength) + jsonLength;
+        *jpeg = [[NSData alloc] initWithBytesNoCopy:(void *)(bytes + offset) length:length - offset deallocator:^(void *unused, NSUInteger unusedLength) {
+            MiSnapSpoolMapRelease(map);
+        }];
+    } else {
+        MiSnapSpoolMapRelease(map);
+    }
+    return YES;
+}
+
+- (BOOL)deleteCapture:(uint64_t)handle {
+
+    __block bool deleted;
+    dispatch_sync(_queue, ^{
+        deleted = MiSnapSpoolDelete(_spool, handle);
+    });
+    return deleted;
+}
+
+- (NSArray *)captures {
+
+    NSMutableArray *captures = [NSMutableArray array];
+    dispatch_sync(_queue, ^{
+        size_t count;
+        const MiSnapSpoolEntry *entries = MiSnapSpoolEntries(_spool, &count);
+        for (size_t i = 0; i < count; i++) {
+            [captures addObject:@{ @"handle": @(entries[i].id), @"bytes": @(entries[i].length) }];
+        }
+    });
+    return captures;
+}
+
+@end
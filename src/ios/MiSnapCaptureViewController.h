@@ -0,0 +1,14 @@
+
+#import "MiSnap.h"
+#import "MiSnapFrameAnalyzer.h"
+
+//MiSnapViewController that also hands every camera frame to a MiSnapFrameAnalyzer before the
+//SDK processes it. Device only, like the rest of libMiSnap.a.
+
+@interface MiSnapCaptureViewController : MiSnapViewController
+
+@property(nonatomic,retain) MiSnapFrameAnalyzer* frameAnalyzer;
+//Called once, on the camera queue, with the first frame delivered after it is set
+@property(nonatomic,copy) void (^firstFrameHandler)(void);
+
+@end
@@ -0,0 +1,34 @@
+
+#import "MiSnapCaptureViewController.h"
+
+#if(__i386__ ||__x86_64__)
+//Nothing to do here, libMiSnap.a has no simulator slices
+#else
+
+@implementation MiSnapCaptureViewController {
+    BOOL _sawFirstFrame;
+}
+
+//The SDK's nib is named after MiSnapViewController, not this subclass
+
+- (NSString *)nibName {
+    
+    return [super nibName] ?: @"MiSnapViewController";
+}
+
+- (void)captureOutput:(AVCaptureOutput *)captureOutput didOutputSampleBuffer:(CMSampleBufferRef)sampleBuffer fromConnection:(AVCaptureConnection *)connection
+{
+    if (!_sawFirstFrame && self.firstFrameHandler != nil) {
+        _sawFirstFrame = YES;
+        self.firstFrameHandler();
+    }
+    [self.frameAnalyzer pushSampleBuffer:sampleBuffer];
+    
+    if ([MiSnapViewController instancesRespondToSelector:_cmd]) {
+        [super captureOutput:captureOutput didOutputSampleBuffer:sampleBuffer fromConnection:connection];
+    }
+}
+
+@end
+
+#endif
@@ -0,0 +1,19 @@
+
+#import <Foundation/Foundation.h>
+#import "MiSnapImageHash.h"
+
+//Serializes access to the index of recent capture hashes (see MiSnapImageHash.h) and keeps it on
+//disk, so a document captured again after a relaunch is still recognized
+@interface MiSnapDuplicateIndex : NSObject
+
+//The index in Application Support, excluded from backups
++ (instancetype)sharedIndex;
+
+- (instancetype)initWithPath:(NSString *)path;
+
+//Looks for a capture of the same document among the recent captures with the same tag, then adds
+//this one. Returns { hash, probable } plus, when probable, the distance and the capturedAt time
+//(milliseconds since 1970) of the closest one.
+- (NSDictionary *)checkHash:(const MiSnapImageHash *)hash tag:(uint32_t)tag;
+
+@end
@@ -0,0 +1,64 @@
+
+#import "MiSnapDuplicateIndex.h"
+
+//Captures older than this are not reported as duplicates
+static const int64_t kMiSnapDuplicateMaxAgeMs = 30LL * 24 * 60 * 60 * 1000;
+
+@implementation MiSnapDuplicateIndex {
+    MiSnapHashIndex _index;
+    NSString *_path;
+    dispatch_queue_t _queue;
+}
+
++ (instancetype)sharedIndex {
+    
+    static MiSnapDuplicateIndex *shared;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        NSURL *directory = [[[NSFileManager defaultManager] URLsForDirectory:NSApplicationSupportDirectory inDomains:NSUserDomainMask] firstObject];
+        directory = [directory URLByAppendingPathComponent:@"MiSnap" isDirectory:YES];
+        [[NSFileManager defaultManager] createDirectoryAtURL:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+        [directory setResourceValue:@YES forKey:NSURLIsExcludedFromBackupKey error:NULL];
+        shared = [[MiSnapDuplicateIndex alloc] initWithPath:[[directory URLByAppendingPathComponent:@"captures.hashes"] path]];
+    });
+    return shared;
+}
+
+- (instancetype)initWithPath:(NSString *)path {
+    
+    self = [super init];
+    if (self) {
+        _path = [path copy];
+        _queue = dispatch_queue_create("MiSnapDuplicateIndex", DISPATCH_QUEUE_SERIAL);
+        //A missing or unreadable index starts empty
+        MiSnapHashIndexLoad(&_index, [_path fileSystemRepresentation]);
+    }
+    return self;
+}
+
+- (NSDictionary *)checkHash:(const MiSnapImageHash *)hash tag:(uint32_t)tag {
+    
+    NSMutableString *hex = [NSMutableString stringWithCapacity:kMiSnapImageHashBits / 4];
+    for (size_t i = 0; i < kMiSnapImageHashWords; i++) {
+        [hex appendFormat:@"%016llx", (unsigned long long)hash->words[i]];
+    }
+    NSMutableDictionary *duplicate = [NSMutableDictionary dictionaryWithObjectsAndKeys:hex, @"hash", @NO, @"probable", nil];
+    MiSnapHashEntry entry = { *hash, (int64_t)([[NSDate date] timeIntervalSince1970] * 1000), tag, 0 };
+    dispatch_sync(_queue, ^{
+        MiSnapHashEntry match;
+        int distance;
+        if (MiSnapHashIndexNearest(&_index, hash, tag, kMiSnapImageHashDuplicateDistance, entry.timeMs - kMiSnapDuplicateMaxAgeMs, &match, &distance)) {
+            [duplicate setObject:@YES forKey:@"probable"];
+            [duplicate setObject:@(distance) forKey:@"distance"];
+            [duplicate setObject:@(match.timeMs) forKey:@"capturedAt"];
+        }
+        MiSnapHashIndexAdd(&_index, &entry);
+    });
+    //Saving is a few kilobytes and nobody waits for it
+    dispatch_async(_queue, ^{
+        MiSnapHashIndexSave(&_index, [_path fileSystemRepresentation]);
+    });
+    return duplicate;
+}
+
+@end
@@ -0,0 +1,30 @@
+
+#import <Foundation/Foundation.h>
+#import <CoreMedia/CoreMedia.h>
+#import "MiSnapFrameScorer.h"
+#import "MiSnapTorch.h"
+
+//Scores live camera frames on a worker queue. The camera callback only copies a downsampled
+//luma plane into a MiSnapFrameRing, so analysis never runs inline on the capture callback.
+
+@interface MiSnapFrameAnalyzer : NSObject
+
+//The torch decisions and the best-of-window selection (bestOfWindowMs > 0) are advisory: they are
+//reported in the statistics, the SDK keeps control of the torch and of the accepted frame
+- (instancetype)initWithThresholds:(MiSnapFrameThresholds)thresholds torchMode:(MiSnapTorchMode)torchMode driversLicense:(BOOL)driversLicense bestOfWindowMs:(double)bestOfWindowMs;
+
+//Called from the capture callback; never blocks
+- (void)pushSampleBuffer:(CMSampleBufferRef)sampleBuffer;
+
+//Stops analysing; frames pushed afterwards are ignored
+- (void)stop;
+
+//Sends the scores of the analysed frames to handler on the analysis queue, coalesced to at most
+//maxRate events per second (see MiSnapFeedback.h). When the analyzer stops, the frames still
+//pending are sent, followed by an "end" event. Set before the first frame is pushed.
+- (void)setEventHandler:(void (^)(NSDictionary *event))handler maxRate:(double)maxRate;
+
+//Frame counts, drops, lag, the last score, the torch decisions and the best-of-window selection
+- (NSDictionary *)statistics;
+
+@end
@@ -0,0 +1,299 @@
+
+#import "MiSnapFrameAnalyzer.h"
+#import "MiSnapFrameRingCore.h"
+#import "MiSnapFrameWindowCore.h"
+#import "MiSnapBufferPool.h"
+#import "MiSnapFeedback.h"
+#import <CoreVideo/CoreVideo.h>
+#include <mach/mach_time.h>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+//Frames are analysed at half resolution or less, so that they fit half of a 1080p frame
+static const size_t kMaxAnalysisWidth = 1920 / 2;
+static const size_t kMaxAnalysisHeight = 1080 / 2;
+//Candidates kept by the best-of-window selection
+static const size_t kWindowCandidates = 4;
+
+//factor x factor box average of a luma plane into dst, with a NEON path for the common 2x2 case
+static void MiSnapDownsampleLuma(const uint8_t *src, size_t rowBytes, size_t factor, uint8_t *dst, size_t dstWidth, size_t dstHeight, size_t dstRowBytes)
+{
+    for (size_t y = 0; y < dstHeight; y++) {
+        const uint8_t *row = src + factor * y * rowBytes;
+        uint8_t *out = dst + y * dstRowBytes;
+        size_t x = 0;
+        if (factor == 2) {
+            const uint8_t *next = row + rowBytes;
+#if defined(__aarch64__)
+            for (; x + 8 <= dstWidth; x += 8) {
+                uint16x8_t sum = vpaddlq_u8(vld1q_u8(row + 2 * x));
+                sum = vpadalq_u8(sum, vld1q_u8(next + 2 * x));
+                vst1_u8(out + x, vrshrn_n_u16(sum, 2));
+            }
+#endif
+            for (; x < dstWidth; x++) {
+                out[x] = (uint8_t)((row[2 * x] + row[2 * x + 1] + next[2 * x] + next[2 * x + 1] + 2) >> 2);
+            }
+            continue;
+        }
+        size_t area = factor * factor;
+        for (; x < dstWidth; x++) {
+            uint32_t sum = 0;
+            for (size_t dy = 0; dy < factor; dy++) {
+                const uint8_t *cell = row + dy * rowBytes + factor * x;
+                for (size_t dx = 0; dx < factor; dx++) {
+                    sum += cell[dx];
+                }
+            }
+            out[x] = (uint8_t)((sum + area / 2) / area);
+        }
+    }
+}
+
+static double MiSnapTicksToMilliseconds(uint64_t ticks)
+{
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return (double)ticks * timebase.numer / timebase.denom / 1e6;
+}
+
+static NSDictionary *MiSnapFeedbackEventDictionary(const MiSnapFeedbackEvent *event)
+{
+    return @{ @"type": @"quality",
+              @"frame": @(event->last.frame),
+              @"sessionMs": @(lround(event->last.timeMs)),
+              @"brightness": @(event->last.brightness),
+              @"sharpness": @(event->last.sharpness),
+              @"angle": @(event->last.angle),
+              @"torch": @(event->last.torch),
+              @"passes": @(event->last.passes),
+              @"frames": @(event->frames),
+              @"passingFrames": @(event->passingFrames),
+              @"bestSharpness": @(event->bestSharpness),
+              @"minBrightness": @(event->minBrightness),
+              @"maxBrightness": @(event->maxBrightness),
+              @"torchSwitches": @(event->torchSwitches) };
+}
+
+@implementation MiSnapFrameAnalyzer {
+    MiSnapFrameRing _ring;
+    BOOL _ringReady;
+    MiSnapFrameThresholds _thresholds;
+    dispatch_queue_t _worker;
+    _Atomic bool _workerScheduled;
+    _Atomic bool _stopped;
+    uint8_t *_bgraLuma;
+    size_t _bgraLumaSize;
+    uint64_t _sequence;
+    
+    //Owned by the worker queue
+    MiSnapFrameScore _lastScore;
+    MiSnapTorchEstimator _torch;
+    MiSnapFrameWindow _window;
+    BOOL _windowReady;
+    MiSnapFrameScore _firstPassingScore;
+    uint64_t _passingFrames;
+    double _totalLagMs;
+    double _maxLagMs;
+    void (^_eventHandler)(NSDictionary *event);
+    MiSnapFeedbackThrottle _feedback;
+    uint64_t _firstFrameTimestamp;
+}
+
+- (instancetype)initWithThresholds:(MiSnapFrameThresholds)thresholds torchMode:(MiSnapTorchMode)torchMode driversLicense:(BOOL)driversLicense bestOfWindowMs:(double)bestOfWindowMs {
+    
+    self = [super init];
+    if (self) {
+        _thresholds = thresholds;
+        MiSnapTorchInit(&_torch, torchMode, driversLicense, thresholds.minBrightness);
+        if (bestOfWindowMs > 0) {
+            _windowReady = MiSnapFrameWindowInit(&_window, kWindowCandidates, kMaxAnalysisWidth, kMaxAnalysisHeight, bestOfWindowMs);
+        }
+        _ringReady = MiSnapFrameRingInit(&_ring, kMaxAnalysisWidth, kMaxAnalysisHeight);
+        _worker = dispatch_queue_create("com.keybank.MiSnapPlugin.analysis", DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(_worker, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0));
+        atomic_init(&_workerScheduled, false);
+        atomic_init(&_stopped, false);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    
+    if (_ringReady) {
+        MiSnapFrameRingDestroy(&_ring);
+    }
+    if (_windowReady) {
+        MiSnapFrameWindowDestroy(&_window);
+    }
+    MiSnapBufferRelease(MiSnapSharedBufferPool(), _bgraLuma);
+}
+
+- (void)pushSampleBuffer:(CMSampleBufferRef)sampleBuffer {
+    
+    if (!_ringReady || atomic_load(&_stopped)) {
+        return;
+    }
+    CVImageBufferRef pixelBuffer = CMSampleBufferGetImageBuffer(sampleBuffer);
+    if (pixelBuffer == NULL) {
+        return;
+    }
+    uint64_t timestamp = mach_absolute_time();
+    
+    CVPixelBufferLockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    OSType format = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    const uint8_t *luma = NULL;
+    size_t width = CVPixelBufferGetWidth(pixelBuffer);
+    size_t height = CVPixelBufferGetHeight(pixelBuffer);
+    size_t rowBytes = 0;
+    if (format == kCVPixelFormatType_420YpCbCr8BiPlanarFullRange || format == kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange) {
+        luma = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 0);
+        rowBytes = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 0);
+    } else if (format == kCVPixelFormatType_32BGRA) {
+        //Only reached for BGRA sessions; the scratch plane is reused across frames
+        if (_bgraLumaSize < width * height) {
+            MiSnapBufferRelease(MiSnapSharedBufferPool(), _bgraLuma);
+            _bgraLuma = MiSnapBufferAcquire(MiSnapSharedBufferPool(), width * height);
+            _bgraLumaSize = _bgraLuma ? width * height : 0;
+        }
+        if (_bgraLuma) {
+            MiSnapExtractLuma(CVPixelBufferGetBaseAddress(pixelBuffer), width, height, CVPixelBufferGetBytesPerRow(pixelBuffer), _bgraLuma, width);
+            luma = _bgraLuma;
+            rowBytes = width;
+        }
+    }
+    
+    if (luma != NULL) {
+        size_t factor = MAX((size_t)2, MAX((width + kMaxAnalysisWidth - 1) / kMaxAnalysisWidth, (height + kMaxAnalysisHeight - 1) / kMaxAnalysisHeight));
+        MiSnapRingFrame *slot = MiSnapFrameRingWriteSlot(&_ring);
+        slot->width = width / factor;
+        slot->height = height / factor;
+        MiSnapDownsampleLuma(luma, rowBytes, factor, slot->luma, slot->width, slot->height, slot->rowBytes);
+        slot->sequence = ++_sequence;
+        slot->timestamp = timestamp;
+        MiSnapFrameRingPublish(&_ring);
+    }
+    CVPixelBufferUnlockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    
+    if (luma != NULL) {
+        [self scheduleWorker];
+    }
+}
+
+//At most one drain block is queued at a time, so a slow worker never builds up a backlog
+
+- (void)scheduleWorker {
+    
+    bool expected = false;
+    if (!atomic_compare_exchange_strong(&_workerScheduled, &expected, true)) {
+        return;
+    }
+    dispatch_async(_worker, ^{
+        [self drain];
+        atomic_store(&self->_workerScheduled, false);
+        //A frame published after the last acquire but before the flag was cleared
+        if (MiSnapFrameRingHasFrame(&self->_ring)) {
+            [self scheduleWorker];
+        }
+    });
+}
+
+- (void)drain {
+    
+    MiSnapRingFrame *frame;
+    while (!atomic_load(&_stopped) && (frame = MiSnapFrameRingAcquire(&_ring)) != NULL) {
+        double lag = MiSnapTicksToMilliseconds(mach_absolute_time() - frame->timestamp);
+        _totalLagMs += lag;
+        _maxLagMs = MAX(_maxLagMs, lag);
+        
+        MiSnapScoreLumaFrame(frame->luma, frame->width, frame->height, frame->rowBytes, &_lastScore);
+        bool passes = MiSnapFrameScorePasses(&_lastScore, &_thresholds);
+        if (passes) {
+            if (_passingFrames++ == 0) {
+                _firstPassingScore = _lastScore;
+            }
+            if (_windowReady) {
+                MiSnapFrameWindowOffer(&_window, &_lastScore, frame->luma, frame->width, frame->height, frame->rowBytes, frame->sequence, MiSnapTicksToMilliseconds(frame->timestamp));
+            }
+        } else if (_windowReady) {
+            MiSnapFrameWindowPoll(&_window, MiSnapTicksToMilliseconds(frame->timestamp));
+        }
+        MiSnapTorchUpdate(&_torch, frame->luma, frame->width, frame->height, frame->rowBytes);
+        
+        if (_eventHandler != nil) {
+            if (_firstFrameTimestamp == 0) {
+                _firstFrameTimestamp = frame->timestamp;
+            }
+            MiSnapFeedbackSample sample = { frame->sequence, MiSnapTicksToMilliseconds(frame->timestamp - _firstFrameTimestamp),
+                                            _lastScore.brightness, _lastScore.sharpness, _lastScore.angle, _torch.torch, passes };
+            MiSnapFeedbackEvent event;
+            if (MiSnapFeedbackOffer(&_feedback, &sample, &event)) {
+                _eventHandler(MiSnapFeedbackEventDictionary(&event));
+            }
+        }
+    }
+}
+
+- (void)setEventHandler:(void (^)(NSDictionary *event))handler maxRate:(double)maxRate {
+    
+    dispatch_sync(_worker, ^{
+        self->_eventHandler = [handler copy];
+        MiSnapFeedbackInit(&self->_feedback, maxRate);
+    });
+}
+
+- (void)stop {
+    
+    atomic_store(&_stopped, true);
+    //Queued behind any drain in progress, so the last frames are in the throttle
+    dispatch_async(_worker, ^{
+        if (self->_windowReady) {
+            MiSnapFrameWindowFinish(&self->_window);
+        }
+        if (self->_eventHandler == nil) {
+            return;
+        }
+        MiSnapFeedbackEvent event;
+        if (MiSnapFeedbackFlush(&self->_feedback, &event)) {
+            self->_eventHandler(MiSnapFeedbackEventDictionary(&event));
+        }
+        self->_eventHandler(@{ @"type": @"end", @"frames": @(self->_feedback.offered), @"events": @(self->_feedback.events) });
+        self->_eventHandler = nil;
+    });
+}
+
+- (NSDictionary *)statistics {
+    
+    __block NSMutableDictionary *statistics;
+    dispatch_sync(_worker, ^{
+        uint64_t analysed = atomic_load(&self->_ring.consumed);
+        statistics = [@{ @"framesCaptured": @(atomic_load(&self->_ring.published)),
+                         @"framesAnalyzed": @(analysed),
+                         @"framesDropped": @(atomic_load(&self->_ring.dropped)),
+                         @"framesPassing": @(self->_passingFrames),
+                         @"meanLagMs": @(analysed ? self->_totalLagMs / analysed : 0),
+                         @"maxLagMs": @(self->_maxLagMs),
+                         @"lastScore": [MiSnapFrameScorer dictionaryFromScore:self->_lastScore],
+                         @"torch": MiSnapTorchDictionary(&self->_torch) } mutableCopy];
+        if (self->_windowReady) {
+            MiSnapFrameWindowPoll(&self->_window, MiSnapTicksToMilliseconds(mach_absolute_time()));
+        }
+        const MiSnapWindowCandidate *best = self->_windowReady ? MiSnapFrameWindowBest(&self->_window) : NULL;
+        if (best != NULL) {
+            [statistics setObject:@{ @"windowMs": @(self->_window.windowMs),
+                                     @"closed": @(self->_window.closed),
+                                     @"framesOffered": @(self->_window.offered),
+                                     @"firstSharpness": @(self->_firstPassingScore.sharpness),
+                                     @"bestSharpness": @(best->score.sharpness),
+                                     @"bestAfterMs": @(best->timeMs - self->_window.openedMs),
+                                     @"bestScore": [MiSnapFrameScorer dictionaryFromScore:best->score] } forKey:@"bestOfWindow"];
+        }
+    });
+    return statistics;
+}
+
+@end
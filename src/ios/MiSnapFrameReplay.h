@@ -0,0 +1,29 @@
+
+#import <Foundation/Foundation.h>
+#import "MiSnapFrameScorer.h"
+#import "MiSnapTorch.h"
+#import "MiSnapFrameReplayCore.h"
+
+//The replayFrames action over MiSnapReplayRun. Runs on devices and on the simulator, so slow
+//auto-capture sessions can be reproduced without a camera; misnap_core_replay reports the same
+//numbers for the same dump on a host.
+
+@interface MiSnapFrameReplay : NSObject
+
+//rowBytes of 0 means tightly packed rows
+- (instancetype)initWithPath:(NSString *)path width:(size_t)width height:(size_t)height rowBytes:(size_t)rowBytes format:(MiSnapFrameFormat)format;
+
+@property(nonatomic,assign) MiSnapFrameThresholds thresholds;
+//Rate the frames were recorded at, used to express time-to-accept in session time (default 30)
+@property(nonatomic,assign) double frameRate;
+//Torch policy the decisions are replayed with (default AUTO, not a driver's license)
+@property(nonatomic,assign) MiSnapTorchMode torchMode;
+@property(nonatomic,assign) BOOL driversLicense;
+//Best-of-window selection (see MiSnapFrameWindowCore.h): 0 accepts the first passing frame (default)
+@property(nonatomic,assign) double bestOfWindowMs;
+@property(nonatomic,assign) NSUInteger candidates;
+
+//Returns the report dictionary, or nil with an error if the dump cannot be read
+- (NSDictionary *)run:(NSError **)error;
+
+@end
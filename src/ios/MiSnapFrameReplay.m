@@ -0,0 +1,91 @@
+#import "MiSnapFrameReplay.h"
+
+static NSString* const kMiSnapFrameReplayErrorDomain = @"MiSnapFrameReplay";
+
+static NSDictionary *MiSnapLatencyDictionary(const MiSnapReplayLatency *latency)
+{
+    return @{ @"meanMs": @(latency->meanMs),
+              @"p50Ms": @(latency->p50Ms),
+              @"p95Ms": @(latency->p95Ms),
+              @"maxMs": @(latency->maxMs) };
+}
+
+@implementation MiSnapFrameReplay {
+    NSString *_path;
+    MiSnapReplayOptions _options;
+}
+
+- (instancetype)initWithPath:(NSString *)path width:(size_t)width height:(size_t)height rowBytes:(size_t)rowBytes format:(MiSnapFrameFormat)format {
+    
+    self = [super init];
+    if (self) {
+        _path = [path copy];
+        MiSnapReplayOptionsInit(&_options, width, height, rowBytes, format);
+        _thresholds = [MiSnapFrameScorer defaultThresholdsForDocumentType:nil];
+        _frameRate = _options.frameRate;
+        _torchMode = _options.torchMode;
+        _candidates = _options.candidates;
+    }
+    return self;
+}
+
+- (NSDictionary *)run:(NSError **)error {
+    
+    MiSnapReplayOptions options = _options;
+    options.thresholds = self.thresholds;
+    options.frameRate = self.frameRate;
+    options.torchMode = self.torchMode;
+    options.driversLicense = self.driversLicense;
+    options.bestOfWindowMs = self.bestOfWindowMs;
+    options.candidates = self.candidates;
+    
+    NSData *dump = [NSData dataWithContentsOfFile:_path options:NSDataReadingMappedIfSafe error:error];
+    if (dump == nil) {
+        return nil;
+    }
+    MiSnapReplayReport result;
+    MiSnapReplayStatus status = MiSnapReplayRun(&options, dump.bytes, dump.length, &result);
+    if (status != MiSnapReplayOK) {
+        if (error) {
+            *error = [NSError errorWithDomain:kMiSnapFrameReplayErrorDomain code:status userInfo:@{ NSLocalizedDescriptionKey: @(MiSnapReplayStatusMessage(status)) }];
+        }
+        return nil;
+    }
+    
+    NSMutableDictionary *stages = [NSMutableDictionary dictionary];
+    for (int s = 0; s < MiSnapReplayStageCount; s++) {
+        [stages setObject:MiSnapLatencyDictionary(&result.stages[s]) forKey:@(kMiSnapReplayStageNames[s])];
+    }
+    NSMutableArray *decisions = [NSMutableArray arrayWithCapacity:result.decisionCount];
+    for (size_t i = 0; i < result.decisionCount; i++) {
+        const MiSnapReplayTorchDecision *decision = &result.decisions[i];
+        [decisions addObject:@{ @"frame": @(decision->frame),
+                                @"torch": @(decision->torch),
+                                @"brightness": @(decision->brightness),
+                                @"ambient": @(decision->ambient),
+                                @"torchGain": @(decision->torchGain) }];
+    }
+    
+    NSMutableDictionary *report = [NSMutableDictionary dictionary];
+    [report setObject:@(result.frames) forKey:@"frames"];
+    [report setObject:@(result.wallMs) forKey:@"wallMs"];
+    [report setObject:@(result.framesPerSecond) forKey:@"framesPerSecond"];
+    [report setObject:@(result.acceptedFrame) forKey:@"acceptedFrame"];
+    if (result.acceptedFrame >= 0) {
+        [report setObject:@(result.timeToAcceptMs) forKey:@"timeToAcceptMs"];
+        [report setObject:@(result.wallTimeToAcceptMs) forKey:@"wallTimeToAcceptMs"];
+        [report setObject:[MiSnapFrameScorer dictionaryFromScore:result.acceptedScore] forKey:@"acceptedScore"];
+        [report setObject:@{ @"windowMs": @(result.windowMs),
+                             @"firstPassingFrame": @(result.firstPassingFrame),
+                             @"framesOffered": @(result.framesOffered),
+                             @"candidates": @(result.candidates) } forKey:@"bestOfWindow"];
+    }
+    NSMutableDictionary *torchReport = [MiSnapTorchDictionary(&result.torch) mutableCopy];
+    [torchReport setObject:decisions forKey:@"decisions"];
+    [report setObject:torchReport forKey:@"torch"];
+    [report setObject:stages forKey:@"stages"];
+    MiSnapReplayReportFree(&result);
+    return report;
+}
+
+@end
@@ -0,0 +1,20 @@
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+#import "MiSnapQuadDetector.h"
+#import "MiSnapFrameScoreCore.h"
+
+@interface MiSnapFrameScorer : NSObject
+
+//The documented defaults for a document type name such as @"CheckFront" (see MiSnapProfiles.h)
++ (MiSnapFrameThresholds)defaultThresholdsForDocumentType:(NSString *)documentType;
+
++ (MiSnapFrameScore)scoreImage:(UIImage *)image;
+//Also hands the same grayscale rendering of the image to analysis, e.g. to hash it (see
+//MiSnapImageHash.h). analysis is not called if the image could not be rendered.
++ (MiSnapFrameScore)scoreImage:(UIImage *)image analysis:(void (^)(const uint8_t *luma, size_t width, size_t height, size_t rowBytes))analysis;
+
+//Scores as a dictionary with brightness, sharpness, angle and quad keys
++ (NSDictionary *)dictionaryFromScore:(MiSnapFrameScore)score;
+
+@end
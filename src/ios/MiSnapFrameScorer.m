@@ -0,0 +1,112 @@
+
+#import "MiSnapFrameScorer.h"
+#import "MiSnapProfiles.h"
+#import "MiSnapBufferPool.h"
+
+//Maps the stored pixels onto an upright width x height context (bottom-left origin)
+static CGAffineTransform MiSnapOrientationTransform(UIImageOrientation orientation, CGFloat width, CGFloat height)
+{
+    CGAffineTransform transform = CGAffineTransformIdentity;
+    switch (orientation) {
+        case UIImageOrientationDown:
+        case UIImageOrientationDownMirrored:
+            transform = CGAffineTransformRotate(CGAffineTransformTranslate(transform, width, height), M_PI);
+            break;
+        case UIImageOrientationLeft:
+        case UIImageOrientationLeftMirrored:
+            transform = CGAffineTransformRotate(CGAffineTransformTranslate(transform, width, 0), M_PI_2);
+            break;
+        case UIImageOrientationRight:
+        case UIImageOrientationRightMirrored:
+            transform = CGAffineTransformRotate(CGAffineTransformTranslate(transform, 0, height), -M_PI_2);
+            break;
+        default:
+            break;
+    }
+    switch (orientation) {
+        case UIImageOrientationUpMirrored:
+        case UIImageOrientationDownMirrored:
+            transform = CGAffineTransformScale(CGAffineTransformTranslate(transform, width, 0), -1, 1);
+            break;
+        case UIImageOrientationLeftMirrored:
+        case UIImageOrientationRightMirrored:
+            transform = CGAffineTransformScale(CGAffineTransformTranslate(transform, height, 0), -1, 1);
+            break;
+        default:
+            break;
+    }
+    return transform;
+}
+
+@implementation MiSnapFrameScorer
+
++ (MiSnapFrameThresholds)defaultThresholdsForDocumentType:(NSString *)documentType {
+    
+    const MiSnapProfile *profile = MiSnapProfileForDocumentType(documentType);
+    if (profile != NULL) {
+        return MiSnapProfileThresholds(profile);
+    }
+    //Documented defaults for any other document type
+    MiSnapFrameThresholds thresholds = { 400, 700, 400, 150 };
+    return thresholds;
+}
+
++ (MiSnapFrameScore)scoreImage:(UIImage *)image {
+    
+    return [self scoreImage:image analysis:nil];
+}
+
+//Renders the image upright, as imageOrientation says it is displayed, into a grayscale buffer no
+//larger than a 1080p frame and scores it
+
++ (MiSnapFrameScore)scoreImage:(UIImage *)image analysis:(void (^)(const uint8_t *luma, size_t width, size_t height, size_t rowBytes))analysis {
+    
+    MiSnapFrameScore score = { 0, 0, 0 };
+    CGImageRef cgImage = image.CGImage;
+    if (cgImage == NULL) {
+        return score;
+    }
+    
+    UIImageOrientation orientation = image.imageOrientation;
+    BOOL sideways = orientation == UIImageOrientationLeft || orientation == UIImageOrientationLeftMirrored ||
+                    orientation == UIImageOrientationRight || orientation == UIImageOrientationRightMirrored;
+    size_t width = sideways ? CGImageGetHeight(cgImage) : CGImageGetWidth(cgImage);
+    size_t height = sideways ? CGImageGetWidth(cgImage) : CGImageGetHeight(cgImage);
+    size_t longSide = MAX(width, height);
+    if (longSide > 1920) {
+        width = width * 1920 / longSide;
+        height = height * 1920 / longSide;
+    }
+    
+    //The bitmap comes from the buffer pool, so consecutive captures reuse it
+    size_t rowBytes = (width + 63) & ~(size_t)63;
+    uint8_t *pixels = MiSnapBufferAcquire(MiSnapSharedBufferPool(), rowBytes * height);
+    CGColorSpaceRef gray = CGColorSpaceCreateDeviceGray();
+    CGContextRef context = pixels ? CGBitmapContextCreate(pixels, width, height, 8, rowBytes, gray, (CGBitmapInfo)kCGImageAlphaNone) : NULL;
+    CGColorSpaceRelease(gray);
+    if (context == NULL) {
+        MiSnapBufferRelease(MiSnapSharedBufferPool(), pixels);
+        return score;
+    }
+    CGContextSetInterpolationQuality(context, kCGInterpolationMedium);
+    CGContextConcatCTM(context, MiSnapOrientationTransform(orientation, width, height));
+    CGContextDrawImage(context, sideways ? CGRectMake(0, 0, height, width) : CGRectMake(0, 0, width, height), cgImage);
+    
+    MiSnapScoreLumaFrame(pixels, width, height, rowBytes, &score);
+    if (analysis) {
+        analysis(pixels, width, height, rowBytes);
+    }
+    CGContextRelease(context);
+    MiSnapBufferRelease(MiSnapSharedBufferPool(), pixels);
+    return score;
+}
+
++ (NSDictionary *)dictionaryFromScore:(MiSnapFrameScore)score {
+    
+    return @{ @"brightness": @(score.brightness),
+              @"sharpness": @(score.sharpness),
+              @"angle": @(score.angle),
+              @"quad": [MiSnapQuadDetector dictionaryFromQuad:&score.quad] };
+}
+
+@end
@@ -0,0 +1,15 @@
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+#import "MiSnapImageScalerCore.h"
+
+@interface MiSnapImageScaler : NSObject
+
+//Scales image so that its upright width is width pixels, keeping the aspect ratio. The pixels are
+//not rotated: the result is in the orientation of image.CGImage (see +EXIFOrientationOfImage:).
++ (CGImageRef)newImageByScalingImage:(UIImage *)image toWidth:(size_t)width CF_RETURNS_RETAINED;
+
+//The EXIF orientation (1-8) matching image.imageOrientation
++ (int)EXIFOrientationOfImage:(UIImage *)image;
+
+@end
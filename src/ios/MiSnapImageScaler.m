@@ -0,0 +1,57 @@
+
+#import "MiSnapImageScaler.h"
+#import "MiSnapBufferPool.h"
+
+@implementation MiSnapImageScaler
+
++ (CGImageRef)newImageByScalingImage:(UIImage *)image toWidth:(size_t)width {
+    
+    CGImageRef source = image.CGImage;
+    if (source == NULL || width == 0) {
+        return NULL;
+    }
+    size_t srcWidth = CGImageGetWidth(source), srcHeight = CGImageGetHeight(source);
+    double factor = MIN(1.0, width / (image.size.width * image.scale));
+    size_t dstWidth = MAX((size_t)1, (size_t)lround(srcWidth * factor));
+    size_t dstHeight = MAX((size_t)1, (size_t)lround(srcHeight * factor));
+    
+    //Draw the source into a pooled BGRA buffer, then resample into the bitmap of the result. The
+    //result's bitmap is left to Core Graphics since the returned image may share it.
+    size_t srcRowBytes = (srcWidth * 4 + 63) & ~(size_t)63;
+    uint8_t *pixels = MiSnapBufferAcquire(MiSnapSharedBufferPool(), srcRowBytes * srcHeight);
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGBitmapInfo bitmapInfo = kCGImageAlphaNoneSkipFirst | kCGBitmapByteOrder32Little;
+    CGContextRef sourceContext = pixels ? CGBitmapContextCreate(pixels, srcWidth, srcHeight, 8, srcRowBytes, colorSpace, bitmapInfo) : NULL;
+    CGContextRef scaledContext = CGBitmapContextCreate(NULL, dstWidth, dstHeight, 8, 0, colorSpace, bitmapInfo);
+    CGColorSpaceRelease(colorSpace);
+    
+    CGImageRef scaled = NULL;
+    if (sourceContext != NULL && scaledContext != NULL) {
+        CGContextDrawImage(sourceContext, CGRectMake(0, 0, srcWidth, srcHeight), source);
+        if (MiSnapScaleImage(pixels, srcWidth, srcHeight, srcRowBytes,
+                             CGBitmapContextGetData(scaledContext), dstWidth, dstHeight, CGBitmapContextGetBytesPerRow(scaledContext), 4)) {
+            scaled = CGBitmapContextCreateImage(scaledContext);
+        }
+    }
+    CGContextRelease(sourceContext);
+    CGContextRelease(scaledContext);
+    MiSnapBufferRelease(MiSnapSharedBufferPool(), pixels);
+    return scaled;
+}
+
++ (int)EXIFOrientationOfImage:(UIImage *)image {
+    
+    switch (image.imageOrientation) {
+        case UIImageOrientationUp:              return 1;
+        case UIImageOrientationUpMirrored:      return 2;
+        case UIImageOrientationDown:            return 3;
+        case UIImageOrientationDownMirrored:    return 4;
+        case UIImageOrientationLeftMirrored:    return 5;
+        case UIImageOrientationRight:           return 6;
+        case UIImageOrientationRightMirrored:   return 7;
+        case UIImageOrientationLeft:            return 8;
+    }
+    return 1;
+}
+
+@end
@@ -0,0 +1,21 @@
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+//Re-encodes captured JPEGs to fit a byte budget. The highest quality that fits is found by
+//encoding several candidate qualities in parallel per round, so the search costs a few encode
+//times on a multi-core device rather than one per bisection step. Metadata of the source JPEG
+//(Exif, TIFF and the SDK's own properties) is carried over.
+
+@interface MiSnapJPEGEncoder : NSObject
+
+//Returns jpeg unchanged if it already fits. Otherwise returns the best encoding found: the highest
+//quality within maxBytes, or the smallest one when even the lowest quality does not fit. report,
+//if given, receives inputBytes, outputBytes, quality (-1 when unchanged), probes, fits and encodeMs.
++ (NSData *)JPEGData:(NSData *)jpeg fittingBytes:(NSUInteger)maxBytes report:(NSDictionary **)report;
+
+//Encodes image at quality (0-1), carrying over the metadata of metadataJPEG (may be nil) with the
+//orientation and pixel dimensions replaced
++ (NSData *)JPEGDataFromImage:(CGImageRef)image quality:(double)quality orientation:(int)orientation metadataFrom:(NSData *)metadataJPEG;
+
+@end
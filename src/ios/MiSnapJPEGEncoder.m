@@ -0,0 +1,150 @@
+
+#import "MiSnapJPEGEncoder.h"
+#import <ImageIO/ImageIO.h>
+#import <MobileCoreServices/MobileCoreServices.h>
+#import <mach/mach_time.h>
+
+//Qualities encoded concurrently per round, and rounds of narrowing. Four probes per round over
+//three rounds resolve the quality to about 1%.
+#define kMiSnapJPEGProbesPerRound 4
+#define kMiSnapJPEGRounds 3
+#define kMiSnapJPEGMinQuality 0.05
+#define kMiSnapJPEGMaxQuality 0.95
+
+static NSData *MiSnapEncodeJPEG(CGImageRef image, NSDictionary *properties, double quality)
+{
+    NSMutableData *data = [NSMutableData data];
+    CGImageDestinationRef destination = CGImageDestinationCreateWithData((__bridge CFMutableDataRef)data, kUTTypeJPEG, 1, NULL);
+    if (destination == NULL) {
+        return nil;
+    }
+    NSMutableDictionary *options = [properties mutableCopy] ?: [NSMutableDictionary dictionary];
+    [options setObject:@(quality) forKey:(__bridge NSString *)kCGImageDestinationLossyCompressionQuality];
+    CGImageDestinationAddImage(destination, image, (__bridge CFDictionaryRef)options);
+    BOOL finished = CGImageDestinationFinalize(destination);
+    CFRelease(destination);
+    return finished ? data : nil;
+}
+
+@implementation MiSnapJPEGEncoder
+
++ (NSData *)JPEGData:(NSData *)jpeg fittingBytes:(NSUInteger)maxBytes report:(NSDictionary **)report {
+    
+    uint64_t start = mach_absolute_time();
+    NSData *best = nil;
+    double bestQuality = -1;
+    int probes = 0;
+    
+    CGImageSourceRef source = jpeg.length > maxBytes ? CGImageSourceCreateWithData((__bridge CFDataRef)jpeg, NULL) : NULL;
+    CGImageRef image = source ? CGImageSourceCreateImageAtIndex(source, 0, NULL) : NULL;
+    if (image != NULL) {
+        NSDictionary *properties = CFBridgingRelease(CGImageSourceCopyPropertiesAtIndex(source, 0, NULL));
+        NSData *smallest = nil;
+        double smallestQuality = -1;
+        double low = kMiSnapJPEGMinQuality, high = kMiSnapJPEGMaxQuality;
+        
+        for (int round = 0; round < kMiSnapJPEGRounds; round++) {
+            //The first round includes both ends of the range; later ones probe strictly inside it
+            double qualities[kMiSnapJPEGProbesPerRound];
+            for (int i = 0; i < kMiSnapJPEGProbesPerRound; i++) {
+                qualities[i] = round == 0 ? low + (high - low) * i / (kMiSnapJPEGProbesPerRound - 1)
+                                          : low + (high - low) * (i + 1) / (kMiSnapJPEGProbesPerRound + 1);
+            }
+            NSMutableArray *encoded = [NSMutableArray arrayWithCapacity:kMiSnapJPEGProbesPerRound];
+            for (int i = 0; i < kMiSnapJPEGProbesPerRound; i++) {
+                [encoded addObject:[NSNull null]];
+            }
+            const double *probeQualities = qualities;
+            dispatch_apply(kMiSnapJPEGProbesPerRound, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+                NSData *data = MiSnapEncodeJPEG(image, properties, probeQualities[i]);
+                if (data != nil) {
+                    @synchronized (encoded) {
+                        [encoded replaceObjectAtIndex:i withObject:data];
+                    }
+                }
+            });
+            probes += kMiSnapJPEGProbesPerRound;
+            
+            //Sizes grow with quality, so the fitting probes form a prefix
+            double nextLow = low, nextHigh = high;
+            for (int i = 0; i < kMiSnapJPEGProbesPerRound; i++) {
+                NSData *data = [encoded objectAtIndex:i];
+                if (![data isKindOfClass:[NSData class]]) {
+                    continue;
+                }
+                if (smallest == nil || data.length < smallest.length) {
+                    smallest = data;
+                    smallestQuality = qualities[i];
+                }
+                if (data.length <= maxBytes) {
+                    if (qualities[i] > bestQuality) {
+                        best = data;
+                        bestQuality = qualities[i];
+                    }
+                    nextLow = qualities[i];
+                } else if (qualities[i] < nextHigh) {
+                    nextHigh = qualities[i];
+                    break;
+                }
+            }
+            if (best == nil || nextHigh <= nextLow) {
+                //Nothing fits even at the lowest quality, or the top of the range fits
+                break;
+            }
+            low = nextLow;
+            high = nextHigh;
+        }
+        if (best == nil && smallest.length < jpeg.length) {
+            best = smallest;
+            bestQuality = smallestQuality;
+        }
+        CGImageRelease(image);
+    }
+    if (source != NULL) {
+        CFRelease(source);
+    }
+    if (best == nil) {
+        best = jpeg;
+        bestQuality = -1;
+    }
+    
+    if (report) {
+        mach_timebase_info_data_t timebase;
+        mach_timebase_info(&timebase);
+        double encodeMs = (double)(mach_absolute_time() - start) * timebase.numer / timebase.denom / 1e6;
+        *report = @{ @"inputBytes": @(jpeg.length),
+                     @"outputBytes": @(best.length),
+                     @"quality": @(bestQuality < 0 ? -1 : (int)lround(bestQuality * 100)),
+                     @"probes": @(probes),
+                     @"fits": @(best.length <= maxBytes),
+                     @"encodeMs": @(encodeMs) };
+    }
+    return best;
+}
+
++ (NSData *)JPEGDataFromImage:(CGImageRef)image quality:(double)quality orientation:(int)orientation metadataFrom:(NSData *)metadataJPEG {
+    
+    NSMutableDictionary *properties = [NSMutableDictionary dictionary];
+    CGImageSourceRef source = metadataJPEG.length ? CGImageSourceCreateWithData((__bridge CFDataRef)metadataJPEG, NULL) : NULL;
+    if (source != NULL) {
+        [properties addEntriesFromDictionary:CFBridgingRelease(CGImageSourceCopyPropertiesAtIndex(source, 0, NULL))];
+        CFRelease(source);
+    }
+    NSMutableDictionary *exif = [[properties objectForKey:(__bridge NSString *)kCGImagePropertyExifDictionary] mutableCopy];
+    if (exif != nil) {
+        [exif setObject:@(CGImageGetWidth(image)) forKey:(__bridge NSString *)kCGImagePropertyExifPixelXDimension];
+        [exif setObject:@(CGImageGetHeight(image)) forKey:(__bridge NSString *)kCGImagePropertyExifPixelYDimension];
+        [properties setObject:exif forKey:(__bridge NSString *)kCGImagePropertyExifDictionary];
+    }
+    NSMutableDictionary *tiff = [[properties objectForKey:(__bridge NSString *)kCGImagePropertyTIFFDictionary] mutableCopy];
+    if (tiff != nil) {
+        [tiff setObject:@(orientation) forKey:(__bridge NSString *)kCGImagePropertyTIFFOrientation];
+        [properties setObject:tiff forKey:(__bridge NSString *)kCGImagePropertyTIFFDictionary];
+    }
+    [properties removeObjectForKey:(__bridge NSString *)kCGImagePropertyPixelWidth];
+    [properties removeObjectForKey:(__bridge NSString *)kCGImagePropertyPixelHeight];
+    [properties setObject:@(orientation) forKey:(__bridge NSString *)kCGImagePropertyOrientation];
+    return MiSnapEncodeJPEG(image, properties, quality);
+}
+
+@end
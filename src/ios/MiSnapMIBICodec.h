@@ -0,0 +1,32 @@
+
+#import <Foundation/Foundation.h>
+#import "MiSnapMIBICore.h"
+
+//Compact binary encoding for MIBI/UXP telemetry (kMiSnapMIBIData), on the format and codec of
+//MiSnapMIBICore.h: repeated strings become string-table references, integers and numeric strings
+//are zigzag varints, and all-integer arrays (per-frame metrics) are delta coded.
+
+@interface MiSnapMIBIWriter : NSObject
+
+//Appends one record and returns the bytes it took. The string table is shared by every record a
+//writer appends, so one writer per session lets later payloads reference the strings of earlier
+//ones. MIBI that is not a JSON object or array is kept as a raw record.
+- (NSUInteger)appendMIBIString:(NSString *)mibi;
+- (NSUInteger)appendObject:(id)object;
+
+//The bytes appended since the last call, the first time starting with the header. The chunks of
+//a writer decode as one stream, concatenated in order. nil if the writer ran out of memory.
+- (NSData *)takeData;
+
+@end
+
+@interface MiSnapMIBIReader : NSObject
+
+//Decodes every record of a stream. JSON records come back as Foundation objects; numeric strings
+//come back as strings and raw records as NSString. Returns nil with an error if the stream is malformed.
++ (NSArray *)recordsFromData:(NSData *)data error:(NSError **)error;
+
+//Decodes records back to the MIBI strings that were appended
++ (NSArray *)MIBIStringsFromData:(NSData *)data error:(NSError **)error;
+
+@end
@@ -0,0 +1,226 @@
+
+#import "MiSnapMIBICodec.h"
+
+static NSString* const kMiSnapMIBIErrorDomain = @"MiSnapMIBICodec";
+
+static bool MiSnapIsBoolean(NSNumber *number)
+{
+    return CFGetTypeID((__bridge CFTypeRef)number) == CFBooleanGetTypeID();
+}
+
+static bool MiSnapIsInteger(NSNumber *number)
+{
+    const char *type = [number objCType];
+    return !MiSnapIsBoolean(number) && strcmp(type, @encode(double)) != 0 && strcmp(type, @encode(float)) != 0;
+}
+
+//Unsigned integers above INT64_MAX; NSJSONSerialization gives them an unsigned type
+static bool MiSnapIsLargeUnsigned(NSNumber *number)
+{
+    const char *type = [number objCType];
+    return (strcmp(type, @encode(unsigned long long)) == 0 || strcmp(type, @encode(unsigned long)) == 0) && [number unsignedLongLongValue] > INT64_MAX;
+}
+
+@implementation MiSnapMIBIWriter {
+    MiSnapMIBIEncoder *_encoder;
+}
+
+- (instancetype)init {
+    
+    self = [super init];
+    if (self) {
+        _encoder = MiSnapMIBIEncoderCreate();
+        if (_encoder == NULL) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    
+    MiSnapMIBIEncoderFree(_encoder);
+}
+
+- (NSUInteger)pendingLength {
+    
+    size_t length;
+    MiSnapMIBIEncoderBytes(_encoder, &length);
+    return length;
+}
+
+- (NSUInteger)appendMIBIString:(NSString *)mibi {
+    
+    NSData *utf8 = [mibi dataUsingEncoding:NSUTF8StringEncoding];
+    id object = utf8 ? [NSJSONSerialization JSONObjectWithData:utf8 options:0 error:NULL] : nil;
+    if ([object isKindOfClass:[NSDictionary class]] || [object isKindOfClass:[NSArray class]]) {
+        return [self appendObject:object];
+    }
+    @synchronized (self) {
+        NSUInteger before = [self pendingLength];
+        MiSnapMIBIWriteRaw(_encoder, utf8.bytes, utf8.length);
+        return [self pendingLength] - before;
+    }
+}
+
+- (NSUInteger)appendObject:(id)object {
+    
+    @synchronized (self) {
+        NSUInteger before = [self pendingLength];
+        [self writeValue:object];
+        return [self pendingLength] - before;
+    }
+}
+
+- (NSData *)takeData {
+    
+    @synchronized (self) {
+        if (MiSnapMIBIEncoderFailed(_encoder)) {
+            return nil;
+        }
+        size_t length;
+        const uint8_t *bytes = MiSnapMIBIEncoderBytes(_encoder, &length);
+        NSData *data = [NSData dataWithBytes:bytes length:length];
+        MiSnapMIBIEncoderDrain(_encoder);
+        return data;
+    }
+}
+
+- (void)writeValue:(id)object {
+    
+    if (object == nil || object == [NSNull null]) {
+        MiSnapMIBIWriteNull(_encoder);
+    } else if ([object isKindOfClass:[NSString class]]) {
+        [self writeString:object];
+    } else if ([object isKindOfClass:[NSNumber class]]) {
+        [self writeNumber:object];
+    } else if ([object isKindOfClass:[NSArray class]]) {
+        [self writeArray:object];
+    } else if ([object isKindOfClass:[NSDictionary class]]) {
+        MiSnapMIBIWriteObject(_encoder, [object count]);
+        //Sorted keys keep the encoding deterministic
+        for (id key in [[object allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+            [self writeString:[key description]];
+            [self writeValue:[object objectForKey:key]];
+        }
+    } else {
+        [self writeString:[object description]];
+    }
+}
+
+- (void)writeString:(NSString *)string {
+    
+    NSData *utf8 = [string dataUsingEncoding:NSUTF8StringEncoding];
+    MiSnapMIBIWriteString(_encoder, utf8.bytes, utf8.length);
+}
+
+- (void)writeNumber:(NSNumber *)number {
+    
+    if (MiSnapIsBoolean(number)) {
+        MiSnapMIBIWriteBool(_encoder, [number boolValue]);
+    } else if (MiSnapIsLargeUnsigned(number)) {
+        MiSnapMIBIWriteUnsigned(_encoder, [number unsignedLongLongValue]);
+    } else if (MiSnapIsInteger(number)) {
+        MiSnapMIBIWriteInteger(_encoder, [number longLongValue]);
+    } else {
+        MiSnapMIBIWriteDouble(_encoder, [number doubleValue]);
+    }
+}
+
+- (void)writeArray:(NSArray *)array {
+    
+    //Delta coded when every element is an integer that fits an int64_t; anything else, including
+    //an unsigned integer above INT64_MAX, goes through the plain tokens
+    BOOL integers = array.count > 1;
+    for (id value in array) {
+        if (![value isKindOfClass:[NSNumber class]] || !MiSnapIsInteger(value) || MiSnapIsLargeUnsigned(value)) {
+            integers = NO;
+            break;
+        }
+    }
+    NSMutableData *values = integers ? [NSMutableData dataWithLength:array.count * sizeof(int64_t)] : nil;
+    if (values != nil) {
+        int64_t *cursor = values.mutableBytes;
+        for (NSNumber *value in array) {
+            *cursor++ = [value longLongValue];
+        }
+        MiSnapMIBIWriteIntegers(_encoder, values.bytes, array.count);
+        return;
+    }
+    MiSnapMIBIWriteArray(_encoder, array.count);
+    for (id value in array) {
+        [self writeValue:value];
+    }
+}
+
+@end
+
+@implementation MiSnapMIBIReader
+
++ (NSArray *)recordsFromData:(NSData *)data error:(NSError **)error {
+    
+    NSArray *strings = [self decodedRecordsFromData:data error:error];
+    if (strings == nil) {
+        return nil;
+    }
+    NSMutableArray *records = [NSMutableArray arrayWithCapacity:strings.count];
+    for (id string in strings) {
+        if ([string isKindOfClass:[NSData class]]) {
+            id record = [NSJSONSerialization JSONObjectWithData:string options:NSJSONReadingFragmentsAllowed error:error];
+            if (record == nil) {
+                return nil;
+            }
+            [records addObject:record];
+        } else {
+            [records addObject:string];
+        }
+    }
+    return records;
+}
+
++ (NSArray *)MIBIStringsFromData:(NSData *)data error:(NSError **)error {
+    
+    NSArray *strings = [self decodedRecordsFromData:data error:error];
+    if (strings == nil) {
+        return nil;
+    }
+    NSMutableArray *mibi = [NSMutableArray arrayWithCapacity:strings.count];
+    for (id string in strings) {
+        [mibi addObject:[string isKindOfClass:[NSData class]] ? [[NSString alloc] initWithData:string encoding:NSUTF8StringEncoding] ?: @"" : string];
+    }
+    return mibi;
+}
+
+//JSON records as UTF-8 NSData, raw records as NSString
++ (NSArray *)decodedRecordsFromData:(NSData *)data error:(NSError **)error {
+    
+    MiSnapMIBIDecoder decoder;
+    if (!MiSnapMIBIDecoderInit(&decoder, data.bytes, data.length)) {
+        if (error) {
+            *error = [NSError errorWithDomain:kMiSnapMIBIErrorDomain code:1 userInfo:@{ NSLocalizedDescriptionKey: @"Not a MIBI buffer" }];
+        }
+        return nil;
+    }
+    NSMutableArray *records = [NSMutableArray array];
+    MiSnapMIBIRecord record;
+    do {
+        MiSnapMIBIBuffer text = { 0 };
+        record = MiSnapMIBIReadRecord(&decoder, &text);
+        if (record == MiSnapMIBIRecordJSON) {
+            [records addObject:[NSData dataWithBytes:text.bytes length:text.length]];
+        } else if (record == MiSnapMIBIRecordRaw) {
+            [records addObject:[[NSString alloc] initWithBytes:text.bytes length:text.length encoding:NSUTF8StringEncoding] ?: @""];
+        }
+        MiSnapMIBIBufferFree(&text);
+    } while (record == MiSnapMIBIRecordJSON || record == MiSnapMIBIRecordRaw);
+    MiSnapMIBIDecoderFree(&decoder);
+    if (record == MiSnapMIBIRecordMalformed) {
+        if (error) {
+            *error = [NSError errorWithDomain:kMiSnapMIBIErrorDomain code:2 userInfo:@{ NSLocalizedDescriptionKey: @"Malformed MIBI buffer" }];
+        }
+        return nil;
+    }
+    return records;
+}
+
+@end
@@ -0,0 +1,14 @@
+
+#import <Foundation/Foundation.h>
+#import "MiSnapMICR.h"
+
+//Reads the MICR line of a check front on the device (see MiSnapMICR.h), so the routing number is
+//known before the image is uploaded
+@interface MiSnapMICRReader : NSObject
+
+//{ text, confidence, characters, routing, routingValid, ms } for the luma plane of a cropped check
+//front, where characters holds a { character, confidence } per character of text other than the
+//spaces. nil if no MICR line was found.
++ (NSDictionary *)readLuma:(const uint8_t *)luma width:(size_t)width height:(size_t)height rowBytes:(size_t)rowBytes;
+
+@end
@@ -0,0 +1,31 @@
+
+#import "MiSnapMICRReader.h"
+#import "MiSnapMetrics.h"
+
+@implementation MiSnapMICRReader
+
++ (NSDictionary *)readLuma:(const uint8_t *)luma width:(size_t)width height:(size_t)height rowBytes:(size_t)rowBytes {
+    
+    uint64_t start = MiSnapMetricsNow();
+    MiSnapMICRLine line;
+    bool found = MiSnapMICRRead(luma, width, height, rowBytes, &line);
+    double ms = MiSnapMetricsMsSince(start);
+    MiSnapMetricsRecordMs(MiSnapMetricMICR, ms);
+    if (!found) {
+        return nil;
+    }
+    
+    NSMutableArray *characters = [NSMutableArray arrayWithCapacity:line.count];
+    for (size_t i = 0; i < line.count; i++) {
+        [characters addObject:@{ @"character": [NSString stringWithFormat:@"%c", line.characters[i].character],
+                                 @"confidence": @(line.characters[i].confidence) }];
+    }
+    return @{ @"text": [NSString stringWithUTF8String:line.text],
+              @"confidence": @(line.confidence),
+              @"characters": characters,
+              @"routing": [NSString stringWithUTF8String:line.routing],
+              @"routingValid": @(line.routingValid),
+              @"ms": @(ms) };
+}
+
+@end
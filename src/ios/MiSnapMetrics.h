@@ -0,0 +1,8 @@
+
+#import <Foundation/Foundation.h>
+#import "MiSnapMetricsCore.h"
+
+//The capture metrics of MiSnapMetricsCore.h for the web layer
+
+//{ histograms: { startup: { count, meanMs, p50Ms, p90Ms, p99Ms, maxMs }, ... }, counters: { ... } }
+NSDictionary *MiSnapMetricsDictionary(BOOL reset);
@@ -0,0 +1,29 @@
+
+#import "MiSnapMetrics.h"
+
+NSDictionary *MiSnapMetricsDictionary(BOOL reset)
+{
+    static NSString *const metricNames[MiSnapMetricCount] = {
+        @"startup", @"firstFrame", @"timeToAccept", @"encode", @"delivery", @"queueWait", @"finish", @"micr"
+    };
+    static NSString *const counterNames[MiSnapCounterCount] = {
+        @"captures", @"cancellations", @"timeouts", @"failovers", @"cameraNotSufficient", @"rejections", @"preemptions"
+    };
+    
+    NSMutableDictionary *histograms = [NSMutableDictionary dictionary];
+    for (int metric = 0; metric < MiSnapMetricCount; metric++) {
+        MiSnapHistogramSummary summary;
+        MiSnapMetricsSummarize(metric, reset, &summary);
+        [histograms setObject:@{ @"count": @(summary.count),
+                                 @"meanMs": @(summary.mean / 1000),
+                                 @"p50Ms": @(summary.p50 / 1000.0),
+                                 @"p90Ms": @(summary.p90 / 1000.0),
+                                 @"p99Ms": @(summary.p99 / 1000.0),
+                                 @"maxMs": @(summary.max / 1000.0) } forKey:metricNames[metric]];
+    }
+    NSMutableDictionary *counters = [NSMutableDictionary dictionary];
+    for (int counter = 0; counter < MiSnapCounterCount; counter++) {
+        [counters setObject:@(MiSnapMetricsCounterValue(counter, reset)) forKey:counterNames[counter]];
+    }
+    return @{ @"histograms": histograms, @"counters": counters };
+}
@@ -3,11 +3,50 @@
 //#import <Cordova/Cordova.h>
 #import <Cordova/CDV.h>
 #import "MiSnap.h"
+#import "MiSnapFrameAnalyzer.h"
+#import "MiSnapProfiles.h"
+#import "MiSnapStartup.h"
+#import "MiSnapCaptureViewController.h"
+#import "MiSnapCaptureSession.h"
+
+//Values for the resultType capture option
+extern NSString* const kMiSnapPluginResultTypeText;
+extern NSString* const kMiSnapPluginResultTypeArrayBuffer;
+extern NSString* const kMiSnapPluginResultTypeHandle;
+
+//Values for the mibiEncoding capture option
+extern NSString* const kMiSnapPluginMIBIEncodingJSON;
+extern NSString* const kMiSnapPluginMIBIEncodingCompact;
 
 @interface MiSnapPlugin : CDVPlugin<MiSnapViewControllerDelegate,UIImagePickerControllerDelegate>
 
-@property(nonatomic,retain) CDVInvokedUrlCommand* cmd;
+//Every capture call from its admission until its result is delivered, keyed by callbackId. The
+//session table decides which of them owns the camera.
+@property(nonatomic,retain) NSMutableDictionary* sessions;
+@property(nonatomic,assign) MiSnapSessionTable sessionTable;
+//Callback kept open by watchQuality for the live quality events, nil when nobody is watching
+@property(nonatomic,copy) NSString* qualityCallbackId;
+@property(nonatomic,assign) double qualityMaxRate;
+
+//Controller built by prewarm for warmProfile, nil when cold. startup times the controller in use.
+@property(nonatomic,retain) MiSnapCaptureViewController* warmController;
+@property(nonatomic,assign) MiSnapProfile warmProfile;
+@property(nonatomic,assign) BOOL keepWarm;
+@property(nonatomic,assign) MiSnapStartupTimeline startup;
 
 - (void) cordovaCallMiSnap:(CDVInvokedUrlCommand *)command;
+- (void) captureBatch:(CDVInvokedUrlCommand *)command;
+- (void) replayFrames:(CDVInvokedUrlCommand *)command;
+- (void) benchmark:(CDVInvokedUrlCommand *)command;
+- (void) prewarm:(CDVInvokedUrlCommand *)command;
+- (void) getMetrics:(CDVInvokedUrlCommand *)command;
+- (void) watchQuality:(CDVInvokedUrlCommand *)command;
+- (void) clearQualityWatch:(CDVInvokedUrlCommand *)command;
+
+//Captures stored with resultType "handle"
+- (void) readCapture:(CDVInvokedUrlCommand *)command;
+- (void) readCaptureChunk:(CDVInvokedUrlCommand *)command;
+- (void) deleteCapture:(CDVInvokedUrlCommand *)command;
+- (void) listCaptures:(CDVInvokedUrlCommand *)command;
 
 @end
@@ -1,31 +1,680 @@
 
 #import "MiSnapPlugin.h"
+#import "MiSnapBase64.h"
+#import "MiSnapFrameScorer.h"
+#import "MiSnapFrameReplay.h"
+#import "MiSnapBenchmark.h"
+#import "MiSnapCaptureViewController.h"
+#import "MiSnapProfiles.h"
+#import "MiSnapMIBICodec.h"
+#import "MiSnapJPEGEncoder.h"
+#import "MiSnapImageScaler.h"
+#import "MiSnapCaptureSpool.h"
+#import "MiSnapDuplicateIndex.h"
+#import "MiSnapMICRReader.h"
+#import "MiSnapMetrics.h"
+#import "MiSnapAAMVA.h"
+#import "MiSnapBufferPool.h"
+
+NSString* const kMiSnapPluginResultTypeText = @"text";
+NSString* const kMiSnapPluginResultTypeArrayBuffer = @"arraybuffer";
+NSString* const kMiSnapPluginResultTypeHandle = @"handle";
+NSString* const kMiSnapPluginMIBIEncodingJSON = @"json";
+NSString* const kMiSnapPluginMIBIEncodingCompact = @"compact";
+
+//Live quality events per second unless watchQuality is given maxRate
+static const double kMiSnapPluginDefaultQualityRate = 4;
+
+//Captures that may wait for the camera, and finished captures whose results may be staged and
+//delivered at once, unless set by preferences
+static const NSUInteger kMiSnapPluginDefaultMaxQueuedSessions = 4;
+static const NSUInteger kMiSnapPluginDefaultMaxFinishingSessions = 2;
+
+//Session table time
+static double MiSnapPluginNowMs(void)
+{
+    return MiSnapMetricsNow() / 1e6;
+}
+
+//A non-negative number option, or value when it is missing or not a number
+static NSUInteger MiSnapPluginUnsignedOption(NSDictionary *options, NSString *key, NSUInteger value)
+{
+    id option = [options objectForKey:key];
+    if ([option isKindOfClass:[NSNumber class]] && [option longLongValue] >= 0) {
+        return [option unsignedIntegerValue];
+    }
+    return value;
+}
+
+//maxBytes and targetWidth must be non-negative numbers when given; returns the error for the
+//first that is not
+static NSString *MiSnapPluginImageOptionsError(NSDictionary *options)
+{
+    for (NSString *key in @[ @"maxBytes", @"targetWidth" ]) {
+        id option = [options objectForKey:key];
+        if (option != nil && option != [NSNull null] && !([option isKindOfClass:[NSNumber class]] && [option longLongValue] >= 0)) {
+            return [NSString stringWithFormat:@"Invalid %@", key];
+        }
+    }
+    return nil;
+}
 
 @implementation MiSnapPlugin
 
+- (void)pluginInitialize
+{
+    [super pluginInitialize];
+    MiSnapStartupInit(&_startup, NULL);
+    
+    //<preference name="MiSnapBufferPoolBytes" value="..." /> sets the idle bytes the buffer pool keeps
+    id poolBytes = [self.commandDelegate.settings objectForKey:[@"MiSnapBufferPoolBytes" lowercaseString]];
+    if ([poolBytes respondsToSelector:@selector(longLongValue)] && [poolBytes longLongValue] >= 0) {
+        MiSnapBufferPoolSetHighWater(MiSnapSharedBufferPool(), (size_t)[poolBytes longLongValue]);
+    }
+    
+    //MiSnapMaxQueuedSessions and MiSnapMaxFinishingSessions bound the session table
+    self.sessions = [NSMutableDictionary dictionary];
+    MiSnapSessionTableInit(&_sessionTable,
+                           [self unsignedPreference:@"MiSnapMaxQueuedSessions" withDefault:kMiSnapPluginDefaultMaxQueuedSessions],
+                           [self unsignedPreference:@"MiSnapMaxFinishingSessions" withDefault:kMiSnapPluginDefaultMaxFinishingSessions]);
+}
+
+- (NSUInteger)unsignedPreference:(NSString *)name withDefault:(NSUInteger)value
+{
+    id preference = [self.commandDelegate.settings objectForKey:[name lowercaseString]];
+    if ([preference respondsToSelector:@selector(integerValue)] && [preference integerValue] >= 0) {
+        return [preference integerValue];
+    }
+    return value;
+}
+
+- (void)onMemoryWarning
+{
+    [super onMemoryWarning];
+    MiSnapBufferPoolTrim(MiSnapSharedBufferPool());
+}
+
 - (void) cordovaCallMiSnap:(CDVInvokedUrlCommand *)command
 {
 #if(__i386__ ||__x86_64__)
     //Nothing to do here, we are on simulator
 #else
-    self.cmd=command;
+    //Options passed from the web layer, e.g. { resultType: "arraybuffer", parameters: { sharpness: 700 } }
+    NSDictionary *options = [command argumentAtIndex:0 withDefault:nil andClass:[NSDictionary class]];
+    
+    //MiSnap Invocation with default parameters for check front unless another document type is requested
+    NSString *documentType = [options objectForKey:@"documentType"] ?: @"CheckFront";
+    MiSnapProfile profile;
+    NSString *error = [self profile:&profile forDocumentType:documentType overrides:[options objectForKey:@"parameters"]] ?: MiSnapPluginImageOptionsError(options);
+    if (error) {
+        [self.commandDelegate sendPluginResult:[CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:error] callbackId:command.callbackId];
+        return;
+    }
+    
+    MiSnapCaptureSession *session = [[MiSnapCaptureSession alloc] initWithCommand:command options:options];
+    session.profile = profile;
+    session.maxBytes = MiSnapPluginUnsignedOption(options, @"maxBytes", 0);
+    session.targetWidth = MiSnapPluginUnsignedOption(options, @"targetWidth", 0);
+    
+    NSLog(@"COMMAND:%@",command.callbackId);
+    
+    [self admitSession:session];
+#endif
+}
+
+//Captures several documents (e.g. CheckFront then CheckBack) in one call. While document N+1 is
+//being captured, document N is decoded and scored in the background; a single result carrying
+//every capture is sent once the last one has been staged.
+
+- (void) captureBatch:(CDVInvokedUrlCommand *)command
+{
+#if(__i386__ ||__x86_64__)
+    //Nothing to do here, we are on simulator
+#else
+    NSArray *documentTypes = [command argumentAtIndex:0 withDefault:nil andClass:[NSArray class]];
+    NSDictionary *options = [command argumentAtIndex:1 withDefault:nil andClass:[NSDictionary class]];
+    NSDictionary *overrides = [options objectForKey:@"parameters"];
+    
+    NSMutableArray *profiles = [NSMutableArray arrayWithCapacity:documentTypes.count];
+    NSString *error = documentTypes.count ? nil : @"No document types";
+    for (id documentType in documentTypes) {
+        MiSnapProfile profile;
+        error = [self profile:&profile forDocumentType:documentType overrides:[overrides isKindOfClass:[NSDictionary class]] ? [overrides objectForKey:documentType] : nil];
+        if (error) {
+            break;
+        }
+        [profiles addObject:[NSValue valueWithBytes:&profile objCType:@encode(MiSnapProfile)]];
+    }
+    error = error ?: MiSnapPluginImageOptionsError(options);
+    if (error) {
+        [self.commandDelegate sendPluginResult:[CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:error] callbackId:command.callbackId];
+        return;
+    }
     
-    //MiSnap Invocation with default parameters for check front
-    NSDictionary *videoParameters = [MiSnapViewController defaultParametersForCheckFront];
-    MiSnapViewController *controller = [[MiSnapViewController alloc] init];
+    MiSnapCaptureSession *session = [[MiSnapCaptureSession alloc] initWithCommand:command options:options];
+    session.resultType = [[options objectForKey:@"resultType"] isEqual:kMiSnapPluginResultTypeHandle] ? kMiSnapPluginResultTypeHandle : kMiSnapPluginResultTypeArrayBuffer;
+    session.batchDocumentTypes = documentTypes;
+    session.batchProfiles = profiles;
+    session.batchCaptures = [NSMutableArray array];
+    session.batchImages = [NSMutableArray array];
+    session.batchGroup = dispatch_group_create();
+    session.profile = [session batchProfileAtIndex:0];
+    session.maxBytes = MiSnapPluginUnsignedOption(options, @"maxBytes", 0);
+    session.targetWidth = MiSnapPluginUnsignedOption(options, @"targetWidth", 0);
+    
+    [self admitSession:session];
+#endif
+}
+
+#pragma mark -
+#pragma mark Sessions
+
+//Starts the session if the camera is free. Otherwise its sessionPolicy decides: "queue" (the
+//default) waits for the sessions before it, "reject" fails at once and "preempt" takes the camera
+//from the session capturing, which fails with "Preempted".
+
+- (void)admitSession:(MiSnapCaptureSession *)session
+{
+    char preempted[kMiSnapSessionKeyBytes];
+    MiSnapSessionAdmission admission = MiSnapSessionAdmit(&_sessionTable, [session.callbackId UTF8String], session.policy, MiSnapPluginNowMs(), preempted);
+    NSString *error = nil;
+    switch (admission) {
+        case MiSnapSessionAdmitBusy:
+            error = @"Capture in progress";
+            break;
+        case MiSnapSessionAdmitFull:
+            error = @"Too many captures waiting";
+            break;
+        case MiSnapSessionAdmitDuplicate:
+            error = @"Capture already started";
+            break;
+        default:
+            break;
+    }
+    if (error) {
+        MiSnapMetricsIncrement(MiSnapCounterRejections);
+        [self.commandDelegate sendPluginResult:[CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:error] callbackId:session.callbackId];
+        return;
+    }
+    
+    [self.sessions setObject:session forKey:session.callbackId];
+    if (admission == MiSnapSessionAdmitPreempted) {
+        [self endPreemptedSession:[self.sessions objectForKey:@(preempted)]];
+    }
+    if (admission != MiSnapSessionAdmitQueued) {
+        [self presentMiSnapWhenIdleForSession:session withProfile:session.profile];
+    }
+}
+
+//The preempted controller is dismissed when the next one is presented. Its delegate is cleared
+//first, so nothing it still reports is taken for the new session.
+
+- (void)endPreemptedSession:(MiSnapCaptureSession *)session
+{
+    session.controller.delegate = nil;
+    [session.frameAnalyzer stop];
+    [self.sessions removeObjectForKey:session.callbackId];
+    MiSnapMetricsIncrement(MiSnapCounterPreemptions);
+    [self.commandDelegate sendPluginResult:[CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:@"Preempted"] callbackId:session.callbackId];
+}
+
+- (MiSnapCaptureSession *)capturingSession
+{
+    const MiSnapSession *capturing = MiSnapSessionCapturing(&_sessionTable);
+    return capturing != NULL ? [self.sessions objectForKey:@(capturing->key)] : nil;
+}
+
+//The capture is over: the camera goes to the next session while this one's result is staged
+
+- (void)sessionCaptured:(MiSnapCaptureSession *)session
+{
+    MiSnapSessionCaptured(&_sessionTable, [session.callbackId UTF8String], MiSnapPluginNowMs());
+    //Queued behind startupEnded, so the next capture starts on a finished startup timeline
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self startNextSession];
+    });
+}
+
+//Called on the main thread once the session's result has been sent, or when it was cancelled
+
+- (void)finishSession:(MiSnapCaptureSession *)session
+{
+    const char *key = [session.callbackId UTF8String];
+    const MiSnapSession *state = MiSnapSessionFind(&_sessionTable, key);
+    BOOL captured = state != NULL && state->state == MiSnapSessionStateFinishing;
+    MiSnapSessionTiming timing;
+    if (MiSnapSessionFinish(&_sessionTable, key, MiSnapPluginNowMs(), &timing)) {
+        MiSnapMetricsRecordMs(MiSnapMetricQueueWait, timing.queuedMs);
+        if (captured) {
+            MiSnapMetricsRecordMs(MiSnapMetricFinish, timing.finishMs);
+        }
+    }
+    [self.sessions removeObjectForKey:session.callbackId];
+    [self startNextSession];
+}
+
+- (void)startNextSession
+{
+    const char *key = MiSnapSessionNext(&_sessionTable, MiSnapPluginNowMs());
+    MiSnapCaptureSession *session = key != NULL ? [self.sessions objectForKey:@(key)] : nil;
+    if (session != nil) {
+        [self presentMiSnapWhenIdleForSession:session withProfile:session.profile];
+    }
+}
+
+//{ capturing, queued, finishing, admitted, ... } for getMetrics
+
+- (NSDictionary *)sessionsDictionary:(BOOL)reset
+{
+    MiSnapSessionStatistics statistics = _sessionTable.statistics;
+    if (reset) {
+        memset(&_sessionTable.statistics, 0, sizeof(_sessionTable.statistics));
+    }
+    return @{ @"capturing": @(MiSnapSessionCount(&_sessionTable, MiSnapSessionStateCapturing)),
+              @"queued": @(MiSnapSessionCount(&_sessionTable, MiSnapSessionStateQueued)),
+              @"finishing": @(MiSnapSessionCount(&_sessionTable, MiSnapSessionStateFinishing)),
+              @"admitted": @(statistics.admitted),
+              @"waited": @(statistics.queued),
+              @"rejected": @(statistics.rejected),
+              @"preempted": @(statistics.preempted),
+              @"finished": @(statistics.finished) };
+}
+
+//Validates the document type and parameter overrides; returns an error message or nil
+
+- (NSString *)profile:(MiSnapProfile *)profile forDocumentType:(id)documentType overrides:(id)overrides
+{
+    const MiSnapProfile *defaults = MiSnapProfileForDocumentType(documentType);
+    if (defaults == NULL) {
+        return [NSString stringWithFormat:@"Unknown document type %@", documentType];
+    }
+    *profile = *defaults;
+    if (overrides != nil && ![overrides isKindOfClass:[NSDictionary class]]) {
+        return @"Invalid parameters";
+    }
+    NSString *error = nil;
+    MiSnapProfileApplyOverrides(profile, overrides, &error);
+    return error;
+}
+
+//Builds and sets up a MiSnap controller, timing each phase on the startup timeline
+
+- (MiSnapCaptureViewController *)controllerWithProfile:(MiSnapProfile)profile
+{
+#if(__i386__ ||__x86_64__)
+    //Nothing to do here, we are on simulator
+    return nil;
+#else
+    MiSnapStartupBegin(&_startup, MiSnapStartupPhaseParameters);
+    NSDictionary *videoParameters = MiSnapProfileParameters(&profile);
+    MiSnapStartupEnd(&_startup, MiSnapStartupPhaseParameters);
+    
+    MiSnapStartupBegin(&_startup, MiSnapStartupPhaseController);
+    MiSnapCaptureViewController *controller = [[MiSnapCaptureViewController alloc] init];
     controller.delegate = self;
     controller.navigationController.navigationBar.hidden=YES;
+    MiSnapStartupEnd(&_startup, MiSnapStartupPhaseController);
+    
+    MiSnapStartupBegin(&_startup, MiSnapStartupPhaseSetup);
     [controller setupMiSnapWithParams:videoParameters];
+    MiSnapStartupEnd(&_startup, MiSnapStartupPhaseSetup);
     
+    MiSnapStartupBegin(&_startup, MiSnapStartupPhaseView);
+    [controller view];
+    MiSnapStartupEnd(&_startup, MiSnapStartupPhaseView);
+    return controller;
+#endif
+}
+
+- (void)presentMiSnapForSession:(MiSnapCaptureSession *)session withProfile:(MiSnapProfile)profile
+{
+#if(__i386__ ||__x86_64__)
+    //Nothing to do here, we are on simulator
+#else
+    //Use the prewarmed controller if it was built for exactly this profile
+    MiSnapCaptureViewController *controller = nil;
+    if (self.warmController != nil && MiSnapProfileEqual(&profile, &_warmProfile) && MiSnapStartupHandle(&_startup, MiSnapStartupEventPresentWarm)) {
+        controller = self.warmController;
+    } else {
+        MiSnapStartupHandle(&_startup, MiSnapStartupEventFinish);
+        MiSnapStartupHandle(&_startup, MiSnapStartupEventPresent);
+        controller = [self controllerWithProfile:profile];
+    }
+    self.warmController = nil;
+    session.profile = profile;
+    session.controller = controller;
     
-    NSLog(@"COMMAND:%@",command.callbackId);
+    //Live frames are scored on a worker queue, off the camera callback
+    session.frameAnalyzer = [[MiSnapFrameAnalyzer alloc] initWithThresholds:MiSnapProfileThresholds(&profile)
+                                                                  torchMode:MiSnapProfileValue(&profile, MiSnapProfileFieldTorchMode)
+                                                             driversLicense:MiSnapProfileIsDriversLicense(&profile)
+                                                             bestOfWindowMs:session.bestOfWindowMs];
+    controller.frameAnalyzer = session.frameAnalyzer;
+    if (self.qualityCallbackId != nil) {
+        [session.frameAnalyzer setEventHandler:[self qualityEventHandler] maxRate:self.qualityMaxRate];
+    }
     
+    __weak MiSnapPlugin *weakSelf = self;
+    controller.firstFrameHandler = ^{
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [weakSelf startupReachedFirstFrame];
+        });
+    };
+    MiSnapStartupBegin(&_startup, MiSnapStartupPhasePresent);
+    MiSnapStartupBegin(&_startup, MiSnapStartupPhaseFirstFrame);
     [self.viewController presentViewController:controller animated:NO completion:^{
-        
+        MiSnapStartupEnd(&self->_startup, MiSnapStartupPhasePresent);
+        MiSnapMetricsRecordMs(MiSnapMetricStartup, MiSnapStartupVisibleMs(&self->_startup));
     }];
 #endif
 }
 
+//The next batch document or session can only be presented once the previous MiSnap controller is
+//gone. Nothing is presented if the session lost the camera in the meantime.
+
+- (void)presentMiSnapWhenIdleForSession:(MiSnapCaptureSession *)session withProfile:(MiSnapProfile)profile
+{
+    UIViewController *presented = self.viewController.presentedViewController;
+    if ([self capturingSession] != session) {
+        return;
+    } else if (presented == nil) {
+        [self presentMiSnapForSession:session withProfile:profile];
+    } else if (presented.isBeingDismissed) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.1 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+            [self presentMiSnapWhenIdleForSession:session withProfile:profile];
+        });
+    } else {
+        [self.viewController dismissViewControllerAnimated:NO completion:^{
+            [self presentMiSnapWhenIdleForSession:session withProfile:profile];
+        }];
+    }
+}
+
+//Builds the MiSnap controller for a document type ahead of time, so that the next capture with
+//the same document type and parameters only has to present it. With keepWarm a new controller
+//is built after every capture. Reports the time taken by each startup phase.
+
+- (void) prewarm:(CDVInvokedUrlCommand *)command
+{
+#if(__i386__ ||__x86_64__)
+    //Nothing to do here, we are on simulator
+#else
+    NSString *documentType = [command argumentAtIndex:0 withDefault:@"CheckFront" andClass:[NSString class]];
+    NSDictionary *options = [command argumentAtIndex:1 withDefault:nil andClass:[NSDictionary class]];
+    MiSnapProfile profile;
+    NSString *error = [self profile:&profile forDocumentType:documentType overrides:[options objectForKey:@"parameters"]];
+    if (error == nil && self.startup.state == MiSnapStartupStateWarm) {
+        //Replace the controller warmed up for another profile
+        self.warmController = nil;
+        MiSnapStartupHandle(&_startup, MiSnapStartupEventFinish);
+    }
+    if (error == nil && !MiSnapStartupHandle(&_startup, MiSnapStartupEventPrewarm)) {
+        error = @"Capture in progress";
+    }
+    if (error) {
+        [self.commandDelegate sendPluginResult:[CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:error] callbackId:command.callbackId];
+        return;
+    }
+    
+    self.keepWarm = [[options objectForKey:@"keepWarm"] boolValue];
+    self.warmProfile = profile;
+    self.warmController = [self controllerWithProfile:profile];
+    
+    CDVPluginResult *pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:MiSnapStartupDictionary(&_startup)];
+    [self.commandDelegate sendPluginResult:pluginResult callbackId:command.callbackId];
+#endif
+}
+
+- (void)startupReachedFirstFrame
+{
+    if (MiSnapStartupHandle(&_startup, MiSnapStartupEventFirstFrame)) {
+        MiSnapStartupEnd(&_startup, MiSnapStartupPhaseFirstFrame);
+        MiSnapMetricsRecordMs(MiSnapMetricFirstFrame, MiSnapStartupPhaseMs(&_startup, MiSnapStartupPhaseFirstFrame));
+    }
+}
+
+//Called once a capture is over; the controller is rebuilt for the next capture when keepWarm is set
+
+- (void)startupEnded
+{
+    MiSnapStartupHandle(&_startup, MiSnapStartupEventFinish);
+    [self prewarmWhenIdle];
+}
+
+- (void)prewarmWhenIdle
+{
+    if (!self.keepWarm || MiSnapSessionCapturing(&_sessionTable) != NULL || MiSnapSessionCount(&_sessionTable, MiSnapSessionStateQueued) > 0 || self.startup.state != MiSnapStartupStateCold) {
+        return;
+    }
+    UIViewController *presented = self.viewController.presentedViewController;
+    if (presented.isBeingDismissed) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.1 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+            [self prewarmWhenIdle];
+        });
+    } else if (presented == nil && MiSnapStartupHandle(&_startup, MiSnapStartupEventPrewarm)) {
+        self.warmController = [self controllerWithProfile:self.warmProfile];
+    }
+}
+
+//Latency histograms and outcome counters since launch, or since the last call with reset: true
+
+- (void) getMetrics:(CDVInvokedUrlCommand *)command
+{
+    NSDictionary *options = [command argumentAtIndex:0 withDefault:nil andClass:[NSDictionary class]];
+    BOOL reset = [[options objectForKey:@"reset"] boolValue];
+    NSMutableDictionary *metrics = [MiSnapMetricsDictionary(reset) mutableCopy];
+    [metrics setObject:MiSnapBufferPoolDictionary(MiSnapSharedBufferPool(), reset) forKey:@"bufferPool"];
+    [metrics setObject:[self sessionsDictionary:reset] forKey:@"sessions"];
+    CDVPluginResult *pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:metrics];
+    [self.commandDelegate sendPluginResult:pluginResult callbackId:command.callbackId];
+}
+
+//Keeps the callback open and sends it the quality of the live frames of every capture from now
+//on, throttled to maxRate events per second: { type: "quality", ... } while a capture runs and
+//{ type: "end", ... } when it finishes. A new watchQuality replaces the previous one.
+
+- (void) watchQuality:(CDVInvokedUrlCommand *)command
+{
+    NSDictionary *options = [command argumentAtIndex:0 withDefault:nil andClass:[NSDictionary class]];
+    id maxRate = [options objectForKey:@"maxRate"];
+    [self endQualityWatch];
+    self.qualityCallbackId = command.callbackId;
+    self.qualityMaxRate = [maxRate respondsToSelector:@selector(doubleValue)] && [maxRate doubleValue] > 0 ? [maxRate doubleValue] : kMiSnapPluginDefaultQualityRate;
+    
+    CDVPluginResult *pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_NO_RESULT];
+    [pluginResult setKeepCallbackAsBool:YES];
+    [self.commandDelegate sendPluginResult:pluginResult callbackId:command.callbackId];
+}
+
+- (void) clearQualityWatch:(CDVInvokedUrlCommand *)command
+{
+    [self endQualityWatch];
+    [self.commandDelegate sendPluginResult:[CDVPluginResult resultWithStatus:CDVCommandStatus_OK] callbackId:command.callbackId];
+}
+
+//Releases the watching callback; a capture in progress keeps sending to it until it ends
+
+- (void)endQualityWatch
+{
+    if (self.qualityCallbackId != nil) {
+        [self.commandDelegate sendPluginResult:[CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:@{ @"type": @"cleared" }] callbackId:self.qualityCallbackId];
+        self.qualityCallbackId = nil;
+    }
+}
+
+//Runs on the analysis queue, so the events never hold up the camera callback or the main thread
+
+- (void (^)(NSDictionary *event))qualityEventHandler
+{
+    NSString *callbackId = self.qualityCallbackId;
+    id<CDVCommandDelegate> commandDelegate = self.commandDelegate;
+    return ^(NSDictionary *event) {
+        CDVPluginResult *pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:event];
+        [pluginResult setKeepCallbackAsBool:YES];
+        [commandDelegate sendPluginResult:pluginResult callbackId:callbackId];
+    };
+}
+
+//Replays a raw NV12/BGRA frame dump through the frame analysis pipeline. Available on the
+//simulator as well, since it does not need the camera or libMiSnap.a
+
+- (void) replayFrames:(CDVInvokedUrlCommand *)command
+{
+    NSDictionary *options = [command argumentAtIndex:0 withDefault:@{} andClass:[NSDictionary class]];
+    NSString *path = [options objectForKey:@"path"];
+    if (![path isKindOfClass:[NSString class]]) {
+        [self.commandDelegate sendPluginResult:[CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:@"Missing path"] callbackId:command.callbackId];
+        return;
+    }
+    if ([path hasPrefix:@"file://"]) {
+        path = [[NSURL URLWithString:path] path];
+    }
+    
+    MiSnapFrameFormat format = [[options objectForKey:@"format"] isEqual:@"bgra"] ? MiSnapFrameFormatBGRA : MiSnapFrameFormatNV12;
+    MiSnapFrameReplay *replay = [[MiSnapFrameReplay alloc] initWithPath:path
+                                                                  width:MiSnapPluginUnsignedOption(options, @"width", 0)
+                                                                 height:MiSnapPluginUnsignedOption(options, @"height", 0)
+                                                               rowBytes:MiSnapPluginUnsignedOption(options, @"rowBytes", 0)
+                                                                 format:format];
+    
+    MiSnapFrameThresholds thresholds = [MiSnapFrameScorer defaultThresholdsForDocumentType:[options objectForKey:@"documentType"]];
+    if ([options objectForKey:@"brightness"]) thresholds.minBrightness = [[options objectForKey:@"brightness"] intValue];
+    if ([options objectForKey:@"maxBrightness"]) thresholds.maxBrightness = [[options objectForKey:@"maxBrightness"] intValue];
+    if ([options objectForKey:@"sharpness"]) thresholds.sharpness = [[options objectForKey:@"sharpness"] intValue];
+    if ([options objectForKey:@"angle"]) thresholds.angle = [[options objectForKey:@"angle"] intValue];
+    replay.thresholds = thresholds;
+    const MiSnapProfile *profile = MiSnapProfileForDocumentType([options objectForKey:@"documentType"]);
+    if (profile != NULL) {
+        replay.torchMode = MiSnapProfileValue(profile, MiSnapProfileFieldTorchMode);
+        replay.driversLicense = MiSnapProfileIsDriversLicense(profile);
+    }
+    NSInteger torchMode = [[options objectForKey:@"torchMode"] integerValue];
+    if ([options objectForKey:@"torchMode"] && torchMode >= MiSnapTorchModeOff && torchMode <= MiSnapTorchModeAutoDriversLicense) {
+        replay.torchMode = torchMode;
+    }
+    if ([options objectForKey:@"frameRate"]) {
+        replay.frameRate = [[options objectForKey:@"frameRate"] doubleValue];
+    }
+    if ([options objectForKey:@"bestOfWindowMs"]) {
+        replay.bestOfWindowMs = [[options objectForKey:@"bestOfWindowMs"] doubleValue];
+    }
+    replay.candidates = MiSnapPluginUnsignedOption(options, @"candidates", replay.candidates);
+    
+    [self.commandDelegate runInBackground:^{
+        NSError *error = nil;
+        NSDictionary *report = [replay run:&error];
+        CDVPluginResult *pluginResult;
+        if (report) {
+            pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:report];
+        } else {
+            pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:[error localizedDescription]];
+        }
+        [self.commandDelegate sendPluginResult:pluginResult callbackId:command.callbackId];
+    }];
+}
+
+//Times the capture kernels on synthetic frames (see MiSnapBenchmark.h) and returns the report.
+//With path the report is also written there as JSON, to be collected and diffed between
+//releases. Available on the simulator as well.
+
+- (void) benchmark:(CDVInvokedUrlCommand *)command
+{
+    NSDictionary *options = [command argumentAtIndex:0 withDefault:@{} andClass:[NSDictionary class]];
+    MiSnapBenchmark *benchmark = [[MiSnapBenchmark alloc] init];
+    benchmark.iterations = MiSnapPluginUnsignedOption(options, @"iterations", benchmark.iterations);
+    if ([[options objectForKey:@"sizes"] isKindOfClass:[NSArray class]]) {
+        benchmark.sizes = [options objectForKey:@"sizes"];
+    }
+    NSString *path = [options objectForKey:@"path"];
+    if ([path isKindOfClass:[NSString class]] && [path hasPrefix:@"file://"]) {
+        path = [[NSURL URLWithString:path] path];
+    }
+    
+    [self.commandDelegate runInBackground:^{
+        NSDictionary *report = [benchmark run];
+        CDVPluginResult *pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:report];
+        if ([path isKindOfClass:[NSString class]]) {
+            NSError *error = nil;
+            NSData *json = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted error:&error];
+            if (json == nil || ![json writeToFile:path options:NSDataWritingAtomic error:&error]) {
+                pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:[error localizedDescription]];
+            }
+        }
+        [self.commandDelegate sendPluginResult:pluginResult callbackId:command.callbackId];
+    }];
+}
+
+#pragma mark -
+#pragma mark Capture spool
+
+//Returns a spooled capture as (ArrayBuffer, results) like resultType "arraybuffer"
+
+- (void) readCapture:(CDVInvokedUrlCommand *)command
+{
+    uint64_t handle = [[command argumentAtIndex:0 withDefault:@0 andClass:[NSNumber class]] unsignedLongLongValue];
+    [self.commandDelegate runInBackground:^{
+        NSData *jpeg = nil;
+        NSDictionary *results = nil;
+        CDVPluginResult *pluginResult;
+        if ([[MiSnapCaptureSpool sharedSpool] readCapture:handle jpeg:&jpeg results:&results]) {
+            pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsMultipart:@[jpeg, results ?: @{}]];
+        } else {
+            pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:@"No such capture"];
+        }
+        [self.commandDelegate sendPluginResult:pluginResult callbackId:command.callbackId];
+    }];
+}
+
+//Returns length bytes of a spooled JPEG from offset as (ArrayBuffer, { offset, length, total }), so
+//large images can cross the bridge in pieces. Past the end the ArrayBuffer is empty.
+
+- (void) readCaptureChunk:(CDVInvokedUrlCommand *)command
+{
+    uint64_t handle = [[command argumentAtIndex:0 withDefault:@0 andClass:[NSNumber class]] unsignedLongLongValue];
+    int64_t offset = [[command argumentAtIndex:1 withDefault:@0 andClass:[NSNumber class]] longLongValue];
+    int64_t length = [[command argumentAtIndex:2 withDefault:@0 andClass:[NSNumber class]] longLongValue];
+    [self.commandDelegate runInBackground:^{
+        NSData *jpeg = nil;
+        CDVPluginResult *pluginResult;
+        if ([[MiSnapCaptureSpool sharedSpool] readCapture:handle jpeg:&jpeg results:NULL]) {
+            MiSnapSpoolChunk range = MiSnapSpoolChunkRange(jpeg.length, offset, length);
+            NSDictionary *chunk = @{ @"offset": @(range.offset), @"length": @(range.length), @"total": @(jpeg.length) };
+            pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsMultipart:@[[jpeg subdataWithRange:NSMakeRange(range.offset, range.length)], chunk]];
+        } else {
+            pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:@"No such capture"];
+        }
+        [self.commandDelegate sendPluginResult:pluginResult callbackId:command.callbackId];
+    }];
+}
+
+- (void) deleteCapture:(CDVInvokedUrlCommand *)command
+{
+    uint64_t handle = [[command argumentAtIndex:0 withDefault:@0 andClass:[NSNumber class]] unsignedLongLongValue];
+    [self.commandDelegate runInBackground:^{
+        CDVPluginResult *pluginResult;
+        if ([[MiSnapCaptureSpool sharedSpool] deleteCapture:handle]) {
+            pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK];
+        } else {
+            pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:@"No such capture"];
+        }
+        [self.commandDelegate sendPluginResult:pluginResult callbackId:command.callbackId];
+    }];
+}
+
+- (void) listCaptures:(CDVInvokedUrlCommand *)command
+{
+    [self.commandDelegate runInBackground:^{
+        NSArray *captures = [[MiSnapCaptureSpool sharedSpool] captures];
+        CDVPluginResult *pluginResult;
+        if (captures != nil) {
+            pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsArray:captures];
+        } else {
+            pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:@"Capture spool unavailable"];
+        }
+        [self.commandDelegate sendPluginResult:pluginResult callbackId:command.callbackId];
+    }];
+}
+
 #pragma mark -
 #pragma mark MiSnap Delegate methods
 
@@ -33,28 +682,361 @@
 
 - (void)miSnapFinishedReturningEncodedImage:(NSString *)encodedImage originalImage:(UIImage *)image andResults:(NSDictionary *)results {
     
-    CDVPluginResult *pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsString:@"Captured Image"];
+    MiSnapCaptureSession *session = [self capturingSession];
+    [session.frameAnalyzer stop];
+    //-1 when presenting was never stamped, which is no sample rather than an instant accept
+    double timeToAccept = MiSnapStartupMsSince(&_startup, MiSnapStartupPhasePresent);
+    if (timeToAccept >= 0) {
+        MiSnapMetricsRecordMs(MiSnapMetricTimeToAccept, timeToAccept);
+    }
+    [self countResultCode:results profile:session.profile];
+    //After the results, which carry the startup timings, have been built
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self startupEnded];
+    });
+    if (session == nil) {
+        return;
+    }
     
-    [self.commandDelegate sendPluginResult:pluginResult callbackId:self.cmd.callbackId];
+    if (session.batchDocumentTypes != nil) {
+        [self batchCaptureFinishedWithEncodedImage:encodedImage originalImage:image results:results session:session];
+        return;
+    }
     
-    /*Sent the image to the web layer from native layer
-     ....
-     ....
-     */
+    if ([session.resultType isEqualToString:kMiSnapPluginResultTypeArrayBuffer] || [session.resultType isEqualToString:kMiSnapPluginResultTypeHandle]) {
+        [self sendImageAsArrayBuffer:encodedImage originalImage:image results:results session:session];
+        [self sessionCaptured:session];
+        return;
+    }
     
+    CDVPluginResult *pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsString:@"Captured Image"];
+    
+    [self.commandDelegate sendPluginResult:pluginResult callbackId:session.callbackId];
+    [self sessionCaptured:session];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self finishSession:session];
+    });
 }
 
 //MiSnap Cancel delegate
 
 - (void)miSnapCancelledWithResults:(NSDictionary *)results {
     
-    CDVPluginResult *pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_NO_RESULT messageAsString:@"Cancelled"];
+    MiSnapCaptureSession *session = [self capturingSession];
+    [session.frameAnalyzer stop];
+    [self countResultCode:results profile:session.profile];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self startupEnded];
+    });
+    if (session == nil) {
+        return;
+    }
+    
+    CDVPluginResult *pluginResult;
+    if (session.batchDocumentTypes != nil) {
+        //A cancelled document ends the whole batch; captures staged so far are dropped, including
+        //any already written to the spool, whose handles the web layer never sees
+        NSMutableDictionary *cancellation = [NSMutableDictionary dictionary];
+        [cancellation setObject:[session.batchDocumentTypes objectAtIndex:session.batchCaptures.count] forKey:@"documentType"];
+        [cancellation setObject:@(session.batchCaptures.count) forKey:@"completed"];
+        [cancellation setObject:[self webSafeResults:results session:session] forKey:@"results"];
+        pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsDictionary:cancellation];
+        if ([session.resultType isEqualToString:kMiSnapPluginResultTypeHandle]) {
+            [self deleteSpooledBatchCaptures:session];
+        }
+    } else if ([session.resultType isEqualToString:kMiSnapPluginResultTypeArrayBuffer] || [session.resultType isEqualToString:kMiSnapPluginResultTypeHandle]) {
+        //Report cancellations with their results so the MIBI data can be forwarded to the server
+        pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsDictionary:[self webSafeResults:results session:session]];
+    } else {
+        pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_NO_RESULT messageAsString:@"Cancelled"];
+    }
     
-    [self.commandDelegate sendPluginResult:pluginResult callbackId:self.cmd.callbackId];
+    [self.commandDelegate sendPluginResult:pluginResult callbackId:session.callbackId];
+    //Queued behind startupEnded, like sessionCaptured
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self finishSession:session];
+    });
 }
 
+#pragma mark -
+#pragma mark Result delivery
 
+//Decodes the JPEG off the main thread and sends it as an ArrayBuffer followed by the results
+//dictionary, so the web layer never holds the multi-megabyte base64 string. With mibiEncoding
+//"compact" the MIBI data follows as a third ArrayBuffer. With resultType "handle" the capture is
+//stored in the spool instead and only its handle and results are sent.
 
-@end
+- (void)sendImageAsArrayBuffer:(NSString *)encodedImage originalImage:(UIImage *)image results:(NSDictionary *)results session:(MiSnapCaptureSession *)session {
+    
+    NSMutableDictionary *webResults = [[self webSafeResults:results session:session] mutableCopy];
+    BOOL spool = [session.resultType isEqualToString:kMiSnapPluginResultTypeHandle];
+    NSData *mibi = nil;
+    if (session.mibiWriter != nil && !spool) {
+        [self compactMIBIInResults:webResults writer:session.mibiWriter];
+        mibi = [session.mibiWriter takeData] ?: [NSData data];
+    }
+    MiSnapProfile profile = session.profile;
+    MiSnapFrameAnalyzer *frameAnalyzer = session.frameAnalyzer;
+    NSUInteger maxBytes = session.maxBytes;
+    NSUInteger targetWidth = session.targetWidth;
+    BOOL readMICR = session.readMICR;
+    NSString *callbackId = session.callbackId;
+    
+    [self.commandDelegate runInBackground:^{
+        NSData *jpeg = [self stageEncodedImage:encodedImage originalImage:image profile:profile frameAnalyzer:frameAnalyzer targetWidth:targetWidth maxBytes:maxBytes readMICR:readMICR results:webResults];
+        
+        uint64_t start = MiSnapMetricsNow();
+        CDVPluginResult *pluginResult;
+        if (spool) {
+            uint64_t handle = [[MiSnapCaptureSpool sharedSpool] appendJPEG:jpeg results:webResults];
+            if (handle != 0) {
+                pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:@{ @"handle": @(handle), @"bytes": @(jpeg.length), @"results": webResults }];
+            } else {
+                pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:@"Cannot store capture"];
+            }
+        } else {
+            pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsMultipart:mibi ? @[jpeg, webResults, mibi] : @[jpeg, webResults]];
+        }
+        [self.commandDelegate sendPluginResult:pluginResult callbackId:callbackId];
+        MiSnapMetricsRecordMs(MiSnapMetricDelivery, MiSnapMetricsMsSince(start));
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self finishSession:session];
+        });
+    }];
+}
 
+//Runs on a background queue: decodes the JPEG, or scales the original image to targetWidth
+//instead, re-encodes it to fit maxBytes if needed ("jpeg") and adds our own scoring of the
+//original image ("frameScore"), whether it looks like a recent capture ("duplicate"), the MICR line
+//of a check front if readMICR ("micr") and the live frame statistics ("frameAnalysis") to the results
 
+- (NSData *)stageEncodedImage:(NSString *)encodedImage originalImage:(UIImage *)image profile:(MiSnapProfile)profile frameAnalyzer:(MiSnapFrameAnalyzer *)frameAnalyzer targetWidth:(NSUInteger)targetWidth maxBytes:(NSUInteger)maxBytes readMICR:(BOOL)readMICR results:(NSMutableDictionary *)webResults {
+    
+    uint64_t start = MiSnapMetricsNow();
+    MiSnapFrameThresholds thresholds = MiSnapProfileThresholds(&profile);
+    NSData *jpeg = [MiSnapBase64 decodeString:encodedImage];
+    if (jpeg == nil) {
+        jpeg = [NSData data];
+    }
+    if (targetWidth > 0 && image != nil) {
+        CGImageRef scaled = [MiSnapImageScaler newImageByScalingImage:image toWidth:targetWidth];
+        if (scaled != NULL) {
+            double quality = MiSnapProfileValue(&profile, MiSnapProfileFieldImageQuality) / 100.0;
+            NSData *scaledJPEG = [MiSnapJPEGEncoder JPEGDataFromImage:scaled quality:quality orientation:[MiSnapImageScaler EXIFOrientationOfImage:image] metadataFrom:jpeg];
+            CGImageRelease(scaled);
+            if (scaledJPEG != nil) {
+                jpeg = scaledJPEG;
+            }
+        }
+    }
+    if (maxBytes > 0 && jpeg.length > 0) {
+        NSDictionary *report = nil;
+        jpeg = [MiSnapJPEGEncoder JPEGData:jpeg fittingBytes:maxBytes report:&report];
+        [webResults setObject:report forKey:@"jpeg"];
+    }
+    if (image != nil) {
+        __block MiSnapImageHash hash;
+        __block BOOL hashed = NO;
+        __block NSDictionary *micr = nil;
+        BOOL checkFront = readMICR && profile.kind == MiSnapDocumentKindCheckFront;
+        MiSnapFrameScore score = [MiSnapFrameScorer scoreImage:image analysis:^(const uint8_t *luma, size_t width, size_t height, size_t rowBytes) {
+            hashed = MiSnapImageHashLuma(luma, width, height, rowBytes, &hash);
+            if (checkFront) {
+                micr = [MiSnapMICRReader readLuma:luma width:width height:height rowBytes:rowBytes];
+            }
+        }];
+        NSMutableDictionary *frameScore = [[MiSnapFrameScorer dictionaryFromScore:score] mutableCopy];
+        [frameScore setObject:@(MiSnapFrameScorePasses(&score, &thresholds)) forKey:@"passes"];
+        [webResults setObject:frameScore forKey:@"frameScore"];
+        if (hashed) {
+            [webResults setObject:[[MiSnapDuplicateIndex sharedIndex] checkHash:&hash tag:(uint32_t)profile.kind] forKey:@"duplicate"];
+        }
+        if (checkFront) {
+            [webResults setObject:micr ?: [NSNull null] forKey:@"micr"];
+        }
+    }
+    if (frameAnalyzer != nil) {
+        [webResults setObject:[frameAnalyzer statistics] forKey:@"frameAnalysis"];
+    }
+    MiSnapMetricsRecordMs(MiSnapMetricEncode, MiSnapMetricsMsSince(start));
+    return jpeg;
+}
+
+#pragma mark -
+#pragma mark Batch capture
+
+- (void)batchCaptureFinishedWithEncodedImage:(NSString *)encodedImage originalImage:(UIImage *)image results:(NSDictionary *)results session:(MiSnapCaptureSession *)session {
+    
+    NSUInteger index = session.batchCaptures.count;
+    NSMutableDictionary *webResults = [[self webSafeResults:results session:session] mutableCopy];
+    if (session.mibiWriter != nil) {
+        [self compactMIBIInResults:webResults writer:session.mibiWriter];
+    }
+    NSMutableDictionary *capture = [NSMutableDictionary dictionaryWithObjectsAndKeys:[session.batchDocumentTypes objectAtIndex:index], @"documentType", webResults, @"results", nil];
+    [session.batchCaptures addObject:capture];
+    [session.batchImages addObject:[NSData data]];
+    
+    //Stage this document while the next one is being captured
+    NSMutableArray *images = session.batchImages;
+    MiSnapProfile profile = session.profile;
+    MiSnapFrameAnalyzer *frameAnalyzer = session.frameAnalyzer;
+    NSUInteger maxBytes = session.maxBytes;
+    NSUInteger targetWidth = session.targetWidth;
+    BOOL readMICR = session.readMICR;
+    BOOL spool = [session.resultType isEqualToString:kMiSnapPluginResultTypeHandle];
+    dispatch_group_async(session.batchGroup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        NSData *jpeg = [self stageEncodedImage:encodedImage originalImage:image profile:profile frameAnalyzer:frameAnalyzer targetWidth:targetWidth maxBytes:maxBytes readMICR:readMICR results:webResults];
+        @synchronized (images) {
+            if (spool) {
+                uint64_t handle = [[MiSnapCaptureSpool sharedSpool] appendJPEG:jpeg results:webResults];
+                [capture setObject:handle != 0 ? @(handle) : [NSNull null] forKey:@"handle"];
+                if (handle == 0) {
+                    [capture setObject:@"Cannot store capture" forKey:@"error"];
+                }
+            } else {
+                [images replaceObjectAtIndex:index withObject:jpeg];
+            }
+        }
+    });
+    
+    if (index + 1 < session.batchDocumentTypes.count) {
+        MiSnapProfile nextProfile = [session batchProfileAtIndex:index + 1];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self presentMiSnapWhenIdleForSession:session withProfile:nextProfile];
+        });
+        return;
+    }
+    
+    //Last document: one consolidated result once every image has been staged. The captures
+    //array comes first, followed by one ArrayBuffer per capture in the same order (none when the
+    //captures were spooled, each capture has a handle instead) and, with mibiEncoding "compact",
+    //by the MIBI data of every capture as one stream.
+    NSArray *captures = session.batchCaptures;
+    NSData *mibi = session.mibiWriter != nil ? [session.mibiWriter takeData] ?: [NSData data] : nil;
+    NSString *callbackId = session.callbackId;
+    [self sessionCaptured:session];
+    dispatch_group_notify(session.batchGroup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        NSMutableArray *messages = [NSMutableArray arrayWithObject:captures];
+        @synchronized (images) {
+            if (!spool) {
+                [messages addObjectsFromArray:images];
+            }
+        }
+        if (mibi != nil) {
+            [messages addObject:mibi];
+        }
+        uint64_t start = MiSnapMetricsNow();
+        CDVPluginResult *pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsMultipart:messages];
+        [self.commandDelegate sendPluginResult:pluginResult callbackId:callbackId];
+        MiSnapMetricsRecordMs(MiSnapMetricDelivery, MiSnapMetricsMsSince(start));
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self finishSession:session];
+        });
+    });
+}
+
+//Deletes the spooled captures of a cancelled batch once the ones still being staged are written
+
+- (void)deleteSpooledBatchCaptures:(MiSnapCaptureSession *)session {
+    
+    NSArray *captures = session.batchCaptures;
+    NSMutableArray *images = session.batchImages;
+    dispatch_group_notify(session.batchGroup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        @synchronized (images) {
+            for (NSDictionary *capture in captures) {
+                id handle = [capture objectForKey:@"handle"];
+                if ([handle isKindOfClass:[NSNumber class]]) {
+                    [[MiSnapCaptureSpool sharedSpool] deleteCapture:[handle unsignedLongLongValue]];
+                }
+            }
+        }
+    });
+}
+
+#pragma mark -
+#pragma mark Result helpers
+
+//Counts the outcome of a capture. A still-camera result is a failover unless the capture was
+//started in manual mode.
+
+- (void)countResultCode:(NSDictionary *)results profile:(MiSnapProfile)profile {
+    
+#if(__i386__ ||__x86_64__)
+    //Nothing to do here, we are on simulator
+#else
+    NSString *resultCode = [results objectForKey:kMiSnapResultCode];
+    if ([resultCode isEqualToString:kMiSnapResultSuccessVideo] || [resultCode isEqualToString:kMiSnapResultSuccessPDF417] || [resultCode isEqualToString:kMiSnapResultSuccessCreditCard]) {
+        MiSnapMetricsIncrement(MiSnapCounterCaptures);
+    } else if ([resultCode isEqualToString:kMiSnapResultSuccessStillCamera]) {
+        MiSnapMetricsIncrement(MiSnapCounterCaptures);
+        if (MiSnapProfileValue(&profile, MiSnapProfileFieldCaptureMode) >= 2) {
+            MiSnapMetricsIncrement(MiSnapCounterFailovers);
+        }
+    } else if ([resultCode isEqualToString:kMiSnapResultVideoCaptureFailed]) {
+        MiSnapMetricsIncrement(MiSnapCounterTimeouts);
+    } else if ([resultCode isEqualToString:kMiSnapResultCameraNotSufficient]) {
+        MiSnapMetricsIncrement(MiSnapCounterCameraNotSufficient);
+    } else {
+        MiSnapMetricsIncrement(MiSnapCounterCancellations);
+    }
+#endif
+}
+
+//Results values are documented as strings; anything else is described so it survives JSON
+//serialization. "session" gives how long the session waited for the camera and has been capturing.
+
+- (NSDictionary *)webSafeResults:(NSDictionary *)results session:(MiSnapCaptureSession *)session {
+    
+    NSMutableDictionary *webResults = [NSMutableDictionary dictionaryWithCapacity:results.count];
+    [results enumerateKeysAndObjectsUsingBlock:^(id key, id value, BOOL *stop) {
+        if ([value isKindOfClass:[NSString class]] || [value isKindOfClass:[NSNumber class]]) {
+            [webResults setObject:value forKey:[key description]];
+        } else {
+            [webResults setObject:[value description] forKey:[key description]];
+        }
+    }];
+    [self addAAMVAFieldsToResults:webResults];
+    [webResults setObject:MiSnapStartupDictionary(&_startup) forKey:@"startup"];
+    MiSnapSessionTiming timing;
+    if (MiSnapSessionGetTiming(&_sessionTable, [session.callbackId UTF8String], MiSnapPluginNowMs(), &timing)) {
+        [webResults setObject:@{ @"queuedMs": @(timing.queuedMs), @"captureMs": @(timing.captureMs) } forKey:@"session"];
+    }
+    return webResults;
+}
+
+//Moves the MIBI JSON into the session's writer, to be sent as binary next to the results, and
+//reports the JSON size and the bytes its record took in "mibiBytes" so the saving can be tracked
+
+- (void)compactMIBIInResults:(NSMutableDictionary *)webResults writer:(MiSnapMIBIWriter *)writer {
+    
+#if(__i386__ ||__x86_64__)
+    //Nothing to do here, we are on simulator
+#else
+    NSString *mibi = [webResults objectForKey:kMiSnapMIBIData];
+    if (![mibi isKindOfClass:[NSString class]]) {
+        return;
+    }
+    NSUInteger compact = [writer appendMIBIString:mibi];
+    
+    [webResults removeObjectForKey:kMiSnapMIBIData];
+    [webResults setObject:@{ @"json": @([mibi lengthOfBytesUsingEncoding:NSUTF8StringEncoding]), @"compact": @(compact) } forKey:@"mibiBytes"];
+#endif
+}
+
+//Adds the fields of a driver's license barcode ("aamva") next to the raw PDF417 data
+
+- (void)addAAMVAFieldsToResults:(NSMutableDictionary *)webResults {
+    
+#if(__i386__ ||__x86_64__)
+    //Nothing to do here, we are on simulator
+#else
+    NSDictionary *fields = [MiSnapAAMVA fieldsFromPDF417String:[webResults objectForKey:kMiSnapPDF417Data]];
+    if (fields != nil) {
+        [webResults setObject:fields forKey:@"aamva"];
+    }
+#endif
+}
+
+
+
+@end
@@ -0,0 +1,19 @@
+
+#import <Foundation/Foundation.h>
+
+#import "MiSnapProfileCore.h"
+#import "MiSnapFrameScorer.h"
+
+//The default profile for a web layer document type such as @"CheckFront", or NULL if it is not a
+//known document type name
+const MiSnapProfile *MiSnapProfileForDocumentType(id documentType);
+
+//Applies overrides keyed by field name (e.g. @{ @"sharpness": @700 }). Returns NO and leaves the
+//profile untouched if a name is unknown, a value is not a whole number within its range or
+//maxBrightness ends up below brightness.
+BOOL MiSnapProfileApplyOverrides(MiSnapProfile *profile, NSDictionary *overrides, NSString **error);
+
+//The SDK parameter dictionary: the SDK's own defaults for the document type, which are built once
+//and copied, plus every field that was given as an override, even when it equals the default
+//profile's value. Empty on the simulator.
+NSMutableDictionary *MiSnapProfileParameters(const MiSnapProfile *profile);
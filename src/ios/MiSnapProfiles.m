@@ -0,0 +1,99 @@
+
+#import "MiSnapProfiles.h"
+#import "MiSnap.h"
+
+const MiSnapProfile *MiSnapProfileForDocumentType(id documentType)
+{
+    if (![documentType isKindOfClass:[NSString class]]) {
+        return NULL;
+    }
+    return MiSnapProfileNamed([documentType UTF8String]);
+}
+
+BOOL MiSnapProfileApplyOverrides(MiSnapProfile *profile, NSDictionary *overrides, NSString **error)
+{
+    MiSnapProfile updated = *profile;
+    for (id key in overrides) {
+        MiSnapProfileField field = [key isKindOfClass:[NSString class]] ? MiSnapProfileFieldNamed([key UTF8String]) : MiSnapProfileFieldCount;
+        if (field == MiSnapProfileFieldCount) {
+            if (error) *error = [NSString stringWithFormat:@"Unknown parameter %@", key];
+            return NO;
+        }
+        id value = [overrides objectForKey:key];
+        const MiSnapProfileFieldRange *range = MiSnapProfileFieldRangeOf(field);
+        if (![value isKindOfClass:[NSNumber class]] || !MiSnapProfileSetValue(&updated, field, [value doubleValue])) {
+            if (error) *error = [NSString stringWithFormat:@"Invalid %s %@ (range %d-%d)", range->name, value, range->min, range->max];
+            return NO;
+        }
+    }
+    if (!MiSnapProfileConsistent(&updated)) {
+        if (error) *error = @"maxBrightness must not be below brightness";
+        return NO;
+    }
+    *profile = updated;
+    return YES;
+}
+
+#if(__i386__ ||__x86_64__)
+//Nothing to do here, libMiSnap.a has no simulator slices
+NSMutableDictionary *MiSnapProfileParameters(const MiSnapProfile *profile)
+{
+    return [NSMutableDictionary dictionary];
+}
+#else
+
+static NSString *MiSnapProfileFieldKey(MiSnapProfileField field)
+{
+    switch (field) {
+        case MiSnapProfileFieldCaptureMode: return kMiSnapCaptureMode;
+        case MiSnapProfileFieldAutoCaptureFailover: return kMiSnapAutoCaptureFailoverToStillCapture;
+        case MiSnapProfileFieldMinHorizontalFill: return kMiSnapViewfinderMinHorizontalFill;
+        case MiSnapProfileFieldUnnecessaryTouchLimit: return kMiSnapUnnecessaryScreenTouchLimit;
+        case MiSnapProfileFieldInitialTimeout: return kMiSnapInitialTimeout;
+        case MiSnapProfileFieldTimeout: return kMiSnapTimeout;
+        case MiSnapProfileFieldMaxTimeouts: return kMiSnapMaxTimeouts;
+        case MiSnapProfileFieldImageQuality: return kMiSnapImageQuality;
+        case MiSnapProfileFieldBrightness: return kMiSnapBrightness;
+        case MiSnapProfileFieldMaxBrightness: return kMiSnapMaxBrightness;
+        case MiSnapProfileFieldSharpness: return kMiSnapSharpness;
+        case MiSnapProfileFieldAngle: return kMiSnapAngle;
+        case MiSnapProfileFieldTorchMode: return kMiSnapTorchMode;
+        default: return nil;
+    }
+}
+
+//The SDK rebuilds these dictionaries on every call, so they are built once and copied
+static NSDictionary *MiSnapSDKDefaults(MiSnapDocumentKind kind)
+{
+    static NSDictionary *defaults[MiSnapDocumentKindCount];
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        defaults[MiSnapDocumentKindACH] = [[MiSnapViewController defaultParametersForACH] copy];
+        defaults[MiSnapDocumentKindCheckFront] = [[MiSnapViewController defaultParametersForCheckFront] copy];
+        defaults[MiSnapDocumentKindCheckBack] = [[MiSnapViewController defaultParametersForCheckBack] copy];
+        defaults[MiSnapDocumentKindRemittance] = [[MiSnapViewController defaultParametersForRemittance] copy];
+        defaults[MiSnapDocumentKindBalanceTransfer] = [[MiSnapViewController defaultParametersForBalanceTransfer] copy];
+        defaults[MiSnapDocumentKindW2] = [[MiSnapViewController defaultParametersForW2] copy];
+        defaults[MiSnapDocumentKindDriversLicense] = [[MiSnapViewController defaultParametersForDriversLicense] copy];
+        defaults[MiSnapDocumentKindLandscapeDocument] = [[MiSnapViewController defaultParametersForLandscapeDocument] copy];
+        //The SDK has no PDF417 defaults: the barcode on the back of a license is read with the
+        //license parameters
+        NSMutableDictionary *pdf417 = [MiSnapViewController defaultParametersForDriversLicense];
+        [pdf417 setObject:kMiSnapDocumentTypePDF417 forKey:kMiSnapDocumentType];
+        defaults[MiSnapDocumentKindPDF417] = [pdf417 copy];
+    });
+    return defaults[kind];
+}
+
+NSMutableDictionary *MiSnapProfileParameters(const MiSnapProfile *profile)
+{
+    NSMutableDictionary *parameters = [MiSnapSDKDefaults(profile->kind) mutableCopy];
+    for (int field = 0; field < MiSnapProfileFieldCount; field++) {
+        if (MiSnapProfileIsSet(profile, field)) {
+            [parameters setObject:[NSString stringWithFormat:@"%d", profile->values[field]] forKey:MiSnapProfileFieldKey(field)];
+        }
+    }
+    return parameters;
+}
+
+#endif
@@ -0,0 +1,10 @@
+
+#import <Foundation/Foundation.h>
+#import "MiSnapQuadCore.h"
+
+@interface MiSnapQuadDetector : NSObject
+
+//{ found, corners: [[x, y] x 4], angle, padding }, or { found: false }
++ (NSDictionary *)dictionaryFromQuad:(const MiSnapQuad *)quad;
+
+@end
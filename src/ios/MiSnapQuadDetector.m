@@ -0,0 +1,21 @@
+
+#import "MiSnapQuadDetector.h"
+
+@implementation MiSnapQuadDetector
+
++ (NSDictionary *)dictionaryFromQuad:(const MiSnapQuad *)quad {
+    
+    if (!quad->found) {
+        return @{ @"found": @NO };
+    }
+    NSMutableArray *corners = [NSMutableArray arrayWithCapacity:4];
+    for (int corner = 0; corner < 4; corner++) {
+        [corners addObject:@[@(lroundf(quad->corners[corner].x)), @(lroundf(quad->corners[corner].y))]];
+    }
+    return @{ @"found": @YES,
+              @"corners": corners,
+              @"angle": @(quad->angle),
+              @"padding": @(quad->padding) };
+}
+
+@end
@@ -0,0 +1,8 @@
+
+#import <Foundation/Foundation.h>
+
+#import "MiSnapStartupCore.h"
+
+//{ state, prewarmed, phases: { parametersMs, controllerMs, setupMs, viewMs, presentMs, firstFrameMs } }
+//with only the finished phases
+NSDictionary *MiSnapStartupDictionary(const MiSnapStartupTimeline *timeline);
@@ -0,0 +1,19 @@
+
+#import "MiSnapStartup.h"
+
+NSDictionary *MiSnapStartupDictionary(const MiSnapStartupTimeline *timeline)
+{
+    static NSString *const phaseNames[MiSnapStartupPhaseCount] = {
+        @"parametersMs", @"controllerMs", @"setupMs", @"viewMs", @"presentMs", @"firstFrameMs"
+    };
+    static NSString *const stateNames[] = { @"cold", @"warm", @"presenting", @"capturing" };
+    
+    NSMutableDictionary *phases = [NSMutableDictionary dictionary];
+    for (int phase = 0; phase < MiSnapStartupPhaseCount; phase++) {
+        double ms = MiSnapStartupPhaseMs(timeline, phase);
+        if (ms >= 0) {
+            [phases setObject:@(ms) forKey:phaseNames[phase]];
+        }
+    }
+    return @{ @"state": stateNames[timeline->state], @"prewarmed": @(timeline->prewarmed), @"phases": phases };
+}
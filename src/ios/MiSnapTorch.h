@@ -0,0 +1,5 @@
+#import <Foundation/Foundation.h>
+#import "MiSnapTorchCore.h"
+
+//{ mode, torch, brightness, ambient, torchGain, frames, switches }
+NSDictionary *MiSnapTorchDictionary(const MiSnapTorchEstimator *estimator);
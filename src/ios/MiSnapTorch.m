@@ -0,0 +1,13 @@
+#import "MiSnapTorch.h"
+
+NSDictionary *MiSnapTorchDictionary(const MiSnapTorchEstimator *estimator)
+{
+    static NSString *const modes[] = { @"off", @"auto", @"on", @"autoDriversLicense" };
+    return @{ @"mode": modes[estimator->mode],
+              @"torch": @(estimator->torch),
+              @"brightness": @(estimator->brightness),
+              @"ambient": @(estimator->ambient),
+              @"torchGain": @(estimator->torchGain),
+              @"frames": @(estimator->frames),
+              @"switches": @(estimator->switches) };
+}
@@ -1,9 +1,121 @@
 module.exports = {
-captureCheckFront: function(success, fail) {
+captureCheckFront: function(success, fail, options) {
     cordova.exec(success,
                  fail,
                  "MiSnapPlugin",
                  "cordovaCallMiSnap",
+                 [options || {}]);
+},
+captureBatch: function(documentTypes, success, fail, options) {
+    //The native result is the captures array followed by one ArrayBuffer per capture, or by
+    //nothing when the captures were stored and carry a handle instead, and with mibiEncoding
+    //"compact" by one ArrayBuffer with the MIBI data of every capture
+    var compact = !!options && options.mibiEncoding === "compact";
+    cordova.exec(function(captures) {
+                     var images = Array.prototype.slice.call(arguments, 1);
+                     var mibi = compact ? images.pop() : undefined;
+                     captures.forEach(function(capture, i) {
+                         if (i < images.length) {
+                             capture.image = images[i];
+                         }
+                     });
+                     success(captures, mibi);
+                 },
+                 fail,
+                 "MiSnapPlugin",
+                 "captureBatch",
+                 [documentTypes, options || {}]);
+},
+prewarm: function(documentType, success, fail, options) {
+    cordova.exec(success,
+                 fail,
+                 "MiSnapPlugin",
+                 "prewarm",
+                 [documentType || "CheckFront", options || {}]);
+},
+getMetrics: function(success, fail, options) {
+    cordova.exec(success,
+                 fail,
+                 "MiSnapPlugin",
+                 "getMetrics",
+                 [options || {}]);
+},
+watchQuality: function(onEvent, fail, options) {
+    cordova.exec(onEvent,
+                 fail,
+                 "MiSnapPlugin",
+                 "watchQuality",
+                 [options || {}]);
+},
+clearQualityWatch: function(success, fail) {
+    cordova.exec(success,
+                 fail,
+                 "MiSnapPlugin",
+                 "clearQualityWatch",
+                 []);
+},
+replayFrames: function(options, success, fail) {
+    cordova.exec(success,
+                 fail,
+                 "MiSnapPlugin",
+                 "replayFrames",
+                 [options]);
+},
+benchmark: function(success, fail, options) {
+    cordova.exec(success,
+                 fail,
+                 "MiSnapPlugin",
+                 "benchmark",
+                 [options || {}]);
+},
+readCapture: function(handle, success, fail) {
+    cordova.exec(success,
+                 fail,
+                 "MiSnapPlugin",
+                 "readCapture",
+                 [handle]);
+},
+readCaptureChunk: function(handle, offset, length, success, fail) {
+    cordova.exec(success,
+                 fail,
+                 "MiSnapPlugin",
+                 "readCaptureChunk",
+                 [handle, offset, length]);
+},
+streamCapture: function(handle, onChunk, success, fail, options) {
+    //Pulls the JPEG one chunk at a time; the next chunk is only requested once onChunk returns,
+    //so at most one chunk is in flight on either side of the bridge
+    var chunkSize = (options && options.chunkSize) || 256 * 1024;
+    var startTime = Date.now(), firstChunkMs;
+    var readFrom = function(offset) {
+        module.exports.readCaptureChunk(handle, offset, chunkSize, function(data, chunk) {
+            if (firstChunkMs === undefined) {
+                firstChunkMs = Date.now() - startTime;
+            }
+            if (chunk.length > 0) {
+                onChunk(data, chunk);
+            }
+            if (chunk.length === 0 || chunk.offset + chunk.length >= chunk.total) {
+                success({ total: chunk.total, firstChunkMs: firstChunkMs, totalMs: Date.now() - startTime });
+            } else {
+                readFrom(chunk.offset + chunk.length);
+            }
+        }, fail);
+    };
+    readFrom(0);
+},
+deleteCapture: function(handle, success, fail) {
+    cordova.exec(success,
+                 fail,
+                 "MiSnapPlugin",
+                 "deleteCapture",
+                 [handle]);
+},
+listCaptures: function(success, fail) {
+    cordova.exec(success,
+                 fail,
+                 "MiSnapPlugin",
+                 "listCaptures",
                  []);
 }
 };
\ No newline at end of file